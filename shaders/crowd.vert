@@ -0,0 +1,83 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform CameraUBO {
+    mat4 proj_view;
+} camera_ubo;
+
+struct BakedClip {
+    uint first_frame;
+    uint frame_count;
+    float frame_rate;
+    float duration;
+};
+
+struct CrowdInstance {
+    mat4 model;
+    uint clip;
+    float time_offset;
+    float speed;
+    float padding;
+};
+
+// Three rows of the affine joint matrix per joint, joint_count joints per frame.
+layout(std430, set = 2, binding = 0) readonly buffer FrameBuffer {
+    vec4 rows[];
+} frame_buf;
+
+layout(std430, set = 2, binding = 1) readonly buffer ClipBuffer {
+    BakedClip clips[];
+} clip_buf;
+
+layout(std430, set = 2, binding = 2) readonly buffer InstanceBuffer {
+    CrowdInstance instances[];
+} instance_buf;
+
+// The pbr constants before offset 104 are read by pbr.frag.
+layout(push_constant) uniform PCO {
+    layout(offset = 104) float time;
+    uint joint_count;
+} pco;
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 uv;
+layout(location = 3) in vec4 joint;
+layout(location = 4) in vec4 weight;
+layout(location = 5) in vec4 color; 
+
+layout(location = 0) out vec3 out_normal;
+layout(location = 1) out vec2 out_uv;
+layout(location = 2) out vec3 frag_uvw;
+layout(location = 5) out vec4 out_color;
+
+mat4 get_joint_M(uint frame, uint joint_id) {
+    uint row = (frame * pco.joint_count + joint_id) * 3;
+    return transpose(mat4(frame_buf.rows[row], frame_buf.rows[row + 1], frame_buf.rows[row + 2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+mat4 get_skin_M(uint frame) {
+    return weight.x * get_joint_M(frame, uint(joint.x)) +
+    weight.y * get_joint_M(frame, uint(joint.y)) +
+    weight.z * get_joint_M(frame, uint(joint.z)) +
+    weight.w * get_joint_M(frame, uint(joint.w));
+}
+
+void main() {
+    CrowdInstance instance = instance_buf.instances[gl_InstanceIndex];
+    BakedClip clip = clip_buf.clips[instance.clip];
+
+    // Loop the instance's time over the clip and blend the two baked frames around it.
+    float time = clip.duration > 0.0 ? mod(pco.time * instance.speed + instance.time_offset, clip.duration) : 0.0;
+    float frame = time * clip.frame_rate;
+    uint frame_0 = min(uint(frame), clip.frame_count - 1);
+    uint frame_1 = min(frame_0 + 1, clip.frame_count - 1);
+    float blend = fract(frame);
+    mat4 skin_M = (1.0 - blend) * get_skin_M(clip.first_frame + frame_0) + blend * get_skin_M(clip.first_frame + frame_1);
+
+    mat4 model = instance.model * skin_M;
+    gl_Position = camera_ubo.proj_view * model * vec4(position, 1.0);
+    out_normal = normalize(transpose(inverse(mat3(model))) * normal);
+    frag_uvw = vec3(instance.model * vec4(position, 1.0));
+    out_uv = uv;
+    out_color = color;
+}
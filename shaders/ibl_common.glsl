@@ -1,16 +1,23 @@
-#version 450
-
-layout (location = 0) in vec3 frag_uvw;
-layout (location = 0) out vec4 out_color;
-
-layout (binding = 0) uniform samplerCube env_cube;
-
-layout(push_constant) uniform PCO {
-	layout (offset = 64) float roughness;
-} pco;
+// Helpers shared by the IBL bake shaders.
 
 const float PI = 3.1415926536;
-const uint NUM_SAMPLES = 32; 
+
+// Direction through the center of a texel of a cube face. texel.z is the face, in Vulkan's order: +X, -X, +Y, -Y, +Z, -Z.
+// Sampling a cube map with the direction returns that texel.
+vec3 cube_dir(ivec3 texel, ivec2 size)
+{
+	vec2 uv = (vec2(texel.xy) + 0.5) / vec2(size) * 2.0 - 1.0;
+	vec3 dir;
+	switch (texel.z) {
+		case 0: dir = vec3(1.0, -uv.y, -uv.x); break;
+		case 1: dir = vec3(-1.0, -uv.y, uv.x); break;
+		case 2: dir = vec3(uv.x, 1.0, uv.y); break;
+		case 3: dir = vec3(uv.x, -1.0, -uv.y); break;
+		case 4: dir = vec3(uv.x, -uv.y, 1.0); break;
+		default: dir = vec3(-uv.x, -uv.y, -1.0); break;
+	}
+	return normalize(dir);
+}
 
 // Based omn http://byteblacksmith.com/improvements-to-the-canonical-one-liner-glsl-rand-for-opengl-es-2-0/
 float random(vec2 co)
@@ -39,9 +46,9 @@ vec2 hammersley2d(uint i, uint N)
 vec3 importance_sample_GGX(vec2 Xi, float roughness, vec3 normal) 
 {
 	// Maps a 2D point to a hemisphere with spread based on roughness
-	float a = roughness * roughness;
+	float alpha = roughness * roughness;
 	float phi = 2.0 * PI * Xi.x + random(normal.xz) * 0.1;
-	float cos_theta = sqrt((1.0 - Xi.y) / (1.0 + (a*a - 1.0) * Xi.y));
+	float cos_theta = sqrt((1.0 - Xi.y) / (1.0 + (alpha*alpha - 1.0) * Xi.y));
 	float sin_theta = sqrt(1.0 - cos_theta * cos_theta);
 
 	// Spherical to cartesian
@@ -65,43 +72,11 @@ float D_GGX(float dotNH, float roughness)
 	return (alpha2)/(PI * denom*denom); 
 }
 
-vec3 prefilter_env_map(vec3 R, float roughness)
+// Geometric Shadowing function
+float G_SchlicksmithGGX(float dotNL, float dotNV, float roughness)
 {
-	vec3 N = R;
-	vec3 V = R;
-	vec3 color = vec3(0.0);
-	float total_weight = 0.0;
-	float env_map_dim = float(textureSize(env_cube, 0).s);
-	for(uint i = 0u; i < NUM_SAMPLES; i++) {
-		vec2 Xi = hammersley2d(i, NUM_SAMPLES);
-		vec3 H = importance_sample_GGX(Xi, roughness, N);
-		vec3 L = 2.0 * dot(V, H) * H - V;
-		float dotNL = clamp(dot(N, L), 0.0, 1.0);
-		if(dotNL > 0.0) {
-			// Filtering based on https://placeholderart.wordpress.com/2015/07/28/implementation-notes-runtime-environment-map-filtering-for-image-based-lighting/
-
-			float dotNH = clamp(dot(N, H), 0.0, 1.0);
-			float dotVH = clamp(dot(V, H), 0.0, 1.0);
-
-			// Probability Distribution Function
-			float pdf = D_GGX(dotNH, roughness) * dotNH / (4.0 * dotVH) + 0.0001;
-			// Solid angle of current smple
-			float omegaS = 1.0 / (float(NUM_SAMPLES) * pdf);
-			// Solid angle of 1 pixel across all cube faces
-			float omegaP = 4.0 * PI / (6.0 * env_map_dim * env_map_dim);
-			// Biased (+1.0) mip level for better result
-			float mip_level = roughness == 0.0 ? 0.0 : max(0.5 * log2(omegaS / omegaP) + 1.0, 0.0f);
-			color += textureLod(env_cube, L, mip_level).rgb * dotNL;
-			total_weight += dotNL;
-
-		}
-	}
-	return (color / total_weight);
+	float k = (roughness * roughness) / 2.0;
+	float GL = dotNL / (dotNL * (1.0 - k) + k);
+	float GV = dotNV / (dotNV * (1.0 - k) + k);
+	return GL * GV;
 }
-
-
-void main()
-{		
-	vec3 N = normalize(frag_uvw);
-	out_color = vec4(prefilter_env_map(N, pco.roughness), 1.0);
-}
\ No newline at end of file
@@ -1,18 +1,19 @@
 #version 450
 
-const int MAX_NUM_JOINTS = 256;
+const uint NO_JOINT_OFFSET = 0xFFFFFFFFu;
 
 layout(binding = 0) uniform CameraUBO {
     mat4 proj_view;
 } camera_ubo;
 
-layout(binding = 1) uniform JointUBO {
-    mat4 M[MAX_NUM_JOINTS];
-    float is_skinned;
-} joint_ubo;
+// The joint matrices of every skin in the scene. A skinned draw's matrices start at its joint offset.
+layout(std430, binding = 1) readonly buffer JointBuffer {
+    mat4 M[];
+} joint_buf;
 
 layout(push_constant) uniform PCO {
     mat4 model;
+    layout(offset = 100) uint joint_offset;
 } pco;
 
 layout(location = 0) in vec3 position;
@@ -28,11 +29,11 @@ layout(location = 2) out vec3 frag_uvw;
 layout(location = 5) out vec4 out_color;
 
 void main() {
-    if (joint_ubo.is_skinned > 0) {
-    mat4 skin_M = weight.x * joint_ubo.M[int(joint.x)] + 
-    weight.y * joint_ubo.M[int(joint.y)] + 
-    weight.z * joint_ubo.M[int(joint.z)] + 
-    weight.w * joint_ubo.M[int(joint.w)];
+    if (pco.joint_offset != NO_JOINT_OFFSET) {
+    mat4 skin_M = weight.x * joint_buf.M[pco.joint_offset + uint(joint.x)] + 
+    weight.y * joint_buf.M[pco.joint_offset + uint(joint.y)] + 
+    weight.z * joint_buf.M[pco.joint_offset + uint(joint.z)] + 
+    weight.w * joint_buf.M[pco.joint_offset + uint(joint.w)];
     gl_Position = camera_ubo.proj_view * pco.model * skin_M * vec4(position, 1.0);
     out_normal = normalize(transpose(inverse(mat3(pco.model * skin_M))) * normal);
 
@@ -0,0 +1,6 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// pbr.frag with the irradiance evaluated from spherical harmonics. See PBRBaker::bake_irradiance_sh().
+#define SH_IRRADIANCE
+#include "pbr_common.glsl"
@@ -0,0 +1,173 @@
+#include "animation_baker.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <unordered_set>
+
+#include "common/logging.hpp"
+#include "common/utils.hpp"
+#include "core/device.hpp"
+#include "core/device_memory/allocator.hpp"
+#include "core/device_memory/buffer.hpp"
+#include "core/upload_batch.hpp"
+#include "scene_graph/components/skin.hpp"
+#include "scene_graph/node.hpp"
+#include "scene_graph/scene.hpp"
+#include "scene_graph/scripts/animation.hpp"
+#include "scene_graph/scripts/animation_clip.hpp"
+#include "scene_graph/scripts/pose.hpp"
+
+namespace W3D
+{
+
+const float AnimationBaker::DEFAULT_FRAME_RATE = 30.0f;
+
+AnimationBaker::AnimationBaker(Device &device, sg::Scene &scene, float frame_rate) :
+    device_(device),
+    scene_(scene),
+    frame_rate_(frame_rate)
+{
+}
+
+// Bake the clips of the node's skin and upload them.
+std::unique_ptr<sg::Crowd> AnimationBaker::bake(sg::Node &node)
+{
+	sg::Skin                    &skin         = node.get_component<sg::Skin>();
+	std::vector<sg::Animation *> p_animations = find_animations(skin);
+	std::unique_ptr<sg::Crowd>   p_crowd      = std::make_unique<sg::Crowd>(node, node.get_name());
+	p_crowd->joint_count_                     = to_u32(skin.get_joint_count());
+	joint_Ms_.resize(skin.get_joint_count());
+	frame_rows_.clear();
+
+	// Gather every node the clips animate, so that the pose they are in now can be put back.
+	std::vector<sg::Node *>        p_nodes;
+	std::unordered_set<sg::Node *> p_seen_nodes;
+	for (sg::Animation *p_animation : p_animations)
+	{
+		for (sg::Node *p_clip_node : p_animation->get_clip().get_nodes())
+		{
+			if (p_seen_nodes.insert(p_clip_node).second)
+			{
+				p_nodes.push_back(p_clip_node);
+			}
+		}
+	}
+	sg::Pose rest_pose;
+	rest_pose.init(p_nodes);
+	std::fill(rest_pose.written.begin(), rest_pose.written.end(), sg::POSE_TRANSLATION | sg::POSE_ROTATION | sg::POSE_SCALE);
+
+	for (sg::Animation *p_animation : p_animations)
+	{
+		// Targets a clip doesn't animate keep their rest values instead of those of the clip baked before it.
+		rest_pose.commit();
+		p_crowd->clip_names_.push_back(p_animation->get_name());
+		bake_clip(skin, p_animation->get_clip(), *p_crowd);
+	}
+	rest_pose.commit();
+	scene_.update_transforms();
+
+	if (p_animations.empty())
+	{
+		p_crowd->clip_names_.push_back("rest");
+		p_crowd->clips_.push_back({
+		    .first_frame = 0,
+		    .frame_count = 1,
+		    .frame_rate  = 0.0f,
+		    .duration    = 0.0f,
+		});
+		bake_frame(skin);
+	}
+
+	UploadBatch batch(device_);
+	p_crowd->p_frame_buf_ = upload_storage_buffer(frame_rows_.data(), frame_rows_.size() * sizeof(glm::vec4), batch);
+	p_crowd->p_clip_buf_  = upload_storage_buffer(p_crowd->clips_.data(), p_crowd->clips_.size() * sizeof(sg::BakedClip), batch);
+	batch.flush();
+
+	LOGI("Baked {} clips of {} into {} frames, {:.2f} MB.",
+	     p_crowd->clips_.size(),
+	     node.get_name(),
+	     frame_rows_.size() / (3 * joint_Ms_.size()),
+	     frame_rows_.size() * sizeof(glm::vec4) / (1024.0 * 1024.0));
+	return p_crowd;
+}
+
+void AnimationBaker::upload_instances(sg::Crowd &crowd, const std::vector<sg::CrowdInstance> &instances)
+{
+	assert(!instances.empty());
+	UploadBatch batch(device_);
+	crowd.p_instance_buf_ = upload_storage_buffer(instances.data(), instances.size() * sizeof(sg::CrowdInstance), batch);
+	crowd.instance_count_ = to_u32(instances.size());
+	batch.flush();
+}
+
+// Find the animations that move at least one joint of the skin.
+std::vector<sg::Animation *> AnimationBaker::find_animations(const sg::Skin &skin)
+{
+	std::unordered_set<sg::Node *> p_joints;
+	for (size_t joint_id = 0; joint_id < skin.get_joint_count(); joint_id++)
+	{
+		p_joints.insert(&scene_.get_node_by_index(skin.get_joint_node_id(joint_id)));
+	}
+
+	std::vector<sg::Animation *> p_animations;
+	for (sg::Animation *p_animation : scene_.get_components<sg::Animation>())
+	{
+		const std::vector<sg::Node *> &p_clip_nodes = p_animation->get_clip().get_nodes();
+		if (std::any_of(p_clip_nodes.begin(), p_clip_nodes.end(), [&](sg::Node *p_node) { return p_joints.count(p_node); }))
+		{
+			p_animations.push_back(p_animation);
+		}
+	}
+	return p_animations;
+}
+
+// Sample the clip at evenly spaced times from its start to its end, both included.
+// The spacing is at most 1 / frame_rate_, so the last frame lands exactly on the end of the clip.
+void AnimationBaker::bake_clip(const sg::Skin &skin, sg::AnimationClip &clip, sg::Crowd &crowd)
+{
+	float    duration    = std::max(0.0f, clip.get_end_time() - clip.get_start_time());
+	uint32_t frame_count = static_cast<uint32_t>(std::ceil(duration * frame_rate_)) + 1;
+	crowd.clips_.push_back({
+	    .first_frame = to_u32(frame_rows_.size() / (3 * joint_Ms_.size())),
+	    .frame_count = frame_count,
+	    .frame_rate  = duration > 0.0f ? (frame_count - 1) / duration : 0.0f,
+	    .duration    = duration,
+	});
+
+	sg::Pose pose;
+	pose.init(clip.get_nodes());
+	for (uint32_t frame = 0; frame < frame_count; frame++)
+	{
+		float time = clip.get_start_time() + (frame_count > 1 ? duration * frame / (frame_count - 1) : 0.0f);
+		pose.clear_written();
+		clip.sample(time, pose);
+		pose.commit();
+		scene_.update_transforms();
+		bake_frame(skin);
+	}
+}
+
+// Append the joint matrices of the scene's current pose.
+// The last row of an affine matrix is always (0, 0, 0, 1), so only the first three are stored.
+void AnimationBaker::bake_frame(const sg::Skin &skin)
+{
+	skin.compute_joint_Ms(scene_, joint_Ms_.data());
+	for (const glm::mat4 &joint_M : joint_Ms_)
+	{
+		for (glm::length_t row = 0; row < 3; row++)
+		{
+			frame_rows_.emplace_back(joint_M[0][row], joint_M[1][row], joint_M[2][row], joint_M[3][row]);
+		}
+	}
+}
+
+std::unique_ptr<Buffer> AnimationBaker::upload_storage_buffer(const void *p_data, size_t size, UploadBatch &batch)
+{
+	Buffer &staging_buf = batch.stage(reinterpret_cast<const uint8_t *>(p_data), size);
+	Buffer  buf         = device_.get_device_memory_allocator().allocate_storage_buffer(size);
+	batch.get_cmd_buf().copy_buffer(staging_buf, buf, size);
+	return std::make_unique<Buffer>(std::move(buf));
+}
+
+}        // namespace W3D
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "common/glm_common.hpp"
+#include "scene_graph/components/crowd.hpp"
+
+namespace W3D
+{
+namespace sg
+{
+class Animation;
+class AnimationClip;
+class Node;
+class Scene;
+class Skin;
+}        // namespace sg
+class Buffer;
+class Device;
+class UploadBatch;
+
+// Responsible for baking the animations of a skinned mesh into a crowd.
+// Every animation that moves a joint of the skin becomes a clip. A clip is sampled at a fixed rate through the scene graph
+// and the joint matrices of every frame are stored in a storage buffer. The scene is put back in the pose it was in afterwards.
+// * Memory grows with frame rate * duration * joint count. 30 frames per second is plenty, since the shader blends between frames.
+class AnimationBaker
+{
+  public:
+	static const float DEFAULT_FRAME_RATE;
+
+	AnimationBaker(Device &device, sg::Scene &scene, float frame_rate = DEFAULT_FRAME_RATE);
+
+	// The node needs a mesh and a skin. A skin that no animation moves gets a single clip of its current pose.
+	std::unique_ptr<sg::Crowd> bake(sg::Node &node);
+	// ! Replaces the instance buffer. Inflight frames must not be drawing the crowd.
+	void upload_instances(sg::Crowd &crowd, const std::vector<sg::CrowdInstance> &instances);
+
+  private:
+	std::vector<sg::Animation *> find_animations(const sg::Skin &skin);
+	void                         bake_clip(const sg::Skin &skin, sg::AnimationClip &clip, sg::Crowd &crowd);
+	void                         bake_frame(const sg::Skin &skin);
+	std::unique_ptr<Buffer>      upload_storage_buffer(const void *p_data, size_t size, UploadBatch &batch);
+
+	Device                &device_;
+	sg::Scene             &scene_;
+	float                  frame_rate_;
+	std::vector<glm::mat4> joint_Ms_;
+	std::vector<glm::vec4> frame_rows_;        // Three rows per joint matrix, joint_count matrices per frame.
+};
+}        // namespace W3D
@@ -0,0 +1,251 @@
+#include "animation_scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
+#include "common/glm_common.hpp"
+#include "common/logging.hpp"
+#include "common/utils.hpp"
+#include "scene_graph/components/aabb.hpp"
+#include "scene_graph/components/camera.hpp"
+#include "scene_graph/components/mesh.hpp"
+#include "scene_graph/components/skin.hpp"
+#include "scene_graph/node.hpp"
+#include "scene_graph/scene.hpp"
+#include "scene_graph/scripts/animator.hpp"
+
+namespace W3D
+{
+
+const uint32_t AnimationScheduler::DEFAULT_EVALUATION_BUDGET = 64;
+const float    AnimationScheduler::DEFAULT_FULL_RATE_PIXELS  = 200.0f;
+const float    AnimationScheduler::FULL_RATE_INTERVAL        = 1.0f / 60.0f;
+const float    AnimationScheduler::MAX_UPDATE_INTERVAL       = 0.25f;
+const float    AnimationScheduler::SKINNED_BOUNDS_SCALE      = 1.5f;
+
+// Conservative frustum test. A box is only culled when all its corners are outside the same clip plane.
+bool is_in_frustum(const glm::mat4 &proj_view, const sg::AABB &bounds)
+{
+	glm::vec3 min     = bounds.get_min();
+	glm::vec3 max     = bounds.get_max();
+	uint32_t  outside = 0x3f;
+	for (uint32_t corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 p = proj_view * glm::vec4(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z, 1.0f);
+		// Depth goes from zero to one. See glm_common.
+		uint32_t planes = (p.x < -p.w) | (p.x > p.w) << 1 | (p.y < -p.w) << 2 | (p.y > p.w) << 3 | (p.z < 0.0f) << 4 | (p.z > p.w) << 5;
+		outside &= planes;
+	}
+	return outside == 0;
+}
+
+AnimationScheduler::AnimationScheduler(sg::Scene &scene, uint32_t evaluation_budget, float full_rate_pixels) :
+    scene_(scene),
+    script_scheduler_(scene),
+    evaluation_budget_(evaluation_budget),
+    full_rate_pixels_(full_rate_pixels)
+{
+	collect_rigs();
+}
+
+void AnimationScheduler::set_evaluation_budget(uint32_t evaluation_budget)
+{
+	evaluation_budget_ = evaluation_budget;
+}
+
+void AnimationScheduler::set_full_rate_pixels(float full_rate_pixels)
+{
+	full_rate_pixels_ = full_rate_pixels;
+}
+
+void AnimationScheduler::update(sg::Camera &camera, float viewport_height, float delta_time)
+{
+	// Animators added since the last update become rigs.
+	if (rigs_.size() != scene_.get_components<sg::Animator>().size())
+	{
+		collect_rigs();
+	}
+	compute_priorities(camera, viewport_height);
+
+	stats_ = AnimationLODStats{
+	    .rig_count = to_u32(rigs_.size()),
+	};
+	p_due_rigs_.clear();
+	for (Rig &rig : rigs_)
+	{
+		schedule(rig);
+		rig.p_animator->advance(delta_time);
+		rig.is_evaluated = false;
+		if (rig.p_animator->is_evaluation_due())
+		{
+			rig.urgency = rig.priority * rig.p_animator->get_time_since_evaluation();
+			p_due_rigs_.push_back(&rig);
+		}
+	}
+
+	// Evaluate the most urgent rigs. The others hold the pose they blended to.
+	size_t evaluated_count = std::min<size_t>(p_due_rigs_.size(), evaluation_budget_);
+	if (evaluated_count < p_due_rigs_.size())
+	{
+		std::nth_element(p_due_rigs_.begin(), p_due_rigs_.begin() + evaluated_count, p_due_rigs_.end(), [](const Rig *p_a, const Rig *p_b) {
+			return p_a->urgency > p_b->urgency;
+		});
+	}
+	for (size_t i = 0; i < evaluated_count; i++)
+	{
+		p_due_rigs_[i]->is_evaluated = true;
+	}
+
+	script_scheduler_.run(
+	    p_animators_,
+	    [this](size_t rig_idx) {
+		    Rig &rig = rigs_[rig_idx];
+		    if (rig.is_evaluated)
+		    {
+			    rig.p_animator->evaluate();
+		    }
+		    else
+		    {
+			    rig.p_animator->interpolate();
+		    }
+	    },
+	    [this](size_t rig_idx) {
+		    rigs_[rig_idx].p_animator->commit();
+	    });
+
+	stats_.evaluated_count = to_u32(evaluated_count);
+	stats_.deferred_count  = to_u32(p_due_rigs_.size() - evaluated_count);
+	frame_count_++;
+	evaluation_count_ += evaluated_count;
+}
+
+const AnimationLODStats &AnimationScheduler::get_stats() const
+{
+	return stats_;
+}
+
+void AnimationScheduler::log_stats() const
+{
+	LOGI("Animation LOD: {} rigs, {} at full rate, {} at reduced rates, {} paused, {} deferred in the last frame. {:.1f} evaluations per frame.",
+	     stats_.rig_count,
+	     stats_.full_rate_count,
+	     stats_.reduced_rate_count,
+	     stats_.paused_count,
+	     stats_.deferred_count,
+	     frame_count_ ? static_cast<double>(evaluation_count_) / frame_count_ : 0.0);
+}
+
+// Find the meshes every animator moves.
+void AnimationScheduler::collect_rigs()
+{
+	rigs_.clear();
+	p_animators_.clear();
+	for (sg::Animator *p_animator : scene_.get_components<sg::Animator>())
+	{
+		Rig rig{
+		    .p_animator   = p_animator,
+		    .priority     = 0.0f,
+		    .urgency      = 0.0f,
+		    .is_evaluated = false,
+		};
+		std::unordered_set<const sg::Node *> p_rig_nodes(p_animator->get_nodes().begin(), p_animator->get_nodes().end());
+
+		for (sg::Mesh *p_mesh : scene_.get_components<sg::Mesh>())
+		{
+			for (sg::Node *p_node : p_mesh->get_p_nodes())
+			{
+				bool is_skinned = p_node->has_component<sg::Skin>();
+				bool is_moved   = false;
+				if (is_skinned)
+				{
+					sg::Skin &skin = p_node->get_component<sg::Skin>();
+					for (size_t joint_id = 0; joint_id < skin.get_joint_count() && !is_moved; joint_id++)
+					{
+						is_moved = p_rig_nodes.count(&scene_.get_node_by_index(skin.get_joint_node_id(joint_id)));
+					}
+				}
+				for (const sg::Node *p_ancestor = p_node; p_ancestor && !is_moved; p_ancestor = p_ancestor->get_parent())
+				{
+					is_moved = p_rig_nodes.count(p_ancestor);
+				}
+
+				if (is_moved)
+				{
+					rig.mesh_instances.push_back({
+					    .p_mesh     = p_mesh,
+					    .p_node     = p_node,
+					    .is_skinned = is_skinned,
+					});
+				}
+			}
+		}
+		rigs_.push_back(std::move(rig));
+		p_animators_.push_back(p_animator);
+	}
+}
+
+// Project the meshes of every rig, like TextureStreamer does. Meshes outside the view frustum don't count.
+void AnimationScheduler::compute_priorities(sg::Camera &camera, float viewport_height)
+{
+	glm::mat4 view      = camera.get_view();
+	glm::mat4 proj      = camera.get_projection();
+	glm::mat4 proj_view = proj * view;
+	glm::vec3 cam_pos   = glm::vec3(glm::inverse(view)[3]);
+	// Pixels covered by one unit at distance one.
+	float focal = std::abs(proj[1][1]) * viewport_height * 0.5f;
+
+	for (Rig &rig : rigs_)
+	{
+		if (rig.mesh_instances.empty())
+		{
+			rig.priority = std::numeric_limits<float>::max();
+			continue;
+		}
+
+		rig.priority = 0.0f;
+		for (const MeshInstance &instance : rig.mesh_instances)
+		{
+			sg::AABB  bounds = instance.p_mesh->get_bounds().transform(instance.p_node->get_transform().get_world_M());
+			glm::vec3 center = bounds.get_center();
+			float     radius = glm::length(bounds.get_max() - bounds.get_min()) * 0.5f;
+			if (instance.is_skinned)
+			{
+				radius *= SKINNED_BOUNDS_SCALE;
+				bounds = sg::AABB(center - glm::vec3(radius), center + glm::vec3(radius));
+			}
+			if (!is_in_frustum(proj_view, bounds))
+			{
+				continue;
+			}
+
+			float distance = glm::length(center - cam_pos);
+			float pixels   = distance > radius ? 2.0f * radius * focal / distance : std::numeric_limits<float>::max();
+			rig.priority   = std::max(rig.priority, pixels);
+		}
+	}
+}
+
+// Pick the update rate of a rig from its priority.
+void AnimationScheduler::schedule(Rig &rig)
+{
+	sg::Animator &animator = *rig.p_animator;
+	animator.set_paused(rig.priority <= 0.0f);
+	if (rig.priority <= 0.0f)
+	{
+		stats_.paused_count++;
+	}
+	else if (rig.priority >= full_rate_pixels_)
+	{
+		animator.set_update_interval(0.0f);
+		stats_.full_rate_count++;
+	}
+	else
+	{
+		animator.set_update_interval(std::min(MAX_UPDATE_INTERVAL, FULL_RATE_INTERVAL * full_rate_pixels_ / rig.priority));
+		stats_.reduced_rate_count++;
+	}
+}
+
+}        // namespace W3D
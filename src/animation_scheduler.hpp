@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "scene_graph/script_scheduler.hpp"
+
+namespace W3D
+{
+namespace sg
+{
+class Animator;
+class Camera;
+class Mesh;
+class Node;
+class Scene;
+class Script;
+}        // namespace sg
+
+// Per frame counts of the animation scheduler.
+struct AnimationLODStats
+{
+	uint32_t rig_count          = 0;
+	uint32_t full_rate_count    = 0;        // Rigs evaluated every frame.
+	uint32_t reduced_rate_count = 0;        // Rigs evaluated every few frames and interpolated in between.
+	uint32_t paused_count       = 0;        // Off-screen rigs.
+	uint32_t evaluated_count    = 0;        // Rigs whose layers were evaluated.
+	uint32_t deferred_count     = 0;        // Rigs due for an evaluation that didn't fit in the budget.
+};
+
+// Animation level of detail.
+// Every animator of a scene is a rig. A rig's priority is the projected size in pixels of the largest visible mesh it moves:
+// skinned meshes whose skin has a joint in the rig, and meshes on or below one of its nodes.
+// - Off-screen rigs are paused. They keep time and snap to it once visible again.
+// - Rigs at least full_rate_pixels tall are evaluated every frame.
+// - Smaller rigs are evaluated less often the smaller they are, and interpolated in between. See Animator::set_update_interval().
+// - Rigs that move no mesh are always evaluated every frame.
+// At most evaluation_budget rigs are evaluated per frame. The rest hold their pose and go first the next frame, since they have waited longer.
+// The rigs are evaluated and interpolated in parallel through a ScriptScheduler. Animators of different skeletons don't conflict.
+// * Skinned meshes are tested with their bind pose bounds, grown by SKINNED_BOUNDS_SCALE since the pose can reach outside them.
+class AnimationScheduler
+{
+  public:
+	static const uint32_t DEFAULT_EVALUATION_BUDGET;
+	static const float    DEFAULT_FULL_RATE_PIXELS;
+	static const float    FULL_RATE_INTERVAL;        // Interval at full_rate_pixels. Halving the size doubles it.
+	static const float    MAX_UPDATE_INTERVAL;
+	static const float    SKINNED_BOUNDS_SCALE;
+
+	AnimationScheduler(sg::Scene &scene, uint32_t evaluation_budget = DEFAULT_EVALUATION_BUDGET, float full_rate_pixels = DEFAULT_FULL_RATE_PIXELS);
+
+	void set_evaluation_budget(uint32_t evaluation_budget);
+	void set_full_rate_pixels(float full_rate_pixels);
+
+	// Prioritize the rigs for the view and update them.
+	void                     update(sg::Camera &camera, float viewport_height, float delta_time);
+	const AnimationLODStats &get_stats() const;
+	void                     log_stats() const;
+
+  private:
+	struct MeshInstance
+	{
+		sg::Mesh *p_mesh;
+		sg::Node *p_node;
+		bool      is_skinned;
+	};
+
+	struct Rig
+	{
+		sg::Animator             *p_animator;
+		std::vector<MeshInstance> mesh_instances;
+		float                     priority;            // Projected size in pixels. 0 when off-screen.
+		float                     urgency;             // Priority weighted by the time since the last evaluation. Ranks rigs against the budget.
+		bool                      is_evaluated;        // This frame. The other rigs interpolate.
+	};
+
+	void collect_rigs();
+	void compute_priorities(sg::Camera &camera, float viewport_height);
+	void schedule(Rig &rig);
+
+	sg::Scene                &scene_;
+	sg::ScriptScheduler       script_scheduler_;
+	uint32_t                  evaluation_budget_;
+	float                     full_rate_pixels_;
+	std::vector<Rig>          rigs_;
+	std::vector<sg::Script *> p_animators_;        // Of the rigs, in the same order.
+	std::vector<Rig *>        p_due_rigs_;
+	AnimationLODStats         stats_;
+	uint64_t                  frame_count_      = 0;
+	uint64_t                  evaluation_count_ = 0;
+};
+
+}        // namespace W3D
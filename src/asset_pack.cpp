@@ -0,0 +1,208 @@
+#include "asset_pack.hpp"
+
+#include <fstream>
+
+namespace W3D::pack
+{
+
+const std::array<const char *, TEXTURE_SLOT_COUNT> TEXTURE_SLOT_NAMES = {
+    "base_color_texture",
+    "normal_texture",
+    "occlusion_texture",
+    "emissive_texture",
+    "metallic_roughness_texture",
+};
+
+// Round size up to the pack alignment.
+uint64_t align_up(uint64_t size)
+{
+	return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+// The string section always starts with an empty string so that a zero name means "no name".
+Writer::Writer()
+{
+	sections_[static_cast<uint32_t>(SectionType::eStrings)].push_back('\0');
+}
+
+// Append a null terminated string and return its offset.
+Name Writer::add_string(const std::string &str)
+{
+	if (str.empty())
+	{
+		return 0;
+	}
+	std::vector<uint8_t> &strings = sections_[static_cast<uint32_t>(SectionType::eStrings)];
+	Name                  name    = static_cast<Name>(strings.size());
+	strings.insert(strings.end(), str.begin(), str.end());
+	strings.push_back('\0');
+	return name;
+}
+
+// Append a payload to the data section. Every blob starts at an aligned offset so that it can be copied with wide loads.
+Blob Writer::add_blob(const void *p_data, size_t size)
+{
+	std::vector<uint8_t> &data = sections_[static_cast<uint32_t>(SectionType::eData)];
+	Blob                  blob{
+	                     .offset = align_up(data.size()),
+	                     .size   = size,
+    };
+	data.resize(blob.offset + size);
+	if (size)
+	{
+		std::copy(static_cast<const uint8_t *>(p_data), static_cast<const uint8_t *>(p_data) + size, data.begin() + blob.offset);
+	}
+	return blob;
+}
+
+void Writer::set_scene_name(const std::string &name)
+{
+	scene_name_ = add_string(name);
+}
+
+uint64_t Writer::get_data_size() const
+{
+	return sections_[static_cast<uint32_t>(SectionType::eData)].size();
+}
+
+// Lay the sections out and write the pack.
+void Writer::write(const std::string &path) const
+{
+	std::array<Section, SECTION_COUNT> section_table;
+
+	uint64_t offset = align_up(sizeof(Header) + sizeof(Section) * SECTION_COUNT);
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		section_table[i] = {
+		    .type     = static_cast<SectionType>(i),
+		    .count    = counts_[i],
+		    .stride   = strides_[i],
+		    .reserved = 0,
+		    .offset   = offset,
+		    .size     = sections_[i].size(),
+		};
+		offset = align_up(offset + sections_[i].size());
+	}
+
+	Header header{
+	    .magic         = MAGIC,
+	    .version       = VERSION,
+	    .section_count = SECTION_COUNT,
+	    .scene_name    = scene_name_,
+	    .file_size     = offset,
+	    .reserved      = 0,
+	};
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open file: " + path);
+	}
+
+	static const char padding[ALIGNMENT] = {};
+	uint64_t          written            = 0;
+	auto              write_bytes        = [&](const void *p_bytes, uint64_t size) {
+        file.write(static_cast<const char *>(p_bytes), size);
+        written += size;
+	};
+	auto pad_to = [&](uint64_t target) {
+		file.write(padding, target - written);
+		written = target;
+	};
+
+	write_bytes(&header, sizeof(header));
+	write_bytes(section_table.data(), sizeof(Section) * SECTION_COUNT);
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		pad_to(section_table[i].offset);
+		write_bytes(sections_[i].data(), sections_[i].size());
+	}
+	pad_to(header.file_size);
+
+	if (!file.good())
+	{
+		throw std::runtime_error("failed to write file: " + path);
+	}
+}
+
+// Map the pack and check that every section fits in the file.
+Reader::Reader(const std::string &path) :
+    file_(path)
+{
+	validate(path);
+}
+
+void Reader::validate(const std::string &path)
+{
+	p_base_ = file_.get_data();
+	if (file_.get_size() < sizeof(Header))
+	{
+		throw std::runtime_error(path + " is not a W3D pack.");
+	}
+
+	p_header_ = reinterpret_cast<const Header *>(p_base_);
+	if (p_header_->magic != MAGIC)
+	{
+		throw std::runtime_error(path + " is not a W3D pack.");
+	}
+	if (p_header_->version != VERSION)
+	{
+		throw std::runtime_error(path + " was cooked with pack version " + std::to_string(p_header_->version) + ", expected " + std::to_string(VERSION) + ". Please recook it.");
+	}
+	if (p_header_->section_count != SECTION_COUNT || p_header_->file_size != file_.get_size() ||
+	    file_.get_size() < sizeof(Header) + sizeof(Section) * SECTION_COUNT)
+	{
+		throw std::runtime_error(path + " is truncated or corrupted.");
+	}
+
+	const Section *p_table = reinterpret_cast<const Section *>(p_base_ + sizeof(Header));
+	for (uint32_t i = 0; i < SECTION_COUNT; i++)
+	{
+		const Section &section = p_table[i];
+		bool           is_valid =
+		    static_cast<uint32_t>(section.type) == i &&
+		    section.offset % ALIGNMENT == 0 &&
+		    section.offset <= file_.get_size() &&
+		    section.size <= file_.get_size() - section.offset &&
+		    static_cast<uint64_t>(section.count) * section.stride <= section.size;
+		if (!is_valid)
+		{
+			throw std::runtime_error(path + " is truncated or corrupted.");
+		}
+		p_sections_[i] = &section;
+	}
+
+	const Section &strings = *p_sections_[static_cast<uint32_t>(SectionType::eStrings)];
+	if (strings.size == 0 || p_base_[strings.offset + strings.size - 1] != '\0')
+	{
+		throw std::runtime_error(path + " has a corrupted string table.");
+	}
+}
+
+const char *Reader::get_scene_name() const
+{
+	return get_string(p_header_->scene_name);
+}
+
+const char *Reader::get_string(Name name) const
+{
+	const Section &strings = *p_sections_[static_cast<uint32_t>(SectionType::eStrings)];
+	if (name >= strings.size)
+	{
+		throw std::runtime_error("Pack string out of range.");
+	}
+	return reinterpret_cast<const char *>(p_base_ + strings.offset + name);
+}
+
+const uint8_t *Reader::get_blob_bytes(const Blob &blob) const
+{
+	const Section &data = *p_sections_[static_cast<uint32_t>(SectionType::eData)];
+	// Written so that a huge offset or size can't wrap around.
+	if (blob.offset > data.size || blob.size > data.size - blob.offset)
+	{
+		throw std::runtime_error("Pack blob out of range.");
+	}
+	return p_base_ + data.offset + blob.offset;
+}
+
+}        // namespace W3D::pack
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "common/file_utils.hpp"
+
+namespace W3D::pack
+{
+
+// The W3D asset pack is a cooked, GPU-ready version of a glTF scene. It's written by the cooker and memory mapped by PackLoader.
+// Layout:
+//   Header | Section table | Sections ... | Data section
+// Every section is an array of POD records and starts at a multiple of ALIGNMENT.
+// Large payloads (vertices, indices, image mips, keyframes) live in the data section and are referenced with a Blob.
+// All transforms and vertices are already converted to W3D's left-handed system.
+
+constexpr uint32_t MAGIC     = 0x50443357;        // "W3DP"
+constexpr uint32_t VERSION   = 1;
+constexpr uint64_t ALIGNMENT = 16;
+
+// Reserved indices.
+constexpr int32_t NONE        = -1;
+constexpr int32_t PARENT_ROOT = -1;        // The node is a child of the scene root.
+constexpr int32_t PARENT_NONE = -2;        // The node is not part of the picked scene.
+
+// The texture slots of a material. The names match the keys of sg::Material::texture_map_.
+constexpr uint32_t                             TEXTURE_SLOT_COUNT = 5;
+extern const std::array<const char *, TEXTURE_SLOT_COUNT> TEXTURE_SLOT_NAMES;
+
+enum class SectionType : uint32_t
+{
+	eStrings,
+	eSamplers,
+	eImages,
+	eTextures,
+	eMaterials,
+	eSubMeshes,
+	eMeshes,
+	eCameras,
+	eNodes,
+	eSkins,
+	eAnimations,
+	eChannels,
+	eData,
+	eCount,
+};
+
+constexpr uint32_t SECTION_COUNT = static_cast<uint32_t>(SectionType::eCount);
+
+// A range of the data section.
+struct Blob
+{
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct Header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t section_count;
+	uint32_t scene_name;
+	uint64_t file_size;
+	uint64_t reserved;
+};
+
+struct Section
+{
+	SectionType type;
+	uint32_t    count;
+	uint32_t    stride;        // sizeof(record). Used to reject packs written with a different layout.
+	uint32_t    reserved;
+	uint64_t    offset;
+	uint64_t    size;
+};
+
+// Names are byte offsets into the string section. Strings are null terminated.
+using Name = uint32_t;
+
+// Filters and address modes are stored as raw VkFilter, VkSamplerMipmapMode and VkSamplerAddressMode values.
+struct Sampler
+{
+	static constexpr SectionType SECTION = SectionType::eSamplers;
+
+	Name     name;
+	uint32_t mag_filter;
+	uint32_t min_filter;
+	uint32_t mipmap_mode;
+	uint32_t address_mode_u;
+	uint32_t address_mode_v;
+	uint32_t address_mode_w;
+	uint32_t reserved;
+};
+
+// data holds every mip level, largest first, tightly packed. format is a raw VkFormat.
+struct Image
+{
+	static constexpr SectionType SECTION = SectionType::eImages;
+
+	Name     name;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	uint32_t reserved;
+	Blob     data;
+};
+
+struct Texture
+{
+	static constexpr SectionType SECTION = SectionType::eTextures;
+
+	Name    name;
+	int32_t image;
+	int32_t sampler;
+};
+
+struct Material
+{
+	static constexpr SectionType SECTION = SectionType::eMaterials;
+
+	Name     name;
+	uint32_t flag;        // sg::PBRMaterialFlag
+	uint32_t alpha_mode;
+	uint32_t double_sided;
+	float    base_color_factor[4];
+	float    emissive[3];
+	float    metallic_factor;
+	float    roughness_factor;
+	float    alpha_cutoff;
+	int32_t  textures[TEXTURE_SLOT_COUNT];        // Indexed by TEXTURE_SLOT_NAMES.
+};
+
+// vertices is an array of sg::Vertex. indices is an array of u32 and may be empty.
+struct SubMesh
+{
+	static constexpr SectionType SECTION = SectionType::eSubMeshes;
+
+	int32_t  material;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t reserved;
+	Blob     vertices;
+	Blob     indices;
+};
+
+struct Mesh
+{
+	static constexpr SectionType SECTION = SectionType::eMeshes;
+
+	Name     name;
+	uint32_t first_submesh;
+	uint32_t submesh_count;
+	float    bound_min[3];
+	float    bound_max[3];
+};
+
+struct Camera
+{
+	static constexpr SectionType SECTION = SectionType::eCameras;
+
+	Name  name;
+	float aspect_ratio;
+	float yfov;
+	float znear;
+	float zfar;
+};
+
+// Parents are always stored before their children.
+struct Node
+{
+	static constexpr SectionType SECTION = SectionType::eNodes;
+
+	Name    name;
+	int32_t parent;
+	int32_t mesh;
+	int32_t camera;
+	int32_t skin;
+	float   translation[3];
+	float   rotation[4];        // (x, y, z, w)
+	float   scale[3];
+};
+
+// joints is an array of u32 node indices. IBMs is an array of mat4.
+struct Skin
+{
+	static constexpr SectionType SECTION = SectionType::eSkins;
+
+	Name     name;
+	uint32_t joint_count;
+	Blob     joints;
+	Blob     IBMs;
+};
+
+struct Animation
+{
+	static constexpr SectionType SECTION = SectionType::eAnimations;
+
+	Name     name;
+	uint32_t first_channel;
+	uint32_t channel_count;
+};
+
+// inputs is an array of float. outputs is an array of vec3 for translation and scale, (x, y, z, w) quaternions for rotation.
+// target and interpolation are sg::AnimationTarget and sg::AnimationType.
+struct Channel
+{
+	static constexpr SectionType SECTION = SectionType::eChannels;
+
+	int32_t  node;
+	uint32_t target;
+	uint32_t interpolation;
+	uint32_t key_count;
+	Blob     inputs;
+	Blob     outputs;
+};
+
+// Builds a pack in memory and writes it to disk.
+class Writer
+{
+  public:
+	Writer();
+
+	Name     add_string(const std::string &str);
+	Blob     add_blob(const void *p_data, size_t size);
+	void     set_scene_name(const std::string &name);
+	void     write(const std::string &path) const;
+	uint64_t get_data_size() const;
+
+	// Append a record and return its index.
+	template <typename T>
+	uint32_t add(const T &record)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Pack records must be POD");
+		uint32_t              section = static_cast<uint32_t>(T::SECTION);
+		std::vector<uint8_t> &bytes   = sections_[section];
+		const uint8_t        *p_bytes = reinterpret_cast<const uint8_t *>(&record);
+		bytes.insert(bytes.end(), p_bytes, p_bytes + sizeof(T));
+		strides_[section] = sizeof(T);
+		return counts_[section]++;
+	}
+
+	template <typename T>
+	uint32_t get_count() const
+	{
+		return counts_[static_cast<uint32_t>(T::SECTION)];
+	}
+
+	// Patch a record that was already added.
+	template <typename T>
+	T &get(uint32_t idx)
+	{
+		return reinterpret_cast<T *>(sections_[static_cast<uint32_t>(T::SECTION)].data())[idx];
+	}
+
+  private:
+	Name                                            scene_name_ = 0;
+	std::array<std::vector<uint8_t>, SECTION_COUNT> sections_;
+	std::array<uint32_t, SECTION_COUNT>             counts_{};
+	std::array<uint32_t, SECTION_COUNT>             strides_{};
+};
+
+// Memory maps a pack and validates its layout.
+// Records and blobs are returned as pointers into the mapping. They are valid as long as the reader lives.
+class Reader
+{
+  public:
+	explicit Reader(const std::string &path);
+
+	const char *get_scene_name() const;
+	const char *get_string(Name name) const;
+
+	template <typename T>
+	uint32_t get_count() const
+	{
+		return p_sections_[static_cast<uint32_t>(T::SECTION)]->count;
+	}
+
+	template <typename T>
+	const T *get_records() const
+	{
+		const Section *p_section = p_sections_[static_cast<uint32_t>(T::SECTION)];
+		if (p_section->count && p_section->stride != sizeof(T))
+		{
+			throw std::runtime_error("Pack record layout mismatch.");
+		}
+		return reinterpret_cast<const T *>(p_base_ + p_section->offset);
+	}
+
+	template <typename T = uint8_t>
+	const T *get_blob(const Blob &blob) const
+	{
+		return reinterpret_cast<const T *>(get_blob_bytes(blob));
+	}
+
+	// Same as above, but the blob must hold exactly count elements.
+	template <typename T>
+	const T *get_blob(const Blob &blob, uint64_t count) const
+	{
+		if (blob.size != count * sizeof(T))
+		{
+			throw std::runtime_error("Pack blob size mismatch.");
+		}
+		return get_blob<T>(blob);
+	}
+
+	// Check an index a record holds into the records of T.
+	template <typename T>
+	uint32_t check_index(int64_t idx) const
+	{
+		if (idx < 0 || idx >= get_count<T>())
+		{
+			throw std::runtime_error("Pack record index out of range.");
+		}
+		return static_cast<uint32_t>(idx);
+	}
+
+	// Check a run of count records of T starting at first.
+	template <typename T>
+	void check_range(uint32_t first, uint32_t count) const
+	{
+		if (static_cast<uint64_t>(first) + count > get_count<T>())
+		{
+			throw std::runtime_error("Pack record range out of range.");
+		}
+	}
+
+  private:
+	const uint8_t *get_blob_bytes(const Blob &blob) const;
+	void           validate(const std::string &path);
+
+	fu::MappedFile                              file_;
+	const uint8_t                              *p_base_   = nullptr;
+	const Header                               *p_header_ = nullptr;
+	std::array<const Section *, SECTION_COUNT> p_sections_{};
+};
+
+}        // namespace W3D::pack
@@ -0,0 +1,195 @@
+#include "async_scene_load.hpp"
+
+#include "common/file_utils.hpp"
+#include "common/logging.hpp"
+#include "gltf_loader.hpp"
+#include "pack_loader.hpp"
+
+#include "scene_graph/components/texture.hpp"
+#include "scene_graph/scene.hpp"
+
+namespace W3D
+{
+// 16 MB per frame keeps the stall from the one-time upload buffers short.
+const size_t AsyncSceneLoad::DEFAULT_UPLOAD_BUDGET = 16 * 1024 * 1024;
+
+// Start reading the file on a job system worker.
+// Cooked packs (.w3dpack) go through PackLoader. Anything else goes through GLTFLoader.
+AsyncSceneLoad::AsyncSceneLoad(const Device &device, const std::string &file_name, int scene_index) :
+    file_name_(file_name),
+    scene_index_(scene_index),
+    status_(SceneLoadStatus::eReadingFile)
+{
+	if (fu::get_file_extension(file_name) == "w3dpack")
+	{
+		p_pack_loader_ = std::make_unique<PackLoader>(device);
+	}
+	else
+	{
+		p_loader_ = std::make_unique<GLTFLoader>(device);
+	}
+	JobSystem::get().run(read_group_, [this]() {
+		read_file();
+	});
+}
+
+// * Block until the worker is done with the loader.
+AsyncSceneLoad::~AsyncSceneLoad()
+{
+	JobSystem::get().wait(read_group_);
+}
+
+// Runs on the worker thread.
+void AsyncSceneLoad::read_file()
+{
+	try
+	{
+		if (p_pack_loader_)
+		{
+			p_pack_loader_->read_file(file_name_);
+		}
+		else
+		{
+			p_loader_->read_file(file_name_);
+		}
+	}
+	catch (const std::exception &e)
+	{
+		fail(e.what());
+		return;
+	}
+
+	// Don't overwrite a cancellation that happened while we were reading.
+	SceneLoadStatus expected = SceneLoadStatus::eReadingFile;
+	status_.compare_exchange_strong(expected, SceneLoadStatus::eFileRead);
+}
+
+// Build the scene once the file is read. The geometry is uploaded and textures point to the default texture.
+// A pack scene is complete right away. Given a texture streamer, its images are handed to it.
+// Return nullptr if the file is not read yet or if the build fails.
+std::unique_ptr<sg::Scene> AsyncSceneLoad::create_scene(TextureStreamer *p_texture_streamer)
+{
+	if (status_ != SceneLoadStatus::eFileRead)
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<sg::Scene> p_scene;
+	try
+	{
+		if (p_pack_loader_)
+		{
+			p_scene = p_pack_loader_->create_scene(p_texture_streamer);
+		}
+		else
+		{
+			p_scene = p_loader_->create_streaming_scene(scene_index_);
+		}
+	}
+	catch (const std::exception &e)
+	{
+		fail(e.what());
+		return nullptr;
+	}
+
+	if (p_pack_loader_)
+	{
+		status_ = SceneLoadStatus::eReady;
+		p_pack_loader_.reset();
+		return p_scene;
+	}
+
+	total_images_ = p_loader_->get_deferred_image_count();
+	status_       = SceneLoadStatus::eStreaming;
+	if (!p_loader_->has_deferred_images())
+	{
+		status_ = SceneLoadStatus::eReady;
+		p_loader_.reset();
+	}
+	return p_scene;
+}
+
+// Upload the next batch of images.
+// Return the textures that switched from the default texture to their real image.
+std::vector<sg::Texture *> AsyncSceneLoad::stream_textures(size_t byte_budget)
+{
+	if (status_ != SceneLoadStatus::eStreaming)
+	{
+		return {};
+	}
+
+	std::vector<sg::Texture *> p_textures = p_loader_->upload_deferred_images(byte_budget);
+	uploaded_images_                      = p_loader_->get_uploaded_image_count();
+
+	if (!p_loader_->has_deferred_images())
+	{
+		status_ = SceneLoadStatus::eReady;
+		// Release the glTF model and the decoded images.
+		p_loader_.reset();
+	}
+	return p_textures;
+}
+
+// Stop the load. The worker finishes its current read but its result is dropped.
+void AsyncSceneLoad::cancel()
+{
+	SceneLoadStatus status = status_;
+	if (status != SceneLoadStatus::eReady && status != SceneLoadStatus::eFailed)
+	{
+		status_ = SceneLoadStatus::eCancelled;
+	}
+}
+
+// Like read_file(), don't overwrite a cancellation.
+void AsyncSceneLoad::fail(const std::string &error)
+{
+	error_                   = error;
+	SceneLoadStatus expected = status_;
+	while (expected != SceneLoadStatus::eCancelled && !status_.compare_exchange_weak(expected, SceneLoadStatus::eFailed))
+	{
+	}
+}
+
+SceneLoadStatus AsyncSceneLoad::get_status() const
+{
+	return status_;
+}
+
+// Fraction of the textures that are resident.
+float AsyncSceneLoad::get_progress() const
+{
+	switch (status_.load())
+	{
+		case SceneLoadStatus::eReady:
+			return 1.0f;
+		case SceneLoadStatus::eStreaming:
+			return total_images_ ? static_cast<float>(uploaded_images_) / total_images_ : 1.0f;
+		default:
+			return 0.0f;
+	}
+}
+
+// Only valid once the status is eFailed.
+const std::string &AsyncSceneLoad::get_error() const
+{
+	return error_;
+}
+
+const std::string &AsyncSceneLoad::get_file_name() const
+{
+	return file_name_;
+}
+
+// Whether the worker thread is done with the loader.
+bool AsyncSceneLoad::is_worker_idle() const
+{
+	return read_group_.is_done();
+}
+
+// Whether the scene comes from a cooked pack, whose textures can be streamed by a TextureStreamer.
+bool AsyncSceneLoad::is_pack() const
+{
+	return fu::get_file_extension(file_name_) == "w3dpack";
+}
+
+}        // namespace W3D
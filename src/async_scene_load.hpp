@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/job_system.hpp"
+
+namespace W3D
+{
+class Device;
+class GLTFLoader;
+class PackLoader;
+class TextureStreamer;
+
+namespace sg
+{
+class Scene;
+class Texture;
+}        // namespace sg
+
+enum class SceneLoadStatus
+{
+	eReadingFile,        // The file is being read and decoded on a worker thread.
+	eFileRead,           // Waiting for the main thread to build the scene.
+	eStreaming,          // The scene is live. Textures are still being uploaded.
+	eReady,              // Every texture is resident.
+	eFailed,
+	eCancelled,
+};
+
+// Handle to a scene that is loaded in the background.
+// The glTF file is parsed and its images are decoded on the job system. A cooked pack (.w3dpack) is only mapped and validated there.
+// Everything that touches the device runs on the main thread. The renderer calls create_scene() and stream_textures() at frame boundaries.
+// Pack images are created in create_scene(), so a pack load goes straight from eFileRead to eReady.
+class AsyncSceneLoad
+{
+  public:
+	static const size_t DEFAULT_UPLOAD_BUDGET;        // Texture bytes uploaded per frame.
+
+	AsyncSceneLoad(const Device &device, const std::string &file_name, int scene_index = -1);
+	~AsyncSceneLoad();
+
+	SceneLoadStatus    get_status() const;
+	float              get_progress() const;
+	const std::string &get_error() const;
+	const std::string &get_file_name() const;
+	bool               is_worker_idle() const;
+	bool               is_pack() const;
+
+	// Main thread only.
+	std::unique_ptr<sg::Scene> create_scene(TextureStreamer *p_texture_streamer = nullptr);
+	std::vector<sg::Texture *> stream_textures(size_t byte_budget = DEFAULT_UPLOAD_BUDGET);
+	void                       cancel();
+
+  private:
+	void read_file();
+	void fail(const std::string &error);
+
+	std::unique_ptr<GLTFLoader>  p_loader_;
+	std::unique_ptr<PackLoader>  p_pack_loader_;
+	std::string                  file_name_;
+	int                          scene_index_;
+	JobGroup                     read_group_;
+	std::atomic<SceneLoadStatus> status_;
+	std::string                  error_;
+	size_t                       total_images_    = 0;
+	size_t                       uploaded_images_ = 0;
+};
+
+}        // namespace W3D
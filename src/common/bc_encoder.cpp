@@ -0,0 +1,255 @@
+#include "bc_encoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace W3D
+{
+
+const uint32_t BC_BLOCK_DIM = 4;
+
+size_t get_bc_block_size(BCFormat format)
+{
+	return format == BCFormat::eBC1 || format == BCFormat::eBC4 ? 8 : 16;
+}
+
+size_t get_bc_level_size(BCFormat format, uint32_t width, uint32_t height)
+{
+	size_t blocks_x = (width + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+	size_t blocks_y = (height + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+	return blocks_x * blocks_y * get_bc_block_size(format);
+}
+
+// Gather a 4x4 block of RGBA texels. Texels past the edge repeat the last row / column.
+void fetch_block_rgba8(const uint8_t *p_rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, uint8_t *p_block)
+{
+	for (uint32_t y = 0; y < BC_BLOCK_DIM; y++)
+	{
+		uint32_t src_y = std::min(block_y * BC_BLOCK_DIM + y, height - 1);
+		for (uint32_t x = 0; x < BC_BLOCK_DIM; x++)
+		{
+			uint32_t src_x = std::min(block_x * BC_BLOCK_DIM + x, width - 1);
+			std::memcpy(&p_block[(y * BC_BLOCK_DIM + x) * 4], &p_rgba[(static_cast<size_t>(src_y) * width + src_x) * 4], 4);
+		}
+	}
+}
+
+uint16_t pack_rgb565(const float *p_color)
+{
+	uint32_t r = static_cast<uint32_t>(std::clamp(p_color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+	uint32_t g = static_cast<uint32_t>(std::clamp(p_color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+	uint32_t b = static_cast<uint32_t>(std::clamp(p_color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpack_rgb565(uint16_t packed, int *p_color)
+{
+	int r      = (packed >> 11) & 31;
+	int g      = (packed >> 5) & 63;
+	int b      = packed & 31;
+	p_color[0] = (r << 3) | (r >> 2);
+	p_color[1] = (g << 2) | (g >> 4);
+	p_color[2] = (b << 3) | (b >> 2);
+}
+
+// Encode the rgb of a 4x4 RGBA block. Always uses the 4 color mode so that the block is also valid inside BC3.
+void encode_bc1_block(const uint8_t *p_block, uint8_t *p_out)
+{
+	// Mean and covariance of the block.
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			mean[c] += p_block[i * 4 + c] / 16.0f;
+		}
+	}
+
+	float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		float r = p_block[i * 4 + 0] - mean[0];
+		float g = p_block[i * 4 + 1] - mean[1];
+		float b = p_block[i * 4 + 2] - mean[2];
+		cov[0] += r * r;
+		cov[1] += r * g;
+		cov[2] += r * b;
+		cov[3] += g * g;
+		cov[4] += g * b;
+		cov[5] += b * b;
+	}
+
+	// Principal axis with a few power iterations.
+	float axis[3] = {1.0f, 1.0f, 1.0f};
+	for (uint32_t iter = 0; iter < 8; iter++)
+	{
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float l = std::max({std::abs(x), std::abs(y), std::abs(z)});
+		if (l < 1e-6f)
+		{
+			break;
+		}
+		axis[0] = x / l;
+		axis[1] = y / l;
+		axis[2] = z / l;
+	}
+
+	// The extremes along the axis become the endpoints.
+	float len_sq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float min_t  = 0.0f;
+	float max_t  = 0.0f;
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		float t = ((p_block[i * 4 + 0] - mean[0]) * axis[0] + (p_block[i * 4 + 1] - mean[1]) * axis[1] + (p_block[i * 4 + 2] - mean[2]) * axis[2]) / len_sq;
+		min_t   = std::min(min_t, t);
+		max_t   = std::max(max_t, t);
+	}
+
+	float    end0[3] = {mean[0] + axis[0] * max_t, mean[1] + axis[1] * max_t, mean[2] + axis[2] * max_t};
+	float    end1[3] = {mean[0] + axis[0] * min_t, mean[1] + axis[1] * min_t, mean[2] + axis[2] * min_t};
+	uint16_t color0  = pack_rgb565(end0);
+	uint16_t color1  = pack_rgb565(end1);
+	// color0 > color1 selects the 4 color mode.
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	int palette[4][3];
+	unpack_rgb565(color0, palette[0]);
+	unpack_rgb565(color1, palette[1]);
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t best      = 0;
+			int      best_dist = std::numeric_limits<int>::max();
+			for (uint32_t p = 0; p < 4; p++)
+			{
+				int dr   = p_block[i * 4 + 0] - palette[p][0];
+				int dg   = p_block[i * 4 + 1] - palette[p][1];
+				int db   = p_block[i * 4 + 2] - palette[p][2];
+				int dist = dr * dr + dg * dg + db * db;
+				if (dist < best_dist)
+				{
+					best      = p;
+					best_dist = dist;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	p_out[0] = static_cast<uint8_t>(color0 & 0xFF);
+	p_out[1] = static_cast<uint8_t>(color0 >> 8);
+	p_out[2] = static_cast<uint8_t>(color1 & 0xFF);
+	p_out[3] = static_cast<uint8_t>(color1 >> 8);
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		p_out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+// Encode one channel of a 4x4 RGBA block. Always uses the 8 value mode.
+void encode_bc4_block(const uint8_t *p_block, uint32_t channel, uint8_t *p_out)
+{
+	uint8_t max_v = 0;
+	uint8_t min_v = 255;
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		max_v = std::max(max_v, p_block[i * 4 + channel]);
+		min_v = std::min(min_v, p_block[i * 4 + channel]);
+	}
+
+	// Code 0 is max, code 1 is min and codes 2-7 step from max to min.
+	// A flat block leaves every code at 0.
+	uint64_t indices = 0;
+	if (max_v != min_v)
+	{
+		float range = static_cast<float>(max_v - min_v);
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			uint32_t step = static_cast<uint32_t>((p_block[i * 4 + channel] - min_v) * 7.0f / range + 0.5f);
+			uint64_t code = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+			indices |= code << (i * 3);
+		}
+	}
+
+	p_out[0] = max_v;
+	p_out[1] = min_v;
+	for (uint32_t i = 0; i < 6; i++)
+	{
+		p_out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+std::vector<uint8_t> encode_bc(BCFormat format, const uint8_t *p_rgba, uint32_t width, uint32_t height)
+{
+	uint32_t             blocks_x   = (width + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+	uint32_t             blocks_y   = (height + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+	size_t               block_size = get_bc_block_size(format);
+	std::vector<uint8_t> binary(get_bc_level_size(format, width, height));
+	uint8_t              block[BC_BLOCK_DIM * BC_BLOCK_DIM * 4];
+
+	for (uint32_t by = 0; by < blocks_y; by++)
+	{
+		for (uint32_t bx = 0; bx < blocks_x; bx++)
+		{
+			fetch_block_rgba8(p_rgba, width, height, bx, by, block);
+			uint8_t *p_out = &binary[(static_cast<size_t>(by) * blocks_x + bx) * block_size];
+			switch (format)
+			{
+				case BCFormat::eBC1:
+					encode_bc1_block(block, p_out);
+					break;
+				case BCFormat::eBC3:
+					encode_bc4_block(block, 3, p_out);
+					encode_bc1_block(block, p_out + 8);
+					break;
+				case BCFormat::eBC4:
+					encode_bc4_block(block, 0, p_out);
+					break;
+				case BCFormat::eBC5:
+					encode_bc4_block(block, 0, p_out);
+					encode_bc4_block(block, 1, p_out + 8);
+					break;
+			}
+		}
+	}
+
+	return binary;
+}
+
+std::vector<uint8_t> encode_bc_mip_chain(BCFormat format, const std::vector<uint8_t> &rgba_chain, uint32_t width, uint32_t height, uint32_t level_count)
+{
+	std::vector<uint8_t> binary;
+	size_t               offset = 0;
+	for (uint32_t m = 0; m < level_count; m++)
+	{
+		uint32_t level_width  = std::max(width >> m, 1u);
+		uint32_t level_height = std::max(height >> m, 1u);
+		if (offset + static_cast<size_t>(level_width) * level_height * 4 > rgba_chain.size())
+		{
+			throw std::runtime_error("The mip chain is smaller than its level count.");
+		}
+
+		std::vector<uint8_t> level = encode_bc(format, &rgba_chain[offset], level_width, level_height);
+		binary.insert(binary.end(), level.begin(), level.end());
+		offset += static_cast<size_t>(level_width) * level_height * 4;
+	}
+	return binary;
+}
+
+}        // namespace W3D
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace W3D
+{
+
+// CPU block compression encoders. Used by the cooker, which has no device.
+// Every format works on 4x4 texel blocks. Blocks that hang over the edge of a level repeat its last row / column.
+// * The encoders fit endpoints along the principal axis of a block. They favor speed over the last bit of quality.
+
+enum class BCFormat
+{
+	eBC1,        // RGB, 8 bytes per block.
+	eBC3,        // RGBA, BC1 color plus a BC4 alpha block. 16 bytes per block.
+	eBC4,        // R, 8 bytes per block.
+	eBC5,        // RG, two BC4 blocks. 16 bytes per block.
+};
+
+// Size in bytes of one 4x4 block.
+size_t get_bc_block_size(BCFormat format);
+// Size in bytes of one compressed level.
+size_t get_bc_level_size(BCFormat format, uint32_t width, uint32_t height);
+// Compress one RGBA8 level. BC4 reads the red channel and BC5 reads red and green.
+std::vector<uint8_t> encode_bc(BCFormat format, const uint8_t *p_rgba, uint32_t width, uint32_t height);
+// Compress a tightly packed RGBA8 mip chain (see generate_mip_chain_rgba8). The levels are kept in the same order.
+std::vector<uint8_t> encode_bc_mip_chain(BCFormat format, const std::vector<uint8_t> &rgba_chain, uint32_t width, uint32_t height, uint32_t level_count);
+
+}        // namespace W3D
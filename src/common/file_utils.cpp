@@ -1,9 +1,26 @@
 #include "file_utils.hpp"
 #include "common/logging.hpp"
 
+#include <filesystem>
 #include <fstream>
+#include <stdexcept>
 #include <unordered_map>
 
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
 namespace W3D::fu
 {
 
@@ -13,6 +30,7 @@ const std::unordered_map<FileType, std::string> relative_paths = {
     {FileType::eShader, "shaders/"},
     {FileType::eModelAsset, "../assets/models/"},
     {FileType::eImage, "../assets/images/"},
+    {FileType::eCache, "cache/"},
 };
 
 // Read a binary from the shader directory.
@@ -42,6 +60,38 @@ std::vector<uint8_t> read_binary(const std::string &path)
 	return buffer;
 }
 
+// Write a file as binary.
+// The bytes go to a temporary file that is renamed over path, so a crash never leaves a half written file behind.
+void write_binary(const std::string &path, const std::vector<uint8_t> &binary)
+{
+	std::filesystem::path parent = std::filesystem::path(path).parent_path();
+	if (!parent.empty())
+	{
+		std::filesystem::create_directories(parent);
+	}
+
+	std::string   tmp_path = path + ".tmp";
+	std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		LOGE("failed to open file: {}", tmp_path);
+		throw std::runtime_error("failed to open file: " + tmp_path);
+	}
+	file.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+	file.close();
+	if (!file.good())
+	{
+		std::filesystem::remove(tmp_path);
+		throw std::runtime_error("failed to write file: " + path);
+	}
+	std::filesystem::rename(tmp_path, path);
+}
+
+bool file_exists(const std::string &path)
+{
+	return std::filesystem::exists(path);
+}
+
 // Helper function that returns a file's extension
 // Eg. aaaa.txt, the extension is txt
 std::string get_file_extension(const std::string &file_name)
@@ -59,4 +109,144 @@ const std::string compute_abs_path(const FileType type, const std::string &file)
 	return relative_paths.at(type) + file;
 }
 
+// Map the whole file into memory.
+MappedFile::MappedFile(const std::string &path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("failed to open file: " + path);
+	}
+	file_handle_ = file;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		unmap();
+		throw std::runtime_error("failed to query the size of file: " + path);
+	}
+	size_ = static_cast<size_t>(file_size.QuadPart);
+	if (size_ == 0)
+	{
+		return;
+	}
+
+	mapping_handle_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_handle_)
+	{
+		unmap();
+		throw std::runtime_error("failed to map file: " + path);
+	}
+	p_data_ = static_cast<const uint8_t *>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("failed to open file: " + path);
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0)
+	{
+		close(fd);
+		throw std::runtime_error("failed to query the size of file: " + path);
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ == 0)
+	{
+		close(fd);
+		return;
+	}
+
+	void *p_mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file.
+	close(fd);
+	if (p_mapping != MAP_FAILED)
+	{
+		p_data_ = static_cast<const uint8_t *>(p_mapping);
+	}
+#endif
+
+	if (!p_data_)
+	{
+		unmap();
+		throw std::runtime_error("failed to map file: " + path);
+	}
+}
+
+MappedFile::MappedFile(MappedFile &&rhs) :
+    p_data_(rhs.p_data_),
+    size_(rhs.size_)
+#ifdef _WIN32
+    ,
+    file_handle_(rhs.file_handle_),
+    mapping_handle_(rhs.mapping_handle_)
+#endif
+{
+	rhs.p_data_ = nullptr;
+	rhs.size_   = 0;
+#ifdef _WIN32
+	rhs.file_handle_    = nullptr;
+	rhs.mapping_handle_ = nullptr;
+#endif
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&rhs)
+{
+	if (this != &rhs)
+	{
+		unmap();
+		std::swap(p_data_, rhs.p_data_);
+		std::swap(size_, rhs.size_);
+#ifdef _WIN32
+		std::swap(file_handle_, rhs.file_handle_);
+		std::swap(mapping_handle_, rhs.mapping_handle_);
+#endif
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	unmap();
+}
+
+void MappedFile::unmap()
+{
+#ifdef _WIN32
+	if (p_data_)
+	{
+		UnmapViewOfFile(p_data_);
+	}
+	if (mapping_handle_)
+	{
+		CloseHandle(mapping_handle_);
+	}
+	if (file_handle_)
+	{
+		CloseHandle(file_handle_);
+	}
+	file_handle_    = nullptr;
+	mapping_handle_ = nullptr;
+#else
+	if (p_data_)
+	{
+		munmap(const_cast<uint8_t *>(p_data_), size_);
+	}
+#endif
+	p_data_ = nullptr;
+	size_   = 0;
+}
+
+const uint8_t *MappedFile::get_data() const
+{
+	return p_data_;
+}
+
+size_t MappedFile::get_size() const
+{
+	return size_;
+}
+
 }        // namespace W3D::fu
\ No newline at end of file
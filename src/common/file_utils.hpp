@@ -12,6 +12,7 @@ enum class FileType
 	eShader,
 	eModelAsset,
 	eImage,
+	eCache,
 };
 
 // Filesystem related utils. Decouple project structure from the rest of the application.
@@ -19,7 +20,37 @@ enum class FileType
 // Eg. read_shader_binary expects the filename to be a relative path from the shader directory.
 std::vector<uint8_t> read_shader_binary(const std::string &filename);
 std::vector<uint8_t> read_binary(const std::string &filename);
+// Create the parent directories of the file if needed. The file is replaced atomically.
+void                 write_binary(const std::string &path, const std::vector<uint8_t> &binary);
+bool                 file_exists(const std::string &path);
 std::string          get_file_extension(const std::string &filename);
 const std::string    compute_abs_path(const FileType type, const std::string &file);
 
+// RAII wrapper around a read-only memory mapped file.
+// * Pages are faulted in by the OS on first access. Nothing is copied into the heap.
+class MappedFile
+{
+  public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string &path);
+	MappedFile(MappedFile &&rhs);
+	MappedFile &operator=(MappedFile &&rhs);
+	MappedFile(const MappedFile &)            = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	const uint8_t *get_data() const;
+	size_t         get_size() const;
+
+  private:
+	void unmap();
+
+	const uint8_t *p_data_ = nullptr;
+	size_t         size_   = 0;
+#ifdef _WIN32
+	void *file_handle_    = nullptr;
+	void *mapping_handle_ = nullptr;
+#endif
+};
+
 }        // namespace W3D::fu
\ No newline at end of file
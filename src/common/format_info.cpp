@@ -0,0 +1,55 @@
+#include "format_info.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace W3D
+{
+
+bool find_format_block_info(vk::Format format, FormatBlockInfo *p_block)
+{
+	static const std::unordered_map<vk::Format, FormatBlockInfo> conversion_map{
+	    {vk::Format::eR32G32B32A32Sfloat, {1, 1, 16}},
+	    {vk::Format::eR16G16B16A16Sfloat, {1, 1, 8}},
+	    {vk::Format::eR32G32Sfloat, {1, 1, 8}},
+	    {vk::Format::eR16G16Sfloat, {1, 1, 4}},
+	    {vk::Format::eR8G8B8A8Srgb, {1, 1, 4}},
+	    {vk::Format::eR8G8B8A8Unorm, {1, 1, 4}},
+	    {vk::Format::eR8G8B8Unorm, {1, 1, 3}},
+	    {vk::Format::eR8G8Unorm, {1, 1, 2}},
+	    {vk::Format::eR8Unorm, {1, 1, 1}},
+	    {vk::Format::eBc1RgbUnormBlock, {4, 4, 8}},
+	    {vk::Format::eBc1RgbSrgbBlock, {4, 4, 8}},
+	    {vk::Format::eBc1RgbaUnormBlock, {4, 4, 8}},
+	    {vk::Format::eBc1RgbaSrgbBlock, {4, 4, 8}},
+	    {vk::Format::eBc2UnormBlock, {4, 4, 16}},
+	    {vk::Format::eBc2SrgbBlock, {4, 4, 16}},
+	    {vk::Format::eBc3UnormBlock, {4, 4, 16}},
+	    {vk::Format::eBc3SrgbBlock, {4, 4, 16}},
+	    {vk::Format::eBc4UnormBlock, {4, 4, 8}},
+	    {vk::Format::eBc4SnormBlock, {4, 4, 8}},
+	    {vk::Format::eBc5UnormBlock, {4, 4, 16}},
+	    {vk::Format::eBc5SnormBlock, {4, 4, 16}},
+	    {vk::Format::eBc6HUfloatBlock, {4, 4, 16}},
+	    {vk::Format::eBc6HSfloatBlock, {4, 4, 16}},
+	    {vk::Format::eBc7UnormBlock, {4, 4, 16}},
+	    {vk::Format::eBc7SrgbBlock, {4, 4, 16}},
+	};
+
+	auto it = conversion_map.find(format);
+	if (it == conversion_map.end())
+	{
+		return false;
+	}
+	*p_block = it->second;
+	return true;
+}
+
+size_t get_level_size(const FormatBlockInfo &block, vk::Extent3D base_extent, uint32_t level)
+{
+	size_t blocks_x = (std::max(base_extent.width >> level, 1u) + block.width - 1) / block.width;
+	size_t blocks_y = (std::max(base_extent.height >> level, 1u) + block.height - 1) / block.height;
+	return blocks_x * blocks_y * block.size;
+}
+
+}        // namespace W3D
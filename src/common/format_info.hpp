@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/vk_common.hpp"
+
+namespace W3D
+{
+
+// Texel layout of the formats W3D reads and writes. Only needs the Vulkan headers, so the cooker can use it too.
+
+// Size of a format's texel block. Uncompressed formats have 1x1 blocks.
+struct FormatBlockInfo
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t size;        // bytes per block
+};
+
+// Return false if the format is not one of them.
+bool   find_format_block_info(vk::Format format, FormatBlockInfo *p_block);
+// Size in bytes of one mip level of one layer, tightly packed.
+size_t get_level_size(const FormatBlockInfo &block, vk::Extent3D base_extent, uint32_t level);
+
+}        // namespace W3D
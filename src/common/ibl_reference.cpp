@@ -0,0 +1,789 @@
+#include "ibl_reference.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "job_system.hpp"
+#include "utils.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define W3D_IBL_REFERENCE_SSE
+#	include <emmintrin.h>
+#endif
+
+namespace W3D
+{
+
+// VkFormat values of the maps.
+const uint32_t FORMAT_RG16F   = 83;         // VK_FORMAT_R16G16_SFLOAT
+const uint32_t FORMAT_RGBA16F = 97;         // VK_FORMAT_R16G16B16A16_SFLOAT
+const uint32_t FORMAT_RGBA32F = 109;        // VK_FORMAT_R32G32B32A32_SFLOAT
+
+// Must match the bake shaders.
+const float    PI                     = 3.1415926536f;
+const float    IRRADIANCE_DELTA       = 0.025f;        // Step of the Riemann sum of irradiance.comp, in radians.
+const uint32_t PREFILTER_SAMPLE_COUNT = 32;
+const uint32_t BRDF_LUT_SAMPLE_COUNT  = 1024;
+
+// Rows are batched into jobs of at least this many texels.
+const size_t MIN_TEXELS_PER_JOB = 1024;
+
+using Vec3 = std::array<float, 3>;
+
+float dot(const Vec3 &a, const Vec3 &b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+Vec3 cross(const Vec3 &a, const Vec3 &b)
+{
+	return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+Vec3 normalize(const Vec3 &v)
+{
+	float inv_length = 1.0f / std::sqrt(dot(v, v));
+	return {v[0] * inv_length, v[1] * inv_length, v[2] * inv_length};
+}
+
+float half_to_float(uint16_t half)
+{
+	uint32_t sign     = static_cast<uint32_t>(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	uint32_t bits;
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else
+	{
+		// Zero or subnormal. Both are exact in float.
+		float value = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign ? -value : value;
+	}
+	float value;
+	std::memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+// Round to nearest even, like the GPU does when it stores to a 16 bit float image.
+uint16_t float_to_half(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(float));
+	uint16_t sign     = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	uint32_t abs_bits = bits & 0x7FFFFFFF;
+	if (abs_bits >= 0x7F800000)
+	{
+		return sign | 0x7C00 | (abs_bits > 0x7F800000 ? 0x200 : 0);
+	}
+	// 65520 and above round to infinity.
+	if (abs_bits >= 0x477FF000)
+	{
+		return sign | 0x7C00;
+	}
+	// Below 2^-14 the half is subnormal. Its mantissa counts steps of 2^-24.
+	if (abs_bits < 0x38800000)
+	{
+		return sign | static_cast<uint16_t>(std::nearbyint(std::abs(value) * 16777216.0f));
+	}
+	uint32_t rounded = abs_bits + 0xFFF + ((abs_bits >> 13) & 1);
+	return sign | static_cast<uint16_t>((rounded - 0x38000000) >> 13);
+}
+
+uint32_t get_channel_count(uint32_t vk_format)
+{
+	switch (vk_format)
+	{
+		case FORMAT_RG16F:
+			return 2;
+		case FORMAT_RGBA16F:
+		case FORMAT_RGBA32F:
+			return 4;
+	}
+	throw std::runtime_error("Unsupported IBL map format " + std::to_string(vk_format));
+}
+
+std::vector<float> unpack_texels(const KTX2Image &image)
+{
+	get_channel_count(image.vk_format);
+	if (image.vk_format == FORMAT_RGBA32F)
+	{
+		std::vector<float> texels(image.binary.size() / sizeof(float));
+		std::memcpy(texels.data(), image.binary.data(), texels.size() * sizeof(float));
+		return texels;
+	}
+
+	std::vector<float> texels(image.binary.size() / sizeof(uint16_t));
+	for (size_t i = 0; i < texels.size(); i++)
+	{
+		uint16_t half;
+		std::memcpy(&half, image.binary.data() + i * sizeof(uint16_t), sizeof(uint16_t));
+		texels[i] = half_to_float(half);
+	}
+	return texels;
+}
+
+std::vector<uint8_t> pack_texels(const std::vector<float> &texels, uint32_t vk_format)
+{
+	if (vk_format == FORMAT_RGBA32F)
+	{
+		const uint8_t *p_data = reinterpret_cast<const uint8_t *>(texels.data());
+		return std::vector<uint8_t>(p_data, p_data + texels.size() * sizeof(float));
+	}
+
+	std::vector<uint8_t> binary(texels.size() * sizeof(uint16_t));
+	for (size_t i = 0; i < texels.size(); i++)
+	{
+		uint16_t half = float_to_half(texels[i]);
+		std::memcpy(binary.data() + i * sizeof(uint16_t), &half, sizeof(uint16_t));
+	}
+	return binary;
+}
+
+// An RGBA cube map unpacked to floats. Texels are in KTX2Image order: face major, then levels from largest to smallest.
+struct FloatCube
+{
+	FloatCube(uint32_t dimension, uint32_t levels);
+
+	uint32_t     get_dimension(uint32_t level) const;
+	float       *get_level(uint32_t face, uint32_t level);
+	const float *get_level(uint32_t face, uint32_t level) const;
+
+	uint32_t            dimension;
+	uint32_t            levels;
+	size_t              face_size;            // In floats.
+	std::vector<size_t> level_offsets;        // In floats, from the start of a face.
+	std::vector<float>  texels;
+};
+
+FloatCube::FloatCube(uint32_t dimension, uint32_t levels) :
+    dimension(dimension),
+    levels(levels),
+    face_size(0)
+{
+	level_offsets.reserve(levels);
+	for (uint32_t m = 0; m < levels; m++)
+	{
+		level_offsets.push_back(face_size);
+		size_t level_dimension = get_dimension(m);
+		face_size += level_dimension * level_dimension * 4;
+	}
+	texels.resize(face_size * 6);
+}
+
+uint32_t FloatCube::get_dimension(uint32_t level) const
+{
+	return std::max(dimension >> level, 1u);
+}
+
+float *FloatCube::get_level(uint32_t face, uint32_t level)
+{
+	return texels.data() + face * face_size + level_offsets[level];
+}
+
+const float *FloatCube::get_level(uint32_t face, uint32_t level) const
+{
+	return texels.data() + face * face_size + level_offsets[level];
+}
+
+FloatCube unpack_cube(const KTX2Image &image)
+{
+	if (image.faces != 6 || image.width != image.height || get_channel_count(image.vk_format) != 4)
+	{
+		throw std::runtime_error("The environment map must be an RGBA16F or RGBA32F cube map");
+	}
+
+	FloatCube cube(image.width, image.levels);
+	cube.texels = unpack_texels(image);
+	if (cube.texels.size() != cube.face_size * 6)
+	{
+		throw std::runtime_error("The environment map doesn't hold every level of its cube");
+	}
+	return cube;
+}
+
+KTX2Image pack_cube(const FloatCube &cube, uint32_t vk_format)
+{
+	return {
+	    .vk_format = vk_format,
+	    .width     = cube.dimension,
+	    .height    = cube.dimension,
+	    .levels    = cube.levels,
+	    .faces     = 6,
+	    .binary    = pack_texels(cube.texels, vk_format),
+	};
+}
+
+// An RGBA texel in a register. With SSE, the 4 channels are filtered at once.
+#ifdef W3D_IBL_REFERENCE_SSE
+using Texel = __m128;
+
+Texel load_texel(const float *p_texel)
+{
+	return _mm_loadu_ps(p_texel);
+}
+
+Texel zero_texel()
+{
+	return _mm_setzero_ps();
+}
+
+void store_texel(Texel texel, float *p_texel)
+{
+	_mm_storeu_ps(p_texel, texel);
+}
+
+Texel lerp_texels(Texel a, Texel b, float t)
+{
+	return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+}
+
+Texel add_weighted_texel(Texel sum, Texel texel, float weight)
+{
+	return _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(weight)));
+}
+#else
+using Texel = std::array<float, 4>;
+
+Texel load_texel(const float *p_texel)
+{
+	return {p_texel[0], p_texel[1], p_texel[2], p_texel[3]};
+}
+
+Texel zero_texel()
+{
+	return {0.0f, 0.0f, 0.0f, 0.0f};
+}
+
+void store_texel(Texel texel, float *p_texel)
+{
+	std::memcpy(p_texel, texel.data(), sizeof(Texel));
+}
+
+Texel lerp_texels(Texel a, Texel b, float t)
+{
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		a[c] += (b[c] - a[c]) * t;
+	}
+	return a;
+}
+
+Texel add_weighted_texel(Texel sum, Texel texel, float weight)
+{
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		sum[c] += texel[c] * weight;
+	}
+	return sum;
+}
+#endif
+
+struct CubeCoord
+{
+	uint32_t face;
+	float    u;
+	float    v;
+};
+
+// Cube map face selection of the Vulkan spec.
+CubeCoord get_cube_coord(float x, float y, float z)
+{
+	float ax = std::abs(x);
+	float ay = std::abs(y);
+	float az = std::abs(z);
+	if (ax >= ay && ax >= az)
+	{
+		return {x >= 0.0f ? 0u : 1u, 0.5f * ((x >= 0.0f ? -z : z) / ax + 1.0f), 0.5f * (-y / ax + 1.0f)};
+	}
+	if (ay >= az)
+	{
+		return {y >= 0.0f ? 2u : 3u, 0.5f * (x / ay + 1.0f), 0.5f * ((y >= 0.0f ? z : -z) / ay + 1.0f)};
+	}
+	return {z >= 0.0f ? 4u : 5u, 0.5f * ((z >= 0.0f ? x : -x) / az + 1.0f), 0.5f * (-y / az + 1.0f)};
+}
+
+// Direction through the center of a texel. The inverse of get_cube_coord(), like cube_dir() of ibl_common.glsl.
+Vec3 get_texel_dir(uint32_t face, uint32_t x, uint32_t y, uint32_t size)
+{
+	float u = (x + 0.5f) / size * 2.0f - 1.0f;
+	float v = (y + 0.5f) / size * 2.0f - 1.0f;
+	switch (face)
+	{
+		case 0:
+			return normalize({1.0f, -v, -u});
+		case 1:
+			return normalize({-1.0f, -v, u});
+		case 2:
+			return normalize({u, 1.0f, v});
+		case 3:
+			return normalize({u, -1.0f, -v});
+		case 4:
+			return normalize({u, -v, 1.0f});
+	}
+	return normalize({-u, -v, -1.0f});
+}
+
+// Bilinear filtering, clamped to the edges of the face.
+Texel sample_level(const FloatCube &cube, const CubeCoord &coord, uint32_t level)
+{
+	int32_t      size    = static_cast<int32_t>(cube.get_dimension(level));
+	const float *p_level = cube.get_level(coord.face, level);
+
+	float   x       = coord.u * size - 0.5f;
+	float   y       = coord.v * size - 0.5f;
+	float   x_floor = std::floor(x);
+	float   y_floor = std::floor(y);
+	int32_t x0      = std::clamp(static_cast<int32_t>(x_floor), 0, size - 1);
+	int32_t x1      = std::clamp(static_cast<int32_t>(x_floor) + 1, 0, size - 1);
+	int32_t y0      = std::clamp(static_cast<int32_t>(y_floor), 0, size - 1);
+	int32_t y1      = std::clamp(static_cast<int32_t>(y_floor) + 1, 0, size - 1);
+
+	Texel top    = lerp_texels(load_texel(p_level + (y0 * size + x0) * 4), load_texel(p_level + (y0 * size + x1) * 4), x - x_floor);
+	Texel bottom = lerp_texels(load_texel(p_level + (y1 * size + x0) * 4), load_texel(p_level + (y1 * size + x1) * 4), x - x_floor);
+	return lerp_texels(top, bottom, y - y_floor);
+}
+
+// Trilinear filtering, like textureLod() with a linear mipmap sampler.
+Texel sample_cube(const FloatCube &cube, const CubeCoord &coord, float lod)
+{
+	lod            = std::clamp(lod, 0.0f, static_cast<float>(cube.levels - 1));
+	uint32_t level = static_cast<uint32_t>(lod);
+	float    t     = lod - level;
+	Texel    texel = sample_level(cube, coord, level);
+	if (t > 0.0f)
+	{
+		texel = lerp_texels(texel, sample_level(cube, coord, level + 1), t);
+	}
+	return texel;
+}
+
+// Fill a level of the cube. row_job(face, y, p_row) writes the RGBA texels of a row. The rows of all 6 faces run in parallel.
+template <typename RowJob>
+void bake_level(FloatCube &cube, uint32_t level, const RowJob &row_job)
+{
+	uint32_t size  = cube.get_dimension(level);
+	size_t   grain = std::max<size_t>(MIN_TEXELS_PER_JOB / size, 1);
+	JobSystem::get().parallel_for(0, size_t(6) * size, grain, [&](size_t first, size_t last) {
+		for (size_t row = first; row < last; row++)
+		{
+			uint32_t face = static_cast<uint32_t>(row / size);
+			uint32_t y    = static_cast<uint32_t>(row % size);
+			row_job(face, y, cube.get_level(face, level) + size_t(y) * size * 4);
+		}
+	});
+}
+
+// Radical inverse based on http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+std::array<float, 2> hammersley2d(uint32_t i, uint32_t n)
+{
+	uint32_t bits = (i << 16u) | (i >> 16u);
+	bits          = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits          = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits          = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits          = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return {static_cast<float>(i) / static_cast<float>(n), static_cast<float>(bits) * 2.3283064365386963e-10f};
+}
+
+// random() of ibl_common.glsl. importance_sample_GGX() jitters its samples with it.
+float random(float x, float y)
+{
+	float dt    = x * 12.9898f + y * 78.233f;
+	float sn    = dt - 3.14f * std::floor(dt / 3.14f);
+	float value = std::sin(sn) * 43758.5453f;
+	return value - std::floor(value);
+}
+
+// cos(theta) of the GGX sample importance_sample_GGX() maps xi_y to.
+float get_ggx_cos_theta(float xi_y, float roughness)
+{
+	float alpha = roughness * roughness;
+	return std::sqrt((1.0f - xi_y) / (1.0f + (alpha * alpha - 1.0f) * xi_y));
+}
+
+float d_ggx(float dot_nh, float roughness)
+{
+	float alpha   = roughness * roughness;
+	float alpha_2 = alpha * alpha;
+	float denom   = dot_nh * dot_nh * (alpha_2 - 1.0f) + 1.0f;
+	return alpha_2 / (PI * denom * denom);
+}
+
+// Samples in SoA order, padded to a multiple of 4 with samples that weigh nothing.
+// The SIMD paths transform 4 of them at a time into the frame of a texel.
+struct IrradianceSamples
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> weight;
+	uint32_t           count;        // Samples the shader takes. It divides the sum by it, the weightless ones included.
+};
+
+IrradianceSamples create_irradiance_samples()
+{
+	IrradianceSamples samples;
+	// Step in float like the shader does, so that the sample count matches.
+	for (float phi = 0.0f; phi < 2.0f * PI; phi += IRRADIANCE_DELTA)
+	{
+		for (float theta = 0.0f; theta < 0.5f * PI; theta += IRRADIANCE_DELTA)
+		{
+			samples.x.push_back(std::sin(theta) * std::cos(phi));
+			samples.y.push_back(std::sin(theta) * std::sin(phi));
+			samples.z.push_back(std::cos(theta));
+			samples.weight.push_back(std::cos(theta) * std::sin(theta));
+		}
+	}
+	samples.count = static_cast<uint32_t>(samples.weight.size());
+	while (samples.weight.size() % 4)
+	{
+		samples.x.push_back(0.0f);
+		samples.y.push_back(0.0f);
+		samples.z.push_back(1.0f);
+		samples.weight.push_back(0.0f);
+	}
+	return samples;
+}
+
+struct PrefilterSamples
+{
+	std::vector<float> cos_phi;          // Before the jitter.
+	std::vector<float> sin_phi;
+	std::vector<float> cos_theta;        // dot(N, H) and dot(V, H), since V = N.
+	std::vector<float> sin_theta;
+	std::vector<float> weight;           // dot(N, L). 0 for the samples the shader skips.
+	std::vector<float> lod;
+};
+
+// The weight and lod of a sample only depend on its angle to N. They are computed once per roughness.
+PrefilterSamples create_prefilter_samples(float roughness, uint32_t environment_dimension)
+{
+	PrefilterSamples samples;
+	// Solid angle of 1 pixel across all cube faces
+	float omega_p = 4.0f * PI / (6.0f * environment_dimension * environment_dimension);
+	for (uint32_t i = 0; i < PREFILTER_SAMPLE_COUNT; i++)
+	{
+		std::array<float, 2> xi        = hammersley2d(i, PREFILTER_SAMPLE_COUNT);
+		float                phi       = 2.0f * PI * xi[0];
+		float                cos_theta = get_ggx_cos_theta(xi[1], roughness);
+		float                dot_nl    = 2.0f * cos_theta * cos_theta - 1.0f;
+
+		float lod = 0.0f;
+		if (roughness > 0.0f)
+		{
+			float pdf     = d_ggx(cos_theta, roughness) / 4.0f + 0.0001f;
+			float omega_s = 1.0f / (PREFILTER_SAMPLE_COUNT * pdf);
+			lod           = std::max(0.5f * std::log2(omega_s / omega_p) + 1.0f, 0.0f);
+		}
+
+		samples.cos_phi.push_back(std::cos(phi));
+		samples.sin_phi.push_back(std::sin(phi));
+		samples.cos_theta.push_back(cos_theta);
+		samples.sin_theta.push_back(std::sqrt(std::max(1.0f - cos_theta * cos_theta, 0.0f)));
+		samples.weight.push_back(std::max(dot_nl, 0.0f));
+		samples.lod.push_back(lod);
+	}
+	while (samples.weight.size() % 4)
+	{
+		samples.cos_phi.push_back(1.0f);
+		samples.sin_phi.push_back(0.0f);
+		samples.cos_theta.push_back(1.0f);
+		samples.sin_theta.push_back(0.0f);
+		samples.weight.push_back(0.0f);
+		samples.lod.push_back(0.0f);
+	}
+	return samples;
+}
+
+// Rotate 4 samples into the frame (t, b, n). p_out receives the 4 x, then the 4 y and the 4 z.
+void transform_samples_4(const float *p_x, const float *p_y, const float *p_z, const Vec3 &t, const Vec3 &b, const Vec3 &n, float *p_out)
+{
+#ifdef W3D_IBL_REFERENCE_SSE
+	__m128 x = _mm_loadu_ps(p_x);
+	__m128 y = _mm_loadu_ps(p_y);
+	__m128 z = _mm_loadu_ps(p_z);
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		__m128 world = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(t[c])), _mm_mul_ps(y, _mm_set1_ps(b[c]))), _mm_mul_ps(z, _mm_set1_ps(n[c])));
+		_mm_storeu_ps(p_out + c * 4, world);
+	}
+#else
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			p_out[c * 4 + lane] = p_x[lane] * t[c] + p_y[lane] * b[c] + p_z[lane] * n[c];
+		}
+	}
+#endif
+}
+
+// L of 4 prefilter samples around n, jittered by the angle (cos_jitter, sin_jitter). Same output layout as transform_samples_4().
+void get_prefilter_dirs_4(const PrefilterSamples &samples, size_t i, float cos_jitter, float sin_jitter, const Vec3 &t, const Vec3 &b, const Vec3 &n, float *p_out)
+{
+	alignas(16) float h[8];
+	alignas(16) float world[12];
+#ifdef W3D_IBL_REFERENCE_SSE
+	__m128 cos_phi   = _mm_loadu_ps(&samples.cos_phi[i]);
+	__m128 sin_phi   = _mm_loadu_ps(&samples.sin_phi[i]);
+	__m128 sin_theta = _mm_loadu_ps(&samples.sin_theta[i]);
+	__m128 cos_j     = _mm_set1_ps(cos_jitter);
+	__m128 sin_j     = _mm_set1_ps(sin_jitter);
+	// cos and sin of phi + jitter.
+	__m128 cos_phi_j = _mm_sub_ps(_mm_mul_ps(cos_phi, cos_j), _mm_mul_ps(sin_phi, sin_j));
+	__m128 sin_phi_j = _mm_add_ps(_mm_mul_ps(sin_phi, cos_j), _mm_mul_ps(cos_phi, sin_j));
+	_mm_store_ps(h, _mm_mul_ps(sin_theta, cos_phi_j));
+	_mm_store_ps(h + 4, _mm_mul_ps(sin_theta, sin_phi_j));
+#else
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		h[lane]     = samples.sin_theta[i + lane] * (samples.cos_phi[i + lane] * cos_jitter - samples.sin_phi[i + lane] * sin_jitter);
+		h[4 + lane] = samples.sin_theta[i + lane] * (samples.sin_phi[i + lane] * cos_jitter + samples.cos_phi[i + lane] * sin_jitter);
+	}
+#endif
+	transform_samples_4(h, h + 4, &samples.cos_theta[i], t, b, n, world);
+
+	// L = 2 * dot(V, H) * H - V, with V = N and dot(V, H) = cos(theta).
+#ifdef W3D_IBL_REFERENCE_SSE
+	__m128 two_cos_theta = _mm_add_ps(_mm_loadu_ps(&samples.cos_theta[i]), _mm_loadu_ps(&samples.cos_theta[i]));
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		_mm_storeu_ps(p_out + c * 4, _mm_sub_ps(_mm_mul_ps(two_cos_theta, _mm_load_ps(world + c * 4)), _mm_set1_ps(n[c])));
+	}
+#else
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			p_out[c * 4 + lane] = 2.0f * samples.cos_theta[i + lane] * world[c * 4 + lane] - n[c];
+		}
+	}
+#endif
+}
+
+// Sum of the split sum terms of 4 samples, for the view vector (v_x, 0, v_z) and N = z.
+// h_x and h_z are the components of the half vectors. Samples below the horizon are masked out.
+void add_brdf_samples_4(const float *p_h_x, const float *p_h_z, float v_x, float v_z, float k, float g_v, float *p_scale, float *p_bias)
+{
+#ifdef W3D_IBL_REFERENCE_SSE
+	__m128 zero   = _mm_setzero_ps();
+	__m128 one    = _mm_set1_ps(1.0f);
+	__m128 h_x    = _mm_loadu_ps(p_h_x);
+	__m128 h_z    = _mm_loadu_ps(p_h_z);
+	__m128 v_dot  = _mm_add_ps(_mm_mul_ps(h_x, _mm_set1_ps(v_x)), _mm_mul_ps(h_z, _mm_set1_ps(v_z)));
+	__m128 dot_nl = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(v_dot, v_dot), h_z), _mm_set1_ps(v_z));
+	__m128 mask   = _mm_cmpgt_ps(dot_nl, zero);
+	__m128 dot_vh = _mm_max_ps(v_dot, zero);
+
+	__m128 g_l   = _mm_div_ps(dot_nl, _mm_add_ps(_mm_mul_ps(dot_nl, _mm_set1_ps(1.0f - k)), _mm_set1_ps(k)));
+	__m128 g_vis = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(g_l, _mm_set1_ps(g_v)), dot_vh), _mm_mul_ps(h_z, _mm_set1_ps(v_z)));
+	__m128 fc_1  = _mm_sub_ps(one, dot_vh);
+	__m128 fc_2  = _mm_mul_ps(fc_1, fc_1);
+	__m128 fc    = _mm_mul_ps(_mm_mul_ps(fc_2, fc_2), fc_1);
+
+	alignas(16) float scale[4];
+	alignas(16) float bias[4];
+	_mm_store_ps(scale, _mm_and_ps(mask, _mm_mul_ps(_mm_sub_ps(one, fc), g_vis)));
+	_mm_store_ps(bias, _mm_and_ps(mask, _mm_mul_ps(fc, g_vis)));
+	*p_scale += (scale[0] + scale[1]) + (scale[2] + scale[3]);
+	*p_bias += (bias[0] + bias[1]) + (bias[2] + bias[3]);
+#else
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		float v_dot  = p_h_x[lane] * v_x + p_h_z[lane] * v_z;
+		float dot_nl = 2.0f * v_dot * p_h_z[lane] - v_z;
+		if (dot_nl > 0.0f)
+		{
+			float dot_vh = std::max(v_dot, 0.0f);
+			float g_l    = dot_nl / (dot_nl * (1.0f - k) + k);
+			float g_vis  = g_l * g_v * dot_vh / (p_h_z[lane] * v_z);
+			float fc     = std::pow(1.0f - dot_vh, 5.0f);
+			*p_scale += (1.0f - fc) * g_vis;
+			*p_bias += fc * g_vis;
+		}
+	}
+#endif
+}
+
+KTX2Image bake_irradiance_reference(const KTX2Image &environment, uint32_t dimension)
+{
+	FloatCube         source  = unpack_cube(environment);
+	FloatCube         cube(dimension, max_mip_levels(dimension, dimension));
+	IrradianceSamples samples = create_irradiance_samples();
+	float             scale   = PI / samples.count;
+
+	// Every level is convolved on its own, like bake_cube_map() does.
+	for (uint32_t m = 0; m < cube.levels; m++)
+	{
+		uint32_t size = cube.get_dimension(m);
+		bake_level(cube, m, [&](uint32_t face, uint32_t y, float *p_row) {
+			alignas(16) float world[12];
+			for (uint32_t x = 0; x < size; x++)
+			{
+				Vec3 n     = get_texel_dir(face, x, y, size);
+				Vec3 up    = std::abs(n[1]) < 0.999f ? Vec3{0.0f, 1.0f, 0.0f} : Vec3{0.0f, 0.0f, 1.0f};
+				Vec3 right = normalize(cross(up, n));
+				up         = cross(n, right);
+
+				Texel sum = zero_texel();
+				for (size_t i = 0; i < samples.weight.size(); i += 4)
+				{
+					transform_samples_4(&samples.x[i], &samples.y[i], &samples.z[i], right, up, n, world);
+					for (uint32_t lane = 0; lane < 4; lane++)
+					{
+						float weight = samples.weight[i + lane];
+						if (weight > 0.0f)
+						{
+							CubeCoord coord = get_cube_coord(world[lane], world[4 + lane], world[8 + lane]);
+							sum             = add_weighted_texel(sum, sample_level(source, coord, 0), weight);
+						}
+					}
+				}
+
+				float *p_texel = p_row + x * 4;
+				store_texel(sum, p_texel);
+				p_texel[0] *= scale;
+				p_texel[1] *= scale;
+				p_texel[2] *= scale;
+				p_texel[3] = 1.0f;
+			}
+		});
+	}
+	return pack_cube(cube, FORMAT_RGBA32F);
+}
+
+KTX2Image bake_prefilter_reference(const KTX2Image &environment, uint32_t dimension)
+{
+	FloatCube source = unpack_cube(environment);
+	FloatCube cube(dimension, max_mip_levels(dimension, dimension));
+
+	for (uint32_t m = 0; m < cube.levels; m++)
+	{
+		uint32_t         size      = cube.get_dimension(m);
+		float            roughness = cube.levels > 1 ? static_cast<float>(m) / (cube.levels - 1) : 0.0f;
+		PrefilterSamples samples   = create_prefilter_samples(roughness, source.dimension);
+		bake_level(cube, m, [&](uint32_t face, uint32_t y, float *p_row) {
+			alignas(16) float dirs[12];
+			for (uint32_t x = 0; x < size; x++)
+			{
+				Vec3  n      = get_texel_dir(face, x, y, size);
+				Vec3  up     = std::abs(n[2]) < 0.999f ? Vec3{0.0f, 0.0f, 1.0f} : Vec3{1.0f, 0.0f, 0.0f};
+				Vec3  t      = normalize(cross(up, n));
+				Vec3  b      = normalize(cross(n, t));
+				float jitter = random(n[0], n[2]) * 0.1f;
+
+				Texel sum          = zero_texel();
+				float total_weight = 0.0f;
+				for (size_t i = 0; i < samples.weight.size(); i += 4)
+				{
+					get_prefilter_dirs_4(samples, i, std::cos(jitter), std::sin(jitter), t, b, n, dirs);
+					for (uint32_t lane = 0; lane < 4; lane++)
+					{
+						float weight = samples.weight[i + lane];
+						if (weight > 0.0f)
+						{
+							CubeCoord coord = get_cube_coord(dirs[lane], dirs[4 + lane], dirs[8 + lane]);
+							sum             = add_weighted_texel(sum, sample_cube(source, coord, samples.lod[i + lane]), weight);
+							total_weight += weight;
+						}
+					}
+				}
+
+				float *p_texel = p_row + x * 4;
+				store_texel(sum, p_texel);
+				p_texel[0] /= total_weight;
+				p_texel[1] /= total_weight;
+				p_texel[2] /= total_weight;
+				p_texel[3] = 1.0f;
+			}
+		});
+	}
+	return pack_cube(cube, FORMAT_RGBA16F);
+}
+
+KTX2Image bake_brdf_lut_reference(uint32_t dimension)
+{
+	std::vector<float> texels(size_t(dimension) * dimension * 2);
+	// importance_sample_GGX() jitters the samples by random(N.xz). N is the z axis for every texel.
+	float jitter = random(0.0f, 1.0f) * 0.1f;
+
+	size_t grain = std::max<size_t>(MIN_TEXELS_PER_JOB / dimension, 1);
+	JobSystem::get().parallel_for(0, dimension, grain, [&](size_t first, size_t last) {
+		std::vector<float> h_x(BRDF_LUT_SAMPLE_COUNT);
+		std::vector<float> h_z(BRDF_LUT_SAMPLE_COUNT);
+		for (size_t y = first; y < last; y++)
+		{
+			// Each row has its own roughness. Its half vectors are shared by the whole row.
+			// With N = z, the tangent frame of importance_sample_GGX() is (0, -1, 0), (1, 0, 0), so H.x = sin(theta) * sin(phi).
+			float roughness = (y + 0.5f) / dimension;
+			for (uint32_t i = 0; i < BRDF_LUT_SAMPLE_COUNT; i++)
+			{
+				std::array<float, 2> xi        = hammersley2d(i, BRDF_LUT_SAMPLE_COUNT);
+				float                phi       = 2.0f * PI * xi[0] + jitter;
+				float                cos_theta = get_ggx_cos_theta(xi[1], roughness);
+				h_x[i]                         = std::sqrt(std::max(1.0f - cos_theta * cos_theta, 0.0f)) * std::sin(phi);
+				h_z[i]                         = cos_theta;
+			}
+
+			float k = roughness * roughness / 2.0f;
+			for (uint32_t x = 0; x < dimension; x++)
+			{
+				float dot_nv = (x + 0.5f) / dimension;
+				float v_x    = std::sqrt(1.0f - dot_nv * dot_nv);
+				float g_v    = dot_nv / (dot_nv * (1.0f - k) + k);
+				float scale  = 0.0f;
+				float bias   = 0.0f;
+				for (uint32_t i = 0; i < BRDF_LUT_SAMPLE_COUNT; i += 4)
+				{
+					add_brdf_samples_4(&h_x[i], &h_z[i], v_x, dot_nv, k, g_v, &scale, &bias);
+				}
+				texels[(y * dimension + x) * 2]     = scale / BRDF_LUT_SAMPLE_COUNT;
+				texels[(y * dimension + x) * 2 + 1] = bias / BRDF_LUT_SAMPLE_COUNT;
+			}
+		}
+	});
+
+	return {
+	    .vk_format = FORMAT_RG16F,
+	    .width     = dimension,
+	    .height    = dimension,
+	    .levels    = 1,
+	    .faces     = 1,
+	    .binary    = pack_texels(texels, FORMAT_RG16F),
+	};
+}
+
+IBLMapError compare_ibl_maps(const KTX2Image &map, const KTX2Image &reference)
+{
+	if (map.vk_format != reference.vk_format || map.width != reference.width || map.height != reference.height ||
+	    map.levels != reference.levels || map.faces != reference.faces || map.binary.size() != reference.binary.size())
+	{
+		throw std::runtime_error("The IBL maps don't have the same format and extent");
+	}
+
+	std::vector<float> texels           = unpack_texels(map);
+	std::vector<float> reference_texels = unpack_texels(reference);
+	IBLMapError        error{0.0f, 0.0f};
+	double             error_sum = 0.0;
+	for (size_t i = 0; i < texels.size(); i++)
+	{
+		float difference = std::abs(texels[i] - reference_texels[i]);
+		error.max_error  = std::max(error.max_error, difference);
+		error_sum += difference;
+	}
+	error.mean_error = texels.empty() ? 0.0f : static_cast<float>(error_sum / texels.size());
+	return error;
+}
+
+}        // namespace W3D
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ktx2.hpp"
+
+namespace W3D
+{
+
+// CPU reference of the IBL bake of PBRBaker. It needs no device.
+// The maps are sampled like the bake shaders sample them, so they are a golden reference to validate the GPU bake against.
+// The cooker bakes them offline with it. See W3DCooker --ibl.
+// Rows of texels are spread over the JobSystem. Samples are transformed 4 at a time and texels are filtered as RGBA vectors with SSE.
+// * Texels are filtered within their face, clamped to its edges. The GPU filters across the faces, so the maps differ slightly along the face edges.
+
+// Environment maps are RGBA16F or RGBA32F cube maps. Their mip chain is sampled by the prefilter.
+// Each map is returned in the format and layout of its PBRBaker counterpart.
+KTX2Image bake_irradiance_reference(const KTX2Image &environment, uint32_t dimension);        // RGBA32F, full mip chain.
+KTX2Image bake_prefilter_reference(const KTX2Image &environment, uint32_t dimension);         // RGBA16F, full mip chain. Level m has roughness m / (levels - 1).
+KTX2Image bake_brdf_lut_reference(uint32_t dimension);                                        // RG16F.
+
+struct IBLMapError
+{
+	float max_error;         // Largest absolute difference of a channel.
+	float mean_error;        // Over every channel of every texel.
+};
+
+// The maps must have the same format and extent.
+IBLMapError compare_ibl_maps(const KTX2Image &map, const KTX2Image &reference);
+
+}        // namespace W3D
@@ -0,0 +1,329 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+
+#include "common/logging.hpp"
+
+namespace W3D
+{
+
+// The system and worker index of the current thread. -1 on threads that are not workers.
+thread_local JobSystem *tls_p_job_system = nullptr;
+thread_local int32_t    tls_worker_idx   = -1;
+
+bool JobGroup::is_done() const
+{
+	return pending_.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem &JobSystem::get()
+{
+	static JobSystem job_system;
+	return job_system;
+}
+
+JobSystem::JobSystem(uint32_t worker_count) :
+    main_thread_id_(std::this_thread::get_id())
+{
+	if (worker_count == 0)
+	{
+		uint32_t hardware_threads = std::thread::hardware_concurrency();
+		worker_count              = hardware_threads > 1 ? hardware_threads - 1 : 1;
+	}
+
+	p_workers_.reserve(worker_count);
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		p_workers_.push_back(std::make_unique<Worker>());
+	}
+	// Start the threads once every deque exists. They steal from each other right away.
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		p_workers_[i]->thread = std::thread(&JobSystem::worker_loop, this, i);
+	}
+
+	stats_timer_.start();
+}
+
+// Workers finish the jobs that are queued before they exit.
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		stop_ = true;
+	}
+	sleep_cv_.notify_all();
+	for (auto &p_worker : p_workers_)
+	{
+		p_worker->thread.join();
+	}
+}
+
+void JobSystem::run(JobGroup &group, Job job)
+{
+	group.pending_.fetch_add(1, std::memory_order_relaxed);
+	push({
+	    .job     = std::move(job),
+	    .p_group = &group,
+	});
+}
+
+// Run jobs until the group is done, then rethrow the first exception of its jobs.
+// The main thread runs its own queue as well, so a group can wait on main thread jobs.
+void JobSystem::wait(JobGroup &group)
+{
+	int32_t worker_idx = tls_p_job_system == this ? tls_worker_idx : -1;
+	while (!group.is_done())
+	{
+		if (is_main_thread())
+		{
+			process_main_thread_jobs();
+		}
+		if (!try_run_one(worker_idx))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(group.error_mutex_);
+	if (group.p_error_)
+	{
+		std::exception_ptr p_error = group.p_error_;
+		group.p_error_             = nullptr;
+		std::rethrow_exception(p_error);
+	}
+}
+
+void JobSystem::parallel_for(size_t begin, size_t end, size_t grain_size, const RangeJob &range_job)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	grain_size = std::max<size_t>(grain_size, 1);
+	// A single range is not worth a round trip through the deques.
+	if (end - begin <= grain_size)
+	{
+		range_job(begin, end);
+		return;
+	}
+
+	JobGroup group;
+	for (size_t first = begin; first < end; first += grain_size)
+	{
+		size_t last = std::min(first + grain_size, end);
+		run(group, [&range_job, first, last]() {
+			range_job(first, last);
+		});
+	}
+	wait(group);
+}
+
+void JobSystem::run_on_main_thread(Job job)
+{
+	std::lock_guard<std::mutex> lock(main_mutex_);
+	main_tasks_.push_back({
+	    .job     = std::move(job),
+	    .p_group = nullptr,
+	});
+}
+
+// Main thread only.
+void JobSystem::process_main_thread_jobs()
+{
+	std::vector<Task> tasks;
+	{
+		std::lock_guard<std::mutex> lock(main_mutex_);
+		tasks.swap(main_tasks_);
+	}
+	for (Task &task : tasks)
+	{
+		execute(task);
+	}
+}
+
+bool JobSystem::is_main_thread() const
+{
+	return std::this_thread::get_id() == main_thread_id_;
+}
+
+uint32_t JobSystem::get_worker_count() const
+{
+	return static_cast<uint32_t>(p_workers_.size());
+}
+
+JobSystemStats JobSystem::get_stats()
+{
+	JobSystemStats stats{
+	    .worker_count = get_worker_count(),
+	    .elapsed_time = stats_timer_.elapsed() - stats_start_,
+	};
+	for (auto &p_worker : p_workers_)
+	{
+		stats.executed_jobs += p_worker->executed_jobs;
+		stats.stolen_jobs += p_worker->stolen_jobs;
+		stats.busy_time += p_worker->busy_time;
+	}
+	double available_time = stats.elapsed_time * stats.worker_count;
+	stats.utilization     = available_time > 0.0 ? stats.busy_time / available_time : 0.0;
+	return stats;
+}
+
+// * A job that finishes during the reset may still be counted in the new period.
+void JobSystem::reset_stats()
+{
+	for (auto &p_worker : p_workers_)
+	{
+		p_worker->executed_jobs = 0;
+		p_worker->stolen_jobs   = 0;
+		p_worker->busy_time     = 0.0;
+	}
+	stats_start_ = stats_timer_.elapsed();
+}
+
+void JobSystem::log_stats()
+{
+	JobSystemStats stats = get_stats();
+	LOGI("Job system: {} workers ran {} jobs ({} stolen) in {:.2f}s, {:.1f}% utilization.",
+	     stats.worker_count,
+	     stats.executed_jobs,
+	     stats.stolen_jobs,
+	     stats.elapsed_time,
+	     stats.utilization * 100.0);
+}
+
+void JobSystem::worker_loop(uint32_t worker_idx)
+{
+	tls_p_job_system = this;
+	tls_worker_idx   = static_cast<int32_t>(worker_idx);
+
+	while (true)
+	{
+		if (try_run_one(tls_worker_idx))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		sleep_cv_.wait(lock, [this]() {
+			return stop_ || queued_tasks_ > 0;
+		});
+		if (stop_ && queued_tasks_ == 0)
+		{
+			return;
+		}
+	}
+}
+
+// Workers push to their own deque, other threads deal jobs round robin.
+void JobSystem::push(Task &&task)
+{
+	uint32_t worker_idx = tls_p_job_system == this ? tls_worker_idx : next_worker_++ % get_worker_count();
+	Worker  &worker     = *p_workers_[worker_idx];
+
+	// Count the task before it can be popped, so the count never drops below zero.
+	// Taking the sleep mutex makes sure no worker is between its check and its wait.
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		queued_tasks_++;
+	}
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	sleep_cv_.notify_one();
+}
+
+// Pop from the back of our own deque first, then steal from the front of the others.
+bool JobSystem::pop(int32_t worker_idx, Task &task)
+{
+	uint32_t worker_count = get_worker_count();
+	if (worker_idx >= 0)
+	{
+		Worker                     &worker = *p_workers_[worker_idx];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.tasks.empty())
+		{
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+			return true;
+		}
+	}
+
+	uint32_t first_victim = worker_idx >= 0 ? worker_idx + 1 : next_worker_.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		uint32_t victim_idx = (first_victim + i) % worker_count;
+		if (static_cast<int32_t>(victim_idx) == worker_idx)
+		{
+			continue;
+		}
+
+		Worker                     &victim = *p_workers_[victim_idx];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			if (worker_idx >= 0)
+			{
+				p_workers_[worker_idx]->stolen_jobs++;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::try_run_one(int32_t worker_idx)
+{
+	Task task;
+	if (!pop(worker_idx, task))
+	{
+		return false;
+	}
+	queued_tasks_--;
+
+	if (worker_idx < 0)
+	{
+		execute(task);
+		return true;
+	}
+
+	// Only time spent in jobs counts towards utilization.
+	Worker &worker = *p_workers_[worker_idx];
+	worker.timer.tick();
+	execute(task);
+	worker.busy_time = worker.busy_time + worker.timer.tick();
+	worker.executed_jobs++;
+	return true;
+}
+
+void JobSystem::execute(Task &task)
+{
+	try
+	{
+		task.job();
+	}
+	catch (...)
+	{
+		if (!task.p_group)
+		{
+			LOGE("A main thread job threw an exception.");
+			abort();
+		}
+		std::lock_guard<std::mutex> lock(task.p_group->error_mutex_);
+		if (!task.p_group->p_error_)
+		{
+			task.p_group->p_error_ = std::current_exception();
+		}
+	}
+
+	if (task.p_group)
+	{
+		task.p_group->pending_.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+}        // namespace W3D
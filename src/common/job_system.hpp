@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "timer.hpp"
+
+namespace W3D
+{
+
+using Job      = std::function<void()>;
+using RangeJob = std::function<void(size_t first, size_t last)>;
+
+// Counter of the unfinished jobs of a group.
+// The first exception one of its jobs throws is kept and rethrown by JobSystem::wait().
+// ! A group must outlive its jobs. Wait on it before it goes out of scope.
+class JobGroup
+{
+  public:
+	JobGroup()                            = default;
+	JobGroup(const JobGroup &)            = delete;
+	JobGroup &operator=(const JobGroup &) = delete;
+
+	bool is_done() const;
+
+  private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> pending_{0};
+	std::mutex            error_mutex_;
+	std::exception_ptr    p_error_;
+};
+
+struct JobSystemStats
+{
+	uint32_t worker_count;
+	size_t   executed_jobs;
+	size_t   stolen_jobs;
+	double   busy_time;           // Seconds the workers spent running jobs.
+	double   elapsed_time;        // Seconds since the stats were reset.
+	double   utilization;         // busy_time over the time all workers were available.
+};
+
+// Work stealing job scheduler shared by the whole engine.
+// Every worker owns a deque. It pushes and pops its own jobs at the back, idle workers steal from the front of the others.
+// Jobs submitted from outside the workers are dealt round robin.
+// A thread that waits on a group runs jobs meanwhile, so jobs can wait on jobs they spawn.
+// Vulkan queues are externally synchronized. Work that submits to them goes through run_on_main_thread().
+// * The thread that first calls get() is the main thread.
+class JobSystem
+{
+  public:
+	static JobSystem &get();
+
+	// 0 workers means one per hardware thread besides the main thread.
+	JobSystem(uint32_t worker_count = 0);
+	JobSystem(const JobSystem &)            = delete;
+	JobSystem &operator=(const JobSystem &) = delete;
+	~JobSystem();
+
+	void run(JobGroup &group, Job job);
+	void wait(JobGroup &group);
+	// Split [begin, end) into ranges of at most grain_size elements, run them and wait for all of them.
+	void parallel_for(size_t begin, size_t end, size_t grain_size, const RangeJob &range_job);
+
+	// Queue a job for the main thread. It runs in the next process_main_thread_jobs() or main thread wait().
+	void run_on_main_thread(Job job);
+	void process_main_thread_jobs();
+	bool is_main_thread() const;
+
+	uint32_t       get_worker_count() const;
+	JobSystemStats get_stats();
+	void           reset_stats();
+	void           log_stats();
+
+  private:
+	struct Task
+	{
+		Job       job;
+		JobGroup *p_group;
+	};
+
+	struct Worker
+	{
+		std::mutex          mutex;
+		std::deque<Task>    tasks;
+		std::thread         thread;
+		Timer               timer;
+		std::atomic<double> busy_time{0.0};
+		std::atomic<size_t> executed_jobs{0};
+		std::atomic<size_t> stolen_jobs{0};
+	};
+
+	void worker_loop(uint32_t worker_idx);
+	void push(Task &&task);
+	bool pop(int32_t worker_idx, Task &task);
+	bool try_run_one(int32_t worker_idx);
+	void execute(Task &task);
+
+	std::vector<std::unique_ptr<Worker>> p_workers_;
+	std::thread::id                      main_thread_id_;
+	std::atomic<uint32_t>                next_worker_{0};
+	std::atomic<size_t>                  queued_tasks_{0};
+	std::atomic<bool>                    stop_{false};
+	std::mutex                           sleep_mutex_;
+	std::condition_variable              sleep_cv_;
+	std::mutex                           main_mutex_;
+	std::vector<Task>                    main_tasks_;
+	Timer                                stats_timer_;
+	double                               stats_start_ = 0.0;        // stats_timer_ time of the last reset.
+};
+
+}        // namespace W3D
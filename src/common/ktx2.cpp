@@ -0,0 +1,227 @@
+#include "ktx2.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "common/format_info.hpp"
+
+namespace W3D
+{
+
+const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// The fixed size part of the file.
+struct KTX2Header
+{
+	uint8_t  identifier[12];
+	uint32_t vk_format;
+	uint32_t type_size;
+	uint32_t pixel_width;
+	uint32_t pixel_height;
+	uint32_t pixel_depth;
+	uint32_t layer_count;
+	uint32_t face_count;
+	uint32_t level_count;
+	uint32_t supercompression_scheme;
+	uint32_t dfd_byte_offset;
+	uint32_t dfd_byte_length;
+	uint32_t kvd_byte_offset;
+	uint32_t kvd_byte_length;
+	uint64_t sgd_byte_offset;
+	uint64_t sgd_byte_length;
+};
+
+struct KTX2LevelIndex
+{
+	uint64_t byte_offset;
+	uint64_t byte_length;
+	uint64_t uncompressed_byte_length;
+};
+
+// Levels are aligned to it. It is a multiple of the texel size of every uncompressed format.
+const size_t KTX2_LEVEL_ALIGNMENT = 16;
+
+static_assert(sizeof(KTX2Header) == 80, "KTX2Header must match the file layout");
+static_assert(sizeof(KTX2LevelIndex) == 24, "KTX2LevelIndex must match the file layout");
+
+bool is_ktx2(const uint8_t *p_data, size_t size)
+{
+	return size >= sizeof(KTX2_IDENTIFIER) && std::memcmp(p_data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+}
+
+bool read_ktx2_extent(const uint8_t *p_data, size_t size, uint32_t *p_width, uint32_t *p_height)
+{
+	if (!is_ktx2(p_data, size) || size < sizeof(KTX2Header))
+	{
+		return false;
+	}
+
+	KTX2Header header;
+	std::memcpy(&header, p_data, sizeof(KTX2Header));
+	*p_width  = header.pixel_width;
+	*p_height = std::max(header.pixel_height, 1u);
+	return true;
+}
+
+KTX2Image read_ktx2(const uint8_t *p_data, size_t size)
+{
+	if (!is_ktx2(p_data, size) || size < sizeof(KTX2Header))
+	{
+		throw std::runtime_error("Not a KTX2 file.");
+	}
+
+	KTX2Header header;
+	std::memcpy(&header, p_data, sizeof(KTX2Header));
+
+	if (header.vk_format == 0 || header.supercompression_scheme != 0)
+	{
+		throw std::runtime_error("Supercompressed KTX2 files are not supported.");
+	}
+	if (header.pixel_depth > 1 || header.layer_count > 1 || (header.face_count != 1 && header.face_count != 6))
+	{
+		throw std::runtime_error("Only 2D and cube KTX2 files are supported.");
+	}
+
+	// A level count of 0 asks the loader to generate the chain. Only level 0 is in the file.
+	uint32_t levels     = std::max(header.level_count, 1u);
+	uint32_t max_extent = std::max(header.pixel_width, header.pixel_height);
+	if (header.pixel_width == 0 || levels > 32 || (max_extent >> (levels - 1)) == 0)
+	{
+		throw std::runtime_error("KTX2 file has a bad extent or level count.");
+	}
+
+	FormatBlockInfo block;
+	if (!find_format_block_info(static_cast<vk::Format>(header.vk_format), &block))
+	{
+		throw std::runtime_error("KTX2 file uses an unsupported format.");
+	}
+
+	size_t index_start = sizeof(KTX2Header);
+	if (index_start + levels * sizeof(KTX2LevelIndex) > size)
+	{
+		throw std::runtime_error("Truncated KTX2 level index.");
+	}
+
+	std::vector<KTX2LevelIndex> level_index(levels);
+	std::memcpy(level_index.data(), p_data + index_start, levels * sizeof(KTX2LevelIndex));
+
+	// Every level must hold exactly its faces. The binary is later copied level by level with the computed sizes.
+	vk::Extent3D extent{
+	    .width  = header.pixel_width,
+	    .height = std::max(header.pixel_height, 1u),
+	    .depth  = 1,
+	};
+	size_t total_size = 0;
+	for (uint32_t m = 0; m < levels; m++)
+	{
+		const KTX2LevelIndex &level = level_index[m];
+		if (level.byte_offset > size || level.byte_length > size - level.byte_offset ||
+		    level.byte_length != get_level_size(block, extent, m) * header.face_count)
+		{
+			throw std::runtime_error("Corrupted KTX2 level index.");
+		}
+		total_size += level.byte_length;
+	}
+
+	// KTX2 stores every face of a level together. Regroup them by face.
+	KTX2Image image{
+	    .vk_format = header.vk_format,
+	    .width     = header.pixel_width,
+	    .height    = std::max(header.pixel_height, 1u),
+	    .levels    = levels,
+	    .faces     = header.face_count,
+	    .binary    = {},
+	};
+	image.binary.reserve(total_size);
+	for (uint32_t f = 0; f < header.face_count; f++)
+	{
+		for (const KTX2LevelIndex &level : level_index)
+		{
+			size_t         face_size = level.byte_length / header.face_count;
+			const uint8_t *p_face    = p_data + level.byte_offset + f * face_size;
+			image.binary.insert(image.binary.end(), p_face, p_face + face_size);
+		}
+	}
+
+	return image;
+}
+
+std::vector<uint8_t> write_ktx2(const KTX2Image &image)
+{
+	if (image.faces != 1 && image.faces != 6)
+	{
+		throw std::runtime_error("Only 2D and cube KTX2 files are supported.");
+	}
+
+	// Size of every level from the extents, so that the face major binary can be regrouped by level.
+	std::vector<size_t> level_sizes(image.levels);
+	size_t              face_size = 0;
+	for (uint32_t m = 0; m < image.levels; m++)
+	{
+		size_t texels  = static_cast<size_t>(std::max(image.width >> m, 1u)) * std::max(image.height >> m, 1u);
+		level_sizes[m] = texels;
+		face_size += texels;
+	}
+	if (face_size == 0 || image.binary.size() % (face_size * image.faces) != 0)
+	{
+		throw std::runtime_error("KTX2 image binary doesn't match its extent.");
+	}
+	size_t texel_size = image.binary.size() / (face_size * image.faces);
+	for (size_t &level_size : level_sizes)
+	{
+		level_size *= texel_size;
+	}
+
+	KTX2Header header{
+	    .identifier              = {},
+	    .vk_format               = image.vk_format,
+	    .type_size               = 1,
+	    .pixel_width             = image.width,
+	    .pixel_height            = image.height,
+	    .pixel_depth             = 0,
+	    .layer_count             = 0,
+	    .face_count              = image.faces,
+	    .level_count             = image.levels,
+	    .supercompression_scheme = 0,
+	    .dfd_byte_offset         = 0,
+	    .dfd_byte_length         = 0,
+	    .kvd_byte_offset         = 0,
+	    .kvd_byte_length         = 0,
+	    .sgd_byte_offset         = 0,
+	    .sgd_byte_length         = 0,
+	};
+	std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+
+	// The smallest level comes first in the file.
+	std::vector<KTX2LevelIndex> level_index(image.levels);
+	size_t                      offset = sizeof(KTX2Header) + image.levels * sizeof(KTX2LevelIndex);
+	for (uint32_t i = 0; i < image.levels; i++)
+	{
+		uint32_t m = image.levels - 1 - i;
+		offset     = (offset + KTX2_LEVEL_ALIGNMENT - 1) / KTX2_LEVEL_ALIGNMENT * KTX2_LEVEL_ALIGNMENT;
+
+		level_index[m].byte_offset              = offset;
+		level_index[m].byte_length              = level_sizes[m] * image.faces;
+		level_index[m].uncompressed_byte_length = level_index[m].byte_length;
+		offset += level_index[m].byte_length;
+	}
+
+	std::vector<uint8_t> file(offset, 0);
+	std::memcpy(file.data(), &header, sizeof(KTX2Header));
+	std::memcpy(file.data() + sizeof(KTX2Header), level_index.data(), level_index.size() * sizeof(KTX2LevelIndex));
+	// The binary is face major. KTX2 stores every face of a level together.
+	const uint8_t *p_src = image.binary.data();
+	for (uint32_t f = 0; f < image.faces; f++)
+	{
+		for (uint32_t m = 0; m < image.levels; m++)
+		{
+			std::memcpy(file.data() + level_index[m].byte_offset + f * level_sizes[m], p_src, level_sizes[m]);
+			p_src += level_sizes[m];
+		}
+	}
+
+	return file;
+}
+
+}        // namespace W3D
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace W3D
+{
+
+// Reader and writer for KTX2 containers.
+// Only containers without supercompression are supported. Basis Universal and zstd payloads are rejected.
+// 2D images and cube maps are supported, array and 3D textures are not.
+
+struct KTX2Image
+{
+	uint32_t             vk_format;
+	uint32_t             width;
+	uint32_t             height;
+	uint32_t             levels;
+	uint32_t             faces;
+	std::vector<uint8_t> binary;        // Face major, then levels from largest to smallest. The order CommandBuffer::update_image expects.
+};
+
+// Check the file identifier.
+bool      is_ktx2(const uint8_t *p_data, size_t size);
+// Throw if the format has no known block layout or a level doesn't hold exactly its faces.
+KTX2Image read_ktx2(const uint8_t *p_data, size_t size);
+// Only read the extent of level 0. Return false if the header is truncated.
+bool      read_ktx2_extent(const uint8_t *p_data, size_t size, uint32_t *p_width, uint32_t *p_height);
+// Write an uncompressed container. Every level of image.binary is expected to be tightly packed.
+// * No data format descriptor is written. read_ktx2() doesn't need one, but other tools may reject the file.
+std::vector<uint8_t> write_ktx2(const KTX2Image &image);
+
+}        // namespace W3D
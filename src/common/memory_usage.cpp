@@ -0,0 +1,85 @@
+#include "memory_usage.hpp"
+
+#include "common/logging.hpp"
+
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#	include <psapi.h>
+#elif defined(__APPLE__)
+#	include <mach/mach.h>
+#	include <sys/resource.h>
+#else
+#	include <fstream>
+#	include <sys/resource.h>
+#	include <unistd.h>
+#endif
+
+namespace W3D
+{
+
+size_t get_current_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+	return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t      count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+	{
+		return 0;
+	}
+	return info.resident_size;
+#else
+	// The second field of statm is the resident page count.
+	std::ifstream statm("/proc/self/statm");
+	size_t        total_pages    = 0;
+	size_t        resident_pages = 0;
+	if (!(statm >> total_pages >> resident_pages))
+	{
+		return 0;
+	}
+	return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+size_t get_peak_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#	ifdef __APPLE__
+	// macOS reports bytes, Linux reports kilobytes.
+	return static_cast<size_t>(usage.ru_maxrss);
+#	else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#	endif
+#endif
+}
+
+void log_memory_usage(const char *phase)
+{
+	LOGI("{}: RSS {:.1f} MB, peak RSS {:.1f} MB", phase, get_current_rss() / (1024.0 * 1024.0), get_peak_rss() / (1024.0 * 1024.0));
+}
+
+}        // namespace W3D
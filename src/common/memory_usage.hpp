@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace W3D
+{
+
+// Resident set size of the process in bytes. Return 0 if the platform can't tell.
+size_t get_current_rss();
+// Highest resident set size of the process so far in bytes.
+size_t get_peak_rss();
+// Log both under the name of a phase, e.g. a step of a loader.
+void log_memory_usage(const char *phase);
+
+}        // namespace W3D
@@ -0,0 +1,190 @@
+#include "mipmap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "utils.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define W3D_MIPMAP_SSE
+#	include <emmintrin.h>
+#endif
+
+namespace W3D
+{
+
+// Number of entries of the linear to sRGB table. 4096 entries keep the round trip exact for 8 bit values.
+const uint32_t LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+
+struct SRGBTables
+{
+	SRGBTables()
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			float c      = i / 255.0f;
+			to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			to_unorm[i]  = c;
+		}
+		for (uint32_t i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; i++)
+		{
+			float c    = i / static_cast<float>(LINEAR_TO_SRGB_TABLE_SIZE - 1);
+			float s    = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+			to_srgb[i] = static_cast<uint8_t>(std::clamp(s * 255.0f + 0.5f, 0.0f, 255.0f));
+		}
+	}
+
+	std::array<float, 256>                         to_linear;
+	std::array<float, 256>                         to_unorm;
+	std::array<uint8_t, LINEAR_TO_SRGB_TABLE_SIZE> to_srgb;
+};
+
+const SRGBTables &get_srgb_tables()
+{
+	static const SRGBTables tables;
+	return tables;
+}
+
+size_t get_mip_chain_size_rgba8(uint32_t width, uint32_t height, uint32_t level_count)
+{
+	size_t size = 0;
+	for (uint32_t m = 0; m < level_count; m++)
+	{
+		size += static_cast<size_t>(std::max(width >> m, 1u)) * std::max(height >> m, 1u) * 4;
+	}
+	return size;
+}
+
+// The source texels [first, last) that fold into destination texel i.
+// Odd sizes fold the last source texel into the last destination texel, so every source texel contributes.
+void get_footprint(uint32_t i, uint32_t src_size, uint32_t dst_size, uint32_t &first, uint32_t &last)
+{
+	first = std::min(i * 2, src_size - 1);
+	last  = std::min(i * 2 + 2, src_size);
+	if (i == dst_size - 1)
+	{
+		last = src_size;
+	}
+}
+
+// The sum of the texels in a footprint. With SSE, the 4 channels are summed and resolved at once.
+// The sRGB table lookups stay scalar. Unorm texels are converted with integer unpacks instead of the table.
+#ifdef W3D_MIPMAP_SSE
+using TexelSum = __m128;
+
+TexelSum zero_texel_sum()
+{
+	return _mm_setzero_ps();
+}
+
+TexelSum add_rgba8_texel(TexelSum sum, const uint8_t *p_texel, const SRGBTables &tables, bool is_srgb)
+{
+	if (is_srgb)
+	{
+		return _mm_add_ps(sum, _mm_setr_ps(tables.to_linear[p_texel[0]], tables.to_linear[p_texel[1]], tables.to_linear[p_texel[2]], tables.to_unorm[p_texel[3]]));
+	}
+
+	int32_t bytes;
+	std::memcpy(&bytes, p_texel, sizeof(bytes));
+	__m128i zero  = _mm_setzero_si128();
+	__m128i texel = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+	return _mm_add_ps(sum, _mm_div_ps(_mm_cvtepi32_ps(texel), _mm_set1_ps(255.0f)));
+}
+
+// Clamp the average and round it to 8 bits. The color of sRGB texels is rounded to an entry of the to_srgb table instead.
+void store_rgba8_average(TexelSum sum, float inv_count, const SRGBTables &tables, bool is_srgb, uint8_t *p_texel)
+{
+	const float srgb_scale = static_cast<float>(LINEAR_TO_SRGB_TABLE_SIZE - 1);
+	__m128      scale      = is_srgb ? _mm_setr_ps(srgb_scale, srgb_scale, srgb_scale, 255.0f) : _mm_set1_ps(255.0f);
+	__m128      value      = _mm_min_ps(_mm_max_ps(_mm_mul_ps(sum, _mm_set1_ps(inv_count)), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+	alignas(16) int32_t rounded[4];
+	_mm_store_si128(reinterpret_cast<__m128i *>(rounded), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), _mm_set1_ps(0.5f))));
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		p_texel[c] = is_srgb ? tables.to_srgb[rounded[c]] : static_cast<uint8_t>(rounded[c]);
+	}
+	p_texel[3] = static_cast<uint8_t>(rounded[3]);
+}
+#else
+using TexelSum = std::array<float, 4>;
+
+TexelSum zero_texel_sum()
+{
+	return {0.0f, 0.0f, 0.0f, 0.0f};
+}
+
+TexelSum add_rgba8_texel(TexelSum sum, const uint8_t *p_texel, const SRGBTables &tables, bool is_srgb)
+{
+	const float *p_to_float = is_srgb ? tables.to_linear.data() : tables.to_unorm.data();
+	sum[0] += p_to_float[p_texel[0]];
+	sum[1] += p_to_float[p_texel[1]];
+	sum[2] += p_to_float[p_texel[2]];
+	sum[3] += tables.to_unorm[p_texel[3]];
+	return sum;
+}
+
+void store_rgba8_average(TexelSum sum, float inv_count, const SRGBTables &tables, bool is_srgb, uint8_t *p_texel)
+{
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		float value = std::clamp(sum[c] * inv_count, 0.0f, 1.0f);
+		p_texel[c]  = is_srgb ? tables.to_srgb[static_cast<uint32_t>(value * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)] : static_cast<uint8_t>(value * 255.0f + 0.5f);
+	}
+	p_texel[3] = static_cast<uint8_t>(std::clamp(sum[3] * inv_count, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+#endif
+
+// Box filter one level into the next one.
+void downsample_rgba8(const uint8_t *p_src, uint32_t src_width, uint32_t src_height, uint8_t *p_dst, bool is_srgb)
+{
+	const SRGBTables &tables     = get_srgb_tables();
+	uint32_t          dst_width  = std::max(src_width / 2, 1u);
+	uint32_t          dst_height = std::max(src_height / 2, 1u);
+
+	for (uint32_t y = 0; y < dst_height; y++)
+	{
+		uint32_t y_first, y_last;
+		get_footprint(y, src_height, dst_height, y_first, y_last);
+
+		for (uint32_t x = 0; x < dst_width; x++)
+		{
+			uint32_t x_first, x_last;
+			get_footprint(x, src_width, dst_width, x_first, x_last);
+
+			TexelSum sum = zero_texel_sum();
+			for (uint32_t sy = y_first; sy < y_last; sy++)
+			{
+				const uint8_t *p_texel = p_src + (static_cast<size_t>(sy) * src_width + x_first) * 4;
+				for (uint32_t sx = x_first; sx < x_last; sx++, p_texel += 4)
+				{
+					sum = add_rgba8_texel(sum, p_texel, tables, is_srgb);
+				}
+			}
+
+			float inv_count = 1.0f / ((y_last - y_first) * (x_last - x_first));
+			store_rgba8_average(sum, inv_count, tables, is_srgb, p_dst + (static_cast<size_t>(y) * dst_width + x) * 4);
+		}
+	}
+}
+
+uint32_t generate_mip_chain_rgba8(std::vector<uint8_t> &binary, uint32_t width, uint32_t height, bool is_srgb)
+{
+	uint32_t level_count = max_mip_levels(width, height);
+	binary.resize(get_mip_chain_size_rgba8(width, height, level_count));
+
+	size_t src_offset = 0;
+	for (uint32_t m = 1; m < level_count; m++)
+	{
+		uint32_t src_width  = std::max(width >> (m - 1), 1u);
+		uint32_t src_height = std::max(height >> (m - 1), 1u);
+		size_t   dst_offset = src_offset + static_cast<size_t>(src_width) * src_height * 4;
+		downsample_rgba8(binary.data() + src_offset, src_width, src_height, binary.data() + dst_offset, is_srgb);
+		src_offset = dst_offset;
+	}
+	return level_count;
+}
+
+}        // namespace W3D
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace W3D
+{
+
+// CPU mip chain generation for RGBA8 images.
+// Used when the device can't blit a format and by the cooker, which has no device.
+// * sRGB images are filtered in linear space. Alpha is always linear.
+
+// Size in bytes of the first level_count levels of an RGBA8 image, tightly packed.
+size_t get_mip_chain_size_rgba8(uint32_t width, uint32_t height, uint32_t level_count);
+// binary holds level 0. Append every other level, largest first, and return the level count.
+uint32_t generate_mip_chain_rgba8(std::vector<uint8_t> &binary, uint32_t width, uint32_t height, bool is_srgb);
+
+}        // namespace W3D
@@ -0,0 +1,203 @@
+#include "soa_interpolate.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define W3D_SOA_INTERPOLATE_SSE
+#	include <emmintrin.h>
+#endif
+
+namespace W3D
+{
+
+// The SIMD loops handle lanes in groups of 4 and return the first lane they left to the scalar loop.
+#ifdef W3D_SOA_INTERPOLATE_SSE
+size_t lerp_soa_sse(size_t count, uint32_t components, const float *p_a, const float *p_b, const float *p_t, float *p_out)
+{
+	size_t simd_count = count & ~size_t(3);
+	for (size_t i = 0; i < simd_count; i += 4)
+	{
+		__m128 t = _mm_loadu_ps(p_t + i);
+		for (uint32_t c = 0; c < components; c++)
+		{
+			size_t offset = c * count + i;
+			__m128 a      = _mm_loadu_ps(p_a + offset);
+			__m128 b      = _mm_loadu_ps(p_b + offset);
+			_mm_storeu_ps(p_out + offset, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)));
+		}
+	}
+	return simd_count;
+}
+
+__m128 dot_quat_sse(const float *p_a, const float *p_b, size_t count, size_t i)
+{
+	__m128 dot = _mm_setzero_ps();
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		dot = _mm_add_ps(dot, _mm_mul_ps(_mm_loadu_ps(p_a + c * count + i), _mm_loadu_ps(p_b + c * count + i)));
+	}
+	return dot;
+}
+
+// Multiply the 4 components at lane i by 1 / |q|, or by 0 if |q| is 0.
+void normalize_quat_lanes_sse(float *p_q, size_t count, size_t i)
+{
+	__m128 length_2 = dot_quat_sse(p_q, p_q, count, i);
+	__m128 nonzero  = _mm_cmpgt_ps(length_2, _mm_setzero_ps());
+	__m128 inv_len  = _mm_and_ps(nonzero, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(length_2)));
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		float *p_c = p_q + c * count + i;
+		_mm_storeu_ps(p_c, _mm_mul_ps(_mm_loadu_ps(p_c), inv_len));
+	}
+}
+
+size_t nlerp_quat_soa_sse(size_t count, const float *p_a, const float *p_b, const float *p_t, float *p_out)
+{
+	size_t       simd_count = count & ~size_t(3);
+	const __m128 sign_mask  = _mm_set1_ps(-0.0f);
+	for (size_t i = 0; i < simd_count; i += 4)
+	{
+		// Flip b where the dot product is negative: take its sign bit and xor it into b.
+		__m128 flip = _mm_and_ps(dot_quat_sse(p_a, p_b, count, i), sign_mask);
+		__m128 t    = _mm_loadu_ps(p_t + i);
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			size_t offset = c * count + i;
+			__m128 a      = _mm_loadu_ps(p_a + offset);
+			__m128 b      = _mm_xor_ps(_mm_loadu_ps(p_b + offset), flip);
+			_mm_storeu_ps(p_out + offset, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)));
+		}
+		normalize_quat_lanes_sse(p_out, count, i);
+	}
+	return simd_count;
+}
+
+size_t hermite_soa_sse(size_t count, uint32_t components, const float *p_p0, const float *p_m0, const float *p_p1, const float *p_m1, const float *p_t, float *p_out)
+{
+	size_t       simd_count = count & ~size_t(3);
+	const __m128 one        = _mm_set1_ps(1.0f);
+	const __m128 two        = _mm_set1_ps(2.0f);
+	const __m128 three      = _mm_set1_ps(3.0f);
+	for (size_t i = 0; i < simd_count; i += 4)
+	{
+		__m128 t   = _mm_loadu_ps(p_t + i);
+		__m128 t_2 = _mm_mul_ps(t, t);
+		__m128 t_3 = _mm_mul_ps(t_2, t);
+		__m128 h00 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(two, t_3), _mm_mul_ps(three, t_2)), one);
+		__m128 h10 = _mm_add_ps(_mm_sub_ps(t_3, _mm_mul_ps(two, t_2)), t);
+		__m128 h01 = _mm_sub_ps(_mm_mul_ps(three, t_2), _mm_mul_ps(two, t_3));
+		__m128 h11 = _mm_sub_ps(t_3, t_2);
+		for (uint32_t c = 0; c < components; c++)
+		{
+			size_t offset = c * count + i;
+			__m128 result = _mm_mul_ps(h00, _mm_loadu_ps(p_p0 + offset));
+			result        = _mm_add_ps(result, _mm_mul_ps(h10, _mm_loadu_ps(p_m0 + offset)));
+			result        = _mm_add_ps(result, _mm_mul_ps(h01, _mm_loadu_ps(p_p1 + offset)));
+			result        = _mm_add_ps(result, _mm_mul_ps(h11, _mm_loadu_ps(p_m1 + offset)));
+			_mm_storeu_ps(p_out + offset, result);
+		}
+	}
+	return simd_count;
+}
+
+size_t normalize_quat_soa_sse(size_t count, float *p_q)
+{
+	size_t simd_count = count & ~size_t(3);
+	for (size_t i = 0; i < simd_count; i += 4)
+	{
+		normalize_quat_lanes_sse(p_q, count, i);
+	}
+	return simd_count;
+}
+#endif
+
+void normalize_quat_lane(float *p_q, size_t count, size_t i)
+{
+	float length_2 = 0.0f;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		length_2 += p_q[c * count + i] * p_q[c * count + i];
+	}
+	float inv_len = length_2 > 0.0f ? 1.0f / std::sqrt(length_2) : 0.0f;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		p_q[c * count + i] *= inv_len;
+	}
+}
+
+void lerp_soa(size_t count, uint32_t components, const float *p_a, const float *p_b, const float *p_t, float *p_out)
+{
+	size_t i = 0;
+#ifdef W3D_SOA_INTERPOLATE_SSE
+	i = lerp_soa_sse(count, components, p_a, p_b, p_t, p_out);
+#endif
+	for (; i < count; i++)
+	{
+		for (uint32_t c = 0; c < components; c++)
+		{
+			size_t offset = c * count + i;
+			p_out[offset] = p_a[offset] + (p_b[offset] - p_a[offset]) * p_t[i];
+		}
+	}
+}
+
+void nlerp_quat_soa(size_t count, const float *p_a, const float *p_b, const float *p_t, float *p_out)
+{
+	size_t i = 0;
+#ifdef W3D_SOA_INTERPOLATE_SSE
+	i = nlerp_quat_soa_sse(count, p_a, p_b, p_t, p_out);
+#endif
+	for (; i < count; i++)
+	{
+		float dot = 0.0f;
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			dot += p_a[c * count + i] * p_b[c * count + i];
+		}
+		float sign = dot < 0.0f ? -1.0f : 1.0f;
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			size_t offset = c * count + i;
+			p_out[offset] = p_a[offset] + (sign * p_b[offset] - p_a[offset]) * p_t[i];
+		}
+		normalize_quat_lane(p_out, count, i);
+	}
+}
+
+void hermite_soa(size_t count, uint32_t components, const float *p_p0, const float *p_m0, const float *p_p1, const float *p_m1, const float *p_t, float *p_out)
+{
+	size_t i = 0;
+#ifdef W3D_SOA_INTERPOLATE_SSE
+	i = hermite_soa_sse(count, components, p_p0, p_m0, p_p1, p_m1, p_t, p_out);
+#endif
+	for (; i < count; i++)
+	{
+		float t   = p_t[i];
+		float t_2 = t * t;
+		float t_3 = t_2 * t;
+		float h00 = 2.0f * t_3 - 3.0f * t_2 + 1.0f;
+		float h10 = t_3 - 2.0f * t_2 + t;
+		float h01 = 3.0f * t_2 - 2.0f * t_3;
+		float h11 = t_3 - t_2;
+		for (uint32_t c = 0; c < components; c++)
+		{
+			size_t offset = c * count + i;
+			p_out[offset] = h00 * p_p0[offset] + h10 * p_m0[offset] + h01 * p_p1[offset] + h11 * p_m1[offset];
+		}
+	}
+}
+
+void normalize_quat_soa(size_t count, float *p_q)
+{
+	size_t i = 0;
+#ifdef W3D_SOA_INTERPOLATE_SSE
+	i = normalize_quat_soa_sse(count, p_q);
+#endif
+	for (; i < count; i++)
+	{
+		normalize_quat_lane(p_q, count, i);
+	}
+}
+
+}        // namespace W3D
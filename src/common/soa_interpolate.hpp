@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace W3D
+{
+
+// Interpolation kernels over many lanes at once, 4 lanes per SSE instruction.
+// Arrays are planar: component c of lane i is at p[c * count + i]. Every lane has its own factor in p_t.
+// * The animation clips gather one lane per channel. See sg::AnimationClip.
+
+// a + (b - a) * t.
+void lerp_soa(size_t count, uint32_t components, const float *p_a, const float *p_b, const float *p_t, float *p_out);
+// Lerp along the shorter arc, then normalize. Quaternions are xyzw.
+void nlerp_quat_soa(size_t count, const float *p_a, const float *p_b, const float *p_t, float *p_out);
+// Cubic Hermite spline. The tangents are already scaled by the interval length.
+// The basis weights are computed from t with multiplies only.
+void hermite_soa(size_t count, uint32_t components, const float *p_p0, const float *p_m0, const float *p_p1, const float *p_m1, const float *p_t, float *p_out);
+// Normalize xyzw quaternions in place. Zero quaternions stay zero.
+void normalize_quat_soa(size_t count, float *p_q);
+
+}        // namespace W3D
@@ -97,19 +97,4 @@ sg::Node *find_valid_camera_node(sg::Scene &scene, const std::string &node_name)
 	return camera_node;
 }
 
-// Calculate the max mipmap levels given the width and the height.
-uint32_t max_mip_levels(uint32_t width, uint32_t height)
-{
-	uint32_t levels = 1;
-
-	while (width != 1 && height != 1)
-	{
-		width  = std::max(width / 2, to_u32(1));
-		height = std::max(height / 2, to_u32(1));
-		levels++;
-	}
-
-	return levels;
-}
-
 }        // namespace W3D
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <sstream>
@@ -70,10 +71,16 @@ sg::Node *add_arc_ball_camera_script(sg::Scene &scene, const std::string &node_n
 
 sg::Node *find_valid_camera_node(sg::Scene &scene, const std::string &node_name);
 
-// FNV-1a 32bit hashing algorithm.
+// FNV-1a 32bit hashing algorithm. Hashes s[0] to s[len], both included.
+// * A loop rather than recursion, scene names are hashed at runtime.
 constexpr uint32_t fnv1a_32(const char *s, std::size_t len)
 {
-	return ((len ? fnv1a_32(s, len - 1) : 2166136261u) ^ s[len]) * 16777619u;
+	uint32_t hash = 2166136261u;
+	for (std::size_t i = 0; i <= len; i++)
+	{
+		hash = (hash ^ s[i]) * 16777619u;
+	}
+	return hash;
 }
 
 constexpr size_t const_strlen(const char *s)
@@ -91,6 +98,20 @@ constexpr uint32_t string_hash(const char *s)
 	return fnv1a_32(s, const_strlen(s));
 }
 
-uint32_t max_mip_levels(uint32_t width, uint32_t height);
+// Calculate the max mipmap levels given the width and the height.
+// * Inline so that the cooker, which doesn't build utils.cpp, can use it too.
+inline uint32_t max_mip_levels(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+
+	while (width > 1 || height > 1)
+	{
+		width  = std::max(width / 2, to_u32(1));
+		height = std::max(height / 2, to_u32(1));
+		levels++;
+	}
+
+	return levels;
+}
 
 }        // namespace W3D
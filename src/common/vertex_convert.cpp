@@ -0,0 +1,367 @@
+#include "vertex_convert.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define W3D_VERTEX_CONVERT_X86
+#	include <immintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+// MSVC compiles intrinsics of any level without flags.
+#		define W3D_TARGET_SSE41
+#		define W3D_TARGET_AVX2
+#	else
+// GCC and Clang need the level enabled per function, so that the rest of the binary runs on any x86 CPU.
+#		define W3D_TARGET_SSE41 __attribute__((target("sse4.1")))
+#		define W3D_TARGET_AVX2  __attribute__((target("avx2,fma")))
+#	endif
+#endif
+
+namespace W3D
+{
+
+SimdLevel detect_simd_level()
+{
+#ifdef W3D_VERTEX_CONVERT_X86
+#	ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+	__cpuid(info, 1);
+	bool has_sse41   = info[2] & (1 << 19);
+	bool has_osxsave = info[2] & (1 << 27);
+	bool has_avx2    = false;
+	// AVX2 also needs the OS to save the ymm registers.
+	if (max_leaf >= 7 && has_osxsave && (_xgetbv(0) & 0x6) == 0x6)
+	{
+		__cpuidex(info, 7, 0);
+		has_avx2 = info[1] & (1 << 5);
+	}
+#	else
+	bool has_sse41 = __builtin_cpu_supports("sse4.1");
+	bool has_avx2  = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#	endif
+	if (has_avx2)
+	{
+		return SimdLevel::eAVX2;
+	}
+	if (has_sse41)
+	{
+		return SimdLevel::eSSE41;
+	}
+#endif
+	return SimdLevel::eScalar;
+}
+
+SimdLevel get_simd_level()
+{
+	static const SimdLevel simd_level = detect_simd_level();
+	return simd_level;
+}
+
+size_t get_component_size(ComponentType type)
+{
+	switch (type)
+	{
+		case ComponentType::eInt8:
+		case ComponentType::eUint8:
+			return 1;
+		case ComponentType::eInt16:
+		case ComponentType::eUint16:
+			return 2;
+		case ComponentType::eUint32:
+		case ComponentType::eFloat:
+			return 4;
+	}
+	return 0;
+}
+
+// The scale that maps a normalized integer to [0, 1] or [-1, 1].
+float get_normalize_scale(ComponentType type)
+{
+	switch (type)
+	{
+		case ComponentType::eInt8:
+			return 1.0f / 127.0f;
+		case ComponentType::eUint8:
+			return 1.0f / 255.0f;
+		case ComponentType::eInt16:
+			return 1.0f / 32767.0f;
+		case ComponentType::eUint16:
+			return 1.0f / 65535.0f;
+		case ComponentType::eUint32:
+			return 1.0f / 4294967295.0f;
+		case ComponentType::eFloat:
+			return 1.0f;
+	}
+	return 1.0f;
+}
+
+float read_component(const uint8_t *p_data, ComponentType type, bool normalized)
+{
+	float value = 0.0f;
+	switch (type)
+	{
+		case ComponentType::eInt8:
+		{
+			int8_t component;
+			std::memcpy(&component, p_data, sizeof(component));
+			value = component;
+			break;
+		}
+		case ComponentType::eUint8:
+			value = p_data[0];
+			break;
+		case ComponentType::eInt16:
+		{
+			int16_t component;
+			std::memcpy(&component, p_data, sizeof(component));
+			value = component;
+			break;
+		}
+		case ComponentType::eUint16:
+		{
+			uint16_t component;
+			std::memcpy(&component, p_data, sizeof(component));
+			value = component;
+			break;
+		}
+		case ComponentType::eUint32:
+		{
+			uint32_t component;
+			std::memcpy(&component, p_data, sizeof(component));
+			value = static_cast<float>(component);
+			break;
+		}
+		case ComponentType::eFloat:
+			std::memcpy(&value, p_data, sizeof(value));
+			return value;
+	}
+	// The smallest signed value maps to -1 as well.
+	return normalized ? std::max(value * get_normalize_scale(type), -1.0f) : value;
+}
+
+void convert_attribute_scalar(const AttributeSource &src, float *p_dst, size_t dst_stride, uint32_t dst_components, size_t first, size_t count, uint32_t convert_bits)
+{
+	size_t   component_size = get_component_size(src.type);
+	uint32_t components     = std::min(src.components, 4u);
+	uint8_t *p_dst_bytes    = reinterpret_cast<uint8_t *>(p_dst);
+
+	for (size_t i = first; i < count; i++)
+	{
+		const uint8_t *p_element = src.p_data + i * src.stride;
+		float          value[4]  = {0.0f, 0.0f, 0.0f, 1.0f};
+		for (uint32_t c = 0; c < components; c++)
+		{
+			value[c] = read_component(p_element + c * component_size, src.type, src.normalized);
+		}
+
+		if (convert_bits & ATTRIBUTE_CONVERT_FLIP_X)
+		{
+			value[0] = -value[0];
+		}
+		if (convert_bits & ATTRIBUTE_CONVERT_NORMALIZE)
+		{
+			float length = std::sqrt(value[0] * value[0] + value[1] * value[1] + value[2] * value[2]);
+			if (length > 0.0f)
+			{
+				value[0] /= length;
+				value[1] /= length;
+				value[2] /= length;
+			}
+		}
+		std::memcpy(p_dst_bytes + i * dst_stride, value, dst_components * sizeof(float));
+	}
+}
+
+#ifdef W3D_VERTEX_CONVERT_X86
+
+// Convert one element per iteration. The components sit in the lanes of one register.
+// Return the first element that is left to the scalar code.
+W3D_TARGET_SSE41 size_t convert_attribute_sse41(const AttributeSource &src, float *p_dst, size_t dst_stride, uint32_t dst_components, size_t count, uint32_t convert_bits)
+{
+	if (src.type == ComponentType::eUint32 || src.components > 4)
+	{
+		return 0;
+	}
+
+	// Every load reads 4 components. With fewer components, a load reads into the next element, so the last element is left to the scalar code.
+	size_t component_size = get_component_size(src.type);
+	size_t last           = count;
+	if (src.components < 4)
+	{
+		if (4 * component_size > src.stride + src.components * component_size)
+		{
+			return 0;
+		}
+		last = count > 0 ? count - 1 : 0;
+	}
+
+	const __m128 scale     = _mm_set1_ps(src.normalized ? get_normalize_scale(src.type) : 1.0f);
+	const __m128 neg_one   = _mm_set1_ps(-1.0f);
+	const __m128 defaults  = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	const __m128 flip      = _mm_setr_ps((convert_bits & ATTRIBUTE_CONVERT_FLIP_X) ? -1.0f : 1.0f, 1.0f, 1.0f, 1.0f);
+	const bool   is_signed = src.type == ComponentType::eInt8 || src.type == ComponentType::eInt16;
+	// Lanes that the source has.
+	const __m128 present = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(static_cast<int>(src.components))));
+	uint8_t     *p_dst_bytes = reinterpret_cast<uint8_t *>(p_dst);
+
+	for (size_t i = 0; i < last; i++)
+	{
+		const uint8_t *p_element = src.p_data + i * src.stride;
+		__m128         value;
+		switch (src.type)
+		{
+			case ComponentType::eFloat:
+				value = _mm_loadu_ps(reinterpret_cast<const float *>(p_element));
+				break;
+			case ComponentType::eInt8:
+			case ComponentType::eUint8:
+			{
+				int32_t packed;
+				std::memcpy(&packed, p_element, sizeof(packed));
+				__m128i bytes = _mm_cvtsi32_si128(packed);
+				value         = _mm_cvtepi32_ps(is_signed ? _mm_cvtepi8_epi32(bytes) : _mm_cvtepu8_epi32(bytes));
+				break;
+			}
+			default:
+			{
+				__m128i shorts = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p_element));
+				value          = _mm_cvtepi32_ps(is_signed ? _mm_cvtepi16_epi32(shorts) : _mm_cvtepu16_epi32(shorts));
+				break;
+			}
+		}
+
+		if (src.type != ComponentType::eFloat && src.normalized)
+		{
+			value = _mm_max_ps(_mm_mul_ps(value, scale), neg_one);
+		}
+		value = _mm_blendv_ps(defaults, value, present);
+		value = _mm_mul_ps(value, flip);
+
+		if (convert_bits & ATTRIBUTE_CONVERT_NORMALIZE)
+		{
+			__m128 length_sq = _mm_dp_ps(value, value, 0x7F);
+			__m128 is_zero   = _mm_cmpeq_ps(length_sq, _mm_setzero_ps());
+			__m128 unit      = _mm_div_ps(value, _mm_sqrt_ps(length_sq));
+			// w and zero vectors keep their value.
+			value = _mm_blend_ps(_mm_blendv_ps(unit, value, is_zero), value, 0x8);
+		}
+
+		float *p_out = reinterpret_cast<float *>(p_dst_bytes + i * dst_stride);
+		switch (dst_components)
+		{
+			case 4:
+				_mm_storeu_ps(p_out, value);
+				break;
+			case 3:
+				_mm_storel_pi(reinterpret_cast<__m64 *>(p_out), value);
+				_mm_store_ss(p_out + 2, _mm_movehl_ps(value, value));
+				break;
+			case 2:
+				_mm_storel_pi(reinterpret_cast<__m64 *>(p_out), value);
+				break;
+			default:
+				_mm_store_ss(p_out, value);
+				break;
+		}
+	}
+	return last;
+}
+
+// Convert 8 float vec3 or vec4 elements per iteration with gathers.
+// Return the first element that is left to the other kernels.
+W3D_TARGET_AVX2 size_t convert_float_attribute_avx2(const AttributeSource &src, float *p_dst, size_t dst_stride, uint32_t dst_components, size_t count, uint32_t convert_bits)
+{
+	if (src.type != ComponentType::eFloat || src.components < 3 || src.components > 4 || dst_components < 3 || src.stride % sizeof(float) != 0)
+	{
+		return 0;
+	}
+
+	const int    float_stride = static_cast<int>(src.stride / sizeof(float));
+	const __m256i indices      = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(float_stride));
+	const __m256 sign         = _mm256_set1_ps((convert_bits & ATTRIBUTE_CONVERT_FLIP_X) ? -0.0f : 0.0f);
+	uint8_t     *p_dst_bytes  = reinterpret_cast<uint8_t *>(p_dst);
+	size_t       i            = 0;
+
+	alignas(32) float xs[8];
+	alignas(32) float ys[8];
+	alignas(32) float zs[8];
+	alignas(32) float ws[8];
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const float *p_element = reinterpret_cast<const float *>(src.p_data + i * src.stride);
+		__m256       x         = _mm256_xor_ps(_mm256_i32gather_ps(p_element, indices, 4), sign);
+		__m256       y         = _mm256_i32gather_ps(p_element + 1, indices, 4);
+		__m256       z         = _mm256_i32gather_ps(p_element + 2, indices, 4);
+		__m256       w         = src.components == 4 ? _mm256_i32gather_ps(p_element + 3, indices, 4) : _mm256_set1_ps(1.0f);
+
+		if (convert_bits & ATTRIBUTE_CONVERT_NORMALIZE)
+		{
+			__m256 length_sq = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z)));
+			__m256 is_zero   = _mm256_cmp_ps(length_sq, _mm256_setzero_ps(), _CMP_EQ_OQ);
+			__m256 length    = _mm256_blendv_ps(_mm256_sqrt_ps(length_sq), _mm256_set1_ps(1.0f), is_zero);
+			x                = _mm256_div_ps(x, length);
+			y                = _mm256_div_ps(y, length);
+			z                = _mm256_div_ps(z, length);
+		}
+
+		_mm256_store_ps(xs, x);
+		_mm256_store_ps(ys, y);
+		_mm256_store_ps(zs, z);
+		_mm256_store_ps(ws, w);
+		for (size_t j = 0; j < 8; j++)
+		{
+			float *p_out = reinterpret_cast<float *>(p_dst_bytes + (i + j) * dst_stride);
+			p_out[0]     = xs[j];
+			p_out[1]     = ys[j];
+			p_out[2]     = zs[j];
+			if (dst_components == 4)
+			{
+				p_out[3] = ws[j];
+			}
+		}
+	}
+	return i;
+}
+
+#endif
+
+void convert_attribute(const AttributeSource &src, float *p_dst, size_t dst_stride, uint32_t dst_components, size_t count, uint32_t convert_bits, SimdLevel simd_level)
+{
+	if (dst_components < 3)
+	{
+		convert_bits = 0;
+	}
+
+	size_t first = 0;
+#ifdef W3D_VERTEX_CONVERT_X86
+	if (simd_level == SimdLevel::eAVX2)
+	{
+		first = convert_float_attribute_avx2(src, p_dst, dst_stride, dst_components, count, convert_bits);
+	}
+	if (simd_level >= SimdLevel::eSSE41 && first < count)
+	{
+		// The SSE4.1 kernel works from element 0. Hand it the rest only.
+		AttributeSource rest = src;
+		rest.p_data          = src.p_data + first * src.stride;
+		float *p_rest        = reinterpret_cast<float *>(reinterpret_cast<uint8_t *>(p_dst) + first * dst_stride);
+		first += convert_attribute_sse41(rest, p_rest, dst_stride, dst_components, count - first, convert_bits);
+	}
+#endif
+	convert_attribute_scalar(src, p_dst, dst_stride, dst_components, first, count, convert_bits);
+}
+
+void fill_attribute(const float *p_value, float *p_dst, size_t dst_stride, uint32_t dst_components, size_t count)
+{
+	uint8_t *p_dst_bytes = reinterpret_cast<uint8_t *>(p_dst);
+	for (size_t i = 0; i < count; i++)
+	{
+		std::memcpy(p_dst_bytes + i * dst_stride, p_value, dst_components * sizeof(float));
+	}
+}
+
+}        // namespace W3D
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace W3D
+{
+
+// Bulk converters from strided vertex attributes to floats.
+// They run on AVX2 or SSE4.1 when the CPU has it and fall back to scalar code otherwise.
+// * Nothing here depends on glTF. gltf_utils maps accessors to AttributeSource.
+
+enum class ComponentType : uint32_t
+{
+	eInt8,
+	eUint8,
+	eInt16,
+	eUint16,
+	eUint32,
+	eFloat,
+};
+
+enum class SimdLevel : uint32_t
+{
+	eScalar,
+	eSSE41,
+	eAVX2,
+};
+
+// count elements of components components each, stride bytes apart.
+struct AttributeSource
+{
+	const uint8_t *p_data;
+	size_t         stride;
+	ComponentType  type;
+	uint32_t       components;
+	bool           normalized;        // Integers are mapped to [0, 1] or [-1, 1]. Otherwise they are converted as they are.
+};
+
+enum AttributeConvertBits : uint32_t
+{
+	ATTRIBUTE_CONVERT_FLIP_X    = 1 << 0,        // Negate x. This is the handedness flip, see W3D_CONVERSION_SCALE.
+	ATTRIBUTE_CONVERT_NORMALIZE = 1 << 1,        // Normalize xyz. Zero vectors stay zero.
+};
+
+// The best level the CPU supports.
+SimdLevel get_simd_level();
+size_t    get_component_size(ComponentType type);
+
+// Convert count elements into p_dst. Destination elements are dst_stride BYTES apart and hold dst_components floats.
+// Components the source doesn't have are 0, except a missing 4th component which is 1.
+// convert_bits only apply when dst_components >= 3.
+void convert_attribute(const AttributeSource &src, float *p_dst, size_t dst_stride, uint32_t dst_components, size_t count, uint32_t convert_bits = 0, SimdLevel simd_level = get_simd_level());
+// Write the dst_components floats of p_value into count elements.
+void fill_attribute(const float *p_value, float *p_dst, size_t dst_stride, uint32_t dst_components, size_t count);
+
+}        // namespace W3D
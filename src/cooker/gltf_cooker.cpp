@@ -0,0 +1,714 @@
+#include "gltf_cooker.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+
+#include <algorithm>
+#include <queue>
+
+#include "common/ktx2.hpp"
+#include "common/logging.hpp"
+#include "common/mipmap.hpp"
+#include "common/utils.hpp"
+#include "gltf_utils.hpp"
+#include "scene_graph/components/pbr_material.hpp"
+#include "scene_graph/components/submesh.hpp"
+#include "scene_graph/scripts/animation.hpp"
+
+namespace W3D
+{
+
+GLTFCooker::GLTFCooker(bool compress_textures) :
+    compress_textures_(compress_textures)
+{
+}
+
+// Cook a glTF file into a pack.
+void GLTFCooker::cook(const std::string &input_path, const std::string &output_path, int scene_index)
+{
+	load_gltf_model(input_path);
+
+	// Same order as GLTFLoader::parse_scene.
+	cook_samplers();
+	cook_images();
+	cook_textures();
+	cook_materials();
+	cook_meshs();
+	cook_skins();
+	cook_cameras();
+	cook_nodes(scene_index);
+	cook_animations();
+
+	writer_.write(output_path);
+	LOGI("Cooked {} into {} ({} bytes of payload).", input_path, output_path, writer_.get_data_size());
+}
+
+// Read the gltf file using tinygltf.
+void GLTFCooker::load_gltf_model(const std::string &input_path)
+{
+	std::string        err;
+	std::string        warn;
+	tinygltf::TinyGLTF gltf_loader;
+
+	std::string file_extension = fu::get_file_extension(input_path);
+	bool        load_result;
+
+	if (file_extension == "glb")
+	{
+		size_t      pos      = input_path.find_last_of('/');
+		std::string base_dir = pos == std::string::npos ? "" : input_path.substr(0, pos);
+		glb_file_            = fu::MappedFile(input_path);
+		load_result          = load_glb_in_place(gltf_model_, &err, &warn, glb_file_.get_data(), glb_file_.get_size(), base_dir, &p_glb_bin_);
+	}
+	else if (file_extension == "gltf")
+	{
+		gltf_loader.SetImageLoader(&load_image_data, nullptr);
+		load_result = gltf_loader.LoadASCIIFromFile(&gltf_model_, &err, &warn, input_path.c_str());
+	}
+	else
+	{
+		throw std::runtime_error("Unsupported file type ." + file_extension + " for gltf models!");
+	}
+
+	if (!warn.empty())
+	{
+		LOGW("{}", warn);
+	}
+
+	if (!err.empty())
+	{
+		throw std::runtime_error(err);
+	}
+
+	if (!load_result)
+	{
+		throw std::runtime_error("Unable to load gltf file.");
+	}
+}
+
+// Pick a scene to cook.
+tinygltf::Scene *GLTFCooker::pick_scene(int scene_idx)
+{
+	int scene_count = static_cast<int>(gltf_model_.scenes.size());
+
+	if (scene_idx >= 0 && scene_idx < scene_count)
+	{
+		return &gltf_model_.scenes[scene_idx];
+	}
+	else if (gltf_model_.defaultScene >= 0 && gltf_model_.defaultScene < scene_count)
+	{
+		return &gltf_model_.scenes[gltf_model_.defaultScene];
+	}
+	else if (scene_count > 0)
+	{
+		return &gltf_model_.scenes[0];
+	}
+
+	throw std::runtime_error("Couldn't determine which scene to cook");
+}
+
+// Cook the samplers. The default sampler goes last.
+void GLTFCooker::cook_samplers()
+{
+	for (const tinygltf::Sampler &gltf_sampler : gltf_model_.samplers)
+	{
+		writer_.add(cook_sampler(gltf_sampler));
+	}
+
+	tinygltf::Sampler default_sampler;
+	default_sampler.minFilter = TINYGLTF_TEXTURE_FILTER_LINEAR;
+	default_sampler.magFilter = TINYGLTF_TEXTURE_FILTER_LINEAR;
+	default_sampler.wrapS     = TINYGLTF_TEXTURE_WRAP_REPEAT;
+	default_sampler.wrapT     = TINYGLTF_TEXTURE_WRAP_REPEAT;
+	default_sampler_          = writer_.add(cook_sampler(default_sampler));
+}
+
+pack::Sampler GLTFCooker::cook_sampler(const tinygltf::Sampler &gltf_sampler)
+{
+	return {
+	    .name           = writer_.add_string(gltf_sampler.name),
+	    .mag_filter     = static_cast<uint32_t>(to_vk_mag_filter(gltf_sampler.magFilter)),
+	    .min_filter     = static_cast<uint32_t>(to_vk_min_filter(gltf_sampler.minFilter)),
+	    .mipmap_mode    = static_cast<uint32_t>(to_vk_mipmap_mode(gltf_sampler.minFilter)),
+	    .address_mode_u = static_cast<uint32_t>(to_vk_wrap_mode(gltf_sampler.wrapS)),
+	    .address_mode_v = static_cast<uint32_t>(to_vk_wrap_mode(gltf_sampler.wrapT)),
+	    .address_mode_w = static_cast<uint32_t>(to_vk_wrap_mode(gltf_sampler.wrapS)),
+	    .reserved       = 0,
+	};
+}
+
+// Cook the images with a full mip chain. Color textures are stored as sRGB, data textures as UNORM.
+// The chain is built in RGBA8 and then block compressed level by level. KTX2 images are copied as they are.
+// The default image (a 1x1 black image) goes last.
+void GLTFCooker::cook_images()
+{
+	image_usages_ = find_image_usages(gltf_model_);
+
+	for (size_t i = 0; i < gltf_model_.images.size(); i++)
+	{
+		tinygltf::Image &gltf_image = gltf_model_.images[i];
+		if (gltf_image.mimeType == "image/ktx2")
+		{
+			writer_.add(cook_ktx2_image(gltf_image));
+			gltf_image.image = std::vector<unsigned char>();
+			continue;
+		}
+
+		bool                 is_srgb = image_usages_[i] & (IMAGE_USAGE_BASE_COLOR | IMAGE_USAGE_EMISSIVE);
+		uint32_t             width   = to_u32(gltf_image.width);
+		uint32_t             height  = to_u32(gltf_image.height);
+		std::vector<uint8_t> binary  = to_rgba8(gltf_image);
+		vk::Format           format  = is_srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+		uint32_t             levels  = generate_mip_chain_rgba8(binary, width, height, is_srgb);
+
+		if (compress_textures_)
+		{
+			BCFormat bc_format = pick_bc_format(image_usages_[i], binary, static_cast<size_t>(width) * height);
+			binary             = encode_bc_mip_chain(bc_format, binary, width, height, levels);
+			format             = to_vk_format(bc_format, is_srgb);
+		}
+
+		writer_.add(pack::Image{
+		    .name     = writer_.add_string(gltf_image.name),
+		    .format   = static_cast<uint32_t>(format),
+		    .width    = width,
+		    .height   = height,
+		    .levels   = levels,
+		    .reserved = 0,
+		    .data     = writer_.add_blob(binary.data(), binary.size()),
+		});
+		// The decoded pixels are not needed anymore.
+		gltf_image.image = std::vector<unsigned char>();
+	}
+
+	const uint8_t black[4] = {0u, 0u, 0u, 0u};
+	writer_.add(pack::Image{
+	    .name     = writer_.add_string("default_image"),
+	    .format   = static_cast<uint32_t>(vk::Format::eR8G8B8A8Srgb),
+	    .width    = 1,
+	    .height   = 1,
+	    .levels   = 1,
+	    .reserved = 0,
+	    .data     = writer_.add_blob(black, sizeof(black)),
+	});
+}
+
+// KTX2 images are already in their GPU format. Their levels are copied without touching them.
+pack::Image GLTFCooker::cook_ktx2_image(const tinygltf::Image &gltf_image)
+{
+	KTX2Image ktx2_image = read_ktx2(gltf_image.image.data(), gltf_image.image.size());
+	if (ktx2_image.faces != 1)
+	{
+		throw std::runtime_error("Image " + gltf_image.uri + " is a cube map.");
+	}
+
+	return {
+	    .name     = writer_.add_string(gltf_image.name),
+	    .format   = ktx2_image.vk_format,
+	    .width    = ktx2_image.width,
+	    .height   = ktx2_image.height,
+	    .levels   = ktx2_image.levels,
+	    .reserved = 0,
+	    .data     = writer_.add_blob(ktx2_image.binary.data(), ktx2_image.binary.size()),
+	};
+}
+
+// Pick a block format from the material slots that use an image.
+// * Normal maps only keep xy in BC5. pbr.frag rebuilds z.
+// * Metallic-roughness reads g and b, so it stays in BC1 like any image with several uses.
+BCFormat GLTFCooker::pick_bc_format(uint32_t usage, const std::vector<uint8_t> &rgba8, size_t pixel_count) const
+{
+	if (usage == IMAGE_USAGE_NORMAL)
+	{
+		return BCFormat::eBC5;
+	}
+	if (usage == IMAGE_USAGE_OCCLUSION)
+	{
+		return BCFormat::eBC4;
+	}
+	if (usage & IMAGE_USAGE_BASE_COLOR)
+	{
+		for (size_t i = 0; i < pixel_count; i++)
+		{
+			if (rgba8[i * 4 + 3] != 255u)
+			{
+				return BCFormat::eBC3;
+			}
+		}
+	}
+	return BCFormat::eBC1;
+}
+
+vk::Format GLTFCooker::to_vk_format(BCFormat format, bool is_srgb) const
+{
+	switch (format)
+	{
+		case BCFormat::eBC1:
+			return is_srgb ? vk::Format::eBc1RgbSrgbBlock : vk::Format::eBc1RgbUnormBlock;
+		case BCFormat::eBC3:
+			return is_srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+		case BCFormat::eBC4:
+			return vk::Format::eBc4UnormBlock;
+		case BCFormat::eBC5:
+			return vk::Format::eBc5UnormBlock;
+	}
+	return vk::Format::eUndefined;
+}
+
+// Expand a decoded 8 bit image to 4 channels.
+std::vector<uint8_t> GLTFCooker::to_rgba8(const tinygltf::Image &gltf_image) const
+{
+	if (gltf_image.image.empty())
+	{
+		throw std::runtime_error("Image " + gltf_image.uri + " could not be decoded.");
+	}
+	if (gltf_image.bits != 8 || gltf_image.component < 1 || gltf_image.component > 4)
+	{
+		throw std::runtime_error("Image " + gltf_image.uri + " is not an 8 bit image.");
+	}
+	if (gltf_image.component == 4)
+	{
+		return gltf_image.image;
+	}
+
+	size_t               pixel_count = static_cast<size_t>(gltf_image.width) * gltf_image.height;
+	size_t               component   = gltf_image.component;
+	std::vector<uint8_t> rgba(pixel_count * 4);
+	for (size_t i = 0; i < pixel_count; i++)
+	{
+		const uint8_t *p_src = &gltf_image.image[i * component];
+		uint8_t       *p_dst = &rgba[i * 4];
+		// Gray and gray-alpha images are splatted to rgb.
+		p_dst[0] = p_src[0];
+		p_dst[1] = component >= 3 ? p_src[1] : p_src[0];
+		p_dst[2] = component >= 3 ? p_src[2] : p_src[0];
+		p_dst[3] = component == 2 ? p_src[1] : 255u;
+	}
+	return rgba;
+}
+
+// Cook the textures. The default texture goes last.
+void GLTFCooker::cook_textures()
+{
+	int32_t default_image = static_cast<int32_t>(writer_.get_count<pack::Image>() - 1);
+	for (const tinygltf::Texture &gltf_texture : gltf_model_.textures)
+	{
+		assert(gltf_texture.source < static_cast<int>(gltf_model_.images.size()));
+		bool has_sampler = gltf_texture.sampler >= 0 && gltf_texture.sampler < static_cast<int>(gltf_model_.samplers.size());
+		writer_.add(pack::Texture{
+		    .name    = writer_.add_string(gltf_texture.name),
+		    .image   = gltf_texture.source >= 0 ? gltf_texture.source : default_image,
+		    .sampler = has_sampler ? gltf_texture.sampler : static_cast<int32_t>(default_sampler_),
+		});
+	}
+
+	writer_.add(pack::Texture{
+	    .name    = writer_.add_string("default_texture"),
+	    .image   = default_image,
+	    .sampler = static_cast<int32_t>(default_sampler_),
+	});
+}
+
+// Cook the materials. The default material goes last.
+// * Factors that are not in the file keep sg::PBRMaterial's defaults, like GLTFLoader.
+void GLTFCooker::cook_materials()
+{
+	std::vector<tinygltf::Material> gltf_materials = gltf_model_.materials;
+	gltf_materials.emplace_back();
+
+	for (size_t i = 0; i < gltf_materials.size(); i++)
+	{
+		const tinygltf::Material &gltf_material = gltf_materials[i];
+		pack::Material            record{
+		               .name              = writer_.add_string(gltf_material.name),
+		               .flag              = 0,
+		               .alpha_mode        = static_cast<uint32_t>(sg::AlphaMode::Opaque),
+		               .double_sided      = 0,
+		               .base_color_factor = {0.0f, 0.0f, 0.0f, 0.0f},
+		               .emissive          = {0.0f, 0.0f, 0.0f},
+		               .metallic_factor   = 0.0f,
+		               .roughness_factor  = 0.0f,
+		               .alpha_cutoff      = 0.5f,
+		               .textures          = {pack::NONE, pack::NONE, pack::NONE, pack::NONE, pack::NONE},
+        };
+
+		for (auto &gltf_value : gltf_material.values)
+		{
+			if (gltf_value.first == "baseColorFactor")
+			{
+				const auto &color_factor = gltf_value.second.ColorFactor();
+				std::transform(color_factor.begin(), color_factor.end(), record.base_color_factor, [](double v) { return static_cast<float>(v); });
+			}
+			else if (gltf_value.first == "metallicFactor")
+			{
+				record.metallic_factor = static_cast<float>(gltf_value.second.Factor());
+			}
+			else if (gltf_value.first == "roughnessFactor")
+			{
+				record.roughness_factor = static_cast<float>(gltf_value.second.Factor());
+			}
+			else if (gltf_value.first.find("Texture") != std::string::npos)
+			{
+				cook_material_texture(record, gltf_value.first, gltf_value.second.TextureIndex());
+			}
+		}
+
+		for (auto &gltf_value : gltf_material.additionalValues)
+		{
+			if (gltf_value.first == "emissiveFactor")
+			{
+				const auto &emissive_factor = gltf_value.second.number_array;
+				for (size_t c = 0; c < 3 && c < emissive_factor.size(); c++)
+				{
+					record.emissive[c] = static_cast<float>(emissive_factor[c]);
+				}
+			}
+			else if (gltf_value.first == "alphaMode")
+			{
+				if (gltf_value.second.string_value == "BLEND")
+				{
+					record.alpha_mode = static_cast<uint32_t>(sg::AlphaMode::Blend);
+				}
+				else if (gltf_value.second.string_value == "MASK")
+				{
+					record.alpha_mode = static_cast<uint32_t>(sg::AlphaMode::Mask);
+				}
+			}
+			else if (gltf_value.first == "alphaCutoff")
+			{
+				record.alpha_cutoff = static_cast<float>(gltf_value.second.number_value);
+			}
+			else if (gltf_value.first == "doubleSided")
+			{
+				record.double_sided = gltf_value.second.bool_value;
+			}
+			else if (gltf_value.first.find("Texture") != std::string::npos)
+			{
+				cook_material_texture(record, gltf_value.first, gltf_value.second.TextureIndex());
+			}
+		}
+
+		writer_.add(record);
+	}
+}
+
+// Bind a texture to a material slot and set the matching flag bit.
+// * The slots follow pack::TEXTURE_SLOT_NAMES.
+void GLTFCooker::cook_material_texture(pack::Material &record, const std::string &gltf_name, int texture_idx)
+{
+	static const char *gltf_slot_names[pack::TEXTURE_SLOT_COUNT] = {
+	    "baseColorTexture",
+	    "normalTexture",
+	    "occlusionTexture",
+	    "emissiveTexture",
+	    "metallicRoughnessTexture",
+	};
+	static const sg::PBRMaterialFlagBits slot_flag_bits[pack::TEXTURE_SLOT_COUNT] = {
+	    sg::PBRMaterialFlagBits::eBaseColorTexture,
+	    sg::PBRMaterialFlagBits::eNormalTexture,
+	    sg::PBRMaterialFlagBits::eOcclusionTexture,
+	    sg::PBRMaterialFlagBits::eEmissiveTexture,
+	    sg::PBRMaterialFlagBits::eMetallicRoughnessTexture,
+	};
+
+	for (uint32_t slot = 0; slot < pack::TEXTURE_SLOT_COUNT; slot++)
+	{
+		if (gltf_name == gltf_slot_names[slot])
+		{
+			assert(texture_idx >= 0 && texture_idx < gltf_model_.textures.size());
+			record.textures[slot] = texture_idx;
+			record.flag |= static_cast<uint32_t>(slot_flag_bits[slot]);
+			return;
+		}
+	}
+	LOGW("Unsupported texture slot {}.", gltf_name);
+}
+
+// Cook the meshes. Vertices and indices are stored in their final GPU layout.
+void GLTFCooker::cook_meshs()
+{
+	for (const tinygltf::Mesh &gltf_mesh : gltf_model_.meshes)
+	{
+		pack::Mesh mesh_record{
+		    .name          = writer_.add_string(gltf_mesh.name),
+		    .first_submesh = writer_.get_count<pack::SubMesh>(),
+		    .submesh_count = to_u32(gltf_mesh.primitives.size()),
+		    .bound_min     = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()},
+		    .bound_max     = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()},
+		};
+
+		for (const tinygltf::Primitive &primitive : gltf_mesh.primitives)
+		{
+			// Same bound as GLTFLoader::update_parent_mesh_bound.
+			const tinygltf::Accessor &pos_accessor = gltf_model_.accessors[primitive.attributes.find("POSITION")->second];
+			for (int c = 0; c < 3; c++)
+			{
+				mesh_record.bound_min[c] = std::min(mesh_record.bound_min[c], static_cast<float>(pos_accessor.minValues[c]));
+				mesh_record.bound_max[c] = std::max(mesh_record.bound_max[c], static_cast<float>(pos_accessor.maxValues[c]));
+			}
+
+			std::vector<sg::Vertex> vertexs = read_submesh_vertices(gltf_model_, primitive, p_glb_bin_);
+			std::vector<uint8_t>    indexs  = read_submesh_indices(gltf_model_, primitive, p_glb_bin_);
+			bool                    has_material =
+			    primitive.material >= 0 && primitive.material < static_cast<int>(gltf_model_.materials.size());
+
+			writer_.add(pack::SubMesh{
+			    .material     = has_material ? primitive.material : static_cast<int32_t>(gltf_model_.materials.size()),
+			    .vertex_count = to_u32(vertexs.size()),
+			    .index_count  = to_u32(indexs.size() / sizeof(uint32_t)),
+			    .reserved     = 0,
+			    .vertices     = writer_.add_blob(vertexs.data(), vertexs.size() * sizeof(sg::Vertex)),
+			    .indices      = writer_.add_blob(indexs.data(), indexs.size()),
+			});
+		}
+
+		writer_.add(mesh_record);
+	}
+}
+
+// Cook the skins. The joints are written in cook_nodes once the node order is known.
+void GLTFCooker::cook_skins()
+{
+	for (const tinygltf::Skin &gltf_skin : gltf_model_.skins)
+	{
+		size_t                 joint_count = gltf_skin.joints.size();
+		std::vector<glm::mat4> IBMs(joint_count, glm::mat4(1.0f));
+		if (gltf_skin.inverseBindMatrices >= 0)
+		{
+			DataAccessInfo<float> IBM = get_accessor_data_ptr<float>(gltf_model_, gltf_skin.inverseBindMatrices, p_glb_bin_);
+			for (size_t joint_id = 0; joint_id < joint_count; joint_id++)
+			{
+				IBMs[joint_id] = glm::make_mat4(&IBM.p_data[joint_id * IBM.stride]);
+				to_W3D_matrix_in_place(IBMs[joint_id]);
+			}
+		}
+
+		writer_.add(pack::Skin{
+		    .name        = writer_.add_string(gltf_skin.name),
+		    .joint_count = to_u32(joint_count),
+		    .joints      = {},
+		    .IBMs        = writer_.add_blob(IBMs.data(), IBMs.size() * sizeof(glm::mat4)),
+		});
+	}
+}
+
+// Cook the cameras. The default camera goes last.
+void GLTFCooker::cook_cameras()
+{
+	for (const tinygltf::Camera &gltf_camera : gltf_model_.cameras)
+	{
+		if (gltf_camera.type != "perspective")
+		{
+			throw std::runtime_error("Camera type not supported");
+		}
+		writer_.add(pack::Camera{
+		    .name         = writer_.add_string(gltf_camera.name),
+		    .aspect_ratio = static_cast<float>(gltf_camera.perspective.aspectRatio),
+		    .yfov         = static_cast<float>(gltf_camera.perspective.yfov),
+		    .znear        = static_cast<float>(gltf_camera.perspective.znear),
+		    .zfar         = static_cast<float>(gltf_camera.perspective.zfar),
+		});
+	}
+
+	writer_.add(pack::Camera{
+	    .name         = writer_.add_string("default_camera"),
+	    .aspect_ratio = 1.77f,
+	    .yfov         = 1.0f,
+	    .znear        = 0.1f,
+	    .zfar         = 1000.0f,
+	});
+}
+
+// Cook the nodes in breadth first order so that parents are written before their children.
+// Nodes that are not part of the picked scene are appended without a parent, like GLTFLoader leaves them.
+void GLTFCooker::cook_nodes(int scene_idx)
+{
+	struct NodeTraversal
+	{
+		int32_t parent;
+		int     curr_idx;
+	};
+
+	tinygltf::Scene          *p_gltf_scene = pick_scene(scene_idx);
+	std::queue<NodeTraversal> q;
+	node_remap_.assign(gltf_model_.nodes.size(), pack::NONE);
+
+	writer_.set_scene_name(p_gltf_scene->name);
+	for (int i : p_gltf_scene->nodes)
+	{
+		q.push({
+		    .parent   = pack::PARENT_ROOT,
+		    .curr_idx = i,
+		});
+	}
+
+	while (!q.empty())
+	{
+		NodeTraversal traversal = q.front();
+		q.pop();
+		assert(traversal.curr_idx < gltf_model_.nodes.size());
+		if (node_remap_[traversal.curr_idx] != pack::NONE)
+		{
+			continue;
+		}
+
+		const tinygltf::Node &gltf_node = gltf_model_.nodes[traversal.curr_idx];
+		pack::Node            record    = cook_node(gltf_node);
+		record.parent                   = traversal.parent;
+		int32_t idx                     = writer_.add(record);
+		node_remap_[traversal.curr_idx] = idx;
+
+		for (int child_idx : gltf_node.children)
+		{
+			q.push({
+			    .parent   = idx,
+			    .curr_idx = child_idx,
+			});
+		}
+	}
+
+	for (size_t i = 0; i < gltf_model_.nodes.size(); i++)
+	{
+		if (node_remap_[i] == pack::NONE)
+		{
+			pack::Node record = cook_node(gltf_model_.nodes[i]);
+			record.parent     = pack::PARENT_NONE;
+			node_remap_[i]    = writer_.add(record);
+		}
+	}
+
+	// The default camera node.
+	writer_.add(pack::Node{
+	    .name        = writer_.add_string("default_camera"),
+	    .parent      = pack::PARENT_ROOT,
+	    .mesh        = pack::NONE,
+	    .camera      = static_cast<int32_t>(writer_.get_count<pack::Camera>() - 1),
+	    .skin        = pack::NONE,
+	    .translation = {0.0f, 0.0f, 0.0f},
+	    .rotation    = {0.0f, 0.0f, 0.0f, 1.0f},
+	    .scale       = {1.0f, 1.0f, 1.0f},
+	});
+
+	// Now that the node order is final, the skin joints can point to it.
+	for (uint32_t i = 0; i < writer_.get_count<pack::Skin>(); i++)
+	{
+		const tinygltf::Skin &gltf_skin = gltf_model_.skins[i];
+		std::vector<uint32_t> joints;
+		joints.reserve(gltf_skin.joints.size());
+		for (int joint : gltf_skin.joints)
+		{
+			joints.push_back(node_remap_[joint]);
+		}
+		writer_.get<pack::Skin>(i).joints = writer_.add_blob(joints.data(), joints.size() * sizeof(uint32_t));
+	}
+}
+
+// Cook a node's local transform. Matrices are decomposed into TRS.
+pack::Node GLTFCooker::cook_node(const tinygltf::Node &gltf_node)
+{
+	glm::vec3 translation(0.0f);
+	glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale(1.0f);
+
+	if (!gltf_node.matrix.empty())
+	{
+		glm::mat4 matrix;
+		std::transform(gltf_node.matrix.begin(), gltf_node.matrix.end(), glm::value_ptr(matrix), [](double v) { return static_cast<float>(v); });
+		to_W3D_matrix_in_place(matrix);
+		glm::vec3 skew;
+		glm::vec4 perspective;
+		glm::decompose(matrix, scale, rotation, translation, skew, perspective);
+	}
+	else
+	{
+		if (!gltf_node.translation.empty())
+		{
+			translation = glm::vec3(gltf_node.translation[0], gltf_node.translation[1], gltf_node.translation[2]);
+			to_W3D_vector_in_place(translation);
+		}
+		if (!gltf_node.rotation.empty())
+		{
+			rotation = glm::quat::wxyz(gltf_node.rotation[3], gltf_node.rotation[0], gltf_node.rotation[1], gltf_node.rotation[2]);
+			to_W3D_quaternion_in_place(rotation);
+		}
+		if (!gltf_node.scale.empty())
+		{
+			scale = glm::vec3(gltf_node.scale[0], gltf_node.scale[1], gltf_node.scale[2]);
+		}
+	}
+
+	return {
+	    .name        = writer_.add_string(gltf_node.name),
+	    .parent      = pack::PARENT_NONE,
+	    .mesh        = gltf_node.mesh,
+	    .camera      = gltf_node.camera,
+	    .skin        = gltf_node.skin,
+	    .translation = {translation.x, translation.y, translation.z},
+	    .rotation    = {rotation.x, rotation.y, rotation.z, rotation.w},
+	    .scale       = {scale.x, scale.y, scale.z},
+	};
+}
+
+// Cook the animations. Every channel carries its own copy of the sampler data, like sg::AnimationChannel.
+void GLTFCooker::cook_animations()
+{
+	for (const tinygltf::Animation &gltf_animation : gltf_model_.animations)
+	{
+		pack::Animation record{
+		    .name          = writer_.add_string(gltf_animation.name),
+		    .first_channel = writer_.get_count<pack::Channel>(),
+		    .channel_count = to_u32(gltf_animation.channels.size()),
+		};
+
+		for (const tinygltf::AnimationChannel &gltf_channel : gltf_animation.channels)
+		{
+			const tinygltf::AnimationSampler &gltf_sampler = gltf_animation.samplers[gltf_channel.sampler];
+			const tinygltf::Accessor         &input        = gltf_model_.accessors[gltf_sampler.input];
+			const tinygltf::Accessor         &output       = gltf_model_.accessors[gltf_sampler.output];
+			sg::AnimationTarget               target       = to_sg_animation_target(gltf_channel.target_path);
+
+			// ! The keyframes are copied as floats, like GLTFLoader reads them. Normalized integer keyframes are not supported.
+			if (input.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || output.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+			{
+				throw std::runtime_error("Animation " + gltf_animation.name + " has non-float keyframes.");
+			}
+
+			std::vector<uint8_t> inputs  = get_attr_data(gltf_model_, gltf_sampler.input, p_glb_bin_);
+			std::vector<uint8_t> outputs = get_attr_data(gltf_model_, gltf_sampler.output, p_glb_bin_);
+
+			// Convert the keyframes to W3D's handedness.
+			float *p_outputs = reinterpret_cast<float *>(outputs.data());
+			if (target == sg::AnimationTarget::eTranslation)
+			{
+				for (size_t i = 0; i < output.count; i++)
+				{
+					p_outputs[i * 3] *= W3D_CONVERSION_SCALE.x;
+				}
+			}
+			else if (target == sg::AnimationTarget::eRotation)
+			{
+				for (size_t i = 0; i < output.count; i++)
+				{
+					glm::quat quat = glm::quat::wxyz(p_outputs[i * 4 + 3], p_outputs[i * 4 + 0], p_outputs[i * 4 + 1], p_outputs[i * 4 + 2]);
+					to_W3D_quaternion_in_place(quat);
+					p_outputs[i * 4 + 0] = quat.x;
+					p_outputs[i * 4 + 1] = quat.y;
+					p_outputs[i * 4 + 2] = quat.z;
+				}
+			}
+
+			writer_.add(pack::Channel{
+			    .node          = node_remap_[gltf_channel.target_node],
+			    .target        = static_cast<uint32_t>(target),
+			    .interpolation = static_cast<uint32_t>(to_sg_animation_type(gltf_sampler.interpolation)),
+			    .key_count     = to_u32(input.count),
+			    .inputs        = writer_.add_blob(inputs.data(), inputs.size()),
+			    .outputs       = writer_.add_blob(outputs.data(), outputs.size()),
+			});
+		}
+
+		writer_.add(record);
+	}
+}
+
+}        // namespace W3D
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <tiny_gltf.h>
+
+#include <string>
+#include <vector>
+
+#include "asset_pack.hpp"
+#include "common/bc_encoder.hpp"
+#include "common/file_utils.hpp"
+#include "common/vk_common.hpp"
+
+namespace W3D
+{
+
+// Offline cooker that turns a glTF scene into a W3D pack.
+// All the work GLTFLoader does on the CPU (decoding, attribute gathering, index widening, handedness conversion) is done here once.
+// The components are written in the same order as GLTFLoader creates them, including the default sampler, texture, material and camera.
+// Material textures are block compressed unless compress_textures is false. See pick_bc_format() for the format of each texture slot.
+class GLTFCooker
+{
+  public:
+	GLTFCooker(bool compress_textures = true);
+
+	void cook(const std::string &input_path, const std::string &output_path, int scene_index = -1);
+
+  private:
+	void                 load_gltf_model(const std::string &input_path);
+	tinygltf::Scene     *pick_scene(int scene_idx);
+	void                 cook_samplers();
+	void                 cook_images();
+	void                 cook_textures();
+	void                 cook_materials();
+	void                 cook_meshs();
+	void                 cook_skins();
+	void                 cook_cameras();
+	void                 cook_nodes(int scene_idx);
+	void                 cook_animations();
+	void                 cook_material_texture(pack::Material &record, const std::string &gltf_name, int texture_idx);
+	pack::Sampler        cook_sampler(const tinygltf::Sampler &gltf_sampler);
+	pack::Node           cook_node(const tinygltf::Node &gltf_node);
+	std::vector<uint8_t> to_rgba8(const tinygltf::Image &gltf_image) const;
+	pack::Image          cook_ktx2_image(const tinygltf::Image &gltf_image);
+	BCFormat             pick_bc_format(uint32_t usage, const std::vector<uint8_t> &rgba8, size_t pixel_count) const;
+	vk::Format           to_vk_format(BCFormat format, bool is_srgb) const;
+
+	bool                  compress_textures_;
+	tinygltf::Model       gltf_model_;
+	fu::MappedFile        glb_file_;
+	const uint8_t        *p_glb_bin_ = nullptr;
+	pack::Writer          writer_;
+	std::vector<uint32_t> image_usages_;
+	std::vector<int>      node_remap_;        // glTF node index -> pack node index
+	uint32_t              default_sampler_ = 0;
+};
+
+}        // namespace W3D
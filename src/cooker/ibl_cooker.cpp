@@ -0,0 +1,43 @@
+#include "ibl_cooker.hpp"
+
+#include <stdexcept>
+
+#include "common/file_utils.hpp"
+#include "common/ibl_reference.hpp"
+#include "common/logging.hpp"
+#include "common/timer.hpp"
+
+namespace W3D
+{
+
+const uint32_t IBLCooker::IRRADIANCE_DIMENSION = 64;
+const uint32_t IBLCooker::PREFILTER_DIMENSION  = 512;
+const uint32_t IBLCooker::BRDF_LUT_DIMENSION   = 512;
+
+void IBLCooker::cook(const std::string &environment_path, const std::string &output_dir)
+{
+	if (fu::get_file_extension(environment_path) != "ktx2")
+	{
+		throw std::runtime_error("Unsupported file type for the environment " + environment_path + ". Only .ktx2 cube maps are supported!");
+	}
+	std::vector<uint8_t> file        = fu::read_binary(environment_path);
+	KTX2Image            environment = read_ktx2(file.data(), file.size());
+
+	Timer timer;
+	timer.start();
+	KTX2Image irradiance = bake_irradiance_reference(environment, IRRADIANCE_DIMENSION);
+	write_map(output_dir, "irradiance", irradiance, timer.tick());
+	KTX2Image prefilter = bake_prefilter_reference(environment, PREFILTER_DIMENSION);
+	write_map(output_dir, "prefilter", prefilter, timer.tick());
+	KTX2Image brdf_lut = bake_brdf_lut_reference(BRDF_LUT_DIMENSION);
+	write_map(output_dir, "brdf_lut", brdf_lut, timer.tick());
+}
+
+void IBLCooker::write_map(const std::string &output_dir, const char *map_name, const KTX2Image &image, double bake_time)
+{
+	std::string path = output_dir + "/" + map_name + ".ktx2";
+	fu::write_binary(path, write_ktx2(image));
+	LOGI("Baked {} in {:.2f} s into {}.", map_name, bake_time, path);
+}
+
+}        // namespace W3D
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+#include "common/ktx2.hpp"
+
+namespace W3D
+{
+
+// Offline cooker that bakes the IBL maps of an environment on the CPU. See common/ibl_reference.hpp.
+// The environment is a KTX2 cube map in RGBA16F or RGBA32F. The maps are written next to each other in the output directory,
+// as irradiance.ktx2, prefilter.ktx2 and brdf_lut.ktx2, with the dimensions and formats PBRBaker bakes them in.
+class IBLCooker
+{
+  public:
+	static const uint32_t IRRADIANCE_DIMENSION;        // Same as PBRBaker.
+	static const uint32_t PREFILTER_DIMENSION;
+	static const uint32_t BRDF_LUT_DIMENSION;
+
+	void cook(const std::string &environment_path, const std::string &output_dir);
+
+  private:
+	void write_map(const std::string &output_dir, const char *map_name, const KTX2Image &image, double bake_time);
+};
+
+}        // namespace W3D
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include "gltf_cooker.hpp"
+#include "ibl_cooker.hpp"
+
+// W3DCooker [--uncompressed] <input.gltf|input.glb> <output.w3dpack> [scene index]
+// --uncompressed keeps the textures in RGBA8 for devices without BC support.
+// W3DCooker --ibl <environment.ktx2> <output directory>
+// --ibl bakes the IBL maps of an environment cube map on the CPU.
+int main(int argc, char **argv)
+{
+	if (argc > 1 && std::string(argv[1]) == "--ibl")
+	{
+		if (argc < 4)
+		{
+			std::cerr << "Usage: W3DCooker --ibl <environment.ktx2> <output directory>" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		try
+		{
+			W3D::IBLCooker cooker;
+			cooker.cook(argv[2], argv[3]);
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	bool compress_textures = true;
+	if (argc > 1 && std::string(argv[1]) == "--uncompressed")
+	{
+		compress_textures = false;
+		argc--;
+		argv++;
+	}
+
+	if (argc < 3)
+	{
+		std::cerr << "Usage: W3DCooker [--uncompressed] <input.gltf|input.glb> <output.w3dpack> [scene index]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		W3D::GLTFCooker cooker(compress_textures);
+		cooker.cook(argv[1], argv[2], argc > 3 ? std::stoi(argv[3]) : -1);
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+};
@@ -1,5 +1,7 @@
 #include "command_buffer.hpp"
 
+#include <algorithm>
+
 #include "core/command_pool.hpp"
 #include "core/device.hpp"
 #include "core/image_resource.hpp"
@@ -64,11 +66,93 @@ void CommandBuffer::reset()
 // Helper function to copy bytes from a buffer into a ImageResource's image.
 void CommandBuffer::update_image(ImageResource &resource, Buffer &staging_buf)
 {
-	auto                            &subresource_range = resource.get_view().get_subresource_range();
-	std::vector<vk::BufferImageCopy> copy_regions      = full_copy_regions(resource.get_view().get_subresource_range(), resource.get_image().get_base_extent(), ImageResource::format_to_bits_per_pixel(resource.get_image().get_format()));
+	update_image(resource, staging_buf, resource.get_view().get_subresource_range().levelCount);
+}
+
+// Only copy the first level_count mip levels. The rest is expected to be generated with generate_mipmaps().
+void CommandBuffer::update_image(ImageResource &resource, Buffer &staging_buf, uint32_t level_count)
+{
+	vk::ImageSubresourceRange subresource_range = resource.get_view().get_subresource_range();
+	subresource_range.levelCount                = level_count;
+
+	std::vector<vk::BufferImageCopy> copy_regions = full_copy_regions(subresource_range, resource.get_image().get_base_extent(), resource.get_image().get_format());
 	handle_.copyBufferToImage(staging_buf.get_handle(), resource.get_image().get_handle(), vk::ImageLayout::eTransferDstOptimal, copy_regions);
 }
 
+// Copy every layer and level of the image into the buffer, in the same layout update_image() expects.
+// * The image is expected to be in eTransferSrcOptimal.
+void CommandBuffer::read_image(ImageResource &resource, Buffer &readback_buf)
+{
+	std::vector<vk::BufferImageCopy> copy_regions = full_copy_regions(resource.get_view().get_subresource_range(), resource.get_image().get_base_extent(), resource.get_image().get_format());
+	handle_.copyImageToBuffer(resource.get_image().get_handle(), vk::ImageLayout::eTransferSrcOptimal, readback_buf.get_handle(), copy_regions);
+}
+
+// Fill every mip level from level 0 with a chain of linear blits.
+// All levels are expected to be in eTransferDstOptimal. They all end up in eShaderReadOnlyOptimal.
+// * The image needs eTransferSrc usage and its format must support linear blits. See PhysicalDevice::is_linear_blit_supported().
+void CommandBuffer::generate_mipmaps(ImageResource &resource, vk::PipelineStageFlags dst_stage_mask)
+{
+	const vk::ImageSubresourceRange &subresource_range = resource.get_view().get_subresource_range();
+	vk::Extent3D                     extent            = resource.get_image().get_base_extent();
+	vk::ImageMemoryBarrier           barrier{
+	              .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	              .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	              .image               = resource.get_image().get_handle(),
+	              .subresourceRange    = {
+	                  .aspectMask     = subresource_range.aspectMask,
+	                  .levelCount     = 1,
+	                  .baseArrayLayer = subresource_range.baseArrayLayer,
+	                  .layerCount     = subresource_range.layerCount,
+            },
+    };
+
+	for (uint32_t m = 1; m < subresource_range.levelCount; m++)
+	{
+		// The previous level becomes the blit source.
+		barrier.subresourceRange.baseMipLevel = m - 1;
+		barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
+		barrier.newLayout                     = vk::ImageLayout::eTransferSrcOptimal;
+		barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask                 = vk::AccessFlagBits::eTransferRead;
+		handle_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+
+		int32_t       src_width  = static_cast<int32_t>(std::max(extent.width >> (m - 1), 1u));
+		int32_t       src_height = static_cast<int32_t>(std::max(extent.height >> (m - 1), 1u));
+		vk::ImageBlit blit{
+		     .srcSubresource = {
+		         .aspectMask     = subresource_range.aspectMask,
+		         .mipLevel       = m - 1,
+		         .baseArrayLayer = subresource_range.baseArrayLayer,
+		         .layerCount     = subresource_range.layerCount,
+            },
+		     .srcOffsets     = {{vk::Offset3D{0, 0, 0}, vk::Offset3D{src_width, src_height, 1}}},
+		     .dstSubresource = {
+		         .aspectMask     = subresource_range.aspectMask,
+		         .mipLevel       = m,
+		         .baseArrayLayer = subresource_range.baseArrayLayer,
+		         .layerCount     = subresource_range.layerCount,
+            },
+		     .dstOffsets = {{vk::Offset3D{0, 0, 0}, vk::Offset3D{std::max(src_width / 2, 1), std::max(src_height / 2, 1), 1}}},
+        };
+		handle_.blitImage(resource.get_image().get_handle(), vk::ImageLayout::eTransferSrcOptimal, resource.get_image().get_handle(), vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+		// The previous level is done.
+		barrier.oldLayout     = vk::ImageLayout::eTransferSrcOptimal;
+		barrier.newLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		handle_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dst_stage_mask, {}, {}, {}, barrier);
+	}
+
+	// The last level was only written to.
+	barrier.subresourceRange.baseMipLevel = subresource_range.levelCount - 1;
+	barrier.oldLayout                     = vk::ImageLayout::eTransferDstOptimal;
+	barrier.newLayout                     = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barrier.srcAccessMask                 = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask                 = vk::AccessFlagBits::eShaderRead;
+	handle_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dst_stage_mask, {}, {}, {}, barrier);
+}
+
 // Helper function to convert a vkImage's format.
 void CommandBuffer::set_image_layout(ImageResource &resource, vk::ImageLayout old_layout, vk::ImageLayout new_layout, vk::PipelineStageFlags src_stage_mask, vk::PipelineStageFlags dst_stage_mask)
 {
@@ -112,6 +196,12 @@ void CommandBuffer::set_image_layout(ImageResource &resource, vk::ImageLayout ol
 			// Make sure any shader reads from the image have been finished
 			barrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
 			break;
+
+		case vk::ImageLayout::eGeneral:
+			// Image is a storage image
+			// Make sure any shader writes to the image have been finished
+			barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+			break;
 		default:
 			// Other source layouts aren't handled (yet)
 			break;
@@ -149,6 +239,11 @@ void CommandBuffer::set_image_layout(ImageResource &resource, vk::ImageLayout ol
 			}
 			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 			break;
+
+		case vk::ImageLayout::eGeneral:
+			// Image will be written by a shader as a storage image
+			barrier.dstAccessMask = vk::AccessFlagBits::eShaderWrite;
+			break;
 		default:
 			// Other source layouts aren't handled (yet)
 			break;
@@ -164,11 +259,12 @@ void CommandBuffer::set_image_layout(ImageResource &resource, vk::ImageLayout ol
 
 // Helper function that generates image copy regions according to a subresource range.
 // The copy regions include all mipmap levels.
-std::vector<vk::BufferImageCopy> CommandBuffer::full_copy_regions(const vk::ImageSubresourceRange &subresource_range, vk::Extent3D base_extent, uint8_t bits_per_pixel)
+// The levels are expected to be tightly packed, layer by layer. Block compressed levels take whole blocks.
+std::vector<vk::BufferImageCopy> CommandBuffer::full_copy_regions(const vk::ImageSubresourceRange &subresource_range, vk::Extent3D base_extent, vk::Format format)
 {
 	std::vector<vk::BufferImageCopy> buffer_copy_regions;
 
-	uint32_t offset = 0;
+	vk::DeviceSize offset = 0;
 	for (size_t l = 0; l < subresource_range.layerCount; l++)
 	{
 		for (size_t m = 0; m < subresource_range.levelCount; m++)
@@ -182,13 +278,13 @@ std::vector<vk::BufferImageCopy> CommandBuffer::full_copy_regions(const vk::Imag
 			        .layerCount     = 1,
 			    },
 			    .imageExtent = {
-			        .width  = base_extent.width >> m,
-			        .height = base_extent.height >> m,
+			        .width  = std::max(base_extent.width >> m, 1u),
+			        .height = std::max(base_extent.height >> m, 1u),
 			        .depth  = 1,
 			    },
 			});
 
-			offset += buffer_copy_regions.back().imageExtent.width * buffer_copy_regions.back().imageExtent.height * bits_per_pixel;
+			offset += ImageResource::get_level_size(format, base_extent, to_u32(m));
 		}
 	}
 
@@ -30,12 +30,15 @@ class CommandBuffer : public VulkanObject<vk::CommandBuffer>
 
 	void set_image_layout(ImageResource &resource, vk::ImageLayout old_layout, vk::ImageLayout new_layout, vk::PipelineStageFlags src_stage_mask = vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlags dst_stage_mask = vk::PipelineStageFlagBits::eAllCommands);
 	void update_image(ImageResource &resouce, Buffer &staging_buf);
+	void update_image(ImageResource &resouce, Buffer &staging_buf, uint32_t level_count);
+	void read_image(ImageResource &resource, Buffer &readback_buf);
+	void generate_mipmaps(ImageResource &resource, vk::PipelineStageFlags dst_stage_mask = vk::PipelineStageFlagBits::eFragmentShader);
 
 	void copy_buffer(Buffer &src, Buffer &dst, size_t size);
 	void copy_buffer(Buffer &src, Buffer &dst, vk::BufferCopy copy_region = {});
 
   private:
-	std::vector<vk::BufferImageCopy> full_copy_regions(const vk::ImageSubresourceRange &subresource_range, vk::Extent3D base_extent, uint8_t bits_per_pixel);
+	std::vector<vk::BufferImageCopy> full_copy_regions(const vk::ImageSubresourceRange &subresource_range, vk::Extent3D base_extent, vk::Format format);
 
   private:
 	CommandPool           &pool_;
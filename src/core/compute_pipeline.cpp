@@ -0,0 +1,46 @@
+#include "compute_pipeline.hpp"
+
+#include "common/file_utils.hpp"
+#include "common/utils.hpp"
+#include "device.hpp"
+
+namespace W3D
+{
+
+// comp_shader_name is the COMPILED compute shader name. Its entry point is assumed to be main.
+ComputePipeline::ComputePipeline(Device &device, const char *comp_shader_name, vk::PipelineLayoutCreateInfo &pl_layout_cinfo) :
+    device_(device)
+{
+	std::vector<uint8_t>       binary = fu::read_shader_binary(comp_shader_name);
+	vk::ShaderModuleCreateInfo shader_module_cinfo{
+	    .codeSize = to_u32(binary.size()),
+	    .pCode    = reinterpret_cast<const uint32_t *>(binary.data()),
+	};
+	vk::ShaderModule comp_shader_module = device_.get_handle().createShaderModule(shader_module_cinfo);
+
+	pl_layout_ = device_.get_handle().createPipelineLayout(pl_layout_cinfo);
+
+	vk::ComputePipelineCreateInfo compute_pipeline_cinfo{
+	    .stage = {
+	        .stage  = vk::ShaderStageFlagBits::eCompute,
+	        .module = comp_shader_module,
+	        .pName  = "main",
+	    },
+	    .layout = pl_layout_,
+	};
+
+	handle_ = device_.get_handle().createComputePipeline(nullptr, compute_pipeline_cinfo).value;
+	device_.get_handle().destroyShaderModule(comp_shader_module);
+}
+
+ComputePipeline::~ComputePipeline()
+{
+	device_.get_handle().destroyPipelineLayout(pl_layout_);
+	device_.get_handle().destroyPipeline(handle_);
+}
+
+vk::PipelineLayout ComputePipeline::get_pipeline_layout()
+{
+	return pl_layout_;
+}
+}        // namespace W3D
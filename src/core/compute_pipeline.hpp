@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common/vk_common.hpp"
+#include "core/vulkan_object.hpp"
+
+namespace W3D
+{
+class Device;
+
+// Wrapper class for a compute vkPipeline.
+// * Like GraphicsPipeline, this class manages both the pipeline's and its layout's lifetime.
+class ComputePipeline : public VulkanObject<vk::Pipeline>
+{
+  public:
+	ComputePipeline(Device &device, const char *comp_shader_name, vk::PipelineLayoutCreateInfo &pl_layout_cinfo);
+	ComputePipeline(ComputePipeline &&) = default;
+	~ComputePipeline() override;
+
+	vk::PipelineLayout get_pipeline_layout();
+
+  private:
+	Device            &device_;
+	vk::PipelineLayout pl_layout_;
+};
+
+}        // namespace W3D
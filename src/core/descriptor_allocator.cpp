@@ -1,8 +1,9 @@
 #include "descriptor_allocator.hpp"
 
+#include <algorithm>
+
 #include "common/utils.hpp"
 #include "device.hpp"
-#include "vulkan/vulkan_hash.hpp"
 
 namespace W3D
 {
@@ -146,7 +147,9 @@ vk::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout &layout)
 
 	try
 	{
-		auto descriptor_set = device_.get_handle().allocateDescriptorSets(descriptor_set_ainfo);
+		auto descriptor_set           = device_.get_handle().allocateDescriptorSets(descriptor_set_ainfo);
+		set_pools_[descriptor_set[0]] = current_pool_;
+		pool_set_counts_[current_pool_]++;
 		return descriptor_set[0];
 	}
 	catch (vk::FragmentedPoolError &err)
@@ -165,7 +168,33 @@ vk::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout &layout)
 	current_pool_ = grab_pool();
 	used_pools_.push_back(current_pool_);
 	descriptor_set_ainfo.descriptorPool = current_pool_;
-	return device_.get_handle().allocateDescriptorSets(descriptor_set_ainfo)[0];
+	vk::DescriptorSet descriptor_set    = device_.get_handle().allocateDescriptorSets(descriptor_set_ainfo)[0];
+	set_pools_[descriptor_set]          = current_pool_;
+	pool_set_counts_[current_pool_]++;
+	return descriptor_set;
+}
+
+// Free a set allocated by this allocator.
+// ! The set must not be used by any pending command buffer.
+void DescriptorAllocator::free(vk::DescriptorSet set)
+{
+	auto it = set_pools_.find(set);
+	if (it == set_pools_.end())
+	{
+		return;
+	}
+	vk::DescriptorPool pool = it->second;
+	set_pools_.erase(it);
+	device_.get_handle().freeDescriptorSets(pool, set);
+
+	// The current pool keeps allocating from the space freed in it. Other pools are recycled once they are empty.
+	if (--pool_set_counts_[pool] == 0 && pool != current_pool_)
+	{
+		device_.get_handle().resetDescriptorPool(pool);
+		pool_set_counts_.erase(pool);
+		used_pools_.erase(std::find(used_pools_.begin(), used_pools_.end(), pool));
+		free_pools_.push_back(pool);
+	}
 }
 
 // Return a free pool.
@@ -193,6 +222,7 @@ vk::DescriptorPool DescriptorAllocator::create_pool()
 		pool_sizes.emplace_back(vk::DescriptorPoolSize{factor.type, to_u32(factor.coeff * DEFAULT_SIZE)});
 	}
 	vk::DescriptorPoolCreateInfo pool_cinfo{};
+	pool_cinfo.flags         = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
 	pool_cinfo.maxSets       = DEFAULT_SIZE;
 	pool_cinfo.poolSizeCount = to_u32(pool_sizes.size());
 	pool_cinfo.pPoolSizes    = pool_sizes.data();
@@ -208,8 +238,10 @@ void DescriptorAllocator::reset_pools()
 		device_.get_handle().resetDescriptorPool(p);
 	}
 
-	free_pools_ = used_pools_;
+	free_pools_.insert(free_pools_.end(), used_pools_.begin(), used_pools_.end());
 	used_pools_.clear();
+	set_pools_.clear();
+	pool_set_counts_.clear();
 	current_pool_ = VK_NULL_HANDLE;
 }
 
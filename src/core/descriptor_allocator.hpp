@@ -3,6 +3,7 @@
 #include <unordered_map>
 
 #include "common/vk_common.hpp"
+#include "vulkan/vulkan_hash.hpp"
 
 namespace W3D
 {
@@ -17,6 +18,7 @@ struct DescriptorAllocation
 
 // Helper Class responsible for allocating descriptor sets.
 // It manages a free list and a used list of descriptor pools.
+// Sets can be freed one by one. A used pool whose sets are all freed goes back to the free list.
 class DescriptorAllocator
 {
 	struct PoolSizeFactor
@@ -33,6 +35,7 @@ class DescriptorAllocator
 	~DescriptorAllocator();
 
 	vk::DescriptorSet allocate(vk::DescriptorSetLayout &layout);
+	void              free(vk::DescriptorSet set);
 	void              reset_pools();
 	const Device     &get_device();
 
@@ -41,9 +44,11 @@ class DescriptorAllocator
 	vk::DescriptorPool grab_pool();
 	vk::DescriptorPool create_pool();
 
-	vk::DescriptorPool              current_pool_{nullptr};        // the pool we allocate things from
-	std::vector<vk::DescriptorPool> free_pools_;                   // contain all free pools
-	std::vector<vk::DescriptorPool> used_pools_;                   // contain all pools that has been used / in use (current_pool_)
+	vk::DescriptorPool                                        current_pool_{nullptr};        // the pool we allocate things from
+	std::vector<vk::DescriptorPool>                           free_pools_;                   // contain all free pools
+	std::vector<vk::DescriptorPool>                           used_pools_;                   // contain all pools that has been used / in use (current_pool_)
+	std::unordered_map<vk::DescriptorSet, vk::DescriptorPool> set_pools_;                    // the pool each live set was allocated from
+	std::unordered_map<vk::DescriptorPool, uint32_t>          pool_set_counts_;              // live sets per used pool
 };
 
 // A cahce from descriptor set layouts.
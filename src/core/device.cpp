@@ -6,6 +6,7 @@
 #include "common/utils.hpp"
 #include "instance.hpp"
 #include "physical_device.hpp"
+#include "resource_cache.hpp"
 
 #include <set>
 
@@ -46,6 +47,10 @@ Device::Device(Instance &instance, PhysicalDevice &physical_device) :
 	vk::PhysicalDeviceFeatures required_features;
 	required_features.samplerAnisotropy = true;
 	required_features.sampleRateShading = true;
+	// Block compressed textures are optional. Packs cooked with --uncompressed run without them.
+	required_features.textureCompressionBC = physical_device.is_bc_compression_supported();
+	// Lets the IBL baker compute the rg16f BRDF LUT. It falls back to a render pass without it.
+	required_features.shaderStorageImageExtendedFormats = physical_device.is_extended_storage_formats_supported();
 
 	vk::DeviceCreateInfo device_cinfo{
 	    .flags                   = {},
@@ -68,10 +73,12 @@ Device::Device(Instance &instance, PhysicalDevice &physical_device) :
 
 	p_device_memory_allocator_ = std::make_unique<DeviceMemoryAllocator>(*this);
 	p_one_time_buf_pool_       = std::make_unique<CommandPool>(*this, graphics_queue_, indices.graphics_index.value(), CommandPoolResetStrategy::eIndividual, vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient);
+	p_resource_cache_          = std::make_unique<ResourceCache>(*this);
 }
 
 Device::~Device()
 {
+	p_resource_cache_.reset();
 	p_one_time_buf_pool_.reset();
 	p_device_memory_allocator_.reset();
 	handle_.destroy();
@@ -132,4 +139,9 @@ const DeviceMemoryAllocator &Device::get_device_memory_allocator() const
 	return *p_device_memory_allocator_;
 }
 
+ResourceCache &Device::get_resource_cache() const
+{
+	return *p_resource_cache_;
+}
+
 }        // namespace W3D
\ No newline at end of file
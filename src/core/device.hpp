@@ -13,9 +13,10 @@ class PhysicalDevice;
 class DeviceMemoryAllocator;
 class CommandPool;
 class CommandBuffer;
+class ResourceCache;
 
 // RAII wrapper for vkDevice.
-// This class also manages queues and device memory allocator.
+// This class also manages queues, device memory allocator and the resource cache.
 // This is the logical representation for a physical device.
 // We offer a graphics queue cmd pool for one time cmd buf along with it.
 // ? (It might be better to decouple this from the device).
@@ -35,6 +36,7 @@ class Device : public VulkanObject<typename vk::Device>
 	const vk::Queue             &get_present_queue() const;
 	const vk::Queue             &get_compute_queue() const;
 	const DeviceMemoryAllocator &get_device_memory_allocator() const;
+	ResourceCache               &get_resource_cache() const;
 
   private:
 	Instance                              &instance_;
@@ -44,5 +46,6 @@ class Device : public VulkanObject<typename vk::Device>
 	vk::Queue                              present_queue_  = nullptr;
 	vk::Queue                              compute_queue_  = nullptr;
 	std::unique_ptr<CommandPool>           p_one_time_buf_pool_;
+	std::unique_ptr<ResourceCache>         p_resource_cache_;
 };
 }        // namespace W3D
\ No newline at end of file
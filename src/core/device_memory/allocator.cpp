@@ -87,6 +87,45 @@ Buffer DeviceMemoryAllocator::allocate_uniform_buffer(size_t size) const
 	return allocate_buffer(buffer_cinfo, allocation_cinfo);
 }
 
+// Allocate a storage buffer.
+// * A storage buffer is filled once through a staging buffer and only read by shaders afterwards.
+Buffer DeviceMemoryAllocator::allocate_storage_buffer(size_t size) const
+{
+	vk::BufferCreateInfo buffer_cinfo{};
+	buffer_cinfo.size  = size;
+	buffer_cinfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	VmaAllocationCreateInfo allocation_cinfo{};
+	allocation_cinfo.flags = 0;
+	allocation_cinfo.usage = VMA_MEMORY_USAGE_AUTO;
+	return allocate_buffer(buffer_cinfo, allocation_cinfo);
+}
+
+// Allocate a storage buffer that stays mapped.
+// * The CPU rewrites it every frame through get_mapped_data(), so it has to be host visible. No transfer is allowed instead.
+Buffer DeviceMemoryAllocator::allocate_mapped_storage_buffer(size_t size) const
+{
+	vk::BufferCreateInfo buffer_cinfo{};
+	buffer_cinfo.size  = size;
+	buffer_cinfo.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+	VmaAllocationCreateInfo allocation_cinfo{};
+	allocation_cinfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+	allocation_cinfo.usage = VMA_MEMORY_USAGE_AUTO;
+	return allocate_buffer(buffer_cinfo, allocation_cinfo);
+}
+
+// Allocate a readback buffer.
+// * A readback buffer is a mapped buffer the GPU copies or writes into, so that we can read the result back. See Buffer::read_mapped_data().
+Buffer DeviceMemoryAllocator::allocate_readback_buffer(size_t size) const
+{
+	vk::BufferCreateInfo buffer_cinfo{};
+	buffer_cinfo.size  = size;
+	buffer_cinfo.usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer;
+	VmaAllocationCreateInfo allocation_cinfo{};
+	allocation_cinfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+	allocation_cinfo.usage = VMA_MEMORY_USAGE_AUTO;
+	return allocate_buffer(buffer_cinfo, allocation_cinfo);
+}
+
 // Helper function to invoke buffer constructor.
 Buffer DeviceMemoryAllocator::allocate_buffer(vk::BufferCreateInfo &buffer_cinfo, VmaAllocationCreateInfo &allocation_cinfo) const
 {
@@ -121,4 +160,29 @@ Image DeviceMemoryAllocator::allocate_null_image() const
 	return Image(Key<DeviceMemoryAllocator>{}, handle_, nullptr);
 };
 
+// Sum the VMA budgets of every device local heap.
+// * Without VK_EXT_memory_budget, VMA estimates the budget as a fraction of the heap size and only counts its own allocations.
+DeviceMemoryBudget DeviceMemoryAllocator::get_device_local_budget() const
+{
+	const VkPhysicalDeviceMemoryProperties *p_memory_props;
+	vmaGetMemoryProperties(handle_, &p_memory_props);
+
+	VmaBudget heap_budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(handle_, heap_budgets);
+
+	DeviceMemoryBudget budget{
+	    .usage  = 0,
+	    .budget = 0,
+	};
+	for (uint32_t i = 0; i < p_memory_props->memoryHeapCount; i++)
+	{
+		if (p_memory_props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+		{
+			budget.usage += heap_budgets[i].usage;
+			budget.budget += heap_budgets[i].budget;
+		}
+	}
+	return budget;
+}
+
 }        // namespace W3D
\ No newline at end of file
@@ -11,6 +11,13 @@ class Device;
 class Image;
 class Buffer;
 
+// Usage and budget of the device local heaps, in bytes.
+struct DeviceMemoryBudget
+{
+	vk::DeviceSize usage;
+	vk::DeviceSize budget;
+};
+
 // RAII Wrapper around VMA allocator.
 // Provide functions that allocate a certain type of buffer.
 class DeviceMemoryAllocator : public VulkanObject<VmaAllocator>
@@ -23,12 +30,17 @@ class DeviceMemoryAllocator : public VulkanObject<VmaAllocator>
 	Buffer allocate_vertex_buffer(size_t size) const;
 	Buffer allocate_index_buffer(size_t size) const;
 	Buffer allocate_uniform_buffer(size_t size) const;
+	Buffer allocate_storage_buffer(size_t size) const;
+	Buffer allocate_mapped_storage_buffer(size_t size) const;
+	Buffer allocate_readback_buffer(size_t size) const;
 	Buffer allocate_buffer(vk::BufferCreateInfo &buffer_cinfo, VmaAllocationCreateInfo &alloc_cinfo) const;
 	Buffer allocate_null_buffer() const;
 
 	Image allocate_device_only_image(vk::ImageCreateInfo &image_cinfo) const;
 	Image allocate_image(vk::ImageCreateInfo &image_cinfo, VmaAllocationCreateInfo &alloc_cinfo) const;
 	Image allocate_null_image() const;
+
+	DeviceMemoryBudget get_device_local_budget() const;
 };
 
 }        // namespace W3D
\ No newline at end of file
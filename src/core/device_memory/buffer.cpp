@@ -74,6 +74,23 @@ void Buffer::update(const uint8_t *p_data, size_t size, size_t offset)
 	}
 }
 
+// Get the address of a persistently mapped buffer, e.g. a staging buffer.
+// * Write to it sequentially and never read from it. The memory may be write combined.
+uint8_t *Buffer::get_mapped_data()
+{
+	assert(is_persistent_);
+	return to_ubyte_ptr(details_.allocation_info.pMappedData);
+}
+
+// Get the address of a persistently mapped buffer the GPU wrote to, e.g. a readback buffer.
+// * The GPU writes must be complete. The memory may not be coherent, so it is invalidated first.
+const uint8_t *Buffer::read_mapped_data()
+{
+	assert(is_persistent_);
+	vmaInvalidateAllocation(details_.allocator, details_.allocation, 0, VK_WHOLE_SIZE);
+	return to_ubyte_ptr(details_.allocation_info.pMappedData);
+}
+
 // Map the buffer if mappable.
 void Buffer::map()
 {
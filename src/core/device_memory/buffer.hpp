@@ -27,6 +27,9 @@ class Buffer : public DeviceMemoryObject<vk::Buffer>
 	void update(const std::vector<uint8_t> &binary, size_t offset = 0);
 	void update(const uint8_t *p_data, size_t size, size_t offset = 0);
 
+	uint8_t       *get_mapped_data();
+	const uint8_t *read_mapped_data();
+
   private:
 	void map();
 	void unmap();
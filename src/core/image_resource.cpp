@@ -3,7 +3,10 @@
 #include <gli/gli.hpp>
 #include <stb_image.h>
 
+#include <algorithm>
+
 #include "common/file_utils.hpp"
+#include "common/ktx2.hpp"
 #include "common/logging.hpp"
 #include "core/device.hpp"
 #include "core/image_view.hpp"
@@ -11,21 +14,30 @@
 namespace W3D
 {
 
-uint8_t ImageResource::format_to_bits_per_pixel(vk::Format format)
+FormatBlockInfo ImageResource::format_to_block_info(vk::Format format)
 {
-	// TODO: add other formats
-	static std::unordered_map<vk::Format, uint32_t> conversion_map{
-	    {vk::Format::eR32G32B32A32Sfloat, 16},
-	    {vk::Format::eR8G8B8A8Srgb, 4},
-	};
+	FormatBlockInfo block;
+	if (!find_format_block_info(format, &block))
+	{
+		LOGE("Unsupported image format {}!", vk::to_string(format));
+		abort();
+	}
+	return block;
+}
 
-	return conversion_map[format];
+// Size in bytes of one mip level of one layer, tightly packed.
+size_t ImageResource::get_level_size(vk::Format format, vk::Extent3D base_extent, uint32_t level)
+{
+	return W3D::get_level_size(format_to_block_info(format), base_extent, level);
 }
 
 // Load an on disk 2d image.
 ImageTransferInfo ImageResource::load_two_dim_image(const std::string &path)
 {
-	// We only use stb now, but we can add more later
+	if (fu::get_file_extension(path) == "ktx2")
+	{
+		return ktx2_load(path);
+	}
 	return stb_load(path);
 };
 
@@ -57,7 +69,7 @@ ImageResource ImageResource::create_empty_two_dim_img_resrc(const Device &device
 ImageTransferInfo stb_load(const std::string &path)
 {
 	std::string extension = fu::get_file_extension(path);
-	if (extension != "jpg" || extension != "png")
+	if (extension != "jpg" && extension != "png")
 	{
 		LOGE("Unsupported file type! W3D only supports loading jpg/png 2d images");
 		abort();
@@ -78,7 +90,7 @@ ImageTransferInfo stb_load(const std::string &path)
 	}
 
 	// Copy raw bytes to our array.
-	std::vector<uint8_t> img_binary = {p_img_data, p_img_data + size};
+	std::vector<uint8_t> img_binary = {p_img_data, p_img_data + static_cast<size_t>(width) * height * req_channels};
 
 	stbi_image_free(p_img_data);
 
@@ -99,6 +111,10 @@ ImageTransferInfo stb_load(const std::string &path)
 // Load a cubic image using gli
 ImageTransferInfo ImageResource::load_cubic_image(const std::string &path)
 {
+	if (fu::get_file_extension(path) == "ktx2")
+	{
+		return ktx2_load(path);
+	}
 	return gli_load(path);
 }
 
@@ -169,6 +185,31 @@ ImageTransferInfo gli_load(const std::string &path)
 	};
 }
 
+// Load a KTX2 file. Block compressed formats are uploaded as they are.
+ImageTransferInfo ktx2_load(const std::string &path)
+{
+	fu::MappedFile file(path);
+	return ktx2_load_from_memory(file.get_data(), file.get_size());
+}
+
+ImageTransferInfo ktx2_load_from_memory(const uint8_t *p_data, size_t size)
+{
+	KTX2Image ktx2_image = read_ktx2(p_data, size);
+
+	return {
+	    .binary = std::move(ktx2_image.binary),
+	    .meta   = {
+	          .extent = {
+	              .width  = ktx2_image.width,
+	              .height = ktx2_image.height,
+	              .depth  = 1,
+            },
+	          .format = static_cast<vk::Format>(ktx2_image.vk_format),
+	          .levels = ktx2_image.levels,
+        },
+	};
+}
+
 // Create NULL image resource
 ImageResource::ImageResource(const Device &device, std::nullptr_t nptr) :
     image_(device.get_device_memory_allocator().allocate_null_image()),
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "common/format_info.hpp"
 #include "common/vk_common.hpp"
 #include "core/image_view.hpp"
 #include "device_memory/image.hpp"
@@ -28,6 +29,8 @@ struct ImageTransferInfo
 
 ImageTransferInfo stb_load(const std::string &path);
 ImageTransferInfo gli_load(const std::string &path);
+ImageTransferInfo ktx2_load(const std::string &path);
+ImageTransferInfo ktx2_load_from_memory(const uint8_t *p_data, size_t size);
 
 class ImageView;
 
@@ -36,7 +39,8 @@ class ImageView;
 class ImageResource
 {
   public:
-	static uint8_t           format_to_bits_per_pixel(vk::Format format);
+	static FormatBlockInfo   format_to_block_info(vk::Format format);
+	static size_t            get_level_size(vk::Format format, vk::Extent3D base_extent, uint32_t level);
 	static ImageTransferInfo load_two_dim_image(const std::string &path);
 	static ImageTransferInfo load_cubic_image(const std::string &path);
 	static ImageResource     create_empty_two_dim_img_resrc(const Device &device, const ImageMetaInfo &meta);
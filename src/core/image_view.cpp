@@ -41,6 +41,25 @@ vk::ImageViewCreateInfo ImageView::cube_view_cinfo(vk::Image image, vk::Format f
 	return view_cinfo;
 }
 
+// Helper function to create a view of the 6 faces of one cube mip level as a 2D array.
+// Compute shaders write the faces of a level through it as an image2DArray storage image.
+vk::ImageViewCreateInfo ImageView::cube_level_view_cinfo(vk::Image image, vk::Format format, vk::ImageAspectFlags aspct_flags, uint32_t mip_level)
+{
+	vk::ImageViewCreateInfo view_cinfo{
+	    .image            = image,
+	    .viewType         = vk::ImageViewType::e2DArray,
+	    .format           = format,
+	    .subresourceRange = {
+	        .aspectMask     = aspct_flags,
+	        .baseMipLevel   = mip_level,
+	        .levelCount     = 1,
+	        .baseArrayLayer = 0,
+	        .layerCount     = 6,
+	    },
+	};
+	return view_cinfo;
+}
+
 // Create a null imageview.
 ImageView::ImageView(const Device &device, std::nullptr_t nptr) :
     device_(device)
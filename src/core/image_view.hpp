@@ -14,6 +14,7 @@ class ImageView : public VulkanObject<vk::ImageView>
   public:
 	static vk::ImageViewCreateInfo two_dim_view_cinfo(vk::Image image, vk::Format format, vk::ImageAspectFlags aspct_flags, uint32_t mip_levels);
 	static vk::ImageViewCreateInfo cube_view_cinfo(vk::Image image, vk::Format format, vk::ImageAspectFlags aspct_flags, uint32_t mip_levels);
+	static vk::ImageViewCreateInfo cube_level_view_cinfo(vk::Image image, vk::Format format, vk::ImageAspectFlags aspct_flags, uint32_t mip_level);
 
 	ImageView(const Device &device, std::nullptr_t nptr);
 	ImageView(const Device &device, vk::ImageViewCreateInfo &image_view_cinfo);
@@ -38,6 +38,37 @@ bool PhysicalDevice::is_all_extensions_supported(const std::vector<const char *>
 	return required_set.empty();
 }
 
+// Check if mip levels of an optimal tiling image with the given format can be generated with linear blits.
+bool PhysicalDevice::is_linear_blit_supported(vk::Format format) const
+{
+	vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	return (handle_.getFormatProperties(format).optimalTilingFeatures & required) == required;
+}
+
+// Check if an optimal tiling image with the given format can be sampled.
+bool PhysicalDevice::is_sampled_image_supported(vk::Format format) const
+{
+	return static_cast<bool>(handle_.getFormatProperties(format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+}
+
+// Check if the BC1-BC7 formats can be enabled. Desktop GPUs have them, most mobile GPUs don't.
+bool PhysicalDevice::is_bc_compression_supported() const
+{
+	return handle_.getFeatures().textureCompressionBC;
+}
+
+// Check if an optimal tiling image with the given format can be written by shaders.
+bool PhysicalDevice::is_storage_image_supported(vk::Format format) const
+{
+	return static_cast<bool>(handle_.getFormatProperties(format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eStorageImage);
+}
+
+// Check if shaders can declare storage images with formats outside the core set, such as rg16f.
+bool PhysicalDevice::is_extended_storage_formats_supported() const
+{
+	return handle_.getFeatures().shaderStorageImageExtendedFormats;
+}
+
 // Query the physical device and find the queue family indices.
 // We can create multiple queue within a family but we don't do that here/
 void PhysicalDevice::find_queue_familiy_indices()
@@ -41,6 +41,11 @@ class PhysicalDevice : public VulkanObject<typename vk::PhysicalDevice>
 	PhysicalDevice &operator=(PhysicalDevice &&)      = delete;
 	PhysicalDevice(PhysicalDevice &&);
 	bool is_all_extensions_supported(const std::vector<const char *> &required_extensions) const;
+	bool is_linear_blit_supported(vk::Format format) const;
+	bool is_sampled_image_supported(vk::Format format) const;
+	bool is_bc_compression_supported() const;
+	bool is_storage_image_supported(vk::Format format) const;
+	bool is_extended_storage_formats_supported() const;
 
 	SwapchainSupportDetails   get_swapchain_support_details() const;
 	const QueueFamilyIndices &get_queue_family_indices() const;
@@ -1,13 +1,22 @@
 #include "renderer.hpp"
 
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <queue>
+#include <unordered_set>
 
+#include "animation_baker.hpp"
+#include "animation_scheduler.hpp"
+#include "async_scene_load.hpp"
 #include "gltf_loader.hpp"
+#include "pack_loader.hpp"
+#include "texture_streamer.hpp"
 
 #include "common/cvar.hpp"
 #include "common/error.hpp"
 #include "common/file_utils.hpp"
+#include "common/job_system.hpp"
 #include "common/logging.hpp"
 #include "common/utils.hpp"
 
@@ -25,23 +34,43 @@
 #include "core/window.hpp"
 
 #include "scene_graph/components/camera.hpp"
+#include "scene_graph/components/crowd.hpp"
 #include "scene_graph/components/mesh.hpp"
 #include "scene_graph/components/pbr_material.hpp"
 #include "scene_graph/components/sampler.hpp"
+#include "scene_graph/components/skin.hpp"
 #include "scene_graph/components/submesh.hpp"
 #include "scene_graph/components/texture.hpp"
 #include "scene_graph/scene.hpp"
 #include "scene_graph/script.hpp"
+#include "scene_graph/script_scheduler.hpp"
 #include "scene_graph/scripts/animation.hpp"
+#include "scene_graph/scripts/animator.hpp"
 
 namespace W3D
 {
-const uint32_t Renderer::NUM_INFLIGHT_FRAMES = 2;
+const uint32_t Renderer::NUM_INFLIGHT_FRAMES    = 2;
+const uint32_t Renderer::INITIAL_JOINT_CAPACITY = 256;
+const uint32_t Renderer::NO_JOINT_OFFSET        = std::numeric_limits<uint32_t>::max();
+// Spherical harmonics lose only very high frequency detail, which irradiance doesn't have. They spare pbr.frag a cube fetch.
+const IrradianceMode Renderer::IRRADIANCE_MODE = IrradianceMode::eSphericalHarmonics;
+
+// All texture names are converted into snake case when they are loaded by gltfloader.
+// Therefore, it's safe to query by name.
+static const std::vector<std::string> PBR_TEXTURE_NAMES = {
+    "base_color_texture",
+    "normal_texture",
+    "occlusion_texture",
+    "emissive_texture",
+    "metallic_roughness_texture",
+};
 
 // Renderer Constructor.
 // * Order matter in this construction.
 Renderer::Renderer()
 {
+	// Start the workers from here so that this thread is the job system's main thread.
+	JobSystem::get();
 	p_window_ = std::make_unique<Window>("Wolfie3D");
 	p_window_->register_callbacks(*this);
 	p_instance_         = std::make_unique<Instance>("Wolfie3D", *p_window_);
@@ -74,8 +103,13 @@ void Renderer::main_loop()
 		timer_.tick();
 		render_frame();
 		update();
+		process_scene_load();
+		stream_textures();
+		JobSystem::get().process_main_thread_jobs();
 		p_window_->poll_events();
 	}
+	JobSystem::get().log_stats();
+	p_animation_scheduler_->log_stats();
 
 	// Wait for all operations in device to end.
 	p_device_->get_handle().waitIdle();
@@ -85,15 +119,23 @@ void Renderer::main_loop()
 void Renderer::update()
 {
 	double delta_time = timer_.tick();
+	crowd_time_ += delta_time;
 	p_camera_node_->get_component<sg::Script>().update(delta_time);
-	std::vector<sg::Animation *> p_animations = p_scene_->get_components<sg::Animation>();
-	for (auto p_animation : p_animations)
+	// Animators are updated at a rate that depends on how visible their meshes are.
+	sg::Camera &camera = p_camera_node_->get_component<sg::Camera>();
+	p_animation_scheduler_->update(camera, static_cast<float>(p_window_->get_extent().height), delta_time);
+	// Animations driven by an animator were sampled by it. The others are sampled in parallel where their nodes don't overlap.
+	std::vector<sg::Script *> p_scripts;
+	for (sg::Animation *p_animation : p_scene_->get_components<sg::Animation>())
 	{
-		// if (p_animation->get_name() == "Survey")
+		if (!p_animation->is_driven())
 		{
-			p_animation->update(delta_time);
-		};
+			p_scripts.push_back(p_animation);
+		}
 	}
+	p_script_scheduler_->update(p_scripts, delta_time);
+	// Scripts and animations only mark transforms dirty. Resolve the world matrices once for the frame.
+	p_scene_->update_transforms();
 }
 
 // Render frame.
@@ -220,10 +262,12 @@ void Renderer::record_draw_commands(uint32_t img_idx)
 	cmd_buf.reset();
 	cmd_buf.begin();
 	update_camera_ubo();
+	update_joint_buf();
 	set_dynamic_states(cmd_buf);
 	begin_render_pass(cmd_buf, p_sframe_buffer_->get_handle(img_idx));
 	draw_skybox(cmd_buf);
 	draw_scene(cmd_buf);
+	draw_crowds(cmd_buf);
 	cmd_buf.get_handle().endRenderPass();
 	cmd_buf.get_handle().end();
 }
@@ -242,6 +286,40 @@ void Renderer::update_camera_ubo()
 	buf.update(&ubo, sizeof(ubo));
 }
 
+// Compute the joint matrices of every skin once for the frame, straight into the frame's joint buffer.
+// Skins are laid out one after the other. Draws find the matrices of their skin by its joint offset.
+// * The frame's fence has been waited on, so neither its joint buffer nor its pbr set are in use.
+void Renderer::update_joint_buf()
+{
+	FrameResource              &frame   = get_current_frame_resource();
+	sg::ComponentView<sg::Skin> p_skins = p_scene_->get_components<sg::Skin>();
+
+	uint32_t joint_count = 0;
+	for (sg::Skin *p_skin : p_skins)
+	{
+		p_skin->joint_offset_ = joint_count;
+		joint_count += to_u32(p_skin->get_joint_count());
+	}
+
+	if (joint_count > frame.joint_capacity)
+	{
+		frame.joint_capacity = std::max(joint_count, 2 * frame.joint_capacity);
+		frame.p_joint_buf    = std::make_unique<Buffer>(p_device_->get_device_memory_allocator().allocate_mapped_storage_buffer(frame.joint_capacity * sizeof(glm::mat4)));
+		// The old set points to the old joint buffer. No submitted work uses it, so free it right away.
+		if (frame.pbr_set)
+		{
+			p_descriptor_state_->allocator.free(frame.pbr_set);
+		}
+		create_pbr_desc_set(frame);
+	}
+
+	glm::mat4 *p_joint_Ms = reinterpret_cast<glm::mat4 *>(frame.p_joint_buf->get_mapped_data());
+	for (sg::Skin *p_skin : p_skins)
+	{
+		p_skin->compute_joint_Ms(*p_scene_, p_joint_Ms + p_skin->joint_offset_);
+	}
+}
+
 // Specify the viewport and the scissor.
 void Renderer::set_dynamic_states(CommandBuffer &cmd_buf)
 {
@@ -361,19 +439,10 @@ void Renderer::draw_node(CommandBuffer &cmd_buf, sg::Node &node)
 {
 	if (node.has_component<sg::Mesh>())
 	{
-		// Bind the skin if there is one.
-		if (node.has_component<sg::Skin>())
-		{
-			bind_skin(cmd_buf, node.get_component<sg::Skin>());
-		}
-		else
-		{
-			disable_skin(cmd_buf);
-		}
-
-		// Push the world matrix.
+		// Push the world matrix and where the matrices of the skin are, if there is one.
 		PBRPCO pbr_pco{
-		    .model = node.get_transform().get_world_M(),
+		    .model        = node.get_transform().get_world_M(),
+		    .joint_offset = node.has_component<sg::Skin>() ? node.get_component<sg::Skin>().joint_offset_ : NO_JOINT_OFFSET,
 		};
 
 		// Draw submeshes
@@ -384,7 +453,7 @@ void Renderer::draw_node(CommandBuffer &cmd_buf, sg::Node &node)
 			// Bind the material.
 			// * The pbr_pco will be updated in bind_material. That's why we need to call push constant per submesh.
 			// * A matrure implementation would sort submesh by material to reduce the amount of bind_material call.
-			bind_material(cmd_buf, *p_pbr_material, pbr_pco);
+			bind_material(cmd_buf, *p_pbr_material, pbr_pco, pbr_.p_pl->get_pipeline_layout());
 			pbr_pco.material_flag = p_pbr_material->flag_;
 			cmd_buf.get_handle().pushConstants<PBRPCO>(pbr_.p_pl->get_pipeline_layout(), vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, pbr_pco);
 			draw_submesh(cmd_buf, *p_submesh);
@@ -392,8 +461,53 @@ void Renderer::draw_node(CommandBuffer &cmd_buf, sg::Node &node)
 	}
 }
 
+// Draw the crowds.
+// Each submesh of a crowd is drawn once for all its instances. crowd.vert skins them with the baked frames.
+void Renderer::draw_crowds(CommandBuffer &cmd_buf)
+{
+	sg::ComponentView<sg::Crowd> p_crowds = p_scene_->get_components<sg::Crowd>();
+	if (p_crowds.empty())
+	{
+		return;
+	}
+
+	vk::PipelineLayout pl_layout = crowd_.p_pl->get_pipeline_layout();
+	cmd_buf.get_handle().bindPipeline(
+	    vk::PipelineBindPoint::eGraphics,
+	    crowd_.p_pl->get_handle());
+	cmd_buf.get_handle().bindDescriptorSets(
+	    vk::PipelineBindPoint::eGraphics,
+	    pl_layout,
+	    0,
+	    get_current_frame_resource().pbr_set,
+	    {});
+
+	for (sg::Crowd *p_crowd : p_crowds)
+	{
+		cmd_buf.get_handle().bindDescriptorSets(
+		    vk::PipelineBindPoint::eGraphics,
+		    pl_layout,
+		    2,
+		    p_crowd->set_,
+		    {});
+
+		CrowdPCO crowd_pco{
+		    .time        = crowd_time_,
+		    .joint_count = p_crowd->joint_count_,
+		};
+		const std::vector<sg::SubMesh *> &p_submeshs = p_crowd->get_node().get_component<sg::Mesh>().get_p_submeshs();
+		for (sg::SubMesh *p_submesh : p_submeshs)
+		{
+			const sg::PBRMaterial *p_pbr_material = dynamic_cast<const sg::PBRMaterial *>(p_submesh->get_material());
+			bind_material(cmd_buf, *p_pbr_material, crowd_pco.pbr, pl_layout);
+			cmd_buf.get_handle().pushConstants<CrowdPCO>(pl_layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, crowd_pco);
+			draw_submesh(cmd_buf, *p_submesh, p_crowd->instance_count_);
+		}
+	}
+}
+
 // Bind the material.
-void Renderer::bind_material(CommandBuffer &cmd_buf, const sg::PBRMaterial &material, PBRPCO &pco)
+void Renderer::bind_material(CommandBuffer &cmd_buf, const sg::PBRMaterial &material, PBRPCO &pco, vk::PipelineLayout pl_layout)
 {
 	// Update the material constants.
 	pco.material_flag        = material.flag_;
@@ -403,37 +517,14 @@ void Renderer::bind_material(CommandBuffer &cmd_buf, const sg::PBRMaterial &mate
 	// Bind the per-submesh descriptor set.
 	cmd_buf.get_handle().bindDescriptorSets(
 	    vk::PipelineBindPoint::eGraphics,
-	    pbr_.p_pl->get_pipeline_layout(),
+	    pl_layout,
 	    1,
 	    material.set_,
 	    {});
 }
 
-// Bind the skin.
-void Renderer::bind_skin(CommandBuffer &cmd_buf, const sg::Skin &skin)
-{
-	Buffer &buf = get_current_frame_resource().joint_buf;
-
-	JointUBO ubo{
-	    .is_skinned = 1,
-	};
-
-	skin.compute_joint_Ms(*p_scene_, ubo.joint_Ms);
-
-	// update the joint uniform buffer
-	buf.update(&ubo, sizeof(ubo));
-}
-
-// Disable the skin.
-void Renderer::disable_skin(CommandBuffer &cmd_buf)
-{
-	Buffer &buf        = get_current_frame_resource().joint_buf;
-	float   is_skinned = 0;
-	buf.update(&is_skinned, sizeof(is_skinned), offsetof(JointUBO, is_skinned));
-}
-
 // Draw commands for the submesh
-void Renderer::draw_submesh(CommandBuffer &cmd_buf, sg::SubMesh &submesh)
+void Renderer::draw_submesh(CommandBuffer &cmd_buf, sg::SubMesh &submesh, uint32_t instance_count)
 {
 	// Vertex buffers are always present.
 	cmd_buf.get_handle().bindVertexBuffers(0, submesh.p_vertex_buf_->get_handle(), {0});
@@ -442,11 +533,11 @@ void Renderer::draw_submesh(CommandBuffer &cmd_buf, sg::SubMesh &submesh)
 	if (submesh.p_idx_buf_)
 	{
 		cmd_buf.get_handle().bindIndexBuffer(submesh.p_idx_buf_->get_handle(), 0, vk::IndexType::eUint32);
-		cmd_buf.get_handle().drawIndexed(submesh.idx_count_, 1, 0, 0, 0);
+		cmd_buf.get_handle().drawIndexed(submesh.idx_count_, instance_count, 0, 0, 0);
 	}
 	else
 	{
-		cmd_buf.get_handle().draw(submesh.vertex_count_, 1, 0, 0);
+		cmd_buf.get_handle().draw(submesh.vertex_count_, instance_count, 0, 0);
 	}
 }
 
@@ -464,7 +555,7 @@ void Renderer::process_event(const Event &event)
 	}
 	else
 	{
-		std::vector<sg::Script *> p_scripts = p_scene_->get_components<sg::Script>();
+		sg::ComponentView<sg::Script> p_scripts = p_scene_->get_components<sg::Script>();
 		for (sg::Script *p_script : p_scripts)
 		{
 			p_script->process_event(event);
@@ -473,20 +564,256 @@ void Renderer::process_event(const Event &event)
 }
 
 // load a scene.
+// Cooked packs (.w3dpack) are memory mapped and their textures are streamed. Anything else goes through GLTFLoader.
 // We add a default arc ball camera.
 void Renderer::load_scene(const char *scene_name)
 {
-	GLTFLoader loader(*p_device_);
-	p_scene_ = loader.read_scene_from_file(scene_name);
+	if (fu::get_file_extension(scene_name) == "w3dpack")
+	{
+		p_texture_streamer_ = std::make_unique<TextureStreamer>(*p_device_, NUM_INFLIGHT_FRAMES);
+		PackLoader loader(*p_device_);
+		p_scene_ = loader.read_scene_from_file(scene_name, p_texture_streamer_.get());
+	}
+	else
+	{
+		GLTFLoader loader(*p_device_);
+		p_scene_ = loader.read_scene_from_file(scene_name);
+	}
+
+	p_animation_scheduler_ = std::make_unique<AnimationScheduler>(*p_scene_);
+	p_script_scheduler_    = std::make_unique<sg::ScriptScheduler>(*p_scene_);
+
+	vk::Extent2D window_extent = p_window_->get_extent();
+	p_camera_node_             = add_arc_ball_camera_script(*p_scene_, "main_camera", window_extent.width, window_extent.height);
+}
+
+// Start loading a scene in the background.
+// A load that is still in progress is cancelled.
+std::shared_ptr<const AsyncSceneLoad> Renderer::load_scene_async(const std::string &scene_name, int scene_index)
+{
+	if (p_scene_load_)
+	{
+		p_scene_load_->cancel();
+		p_cancelled_loads_.push_back(std::move(p_scene_load_));
+	}
+	p_scene_load_ = std::make_shared<AsyncSceneLoad>(*p_device_, scene_name, scene_index);
+	return p_scene_load_;
+}
+
+// Advance the pending scene load.
+// * This runs between two frames, so the scene graph is not being traversed.
+void Renderer::process_scene_load()
+{
+	release_retired_scenes();
+	release_retired_desc_sets();
+
+	// Cancelled loads are kept alive until their worker is done. Otherwise, we would block on it.
+	p_cancelled_loads_.erase(std::remove_if(p_cancelled_loads_.begin(), p_cancelled_loads_.end(), [](const std::shared_ptr<AsyncSceneLoad> &p_load) {
+		                         return p_load->is_worker_idle();
+	                         }),
+	                         p_cancelled_loads_.end());
+
+	if (!p_scene_load_)
+	{
+		return;
+	}
+
+	switch (p_scene_load_->get_status())
+	{
+		case SceneLoadStatus::eReadingFile:
+			break;
+		case SceneLoadStatus::eFileRead:
+		{
+			// Pack textures are streamed. The streamer goes live with the scene it was handed.
+			std::unique_ptr<TextureStreamer> p_texture_streamer;
+			if (p_scene_load_->is_pack())
+			{
+				p_texture_streamer = std::make_unique<TextureStreamer>(*p_device_, NUM_INFLIGHT_FRAMES);
+			}
+			std::unique_ptr<sg::Scene> p_scene = p_scene_load_->create_scene(p_texture_streamer.get());
+			if (p_scene)
+			{
+				swap_scene(std::move(p_scene), std::move(p_texture_streamer));
+				spawn_requested_crowds();
+			}
+			break;
+		}
+		case SceneLoadStatus::eStreaming:
+			refresh_materials_desc_resources(p_scene_load_->stream_textures());
+			break;
+		case SceneLoadStatus::eFailed:
+			LOGE("Failed to load scene {}: {}", p_scene_load_->get_file_name(), p_scene_load_->get_error());
+			p_scene_load_.reset();
+			spawn_requested_crowds();
+			return;
+		default:
+			break;
+	}
+
+	SceneLoadStatus status = p_scene_load_->get_status();
+	if (status == SceneLoadStatus::eReady || status == SceneLoadStatus::eCancelled)
+	{
+		p_scene_load_.reset();
+	}
+}
+
+// Make p_scene the live scene, along with the streamer of its textures if it has one.
+// The old scene is retired instead of destroyed because inflight frames still reference its buffers and descriptor sets.
+void Renderer::swap_scene(std::unique_ptr<sg::Scene> &&p_scene, std::unique_ptr<TextureStreamer> &&p_texture_streamer)
+{
+	for (sg::PBRMaterial *p_material : p_scene_->get_components<sg::PBRMaterial>())
+	{
+		retire_desc_set(p_material->set_);
+	}
+	retired_scenes_.push_back({
+	    .p_scene            = std::move(p_scene_),
+	    .p_texture_streamer = std::move(p_texture_streamer_),
+	    .frames_left        = NUM_INFLIGHT_FRAMES,
+	});
+	p_scene_            = std::move(p_scene);
+	p_texture_streamer_ = std::move(p_texture_streamer);
+
+	p_animation_scheduler_ = std::make_unique<AnimationScheduler>(*p_scene_);
+	p_script_scheduler_    = std::make_unique<sg::ScriptScheduler>(*p_scene_);
 
 	vk::Extent2D window_extent = p_window_->get_extent();
 	p_camera_node_             = add_arc_ball_camera_script(*p_scene_, "main_camera", window_extent.width, window_extent.height);
+	create_materials_desc_resources();
+}
+
+// Destroy the retired scenes that no inflight frame can reference anymore.
+// * The frame fences are waited before a frame slot is reused, so NUM_INFLIGHT_FRAMES frames is enough.
+void Renderer::release_retired_scenes()
+{
+	for (RetiredScene &retired_scene : retired_scenes_)
+	{
+		retired_scene.frames_left--;
+	}
+	retired_scenes_.erase(std::remove_if(retired_scenes_.begin(), retired_scenes_.end(), [](const RetiredScene &retired_scene) {
+		                      return retired_scene.frames_left == 0;
+	                      }),
+	                      retired_scenes_.end());
+}
+
+// Free the set once the inflight frames that may be using it are done.
+void Renderer::retire_desc_set(vk::DescriptorSet set)
+{
+	if (set)
+	{
+		retired_desc_sets_.push_back({
+		    .set         = set,
+		    .frames_left = NUM_INFLIGHT_FRAMES,
+		});
+	}
+}
+
+// Same frame counting as release_retired_scenes().
+void Renderer::release_retired_desc_sets()
+{
+	for (RetiredDescriptorSet &retired_set : retired_desc_sets_)
+	{
+		if (--retired_set.frames_left == 0)
+		{
+			p_descriptor_state_->allocator.free(retired_set.set);
+		}
+	}
+	retired_desc_sets_.erase(std::remove_if(retired_desc_sets_.begin(), retired_desc_sets_.end(), [](const RetiredDescriptorSet &retired_set) {
+		                         return retired_set.frames_left == 0;
+	                         }),
+	                         retired_desc_sets_.end());
+}
+
+// * Like process_scene_load(), call this between two frames. Baking poses the scene graph.
+void Renderer::spawn_crowd(const std::string &node_name, uint32_t instance_count)
+{
+	// The node most likely lives in the loading scene.
+	if (p_scene_load_)
+	{
+		crowd_requests_.push_back({
+		    .node_name      = node_name,
+		    .instance_count = instance_count,
+		});
+		return;
+	}
+	create_crowd(node_name, instance_count);
+}
+
+// Spawn the crowds that were waiting for the scene load.
+void Renderer::spawn_requested_crowds()
+{
+	std::vector<CrowdRequest> crowd_requests = std::move(crowd_requests_);
+	crowd_requests_.clear();
+	for (const CrowdRequest &crowd_request : crowd_requests)
+	{
+		create_crowd(crowd_request.node_name, crowd_request.instance_count);
+	}
+}
+
+// Bake the crowd and lay it out on a grid centered on the node.
+// The copies cycle through the baked clips. Each one starts at its own point of its clip and plays at its own speed.
+void Renderer::create_crowd(const std::string &node_name, uint32_t instance_count)
+{
+	sg::Node *p_node = p_scene_->find_node(node_name);
+	if (!p_node || !p_node->has_component<sg::Mesh>() || !p_node->has_component<sg::Skin>())
+	{
+		LOGW("Can't spawn a crowd of {}. It isn't a skinned mesh.", node_name);
+		return;
+	}
+	if (instance_count == 0)
+	{
+		return;
+	}
+
+	AnimationBaker             baker(*p_device_, *p_scene_);
+	std::unique_ptr<sg::Crowd> p_crowd = baker.bake(*p_node);
+
+	// Leave some room between the copies.
+	const sg::AABB &bounds  = p_node->get_component<sg::Mesh>().get_bounds();
+	glm::vec3       extent  = bounds.get_max() - bounds.get_min();
+	float           spacing = 1.5f * std::max(extent.x, extent.z);
+	uint32_t        columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instance_count))));
+	uint32_t        rows    = (instance_count + columns - 1) / columns;
+	glm::mat4       node_M  = p_node->get_transform().get_world_M();
+
+	std::vector<sg::CrowdInstance> instances(instance_count);
+	for (uint32_t i = 0; i < instance_count; i++)
+	{
+		uint32_t             clip_idx = i % to_u32(p_crowd->clips_.size());
+		const sg::BakedClip &clip     = p_crowd->clips_[clip_idx];
+		// Golden ratio sequences spread the offsets and speeds evenly without repeating along the grid.
+		float     offset_fraction = std::fmod(i * 0.618034f, 1.0f);
+		float     speed_fraction  = std::fmod(i * 0.754878f, 1.0f);
+		glm::vec3 position((i % columns - 0.5f * (columns - 1)) * spacing, 0.0f, (i / columns - 0.5f * (rows - 1)) * spacing);
+		instances[i] = {
+		    .model       = glm::translate(position) * node_M,
+		    .clip        = clip_idx,
+		    .time_offset = offset_fraction * clip.duration,
+		    .speed       = 0.8f + 0.4f * speed_fraction,
+		};
+	}
+	baker.upload_instances(*p_crowd, instances);
+
+	create_crowd_desc_resources(*p_crowd);
+	p_scene_->add_component(std::move(p_crowd));
+}
+
+// Let the texture streamer move mip levels in and out for the current view.
+// * Like process_scene_load(), this runs between two frames.
+void Renderer::stream_textures()
+{
+	if (!p_texture_streamer_)
+	{
+		return;
+	}
+
+	sg::Camera &camera = p_camera_node_->get_component<sg::Camera>();
+	refresh_materials_desc_resources(p_texture_streamer_->update(*p_scene_, camera, static_cast<float>(p_window_->get_extent().height)));
 }
 
 // Bake the IBL resources.
 void Renderer::create_pbr_resources()
 {
-	PBRBaker baker(*p_device_);
+	PBRBaker baker(*p_device_, IRRADIANCE_MODE);
 	baked_pbr_ = baker.bake();
 }
 
@@ -508,7 +835,8 @@ void Renderer::create_frame_resources()
 		frame_resources_.push_back({
 		    .cmd_buf                   = std::move(p_cmd_pool_->allocate_command_buffer()),
 		    .camera_buf                = std::move(p_device_->get_device_memory_allocator().allocate_uniform_buffer(sizeof(CameraUBO))),
-		    .joint_buf                 = std::move(p_device_->get_device_memory_allocator().allocate_uniform_buffer(sizeof(JointUBO))),
+		    .p_joint_buf               = std::make_unique<Buffer>(p_device_->get_device_memory_allocator().allocate_mapped_storage_buffer(INITIAL_JOINT_CAPACITY * sizeof(glm::mat4))),
+		    .joint_capacity            = INITIAL_JOINT_CAPACITY,
 		    .image_avaliable_semaphore = std::move(Semaphore(*p_device_)),
 		    .render_finished_semaphore = std::move(Semaphore(*p_device_)),
 		    .in_flight_fence           = std::move(Fence(*p_device_, vk::FenceCreateFlagBits::eSignaled)),
@@ -522,16 +850,41 @@ void Renderer::create_descriptor_resources()
 	create_pbr_desc_resources();
 	create_skybox_desc_resources();
 	create_materials_desc_resources();
+	create_crowd_desc_layout();
 }
 
 // Create pbr descriptor sets.
 void Renderer::create_pbr_desc_resources()
 {
-	vk::DescriptorImageInfo irradiance{
-	    .sampler     = baked_pbr_.p_irradiance->sampler.get_handle(),
-	    .imageView   = baked_pbr_.p_irradiance->resource.get_view().get_handle(),
-	    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-	};
+	for (FrameResource &frame : frame_resources_)
+	{
+		create_pbr_desc_set(frame);
+	}
+}
+
+// Create the pbr descriptor set of a frame.
+// * It binds the frame's joint buffer, so it is created again whenever that buffer grows.
+// * Binding 2 is the irradiance map, or the irradiance spherical harmonics with IrradianceMode::eSphericalHarmonics.
+void Renderer::create_pbr_desc_set(FrameResource &frame)
+{
+	vk::DescriptorImageInfo  irradiance;
+	vk::DescriptorBufferInfo irradiance_sh_bbinfo;
+	if (baked_pbr_.p_irradiance_sh)
+	{
+		irradiance_sh_bbinfo = {
+		    .buffer = baked_pbr_.p_irradiance_sh->get_handle(),
+		    .offset = 0,
+		    .range  = sizeof(IrradianceSH),
+		};
+	}
+	else
+	{
+		irradiance = {
+		    .sampler     = baked_pbr_.p_irradiance->sampler.get_handle(),
+		    .imageView   = baked_pbr_.p_irradiance->resource.get_view().get_handle(),
+		    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+		};
+	}
 
 	vk::DescriptorImageInfo prefilter{
 	    .sampler     = baked_pbr_.p_prefilter->sampler.get_handle(),
@@ -545,33 +898,38 @@ void Renderer::create_pbr_desc_resources()
 	    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
 	};
 
-	for (uint32_t i = 0; i < NUM_INFLIGHT_FRAMES; i++)
-	{
-		vk::DescriptorBufferInfo camera_bbinfo{
-		    .buffer = frame_resources_[i].camera_buf.get_handle(),
-		    .offset = 0,
-		    .range  = sizeof(CameraUBO),
-		};
-
-		vk::DescriptorBufferInfo joint_bbinfo{
-		    .buffer = frame_resources_[i].joint_buf.get_handle(),
-		    .offset = 0,
-		    .range  = sizeof(JointUBO),
-		};
+	vk::DescriptorBufferInfo camera_bbinfo{
+	    .buffer = frame.camera_buf.get_handle(),
+	    .offset = 0,
+	    .range  = sizeof(CameraUBO),
+	};
 
-		DescriptorAllocation allocation =
-		    DescriptorBuilder::begin(p_descriptor_state_->cache, p_descriptor_state_->allocator)
-		        .bind_buffer(0, camera_bbinfo, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment)
-		        .bind_buffer(1, joint_bbinfo, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eVertex)
-		        .bind_image(2, irradiance, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
-		        .bind_image(3, prefilter, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
-		        .bind_image(4, brdf_lut, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
-		        .build();
+	vk::DescriptorBufferInfo joint_bbinfo{
+	    .buffer = frame.p_joint_buf->get_handle(),
+	    .offset = 0,
+	    .range  = VK_WHOLE_SIZE,
+	};
 
-		frame_resources_[i].pbr_set = allocation.set;
-		// We are assigning the same set layout twice here. But, it doesn't matter.
-		pbr_.desc_layout_ring[DescriptorRingAccessor::eGlobal] = allocation.set_layout;
+	DescriptorBuilder builder =
+	    DescriptorBuilder::begin(p_descriptor_state_->cache, p_descriptor_state_->allocator)
+	        .bind_buffer(0, camera_bbinfo, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment)
+	        .bind_buffer(1, joint_bbinfo, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eVertex);
+	if (baked_pbr_.p_irradiance_sh)
+	{
+		builder.bind_buffer(2, irradiance_sh_bbinfo, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eFragment);
 	}
+	else
+	{
+		builder.bind_image(2, irradiance, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment);
+	}
+	DescriptorAllocation allocation =
+	    builder.bind_image(3, prefilter, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
+	        .bind_image(4, brdf_lut, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
+	        .build();
+
+	frame.pbr_set = allocation.set;
+	// Every frame gets the same set layout. But, it doesn't matter.
+	pbr_.desc_layout_ring[DescriptorRingAccessor::eGlobal] = allocation.set_layout;
 }
 
 // Create skybox descriptor resource.
@@ -599,50 +957,128 @@ void Renderer::create_skybox_desc_resources()
 // Allocate a descriptor set for every material.
 void Renderer::create_materials_desc_resources()
 {
-	// All texture names are converted into snake case when they are loaded by gltfloader.
-	// Therefore, it's safe to query by name.
-	static const std::vector<std::string> pbr_texture_names = {
-	    "base_color_texture",
-	    "normal_texture",
-	    "occlusion_texture",
-	    "emissive_texture",
-	    "metallic_roughness_texture",
-	};
 	sg::Texture *p_default_texture = p_scene_->find_component<sg::Texture>("default_texture");
 
-	std::vector<sg::PBRMaterial *> p_materials = p_scene_->get_components<sg::PBRMaterial>();
+	sg::ComponentView<sg::PBRMaterial> p_materials = p_scene_->get_components<sg::PBRMaterial>();
 	for (sg::PBRMaterial *p_material : p_materials)
 	{
-		DescriptorBuilder builder =
-		    DescriptorBuilder::begin(p_descriptor_state_->cache, p_descriptor_state_->allocator);
+		create_material_desc_resources(*p_material, *p_default_texture);
+	}
+}
+
+// Allocate a descriptor set for a material.
+void Renderer::create_material_desc_resources(sg::PBRMaterial &material, sg::Texture &default_texture)
+{
+	DescriptorBuilder builder =
+	    DescriptorBuilder::begin(p_descriptor_state_->cache, p_descriptor_state_->allocator);
+
+	std::vector<vk::DescriptorImageInfo> desc_iinfos;
+	desc_iinfos.reserve(PBR_TEXTURE_NAMES.size());
+
+	// Bind the default texture if we can't find one with specified name.
+	for (int i = 0; i < PBR_TEXTURE_NAMES.size(); i++)
+	{
+		const std::string &name      = PBR_TEXTURE_NAMES[i];
+		sg::Texture       *p_texture = &default_texture;
+		auto               it        = material.texture_map_.find(name);
+		if (it != material.texture_map_.end())
+		{
+			p_texture = it->second;
+		}
+		desc_iinfos.emplace_back(vk::DescriptorImageInfo{
+		    .sampler     = p_texture->p_sampler_->get_handle(),
+		    .imageView   = p_texture->p_resource_->get_view().get_handle(),
+		    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+		});
+		builder.bind_image(i, desc_iinfos.back(), vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment);
+	}
+
+	DescriptorAllocation desc_allocation = builder.build();
+
+	material.set_ = desc_allocation.set;
+	// We are assigning the same set layout twice here. But, it doesn't matter.
+	pbr_.desc_layout_ring[DescriptorRingAccessor::eMaterial] = desc_allocation.set_layout;
+}
+
+// Rebuild the descriptor sets of the materials that sample one of the given textures.
+// * Inflight frames may still be using the old sets, so we allocate new sets instead of updating them in place.
+// The old sets are retired and freed once those frames are done.
+void Renderer::refresh_materials_desc_resources(const std::vector<sg::Texture *> &p_textures)
+{
+	if (p_textures.empty())
+	{
+		return;
+	}
 
-		std::vector<vk::DescriptorImageInfo> desc_iinfos;
-		desc_iinfos.reserve(pbr_texture_names.size());
+	std::unordered_set<sg::Texture *> p_updated_textures(p_textures.begin(), p_textures.end());
+	sg::Texture                      *p_default_texture = p_scene_->find_component<sg::Texture>("default_texture");
 
-		// Bind the default texture if we can't find one with specified name.
-		for (int i = 0; i < pbr_texture_names.size(); i++)
+	sg::ComponentView<sg::PBRMaterial> p_materials = p_scene_->get_components<sg::PBRMaterial>();
+	for (sg::PBRMaterial *p_material : p_materials)
+	{
+		for (auto &[name, p_texture] : p_material->texture_map_)
 		{
-			const std::string &name      = pbr_texture_names[i];
-			sg::Texture       *p_texture = p_default_texture;
-			auto               it        = p_material->texture_map_.find(name);
-			if (it != p_material->texture_map_.end())
+			if (p_updated_textures.count(p_texture))
 			{
-				p_texture = it->second;
+				retire_desc_set(p_material->set_);
+				create_material_desc_resources(*p_material, *p_default_texture);
+				break;
 			}
-			desc_iinfos.emplace_back(vk::DescriptorImageInfo{
-			    .sampler     = p_texture->p_sampler_->get_handle(),
-			    .imageView   = p_texture->p_resource_->get_view().get_handle(),
-			    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-			});
-			builder.bind_image(i, desc_iinfos.back(), vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment);
 		}
+	}
+}
 
-		DescriptorAllocation desc_allocation = builder.build();
-
-		p_material->set_ = desc_allocation.set;
-		// We are assigning the same set layout twice here. But, it doesn't matter.
-		pbr_.desc_layout_ring[DescriptorRingAccessor::eMaterial] = desc_allocation.set_layout;
+// Create the descriptor set layout of crowds.
+// * Crowds are spawned after the pipelines are created, so the layout can't come from their DescriptorBuilder.
+// The layout cache returns this layout again when their sets are built.
+void Renderer::create_crowd_desc_layout()
+{
+	std::array<vk::DescriptorSetLayoutBinding, 3> bindings;
+	for (uint32_t i = 0; i < bindings.size(); i++)
+	{
+		bindings[i] = vk::DescriptorSetLayoutBinding{
+		    .binding         = i,
+		    .descriptorType  = vk::DescriptorType::eStorageBuffer,
+		    .descriptorCount = 1,
+		    .stageFlags      = vk::ShaderStageFlagBits::eVertex,
+		};
 	}
+	vk::DescriptorSetLayoutCreateInfo layout_cinfo{
+	    .bindingCount = to_u32(bindings.size()),
+	    .pBindings    = bindings.data(),
+	};
+	crowd_.desc_layout_ring[DescriptorRingAccessor::eCrowd] = p_descriptor_state_->cache.create_descriptor_layout(layout_cinfo);
+}
+
+// Allocate the descriptor set of a crowd. Frames, clips and instances are bound in that order.
+void Renderer::create_crowd_desc_resources(sg::Crowd &crowd)
+{
+	vk::DescriptorBufferInfo frame_bbinfo{
+	    .buffer = crowd.p_frame_buf_->get_handle(),
+	    .offset = 0,
+	    .range  = VK_WHOLE_SIZE,
+	};
+
+	vk::DescriptorBufferInfo clip_bbinfo{
+	    .buffer = crowd.p_clip_buf_->get_handle(),
+	    .offset = 0,
+	    .range  = VK_WHOLE_SIZE,
+	};
+
+	vk::DescriptorBufferInfo instance_bbinfo{
+	    .buffer = crowd.p_instance_buf_->get_handle(),
+	    .offset = 0,
+	    .range  = VK_WHOLE_SIZE,
+	};
+
+	DescriptorAllocation allocation =
+	    DescriptorBuilder::begin(p_descriptor_state_->cache, p_descriptor_state_->allocator)
+	        .bind_buffer(0, frame_bbinfo, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eVertex)
+	        .bind_buffer(1, clip_bbinfo, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eVertex)
+	        .bind_buffer(2, instance_bbinfo, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eVertex)
+	        .build();
+
+	crowd.set_ = allocation.set;
 }
 
 // Create a renderpass with a color attachment and a depth attachment.
@@ -708,7 +1144,7 @@ void Renderer::create_pipeline_resources()
 	// The pbr pipeline.
 	GraphicsPipelineState pl_state{
 	    .vert_shader_name   = "pbr.vert.spv",
-	    .frag_shader_name   = "pbr.frag.spv",
+	    .frag_shader_name   = baked_pbr_.p_irradiance_sh ? "pbr_sh.frag.spv" : "pbr.frag.spv",
 	    .vertex_input_state = {
 	        .attribute_descriptions = sg::Vertex::get_input_attr_descriptions(),
 	        .binding_descriptions   = binding_descriptions,
@@ -730,6 +1166,25 @@ void Renderer::create_pipeline_resources()
 
 	pbr_.p_pl = std::make_unique<GraphicsPipeline>(*p_device_, *p_render_pass_, pl_state, pbr_pl_layout_cinfo);
 
+	// The crowd pipeline.
+	// It shares the global and material sets of the pbr pipeline and shades with pbr.frag.
+	std::array<vk::PushConstantRange, 1> crowd_push_const_ranges;
+	crowd_push_const_ranges[0] = {
+	    .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+	    .offset     = 0,
+	    .size       = sizeof(CrowdPCO),
+	};
+	crowd_.desc_layout_ring[DescriptorRingAccessor::eGlobal]   = pbr_.desc_layout_ring[DescriptorRingAccessor::eGlobal];
+	crowd_.desc_layout_ring[DescriptorRingAccessor::eMaterial] = pbr_.desc_layout_ring[DescriptorRingAccessor::eMaterial];
+	vk::PipelineLayoutCreateInfo crowd_pl_layout_cinfo{
+	    .setLayoutCount         = 3,
+	    .pSetLayouts            = crowd_.desc_layout_ring.data(),
+	    .pushConstantRangeCount = to_u32(crowd_push_const_ranges.size()),
+	    .pPushConstantRanges    = crowd_push_const_ranges.data(),
+	};
+	pl_state.vert_shader_name = "crowd.vert.spv";
+	crowd_.p_pl               = std::make_unique<GraphicsPipeline>(*p_device_, *p_render_pass_, pl_state, crowd_pl_layout_cinfo);
+
 	// Skybox pipeline creation
 	vk::PushConstantRange skybox_push_const_range{
 	    .stageFlags = vk::ShaderStageFlagBits::eVertex,
@@ -8,7 +8,6 @@
 #include "core/sampler.hpp"
 #include "device_memory/buffer.hpp"
 #include "pbr_baker.hpp"
-#include "scene_graph/components/skin.hpp"
 #include "sync_objects.hpp"
 
 namespace W3D
@@ -16,9 +15,13 @@ namespace W3D
 
 namespace sg
 {
+class Node;
+class Scene;
 class PBRMaterial;
 class Texture;
 class Camera;
+class Crowd;
+class ScriptScheduler;
 }        // namespace sg
 
 class Window;
@@ -32,6 +35,9 @@ class PipelineResource;
 
 struct DescriptorState;
 struct Event;
+class AsyncSceneLoad;
+class TextureStreamer;
+class AnimationScheduler;
 
 // This class is the center of all operations.
 // It handles the creation of vulkan, scene, and PBR resources.
@@ -44,20 +50,54 @@ class Renderer
 	void start();
 	void process_event(const Event &event);
 
+	// Load a scene in the background and swap it in once its geometry is ready.
+	// Textures are streamed in over the following frames.
+	std::shared_ptr<const AsyncSceneLoad> load_scene_async(const std::string &scene_name, int scene_index = -1);
+
+	// Spawn a crowd of instance_count copies of a skinned node. Its animations are baked and played on the GPU.
+	// While a scene is loading, the crowd is spawned into that scene once it's swapped in.
+	void spawn_crowd(const std::string &node_name, uint32_t instance_count);
+
   private:
-	static const uint32_t NUM_INFLIGHT_FRAMES;        // We use two inflight frames to avoid idling GPU.
+	static const uint32_t       NUM_INFLIGHT_FRAMES;           // We use two inflight frames to avoid idling GPU.
+	static const uint32_t       INITIAL_JOINT_CAPACITY;        // Joint matrices the joint buffers hold before they grow.
+	static const uint32_t       NO_JOINT_OFFSET;               // Joint offset of draws that aren't skinned.
+	static const IrradianceMode IRRADIANCE_MODE;               // How the diffuse IBL is baked and shaded.
 
 	// POD struct containing all resource that needs to be seperated by frame.
 	struct FrameResource
 	{
-		CommandBuffer     cmd_buf;
-		Buffer            camera_buf;
-		Buffer            joint_buf;
-		Semaphore         image_avaliable_semaphore;
-		Semaphore         render_finished_semaphore;
-		Fence             in_flight_fence;
-		vk::DescriptorSet pbr_set;
-		vk::DescriptorSet skybox_set;
+		CommandBuffer           cmd_buf;
+		Buffer                  camera_buf;
+		std::unique_ptr<Buffer> p_joint_buf;           // The joint matrices of every skin, one skin after the other.
+		uint32_t                joint_capacity;        // In matrices.
+		Semaphore               image_avaliable_semaphore;
+		Semaphore               render_finished_semaphore;
+		Fence                   in_flight_fence;
+		vk::DescriptorSet       pbr_set;
+		vk::DescriptorSet       skybox_set;
+	};
+
+	// A scene that was swapped out. It's destroyed once no inflight frame can reference it.
+	struct RetiredScene
+	{
+		std::unique_ptr<sg::Scene>       p_scene;
+		std::unique_ptr<TextureStreamer> p_texture_streamer;
+		uint32_t                         frames_left;
+	};
+
+	// A descriptor set that was replaced. It's freed once no inflight frame can reference it.
+	struct RetiredDescriptorSet
+	{
+		vk::DescriptorSet set;
+		uint32_t          frames_left;
+	};
+
+	// A crowd waiting for the loading scene.
+	struct CrowdRequest
+	{
+		std::string node_name;
+		uint32_t    instance_count;
 	};
 
 	// POD struct to contain the graphics pipeline and descriptor layouts.
@@ -71,13 +111,7 @@ class Renderer
 	{
 		eGlobal   = 0,
 		eMaterial = 1,
-	};
-
-	// Uniform Object for animation;
-	struct JointUBO
-	{
-		glm::mat4 joint_Ms[sg::Skin::MAX_NUM_JOINTS];
-		float     is_skinned;        // boolean value that tells the shader whether the current submesh is skinned. We use a float b/c alignment.
+		eCrowd    = 2,
 	};
 
 	// Uniform Object for camera matrices.
@@ -101,6 +135,16 @@ class Renderer
 		glm::vec4 base_color;
 		glm::vec4 metallic_roughness;
 		uint32_t  material_flag;
+		uint32_t  joint_offset;        // Index of the first joint matrix of the node's skin in the joint buffer. NO_JOINT_OFFSET if there is no skin.
+	};
+
+	// Push constant object for crowd pipeline.
+	// The pbr constants come first so that pbr.frag finds them at the same offsets.
+	struct CrowdPCO
+	{
+		PBRPCO   pbr;
+		float    time;
+		uint32_t joint_count;
 	};
 
 	// High level operations.
@@ -116,20 +160,28 @@ class Renderer
 
 	// Low level operations called druing render_frame()
 	void update_camera_ubo();
+	void update_joint_buf();
 	void set_dynamic_states(CommandBuffer &cmd_buf);
 	void begin_render_pass(CommandBuffer &cmd_buf, vk::Framebuffer framebuffer);
 	void draw_scene(CommandBuffer &cmd_buf);
 	void draw_skybox(CommandBuffer &cmd_buf);
+	void draw_crowds(CommandBuffer &cmd_buf);
 	void draw_node(CommandBuffer &cmd_buf, sg::Node &node);
-	void draw_submesh(CommandBuffer &cmd_buf, sg::SubMesh &submesh);
-	void bind_material(CommandBuffer &cmd_buf, const sg::PBRMaterial &material, PBRPCO &pco);
-	void bind_skin(CommandBuffer &cmd_buf, const sg::Skin &skin);
-	void disable_skin(CommandBuffer &cmd_buf);
+	void draw_submesh(CommandBuffer &cmd_buf, sg::SubMesh &submesh, uint32_t instance_count = 1);
+	void bind_material(CommandBuffer &cmd_buf, const sg::PBRMaterial &material, PBRPCO &pco, vk::PipelineLayout pl_layout);
 
 	// Misc. Functions.
 	void           resize();
 	FrameResource &get_current_frame_resource();
 
+	// Scene streaming. Called at frame boundaries.
+	void process_scene_load();
+	void swap_scene(std::unique_ptr<sg::Scene> &&p_scene, std::unique_ptr<TextureStreamer> &&p_texture_streamer = nullptr);
+	void release_retired_scenes();
+	void retire_desc_set(vk::DescriptorSet set);
+	void release_retired_desc_sets();
+	void stream_textures();
+
 	// Resource creation functions.
 	void load_scene(const char *scene_name);
 	void create_pbr_resources();
@@ -138,7 +190,14 @@ class Renderer
 	void create_descriptor_resources();
 	void create_skybox_desc_resources();
 	void create_pbr_desc_resources();
+	void create_pbr_desc_set(FrameResource &frame);
 	void create_materials_desc_resources();
+	void create_material_desc_resources(sg::PBRMaterial &material, sg::Texture &default_texture);
+	void refresh_materials_desc_resources(const std::vector<sg::Texture *> &p_textures);
+	void create_crowd_desc_layout();
+	void create_crowd_desc_resources(sg::Crowd &crowd);
+	void create_crowd(const std::string &node_name, uint32_t instance_count);
+	void spawn_requested_crowds();
 	void create_render_pass();
 	void create_pipeline_resources();
 
@@ -153,15 +212,27 @@ class Renderer
 	std::unique_ptr<DescriptorState>      p_descriptor_state_;
 	std::unique_ptr<CommandPool>          p_cmd_pool_;
 	std::unique_ptr<sg::Scene>            p_scene_;
+	std::unique_ptr<AnimationScheduler>   p_animation_scheduler_;
+	std::unique_ptr<sg::ScriptScheduler>  p_script_scheduler_;
 	sg::Node                             *p_camera_node_ = nullptr;
 
+	// Scene Streaming State.
+	std::shared_ptr<AsyncSceneLoad>              p_scene_load_;
+	std::vector<std::shared_ptr<AsyncSceneLoad>> p_cancelled_loads_;
+	std::vector<RetiredScene>                    retired_scenes_;
+	std::vector<RetiredDescriptorSet>            retired_desc_sets_;
+	std::vector<CrowdRequest>                    crowd_requests_;
+	std::unique_ptr<TextureStreamer>             p_texture_streamer_;
+
 	// Renderer State
 	Timer                      timer_;
 	uint32_t                   frame_idx_ = 0;
 	std::vector<FrameResource> frame_resources_;
 	PipelineResource           skybox_;
 	PipelineResource           pbr_;
+	PipelineResource           crowd_;
 	PBR                        baked_pbr_;
+	float                      crowd_time_        = 0.0f;        // Seconds crowds have played for. Instances offset and scale it.
 	bool                       is_window_resized_ = false;
 };
 }        // namespace W3D
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "resource_cache.hpp"
+
+#include <cstring>
+
+#include "common/logging.hpp"
+#include "device.hpp"
+#include "sampler.hpp"
+
+#include "scene_graph/components/pbr_material.hpp"
+
+namespace W3D
+{
+
+const uint64_t FNV_64_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_64_PRIME  = 1099511628211ull;
+
+// FNV-1a that consumes 8 bytes per step. The upper half is folded back after every step so that high bits reach the low ones.
+uint64_t hash_bytes(const uint8_t *p_data, size_t size, uint64_t hash)
+{
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, p_data + i, sizeof(uint64_t));
+		hash = (hash ^ word) * FNV_64_PRIME;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; i++)
+	{
+		hash = (hash ^ p_data[i]) * FNV_64_PRIME;
+	}
+	return hash;
+}
+
+void hash_combine(size_t &seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+// The meta info is part of the key. The same bytes in another format are another image.
+uint64_t ResourceCache::hash_image(const uint8_t *p_data, size_t size, const ImageMetaInfo &meta)
+{
+	uint32_t meta_words[5] = {meta.extent.width, meta.extent.height, meta.extent.depth, static_cast<uint32_t>(meta.format), meta.levels};
+	uint64_t hash          = hash_bytes(reinterpret_cast<const uint8_t *>(meta_words), sizeof(meta_words), FNV_64_OFFSET);
+	return hash_bytes(p_data, size, hash);
+}
+
+// Textures are compared by identity. Two materials that point to different textures of the same image are not merged.
+size_t ResourceCache::hash_material(const sg::PBRMaterial &material)
+{
+	size_t seed = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		hash_combine(seed, std::hash<float>()(material.base_color_factor_[i]));
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		hash_combine(seed, std::hash<float>()(material.emissive_[i]));
+	}
+	hash_combine(seed, std::hash<float>()(material.metallic_factor_));
+	hash_combine(seed, std::hash<float>()(material.roughness_factor_));
+	hash_combine(seed, std::hash<float>()(material.alpha_cutoff_));
+	hash_combine(seed, static_cast<size_t>(material.alpha_mode_));
+	hash_combine(seed, static_cast<size_t>(material.is_double_sided));
+	// The texture map is unordered. Combine its entries in an order independent way.
+	size_t textures_seed = 0;
+	for (const auto &[name, p_texture] : material.texture_map_)
+	{
+		size_t entry_seed = std::hash<std::string>()(name);
+		hash_combine(entry_seed, std::hash<const sg::Texture *>()(p_texture));
+		textures_seed ^= entry_seed;
+	}
+	hash_combine(seed, textures_seed);
+	return seed;
+}
+
+bool ResourceCache::is_same_material(const sg::PBRMaterial &lhs, const sg::PBRMaterial &rhs)
+{
+	return lhs.base_color_factor_ == rhs.base_color_factor_ &&
+	       lhs.emissive_ == rhs.emissive_ &&
+	       lhs.metallic_factor_ == rhs.metallic_factor_ &&
+	       lhs.roughness_factor_ == rhs.roughness_factor_ &&
+	       lhs.alpha_cutoff_ == rhs.alpha_cutoff_ &&
+	       lhs.alpha_mode_ == rhs.alpha_mode_ &&
+	       lhs.is_double_sided == rhs.is_double_sided &&
+	       lhs.texture_map_ == rhs.texture_map_;
+}
+
+ResourceCache::ResourceCache(const Device &device) :
+    device_(device)
+{
+}
+
+ResourceCache::~ResourceCache()
+{
+}
+
+std::shared_ptr<ImageResource> ResourceCache::find_image(uint64_t hash)
+{
+	auto it = images_.find(hash);
+	if (it == images_.end())
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<ImageResource> p_resource = it->second.p_resource.lock();
+	if (p_resource)
+	{
+		record_image_reuse(it->second.meta);
+	}
+	return p_resource;
+}
+
+void ResourceCache::add_image(uint64_t hash, std::shared_ptr<ImageResource> p_resource, const ImageMetaInfo &meta)
+{
+	images_[hash] = {
+	    .p_resource = p_resource,
+	    .meta       = meta,
+	};
+}
+
+// Return the sampler created with the same create info, or create one.
+std::shared_ptr<Sampler> ResourceCache::request_sampler(const vk::SamplerCreateInfo &sampler_cinfo)
+{
+	std::weak_ptr<Sampler>  &p_entry   = samplers_[sampler_cinfo];
+	std::shared_ptr<Sampler> p_sampler = p_entry.lock();
+	if (p_sampler)
+	{
+		stats_.reused_samplers++;
+		return p_sampler;
+	}
+
+	vk::SamplerCreateInfo cinfo = sampler_cinfo;
+	p_sampler                   = std::make_shared<Sampler>(device_, cinfo);
+	p_entry                     = p_sampler;
+	return p_sampler;
+}
+
+void ResourceCache::record_image_reuse(const ImageMetaInfo &meta)
+{
+	stats_.reused_images++;
+	for (uint32_t level = 0; level < meta.levels; level++)
+	{
+		stats_.reused_image_size += ImageResource::get_level_size(meta.format, meta.extent, level);
+	}
+}
+
+void ResourceCache::record_material_reuse()
+{
+	stats_.reused_materials++;
+}
+
+// Drop the entries whose resource no scene uses anymore.
+void ResourceCache::release_expired()
+{
+	for (auto it = images_.begin(); it != images_.end();)
+	{
+		it = it->second.p_resource.expired() ? images_.erase(it) : std::next(it);
+	}
+	for (auto it = samplers_.begin(); it != samplers_.end();)
+	{
+		it = it->second.expired() ? samplers_.erase(it) : std::next(it);
+	}
+}
+
+const ResourceCacheStats &ResourceCache::get_stats() const
+{
+	return stats_;
+}
+
+void ResourceCache::log_stats() const
+{
+	LOGI("Resource cache: {} images ({:.2f} MB), {} samplers and {} materials reused so far.",
+	     stats_.reused_images,
+	     stats_.reused_image_size / (1024.0 * 1024.0),
+	     stats_.reused_samplers,
+	     stats_.reused_materials);
+}
+
+}        // namespace W3D
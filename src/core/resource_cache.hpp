@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include "common/vk_common.hpp"
+#include "vulkan/vulkan_hash.hpp"
+
+#include "image_resource.hpp"
+
+namespace W3D
+{
+class Device;
+class Sampler;
+
+namespace sg
+{
+class PBRMaterial;
+}        // namespace sg
+
+struct ResourceCacheStats
+{
+	size_t reused_images;
+	size_t reused_image_size;        // Device bytes the reused images would have taken.
+	size_t reused_samplers;
+	size_t reused_materials;
+};
+
+// Device level cache of the GPU resources scenes can share.
+// Images are keyed by a hash of their content, samplers by their create info.
+// The cache only holds weak references. An entry lives as long as some scene holds it and is dropped by release_expired().
+// Materials own a descriptor set and point to scene textures, so they can only be shared within a scene.
+// The cache provides their parameter hash and keeps count of them.
+// * Only use the cache from the main thread.
+class ResourceCache
+{
+  public:
+	static uint64_t hash_image(const uint8_t *p_data, size_t size, const ImageMetaInfo &meta);
+	static size_t   hash_material(const sg::PBRMaterial &material);
+	static bool     is_same_material(const sg::PBRMaterial &lhs, const sg::PBRMaterial &rhs);
+
+	ResourceCache(const Device &device);
+	ResourceCache(const ResourceCache &)            = delete;
+	ResourceCache &operator=(const ResourceCache &) = delete;
+	~ResourceCache();
+
+	// Return nullptr on a miss. A hit counts as a reuse.
+	std::shared_ptr<ImageResource> find_image(uint64_t hash);
+	// The image must be uploaded, or have its upload recorded, before anyone else can find it.
+	void                           add_image(uint64_t hash, std::shared_ptr<ImageResource> p_resource, const ImageMetaInfo &meta);
+	std::shared_ptr<Sampler>       request_sampler(const vk::SamplerCreateInfo &sampler_cinfo);
+
+	void                      record_image_reuse(const ImageMetaInfo &meta);
+	void                      record_material_reuse();
+	void                      release_expired();
+	const ResourceCacheStats &get_stats() const;
+	void                      log_stats() const;
+
+  private:
+	struct ImageEntry
+	{
+		std::weak_ptr<ImageResource> p_resource;
+		ImageMetaInfo                meta;
+	};
+
+	const Device                                                      &device_;
+	std::unordered_map<uint64_t, ImageEntry>                          images_;
+	std::unordered_map<vk::SamplerCreateInfo, std::weak_ptr<Sampler>> samplers_;
+	ResourceCacheStats                                                stats_{};
+};
+
+}        // namespace W3D
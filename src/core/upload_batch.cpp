@@ -0,0 +1,66 @@
+#include "upload_batch.hpp"
+
+#include "core/device.hpp"
+#include "core/device_memory/allocator.hpp"
+
+namespace W3D
+{
+const size_t UploadBatch::DEFAULT_BYTE_BUDGET = 64 * 1024 * 1024;
+
+UploadBatch::UploadBatch(const Device &device, size_t byte_budget) :
+    device_(device),
+    byte_budget_(byte_budget)
+{
+}
+
+// ! Call flush() before the batch goes out of scope. This is only a safety net.
+UploadBatch::~UploadBatch()
+{
+	flush();
+}
+
+// Copy p_data into a new staging buffer. The caller records the copy out of it with get_cmd_buf().
+// * The returned reference is only valid until the next call to stage().
+Buffer &UploadBatch::stage(const uint8_t *p_data, size_t size)
+{
+	Buffer &staging_buf = stage(size);
+	staging_buf.update(p_data, size);
+	return staging_buf;
+}
+
+// Allocate a staging buffer and let the caller write into Buffer::get_mapped_data().
+// This saves a CPU copy when the data is produced by a conversion anyway.
+Buffer &UploadBatch::stage(size_t size)
+{
+	if (batch_size_ >= byte_budget_)
+	{
+		flush();
+	}
+	batch_size_ += size;
+	staging_bufs_.emplace_back(device_.get_device_memory_allocator().allocate_staging_buffer(size));
+	return staging_bufs_.back();
+}
+
+// Get the command buffer of the current batch. Start a new batch if there is none.
+CommandBuffer &UploadBatch::get_cmd_buf()
+{
+	if (!cmd_buf_)
+	{
+		cmd_buf_.emplace(device_.begin_one_time_buf());
+	}
+	return *cmd_buf_;
+}
+
+// Submit the current batch and wait for it to finish.
+void UploadBatch::flush()
+{
+	if (cmd_buf_)
+	{
+		device_.end_one_time_buf(*cmd_buf_);
+		cmd_buf_.reset();
+	}
+	staging_bufs_.clear();
+	batch_size_ = 0;
+}
+
+}        // namespace W3D
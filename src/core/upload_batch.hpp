@@ -0,0 +1,38 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "core/command_buffer.hpp"
+#include "core/device_memory/buffer.hpp"
+
+namespace W3D
+{
+class Device;
+
+// Helper class that batches host to device uploads into one-time command buffers.
+// Staging buffers are kept alive until their batch is submitted. A batch is submitted once it holds more than byte_budget bytes.
+class UploadBatch
+{
+  public:
+	static const size_t DEFAULT_BYTE_BUDGET;
+
+	UploadBatch(const Device &device, size_t byte_budget = DEFAULT_BYTE_BUDGET);
+	UploadBatch(const UploadBatch &)            = delete;
+	UploadBatch &operator=(const UploadBatch &) = delete;
+	~UploadBatch();
+
+	Buffer        &stage(const uint8_t *p_data, size_t size);
+	Buffer        &stage(size_t size);
+	CommandBuffer &get_cmd_buf();
+	void           flush();
+
+  private:
+	const Device                &device_;
+	size_t                       byte_budget_;
+	size_t                       batch_size_ = 0;
+	std::optional<CommandBuffer> cmd_buf_;
+	std::vector<Buffer>          staging_bufs_;
+};
+
+}        // namespace W3D
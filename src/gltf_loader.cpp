@@ -1,5 +1,6 @@
 #include "gltf_loader.hpp"
 
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <queue>
 
@@ -9,6 +10,9 @@
 
 #include "common/error.hpp"
 #include "common/file_utils.hpp"
+#include "common/job_system.hpp"
+#include "common/memory_usage.hpp"
+#include "common/mipmap.hpp"
 #include "common/utils.hpp"
 #include "core/command_buffer.hpp"
 #include "core/device.hpp"
@@ -16,6 +20,9 @@
 #include "core/image_view.hpp"
 #include "core/instance.hpp"
 #include "core/physical_device.hpp"
+#include "core/resource_cache.hpp"
+#include "core/upload_batch.hpp"
+#include "gltf_utils.hpp"
 
 #include "scene_graph/components/aabb.hpp"
 #include "scene_graph/components/camera.hpp"
@@ -31,37 +38,15 @@
 #include "scene_graph/node.hpp"
 #include "scene_graph/scene.hpp"
 #include "scene_graph/scripts/animation.hpp"
+#include "scene_graph/scripts/animator.hpp"
 
 namespace W3D
 {
 
 // Forward declarations for type conversions helper functions.
 // They convert tinygltf constants to our types.
-vk::Filter              to_vk_min_filter(int min_filter);
-vk::Filter              to_vk_mag_filter(int mag_filter);
-vk::SamplerMipmapMode   to_vk_mipmap_mode(int mipmap_mode);
-vk::SamplerAddressMode  to_vk_wrap_mode(int wrap_mode);
 sg::PBRMaterialFlagBits to_sg_material_flag_bit(const std::string &texture_name);
-void                    to_sg_channel_output(sg::AnimationChannel &channel);
-sg::AnimationType       to_sg_animation_type(const std::string &interpolation);
-sg::AnimationTarget     to_sg_animation_target(const std::string &target);
-void                    to_W3D_vector_in_place(glm::vec3 &vec);
-void                    to_W3D_quaternion_in_place(glm::quat &quat);
-void                    to_W3D_matrix_in_place(glm::mat4 &M);
 void                    to_W3D_output_data_in_place(sg::AnimationSampler &sampler, sg::AnimationTarget target);
-vk::Format              get_attr_format(const tinygltf::Model &model, uint32_t accessor_id);
-std::vector<uint8_t>    get_attr_data(const tinygltf::Model &model, uint32_t accessor_id);
-std::vector<uint8_t>    convert_data_stride(const std::vector<uint8_t> &src, uint32_t src_stride, uint32_t dst_stride);
-
-// Default vertex attributes.
-const glm::vec3 DEFAULT_NORMAL = glm::vec3(0.0f);
-const glm::vec2 DEFAULT_UV     = glm::vec2(0.0f);
-const glm::vec4 DEFAULT_JOINT  = glm::vec4(0.0f);
-const glm::vec4 DEFAULT_WEIGHT = glm::vec4(0.0f);
-const glm::vec4 DEFAULT_COLOR  = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
-
-// This conversion scale is needed because gltf is right-handed but W3D is left handed.
-const glm::vec3 GLTFLoader::W3D_CONVERSION_SCALE = glm::vec3(-1, 1, 1);
 
 template <class T, class Y>
 struct TypeCast
@@ -82,15 +67,79 @@ GLTFLoader::GLTFLoader(Device const &device) :
 std::unique_ptr<sg::SubMesh> GLTFLoader::read_model_from_file(const std::string &file_name, int mesh_idx)
 {
 	load_gltf_model(file_name);
-	return parse_submesh(nullptr, gltf_model_.meshes[mesh_idx].primitives[0]);
+	UploadBatch                  batch(device_);
+	std::unique_ptr<sg::SubMesh> p_submesh = parse_submesh(nullptr, gltf_model_.meshes[mesh_idx].primitives[0], batch);
+	batch.flush();
+	return p_submesh;
 }
 
 // Read the entire scene.
 std::unique_ptr<sg::Scene> GLTFLoader::read_scene_from_file(const std::string &file_name,
                                                             int                scene_index)
+{
+	read_file(file_name);
+	return parse_scene(scene_index);
+}
+
+// Read the gltf file and decode its images.
+// * Nothing here touches the device, so this can run on a worker thread.
+void GLTFLoader::read_file(const std::string &file_name)
 {
 	load_gltf_model(file_name);
-	return std::make_unique<sg::Scene>(parse_scene(scene_index));
+	log_memory_usage("glTF read");
+	load_image_transfer_infos();
+	log_memory_usage("glTF images decoded");
+}
+
+// Build the scene from a file that is already read.
+// The geometry is uploaded right away. Images are left empty and textures point to the default texture until upload_deferred_images() uploads them.
+std::unique_ptr<sg::Scene> GLTFLoader::create_streaming_scene(int scene_index)
+{
+	defer_images_ = true;
+	return parse_scene(scene_index);
+}
+
+// Upload the next deferred images until byte_budget is reached. At least one image is uploaded per call.
+// Return the textures that now point to their real image.
+std::vector<sg::Texture *> GLTFLoader::upload_deferred_images(size_t byte_budget)
+{
+	std::vector<sg::Texture *> p_updated_textures;
+	if (!has_deferred_images())
+	{
+		return p_updated_textures;
+	}
+
+	std::vector<Buffer> staging_bufs;
+	CommandBuffer       cmd_buf = device_.begin_one_time_buf();
+	size_t              first   = next_deferred_img_;
+	next_deferred_img_          = record_image_uploads(cmd_buf, staging_bufs, p_deferred_images_, first, p_deferred_images_.size(), byte_budget);
+	device_.end_one_time_buf(cmd_buf);
+
+	for (size_t i = first; i < next_deferred_img_; i++)
+	{
+		for (sg::Texture *p_texture : img_textures_[i])
+		{
+			p_texture->p_resource_ = &p_deferred_images_[i]->get_resource();
+			p_updated_textures.push_back(p_texture);
+		}
+	}
+
+	return p_updated_textures;
+}
+
+bool GLTFLoader::has_deferred_images() const
+{
+	return next_deferred_img_ < p_deferred_images_.size();
+}
+
+size_t GLTFLoader::get_deferred_image_count() const
+{
+	return p_deferred_images_.size();
+}
+
+size_t GLTFLoader::get_uploaded_image_count() const
+{
+	return next_deferred_img_;
 }
 
 // Read the gltf file using tinygltf.
@@ -106,20 +155,29 @@ void GLTFLoader::load_gltf_model(const std::string &file_name)
 	std::string file_extension = fu::get_file_extension(gltf_file_path);
 	bool        load_result;
 
-	if (file_extension == "bin")
+	size_t pos  = gltf_file_path.find_last_of('/');
+	model_path_ = gltf_file_path.substr(0, pos);
+	if (pos == std::string::npos)
+	{
+		model_path_.clear();
+	}
+
+	if (file_extension == "glb")
 	{
+		// Map the file and let the accessors read the binary chunk in place.
+		glb_file_ = fu::MappedFile(gltf_file_path);
 		load_result =
-		    gltf_loader.LoadBinaryFromFile(&gltf_model_, &err, &warn, gltf_file_path.c_str());
+		    load_glb_in_place(gltf_model_, &err, &warn, glb_file_.get_data(), glb_file_.get_size(), model_path_, &p_glb_bin_);
 	}
 	else if (file_extension == "gltf")
 	{
+		gltf_loader.SetImageLoader(&load_image_data, nullptr);
 		load_result =
 		    gltf_loader.LoadASCIIFromFile(&gltf_model_, &err, &warn, gltf_file_path.c_str());
 	}
 	else
 	{
-		LOGE("Unsupported file type .{} for gltf models!", file_extension);
-		abort();
+		throw std::runtime_error("Unsupported file type ." + file_extension + " for gltf models!");
 	}
 
 	if (!err.empty())
@@ -136,36 +194,45 @@ void GLTFLoader::load_gltf_model(const std::string &file_name)
 	{
 		throw std::runtime_error("Unable to load gltf file.");
 	}
-
-	size_t pos  = gltf_file_path.find_last_of('/');
-	model_path_ = gltf_file_path.substr(0, pos);
-	if (pos == std::string::npos)
-	{
-		model_path_.clear();
-	}
 }
 
 // Parse the scene.
-sg::Scene GLTFLoader::parse_scene(int scene_idx)
+std::unique_ptr<sg::Scene> GLTFLoader::parse_scene(int scene_idx)
 {
-	sg::Scene scene = sg::Scene("gltf_scene");
-	p_scene_        = &scene;
+	std::unique_ptr<sg::Scene> p_scene = std::make_unique<sg::Scene>("gltf_scene");
+	p_scene_                           = p_scene.get();
 
 	// We load components in a bottom-up version such that when a component A is loaded, all components A points to are already loaded.
 	// All components are loaded linearly.
+	device_.get_resource_cache().release_expired();
 	load_samplers();
 	load_images();
 	load_textures();
 	load_materials();
-	batch_upload_images();
+	if (!defer_images_)
+	{
+		batch_upload_images();
+		log_memory_usage("glTF images uploaded");
+	}
 	load_meshs();
+	log_memory_usage("glTF meshes uploaded");
 	load_skins();
 	load_cameras();
 	load_nodes(scene_idx);
 	load_default_camera();
 	load_animations();
+	p_scene_->init_transform_hierarchy();
 	init_scene_bound();
-	return scene;
+
+	// Everything that reads the buffers is done. Unmap the glb and drop the model.
+	// * Deferred images only need img_tinfos_ from here on.
+	p_glb_bin_  = nullptr;
+	glb_file_   = fu::MappedFile();
+	gltf_model_ = tinygltf::Model();
+	log_memory_usage("glTF model released");
+
+	device_.get_resource_cache().log_stats();
+	return p_scene;
 }
 
 // We calculate the scene's AABB by taking the union of all node's AABB.
@@ -240,29 +307,74 @@ std::unique_ptr<sg::Sampler> GLTFLoader::create_default_sampler() const
 	return parse_sampler(gltf_sampler);
 }
 
-// Load all images.
-// * Actual image bytes are not uploaded to GPU yet. We defer that untill all images (including the default texture images) are parsed.
-void GLTFLoader::load_images()
+// Decode all images into transfer infos.
+// Color images are tagged as sRGB here so that their mips are filtered correctly.
+// Their content hashes are computed here as well, so that an async load hashes on the worker thread.
+// Images are independent of each other and are decoded in parallel on the job system.
+void GLTFLoader::load_image_transfer_infos()
 {
-	std::vector<std::unique_ptr<sg::Image>> p_images;
-	p_images.reserve(gltf_model_.images.size());
-	img_tinfos_.reserve(gltf_model_.images.size());
+	std::vector<bool>    is_srgb_image = find_srgb_images(gltf_model_);
+	std::vector<uint8_t> blit_mips(gltf_model_.images.size());        // Not a vector<bool>, jobs write neighbouring elements.
+	img_tinfos_.resize(gltf_model_.images.size());
+	img_hashes_.resize(gltf_model_.images.size());
 
-	for (size_t i = 0; i < gltf_model_.images.size(); i++)
+	JobSystem::get().parallel_for(0, gltf_model_.images.size(), 1, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+		{
+			ImageTransferInfo &img_tinfo = img_tinfos_[i];
+			img_tinfo                    = parse_image_transfer_info(gltf_model_.images[i]);
+			if (is_srgb_image[i] && img_tinfo.meta.format == vk::Format::eR8G8B8A8Unorm)
+			{
+				img_tinfo.meta.format = vk::Format::eR8G8B8A8Srgb;
+			}
+			blit_mips[i]   = prepare_mipmaps(img_tinfo);
+			img_hashes_[i] = ResourceCache::hash_image(img_tinfo.binary.data(), img_tinfo.binary.size(), img_tinfo.meta);
+		}
+	});
+	img_blit_mips_.assign(blit_mips.begin(), blit_mips.end());
+}
+
+// Give an image a full mip chain.
+// Return true if the chain is generated on the GPU with blits after level 0 is uploaded.
+// Otherwise, RGBA8 images get their chain generated on the CPU and other formats keep the levels they have.
+bool GLTFLoader::prepare_mipmaps(ImageTransferInfo &img_tinfo) const
+{
+	ImageMetaInfo &meta = img_tinfo.meta;
+	if (meta.levels > 1)
 	{
-		p_images.emplace_back(parse_image(gltf_model_.images[i]));
+		return false;
 	}
 
-	p_scene_->set_components(std::move(p_images));
+	if (device_.get_physical_device().is_linear_blit_supported(meta.format))
+	{
+		meta.levels = max_mip_levels(meta.extent.width, meta.extent.height);
+		return meta.levels > 1;
+	}
+
+	if (meta.format == vk::Format::eR8G8B8A8Srgb || meta.format == vk::Format::eR8G8B8A8Unorm)
+	{
+		meta.levels = generate_mip_chain_rgba8(img_tinfo.binary, meta.extent.width, meta.extent.height, meta.format == vk::Format::eR8G8B8A8Srgb);
+	}
+	return false;
 }
 
-// Parse an image and prepare the transfer infos.
-// * The resultant image are EMPTY.
-std::unique_ptr<sg::Image> GLTFLoader::parse_image(const tinygltf::Image &gltf_image)
+// Prepare the transfer info of an image.
+ImageTransferInfo GLTFLoader::parse_image_transfer_info(tinygltf::Image &gltf_image) const
 {
+	if (gltf_image.mimeType == "image/ktx2")
+	{
+		ImageTransferInfo img_tinfo = ktx2_load_from_memory(gltf_image.image.data(), gltf_image.image.size());
+		if (!device_.get_physical_device().is_sampled_image_supported(img_tinfo.meta.format))
+		{
+			throw std::runtime_error("Image " + gltf_image.uri + " uses a format the device can't sample.");
+		}
+		gltf_image.image = std::vector<unsigned char>();
+		return img_tinfo;
+	}
+
 	if (!gltf_image.image.empty())
 	{
-		img_tinfos_.push_back({
+		return {
 		    .binary = std::move(gltf_image.image),
 		    .meta   = {
 		          .extent = {
@@ -273,23 +385,69 @@ std::unique_ptr<sg::Image> GLTFLoader::parse_image(const tinygltf::Image &gltf_i
 		          .format = vk::Format::eR8G8B8A8Unorm,
 		          .levels = 1,
             },
-		});
+		};
 	}
-	else
+
+	std::string path = model_path_ + "/" + gltf_image.uri;
+	return ImageResource::load_two_dim_image(path);
+}
+
+// Load all images.
+// An image whose content is already on the device, from another load or from an earlier image of this model, shares that resource.
+// * Actual image bytes are not uploaded to GPU yet. We defer that untill all images (including the default texture images) are parsed.
+void GLTFLoader::load_images()
+{
+	ResourceCache                          &cache = device_.get_resource_cache();
+	std::unordered_map<uint64_t, size_t>    first_images;        // content hash -> first image of this model with it
+	std::vector<std::unique_ptr<sg::Image>> p_images;
+	p_images.reserve(gltf_model_.images.size());
+	img_uploads_.assign(gltf_model_.images.size(), false);
+
+	for (size_t i = 0; i < gltf_model_.images.size(); i++)
 	{
-		std::string path = model_path_ + "/" + gltf_image.uri;
-		img_tinfos_.push_back(ImageResource::load_two_dim_image(path));
+		std::shared_ptr<ImageResource> p_resource = cache.find_image(img_hashes_[i]);
+		auto                           it         = first_images.find(img_hashes_[i]);
+		if (!p_resource && it != first_images.end())
+		{
+			p_resource = p_images[it->second]->get_shared_resource();
+			cache.record_image_reuse(img_tinfos_[i].meta);
+		}
+
+		if (p_resource)
+		{
+			p_images.emplace_back(std::make_unique<sg::Image>(std::move(p_resource), gltf_model_.images[i].name));
+			img_tinfos_[i].binary = std::vector<uint8_t>();
+		}
+		else
+		{
+			p_images.emplace_back(parse_image(gltf_model_.images[i]));
+			first_images[img_hashes_[i]] = i;
+			img_uploads_[i]              = true;
+		}
+
+		if (defer_images_)
+		{
+			p_deferred_images_.push_back(p_images.back().get());
+		}
 	}
 
+	p_scene_->set_components(std::move(p_images));
+}
+
+// Parse an image.
+// * The resultant image are EMPTY.
+std::unique_ptr<sg::Image> GLTFLoader::parse_image(const tinygltf::Image &gltf_image) const
+{
 	return std::make_unique<sg::Image>(
 	    ImageResource(device_, nullptr),
 	    gltf_image.name);
 }
 
 // Actually upload the images to GPU.
-void GLTFLoader::batch_upload_images() const
+void GLTFLoader::batch_upload_images()
 {
-	std::vector<sg::Image *> p_images = p_scene_->get_components<sg::Image>();
+	sg::ComponentView<sg::Image> image_view = p_scene_->get_components<sg::Image>();
+	std::vector<sg::Image *>     p_images(image_view.begin(), image_view.end());
 
 	size_t i = 0;
 	// we ignore the last image b/c it's the default image we've created for default texture.
@@ -298,34 +456,65 @@ void GLTFLoader::batch_upload_images() const
 	while (i < count)
 	{
 		std::vector<Buffer> staging_bufs;
-		CommandBuffer       cmd_buf    = device_.begin_one_time_buf();
-		size_t              batch_size = 0;
+		CommandBuffer       cmd_buf = device_.begin_one_time_buf();
 
 		// Upload 64 MB data at once.
-		while (i < count && batch_size < 64 * 1024 * 1024)
+		i = record_image_uploads(cmd_buf, staging_bufs, p_images, i, count, 64 * 1024 * 1024);
+		device_.end_one_time_buf(cmd_buf);
+	}
+};
+
+// Record the uploads of p_images[first, count) until byte_budget is reached.
+// The staging buffers must outlive the submission of cmd_buf.
+// The CPU bytes of an image are freed as soon as they are in its staging buffer.
+// Return the index of the first image that is not recorded.
+size_t GLTFLoader::record_image_uploads(CommandBuffer &cmd_buf, std::vector<Buffer> &staging_bufs, const std::vector<sg::Image *> &p_images, size_t first, size_t count, size_t byte_budget)
+{
+	size_t i          = first;
+	size_t batch_size = 0;
+
+	while (i < count && batch_size < byte_budget)
+	{
+		// A shared image is uploaded by the image it shares with.
+		if (!img_uploads_[i])
 		{
-			sg::Image               *p_image   = p_images[i];
-			const ImageTransferInfo &img_tinfo = img_tinfos_[i];
-			size_t                   img_size  = img_tinfo.binary.size();
+			i++;
+			continue;
+		}
 
-			create_image_resource(*p_image, i);
+		sg::Image         *p_image   = p_images[i];
+		ImageTransferInfo &img_tinfo = img_tinfos_[i];
+		size_t             img_size  = img_tinfo.binary.size();
 
-			batch_size += img_size;
-			staging_bufs.emplace_back(device_.get_device_memory_allocator().allocate_staging_buffer(img_size));
+		create_image_resource(*p_image, i);
 
-			staging_bufs.back().update(img_tinfo.binary);
+		batch_size += img_size;
+		staging_bufs.emplace_back(device_.get_device_memory_allocator().allocate_staging_buffer(img_size));
 
-			cmd_buf.set_image_layout(p_image->get_resource(), vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer);
+		staging_bufs.back().update(img_tinfo.binary);
+		img_tinfo.binary = std::vector<uint8_t>();
 
-			cmd_buf.update_image(p_image->get_resource(), staging_bufs.back());
+		cmd_buf.set_image_layout(p_image->get_resource(), vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer);
 
+		if (img_blit_mips_[i])
+		{
+			// Only level 0 is in the staging buffer. The blits leave every level ready for sampling.
+			cmd_buf.update_image(p_image->get_resource(), staging_bufs.back(), 1);
+			cmd_buf.generate_mipmaps(p_image->get_resource());
+		}
+		else
+		{
+			cmd_buf.update_image(p_image->get_resource(), staging_bufs.back());
 			cmd_buf.set_image_layout(p_image->get_resource(), vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
-
-			i++;
 		}
-		device_.end_one_time_buf(cmd_buf);
+
+		// The upload is submitted before the main thread can start another load, so other loads may share the image now.
+		device_.get_resource_cache().add_image(img_hashes_[i], p_image->get_shared_resource(), img_tinfo.meta);
+		i++;
 	}
-};
+
+	return i;
+}
 
 // Helper function to create image resource.
 void GLTFLoader::create_image_resource(sg::Image &image, size_t idx) const
@@ -342,6 +531,10 @@ void GLTFLoader::create_image_resource(sg::Image &image, size_t idx) const
 	         .usage       = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
 	         .sharingMode = vk::SharingMode::eExclusive,
     };
+	if (img_blit_mips_[idx])
+	{
+		img_cinfo.usage |= vk::ImageUsageFlagBits::eTransferSrc;
+	}
 
 	Image vk_image = device_.get_device_memory_allocator().allocate_device_only_image(img_cinfo);
 
@@ -351,18 +544,30 @@ void GLTFLoader::create_image_resource(sg::Image &image, size_t idx) const
 }
 
 // Load the textures.
+// * When images are deferred, textures point to the default texture image until their own image is uploaded.
 void GLTFLoader::load_textures()
 {
 	// Create a default sampler in case a texture points to no sampler.
-	std::unique_ptr<sg::Sampler> p_default_sampler = create_default_sampler();
-	std::vector<sg::Sampler *>   p_samplers        = p_scene_->get_components<sg::Sampler>();
-	std::vector<sg::Image *>     p_images          = p_scene_->get_components<sg::Image>();
+	std::unique_ptr<sg::Sampler>   p_default_sampler = create_default_sampler();
+	std::unique_ptr<sg::Texture>   p_default_texture = create_default_texture(*p_default_sampler);
+	sg::ComponentView<sg::Sampler> p_samplers        = p_scene_->get_components<sg::Sampler>();
+	sg::ComponentView<sg::Image>   p_images          = p_scene_->get_components<sg::Image>();
+
+	img_textures_.resize(gltf_model_.images.size());
 
 	for (auto &gltf_texture : gltf_model_.textures)
 	{
 		std::unique_ptr<sg::Texture> p_texture = parse_texture(gltf_texture);
 		assert(gltf_texture.source < p_images.size());
-		p_texture->p_resource_ = &p_images[gltf_texture.source]->get_resource();
+		if (defer_images_)
+		{
+			p_texture->p_resource_ = p_default_texture->p_resource_;
+			img_textures_[gltf_texture.source].push_back(p_texture.get());
+		}
+		else
+		{
+			p_texture->p_resource_ = &p_images[gltf_texture.source]->get_resource();
+		}
 
 		if (gltf_texture.sampler >= 0 && gltf_texture.sampler < static_cast<int>(p_samplers.size()))
 		{
@@ -379,7 +584,7 @@ void GLTFLoader::load_textures()
 		p_scene_->add_component(std::move(p_texture));
 	}
 
-	p_scene_->add_component(create_default_texture(*p_default_sampler));
+	p_scene_->add_component(std::move(p_default_texture));
 	p_scene_->add_component(std::move(p_default_sampler));
 }
 
@@ -395,8 +600,27 @@ std::unique_ptr<sg::Texture> GLTFLoader::create_default_texture(sg::Sampler &def
 }
 
 // Create a default texture image. (a 1x1 black image)
+// Every scene shares the same one through the resource cache.
 std::unique_ptr<sg::Image> GLTFLoader::create_default_texture_image() const
 {
+	std::vector<uint8_t> binary = {0u, 0u, 0u, 0u};
+	ImageMetaInfo        meta{
+	    .extent = {
+	        .width  = 1,
+	        .height = 1,
+	        .depth  = 1,
+	    },
+	    .format = vk::Format::eR8G8B8A8Srgb,
+	    .levels = 1,
+	};
+	ResourceCache                 &cache      = device_.get_resource_cache();
+	uint64_t                       hash       = ResourceCache::hash_image(binary.data(), binary.size(), meta);
+	std::shared_ptr<ImageResource> p_resource = cache.find_image(hash);
+	if (p_resource)
+	{
+		return std::make_unique<sg::Image>(std::move(p_resource), "default_image");
+	}
+
 	vk::ImageCreateInfo image_cinfo{
 	    .imageType = vk::ImageType::e2D,
 	    .format    = vk::Format::eR8G8B8A8Srgb,
@@ -418,8 +642,6 @@ std::unique_ptr<sg::Image> GLTFLoader::create_default_texture_image() const
 	vk::ImageViewCreateInfo view_cinfo = ImageView::two_dim_view_cinfo(img.get_handle(), image_cinfo.format, vk::ImageAspectFlagBits::eColor, 1);
 	ImageResource           resource   = ImageResource(std::move(img), ImageView(device_, view_cinfo));
 
-	std::vector<uint8_t> binary = {0u, 0u, 0u, 0u};
-
 	Buffer staging_buf = device_.get_device_memory_allocator().allocate_staging_buffer(binary.size());
 	staging_buf.update(binary);
 
@@ -431,7 +653,9 @@ std::unique_ptr<sg::Image> GLTFLoader::create_default_texture_image() const
 
 	device_.end_one_time_buf(cmd_buf);
 
-	return std::make_unique<sg::Image>(std::move(resource), "default_image");
+	std::unique_ptr<sg::Image> p_image = std::make_unique<sg::Image>(std::move(resource), "default_image");
+	cache.add_image(hash, p_image->get_shared_resource(), meta);
+	return p_image;
 }
 
 // Parse and create the texture.
@@ -442,19 +666,37 @@ std::unique_ptr<sg::Texture> GLTFLoader::parse_texture(
 }
 
 // Load the materials.
+// Materials with the same parameters and textures are merged. material_indices_ maps a glTF material to the one kept.
 void GLTFLoader::load_materials()
 {
-	std::vector<sg::Texture *> p_textures;
-	if (p_scene_->has_component<sg::Texture>())
-	{
-		p_textures = p_scene_->get_components<sg::Texture>();
-	}
+	sg::ComponentView<sg::Texture> p_textures = p_scene_->get_components<sg::Texture>();
+
+	ResourceCache                          &cache = device_.get_resource_cache();
+	std::unordered_multimap<size_t, size_t> hash_to_index;
+	std::vector<sg::PBRMaterial *>          p_materials;
+	material_indices_.reserve(gltf_model_.materials.size());
 
 	for (auto &gltf_material : gltf_model_.materials)
 	{
 		std::unique_ptr<sg::PBRMaterial> p_material = parse_material(gltf_material);
 		append_textures_to_material(gltf_material.values, p_textures, p_material.get());
 		append_textures_to_material(gltf_material.additionalValues, p_textures, p_material.get());
+
+		size_t hash  = ResourceCache::hash_material(*p_material);
+		auto   range = hash_to_index.equal_range(hash);
+		auto   it    = std::find_if(range.first, range.second, [&](const auto &entry) {
+			return ResourceCache::is_same_material(*p_materials[entry.second], *p_material);
+		});
+		if (it != range.second)
+		{
+			material_indices_.push_back(it->second);
+			cache.record_material_reuse();
+			continue;
+		}
+
+		hash_to_index.emplace(hash, p_materials.size());
+		material_indices_.push_back(p_materials.size());
+		p_materials.push_back(p_material.get());
 		p_scene_->add_component(std::move(p_material));
 	}
 	std::unique_ptr<sg::PBRMaterial> p_default_material = create_default_material();
@@ -521,7 +763,7 @@ std::unique_ptr<sg::PBRMaterial> GLTFLoader::parse_material(
 }
 
 // Search for already loaded textures and append pointers.
-void GLTFLoader::append_textures_to_material(tinygltf::ParameterMap &parameter_map, std::vector<sg::Texture *> &p_textures, sg::PBRMaterial *p_material)
+void GLTFLoader::append_textures_to_material(tinygltf::ParameterMap &parameter_map, const sg::ComponentView<sg::Texture> &p_textures, sg::PBRMaterial *p_material)
 {
 	for (auto &value : parameter_map)
 	{
@@ -532,10 +774,6 @@ void GLTFLoader::append_textures_to_material(tinygltf::ParameterMap &parameter_m
 			sg::PBRMaterialFlagBits flag_bit     = to_sg_material_flag_bit(texture_name);
 			assert(texture_idx < p_textures.size());
 
-			if (flag_bit == sg::PBRMaterialFlagBits::eBaseColorTexture || flag_bit == sg::PBRMaterialFlagBits::eEmissiveTexture)
-			{
-				img_tinfos_[gltf_model_.textures[texture_idx].source].meta.format = vk::Format::eR8G8B8A8Srgb;
-			}
 			p_material->texture_map_[texture_name] = p_textures[value.second.TextureIndex()];
 			p_material->flag_ |= flag_bit;
 		}
@@ -552,8 +790,9 @@ std::unique_ptr<sg::PBRMaterial> GLTFLoader::create_default_material() const
 // Load all meshes.
 void GLTFLoader::load_meshs()
 {
-	std::unique_ptr<sg::PBRMaterial> p_default_material = create_default_material();
-	std::vector<sg::PBRMaterial *>   p_materials        = p_scene_->get_components<sg::PBRMaterial>();
+	std::unique_ptr<sg::PBRMaterial>   p_default_material = create_default_material();
+	sg::ComponentView<sg::PBRMaterial> p_materials        = p_scene_->get_components<sg::PBRMaterial>();
+	UploadBatch                        batch(device_);
 
 	for (auto &gltf_mesh : gltf_model_.meshes)
 	{
@@ -561,11 +800,11 @@ void GLTFLoader::load_meshs()
 
 		for (const auto &primitive : gltf_mesh.primitives)
 		{
-			std::unique_ptr<sg::SubMesh> p_submesh = parse_submesh(p_mesh.get(), primitive);
+			std::unique_ptr<sg::SubMesh> p_submesh = parse_submesh(p_mesh.get(), primitive, batch);
 			if (primitive.material >= 0)
 			{
-				assert(primitive.material < p_materials.size());
-				p_submesh->set_material(*p_materials[primitive.material]);
+				assert(primitive.material < material_indices_.size());
+				p_submesh->set_material(*p_materials[material_indices_[primitive.material]]);
 			}
 			else
 			{
@@ -577,6 +816,7 @@ void GLTFLoader::load_meshs()
 
 		p_scene_->add_component(std::move(p_mesh));
 	}
+	batch.flush();
 
 	p_scene_->add_component(std::move(p_default_material));
 }
@@ -589,96 +829,37 @@ std::unique_ptr<sg::Mesh> GLTFLoader::parse_mesh(const tinygltf::Mesh &gltf_mesh
 
 // Parse the submesh.
 // First, we load the vertex attributes and then the indices.
-std::unique_ptr<sg::SubMesh> GLTFLoader::parse_submesh(sg::Mesh *p_mesh, const tinygltf::Primitive &gltf_submesh) const
+// Both are converted straight into their staging buffers. The copies are recorded into batch.
+std::unique_ptr<sg::SubMesh> GLTFLoader::parse_submesh(sg::Mesh *p_mesh, const tinygltf::Primitive &gltf_submesh, UploadBatch &batch) const
 {
-	std::vector<Buffer>          transient_bufs;
 	std::unique_ptr<sg::SubMesh> p_submesh = std::make_unique<sg::SubMesh>();
-	p_submesh->vertex_count_               = get_submesh_vertex_count(gltf_submesh);
+	p_submesh->vertex_count_               = get_submesh_vertex_count(gltf_model_, gltf_submesh);
 	if (p_mesh)
 	{
 		update_parent_mesh_bound(p_mesh, gltf_submesh);
 	}
-	std::vector<sg::Vertex> vertexs;
-	vertexs.reserve(p_submesh->vertex_count_);
 
-	DataAccessInfo<float>    pos    = get_attr_data_ptr<float>(gltf_submesh, "POSITION");
-	DataAccessInfo<float>    norm   = get_attr_data_ptr<float>(gltf_submesh, "NORMAL");
-	DataAccessInfo<float>    uv     = get_attr_data_ptr<float>(gltf_submesh, "TEXCOORD_0");
-	DataAccessInfo<uint16_t> joint  = get_attr_data_ptr<uint16_t>(gltf_submesh, "JOINTS_0");
-	DataAccessInfo<float>    weight = get_attr_data_ptr<float>(gltf_submesh, "WEIGHTS_0");
-	DataAccessInfo<float>    color  = get_attr_data_ptr<float>(gltf_submesh, "COLOR_0");
-
-	bool is_skinned = joint.p_data && weight.p_data;
-
-	for (size_t i = 0; i < p_submesh->vertex_count_; i++)
-	{
-		vertexs.emplace_back(sg::Vertex{
-		    .pos    = glm::make_vec3(&pos.p_data[i * pos.stride]),
-		    .norm   = norm.p_data ? glm::normalize(glm::make_vec3(&norm.p_data[i * norm.stride])) : DEFAULT_NORMAL,
-		    .uv     = uv.p_data ? glm::make_vec2(&uv.p_data[i * uv.stride]) : DEFAULT_UV,
-		    .joint  = is_skinned ? glm::vec4(glm::make_vec4(&joint.p_data[i * joint.stride])) : DEFAULT_JOINT,
-		    .weight = is_skinned ? glm::make_vec4(&weight.p_data[i * weight.stride]) : DEFAULT_WEIGHT,
-		    .color  = color.p_data ? glm::make_vec4(&color.p_data[i * color.stride]) : DEFAULT_COLOR,
-		});
-		to_W3D_vector_in_place(vertexs.back().pos);
-		to_W3D_vector_in_place(vertexs.back().norm);
-	}
-
-	size_t vertex_buf_size    = vertexs.size() * sizeof(sg::Vertex);
-	Buffer vertex_staging_buf = device_.get_device_memory_allocator().allocate_staging_buffer(vertex_buf_size);
-	Buffer vertex_buf         = device_.get_device_memory_allocator().allocate_vertex_buffer(vertex_buf_size);
-	vertex_staging_buf.update(vertexs.data(), vertex_buf_size);
-	CommandBuffer cmd_buf = device_.begin_one_time_buf();
-	cmd_buf.copy_buffer(vertex_staging_buf, vertex_buf, vertex_buf_size);
+	size_t  vertex_buf_size    = p_submesh->vertex_count_ * sizeof(sg::Vertex);
+	Buffer &vertex_staging_buf = batch.stage(vertex_buf_size);
+	Buffer  vertex_buf         = device_.get_device_memory_allocator().allocate_vertex_buffer(vertex_buf_size);
+	write_submesh_vertices(gltf_model_, gltf_submesh, reinterpret_cast<sg::Vertex *>(vertex_staging_buf.get_mapped_data()), p_glb_bin_);
+	batch.get_cmd_buf().copy_buffer(vertex_staging_buf, vertex_buf, vertex_buf_size);
 	p_submesh->p_vertex_buf_ = std::make_unique<Buffer>(std::move(vertex_buf));
-	transient_bufs.push_back(std::move(vertex_staging_buf));
 
 	// Load the indices if there is an index buffer.
 	if (gltf_submesh.indices >= 0)
 	{
-		const tinygltf::Accessor &accessor = gltf_model_.accessors[gltf_submesh.indices];
-		p_submesh->idx_count_              = accessor.count;
-
-		vk::Format           format = get_attr_format(gltf_model_, gltf_submesh.indices);
-		std::vector<uint8_t> indexs = get_attr_data(gltf_model_, gltf_submesh.indices);
+		p_submesh->idx_count_ = get_submesh_index_count(gltf_model_, gltf_submesh);
 
-		switch (format)
-		{
-			case vk::Format::eR32Uint:
-				break;
-			case vk::Format::eR16Uint:
-			{
-				indexs = convert_data_stride(indexs, 2, 4);
-				break;
-			}
-			case vk::Format::eR8Uint:
-			{
-				indexs = convert_data_stride(indexs, 1, 4);
-				break;
-			}
-			default:
-				// unreachable;
-				break;
-		}
-
-		Buffer idx_staging_buf = device_.get_device_memory_allocator().allocate_staging_buffer(indexs.size());
-		Buffer idx_buf         = device_.get_device_memory_allocator().allocate_index_buffer(indexs.size());
-		idx_staging_buf.update(indexs);
-		cmd_buf.copy_buffer(idx_staging_buf, idx_buf, indexs.size());
-		transient_bufs.push_back(std::move(idx_staging_buf));
+		size_t  idx_buf_size    = p_submesh->idx_count_ * sizeof(uint32_t);
+		Buffer &idx_staging_buf = batch.stage(idx_buf_size);
+		Buffer  idx_buf         = device_.get_device_memory_allocator().allocate_index_buffer(idx_buf_size);
+		write_submesh_indices(gltf_model_, gltf_submesh, reinterpret_cast<uint32_t *>(idx_staging_buf.get_mapped_data()), p_glb_bin_);
+		batch.get_cmd_buf().copy_buffer(idx_staging_buf, idx_buf, idx_buf_size);
 		p_submesh->p_idx_buf_ = std::make_unique<Buffer>(std::move(idx_buf));
 	}
 
-	device_.end_one_time_buf(cmd_buf);
-	return std::move(p_submesh);
-}
-
-// Helper function for getting the vertex count
-size_t GLTFLoader::get_submesh_vertex_count(const tinygltf::Primitive &submesh) const
-{
-	// GLTF gurantees that a vertex will always have position attribute
-	const tinygltf::Accessor accessor = gltf_model_.accessors[submesh.attributes.find("POSITION")->second];
-	return accessor.count;
+	return p_submesh;
 }
 
 // Helper function to update a mesh's bound given the submesh
@@ -772,9 +953,9 @@ void GLTFLoader::load_nodes(int scene_idx)
 // Parse all nodes.
 std::vector<std::unique_ptr<sg::Node>> GLTFLoader::parse_nodes()
 {
-	std::vector<sg::Camera *>              p_cameras = p_scene_->get_components<sg::Camera>();
-	std::vector<sg::Mesh *>                p_meshs   = p_scene_->get_components<sg::Mesh>();
-	std::vector<sg::Skin *>                p_skins   = p_scene_->get_components<sg::Skin>();
+	sg::ComponentView<sg::Camera>          p_cameras = p_scene_->get_components<sg::Camera>();
+	sg::ComponentView<sg::Mesh>            p_meshs   = p_scene_->get_components<sg::Mesh>();
+	sg::ComponentView<sg::Skin>            p_skins   = p_scene_->get_components<sg::Skin>();
 	std::vector<std::unique_ptr<sg::Node>> p_nodes;
 	p_nodes.reserve(gltf_model_.nodes.size());
 
@@ -901,6 +1082,7 @@ void GLTFLoader::load_animations()
 {
 	std::vector<sg::Node *>                     p_nodes = p_scene_->get_nodes();
 	std::vector<std::unique_ptr<sg::Animation>> p_animations;
+	sg::ClipCompressionStats                    compression_stats;
 	p_animations.reserve(gltf_model_.animations.size());
 	for (size_t i = 0; i < gltf_model_.animations.size(); i++)
 	{
@@ -908,9 +1090,16 @@ void GLTFLoader::load_animations()
 		std::unique_ptr<sg::Animation> p_animation    = std::make_unique<sg::Animation>(gltf_animation.name);
 		p_animation->set_channels(parse_animation_channels(gltf_animation, p_nodes));
 		p_animation->update_interval();
+		p_animation->compile();
+		compression_stats.add(p_animation->get_compression_stats());
 		p_animations.push_back(std::move(p_animation));
 	}
+	if (!p_animations.empty())
+	{
+		sg::log_clip_compression_stats("glTF animations", compression_stats);
+	}
 	p_scene_->set_components(std::move(p_animations));
+	p_scene_->set_components(sg::Animator::create_per_skeleton(p_scene_->get_components<sg::Animation>()));
 }
 
 // Load all the animation channels.
@@ -957,11 +1146,11 @@ std::vector<sg::AnimationSampler> GLTFLoader::parse_animation_samplers(const tin
 void GLTFLoader::parse_animation_input_data(const tinygltf::AnimationSampler &gltf_sampler, sg::AnimationSampler &sampler) const
 {
 	const tinygltf::Accessor &input_accessor = gltf_model_.accessors[gltf_sampler.input];
-	std::vector<uint8_t>      input_data     = get_attr_data(gltf_model_, gltf_sampler.input);
-	const float              *p_input_data   = reinterpret_cast<const float *>(input_data.data());
+	DataAccessInfo<float>     input_data     = get_accessor_data_ptr<float>(gltf_model_, gltf_sampler.input, p_glb_bin_);
+	sampler.inputs.reserve(input_accessor.count);
 	for (size_t i = 0; i < input_accessor.count; i++)
 	{
-		sampler.inputs.push_back(p_input_data[i]);
+		sampler.inputs.push_back(input_data.p_data[i * input_data.stride]);
 	}
 }
 
@@ -969,7 +1158,7 @@ void GLTFLoader::parse_animation_input_data(const tinygltf::AnimationSampler &gl
 void GLTFLoader::parse_animation_output_data(const tinygltf::AnimationSampler &gltf_sampler, sg::AnimationSampler &sampler) const
 {
 	const tinygltf::Accessor &output_accessor = gltf_model_.accessors[gltf_sampler.output];
-	std::vector<uint8_t>      output_data     = get_attr_data(gltf_model_, gltf_sampler.output);
+	DataAccessInfo<float>     output_data     = get_accessor_data_ptr<float>(gltf_model_, gltf_sampler.output, p_glb_bin_);
 	switch (output_accessor.type)
 	{
 		case TINYGLTF_TYPE_VEC3:
@@ -977,10 +1166,10 @@ void GLTFLoader::parse_animation_output_data(const tinygltf::AnimationSampler &g
 			sampler.init_vecs();
 			std::vector<glm::vec3> &sampler_outputs = sampler.get_mut_vecs();
 
-			const glm::vec3 *p_vecs = reinterpret_cast<const glm::vec3 *>(output_data.data());
+			sampler_outputs.reserve(output_accessor.count);
 			for (size_t i = 0; i < output_accessor.count; i++)
 			{
-				sampler_outputs.push_back(glm::vec3(p_vecs[i]));
+				sampler_outputs.push_back(glm::make_vec3(&output_data.p_data[i * output_data.stride]));
 			}
 			break;
 		}
@@ -989,15 +1178,16 @@ void GLTFLoader::parse_animation_output_data(const tinygltf::AnimationSampler &g
 			sampler.init_quats();
 			std::vector<glm::quat> &sampler_outputs = sampler.get_mut_quats();
 
-			const float *p_float = reinterpret_cast<const float *>(output_data.data());
+			sampler_outputs.reserve(output_accessor.count);
 			for (size_t i = 0; i < output_accessor.count; i++)
 			{
 				// gltf passes in quat as (x, y, z, w)
+				const float *p_float = &output_data.p_data[i * output_data.stride];
 				sampler_outputs.push_back(glm::quat::wxyz(
-				    p_float[i * 4 + 3],
-				    p_float[i * 4 + 0],
-				    p_float[i * 4 + 1],
-				    p_float[i * 4 + 2]));
+				    p_float[3],
+				    p_float[0],
+				    p_float[1],
+				    p_float[2]));
 			}
 			break;
 		}
@@ -1025,25 +1215,17 @@ void GLTFLoader::load_skins()
 // Parse the skin.
 std::unique_ptr<sg::Skin> GLTFLoader::parse_skin(const tinygltf::Skin &gltf_skin)
 {
-	const std::vector<int> &joints = gltf_skin.joints;
-	// We forces a 256 joints limit.
-	if (joints.size() > sg::Skin::MAX_NUM_JOINTS)
-	{
-		LOGE("Skin {} exceeds the joint limits.", gltf_skin.name);
-		abort();
-	}
+	const std::vector<int>   &joints = gltf_skin.joints;
 	std::unique_ptr<sg::Skin> p_skin = std::make_unique<sg::Skin>(gltf_skin.name);
-
-	auto                 &IBMs = p_skin->get_IBMs();
-	DataAccessInfo<float> IBM  = get_accessor_data_ptr<float>(gltf_skin.inverseBindMatrices);
+	DataAccessInfo<float>     IBM    = get_accessor_data_ptr<float>(gltf_model_, gltf_skin.inverseBindMatrices, p_glb_bin_);
 
 	// The inverse bind matrices are also defined in right-handed system. We need to convert them.
+	p_skin->reserve_joints(joints.size());
 	for (int joint_id = 0; joint_id < joints.size(); joint_id++)
 	{
-		p_skin->add_new_joint(joint_id, joints[joint_id]);
 		glm::mat4 m = glm::make_mat4(&IBM.p_data[joint_id * IBM.stride]);
 		to_W3D_matrix_in_place(m);
-		IBMs[joint_id] = m;
+		p_skin->add_joint(joints[joint_id], m);
 	}
 
 	return p_skin;
@@ -1070,73 +1252,12 @@ tinygltf::Scene *GLTFLoader::pick_scene(int scene_idx)
 
 	if (!gltf_scene)
 	{
-		LOGE("Couldn't determine which scene to load");
-		abort();
+		throw std::runtime_error("Couldn't determine which scene to load");
 	}
 
 	return gltf_scene;
 }
 
-vk::Filter to_vk_min_filter(int min_filter)
-{
-	switch (min_filter)
-	{
-		case TINYGLTF_TEXTURE_FILTER_NEAREST:
-		case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR:
-		case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
-			return vk::Filter::eNearest;
-		case TINYGLTF_TEXTURE_FILTER_LINEAR:
-		case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR:
-		case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
-			return vk::Filter::eLinear;
-		default:
-			return vk::Filter::eLinear;
-	}
-}
-
-vk::Filter to_vk_mag_filter(int mag_filter)
-{
-	switch (mag_filter)
-	{
-		case TINYGLTF_TEXTURE_FILTER_LINEAR:
-			return vk::Filter::eLinear;
-		case TINYGLTF_TEXTURE_FILTER_NEAREST:
-			return vk::Filter::eNearest;
-		default:
-			return vk::Filter::eLinear;
-	}
-}
-
-vk::SamplerMipmapMode to_vk_mipmap_mode(int mipmap_mode)
-{
-	switch (mipmap_mode)
-	{
-		case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR:
-		case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
-			return vk::SamplerMipmapMode::eNearest;
-		case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR:
-		case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
-			return vk::SamplerMipmapMode::eLinear;
-		default:
-			return vk::SamplerMipmapMode::eLinear;
-	}
-}
-
-vk::SamplerAddressMode to_vk_wrap_mode(int wrap_mode)
-{
-	switch (wrap_mode)
-	{
-		case TINYGLTF_TEXTURE_WRAP_REPEAT:
-			return vk::SamplerAddressMode::eRepeat;
-		case TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE:
-			return vk::SamplerAddressMode::eClampToEdge;
-		case TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT:
-			return vk::SamplerAddressMode::eMirroredRepeat;
-		default:
-			return vk::SamplerAddressMode::eRepeat;
-	}
-}
-
 sg::PBRMaterialFlagBits to_sg_material_flag_bit(const std::string &texture_name)
 {
 	static std::unordered_map<std::string, sg::PBRMaterialFlagBits> name_to_flag_bit_map = {
@@ -1150,63 +1271,6 @@ sg::PBRMaterialFlagBits to_sg_material_flag_bit(const std::string &texture_name)
 	return name_to_flag_bit_map[texture_name];
 }
 
-sg::AnimationType to_sg_animation_type(const std::string &interpolation)
-{
-	if (interpolation == "LINEAR")
-	{
-		return sg::AnimationType::eLinear;
-	}
-	else if (interpolation == "STEP")
-	{
-		return sg::AnimationType::eStep;
-	}
-	else if (interpolation == "CUBICSPLINE")
-	{
-		return sg::AnimationType::eCubicSpline;
-	}
-	LOGW("Unkown interpolation value {}.", interpolation);
-	return sg::AnimationType::eLinear;
-}
-
-sg::AnimationTarget to_sg_animation_target(const std::string &target)
-{
-	if (target == "translation")
-	{
-		return sg::AnimationTarget::eTranslation;
-	}
-	else if (target == "rotation")
-	{
-		return sg::AnimationTarget::eRotation;
-	}
-	else if (target == "scale")
-	{
-		return sg::AnimationTarget::eScale;
-	}
-	LOGW("Animation target {} is not supported!", target);
-	return sg::AnimationTarget::eTranslation;
-}
-
-void to_W3D_vector_in_place(glm::vec3 &vec)
-{
-	vec *= GLTFLoader::W3D_CONVERSION_SCALE;
-}
-
-void to_W3D_quaternion_in_place(glm::quat &quat)
-{
-	// We need to flip the handiness
-	float     flip_scale        = -1;
-	glm::vec3 new_axis_rotation = flip_scale * glm::vec3(quat.x, quat.y, quat.z) * GLTFLoader::W3D_CONVERSION_SCALE;
-	quat.x                      = new_axis_rotation.x;
-	quat.y                      = new_axis_rotation.y;
-	quat.z                      = new_axis_rotation.z;
-}
-
-void to_W3D_matrix_in_place(glm::mat4 &M)
-{
-	glm::mat4 convert = glm::scale(glm::mat4(1.0f), GLTFLoader::W3D_CONVERSION_SCALE);
-	M                 = convert * M * convert;
-}
-
 void to_W3D_output_data_in_place(sg::AnimationSampler &sampler, sg::AnimationTarget target)
 {
 	switch (target)
@@ -1234,163 +1298,4 @@ void to_W3D_output_data_in_place(sg::AnimationSampler &sampler, sg::AnimationTar
 	}
 }
 
-vk::Format get_attr_format(const tinygltf::Model &model, uint32_t accessor_id)
-{
-	assert(accessor_id < model.accessors.size());
-	auto &accessor = model.accessors[accessor_id];
-
-	vk::Format format;
-
-	switch (accessor.componentType)
-	{
-		case TINYGLTF_COMPONENT_TYPE_BYTE:
-		{
-			static const std::map<int, vk::Format> mapped_format = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR8Sint},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR8G8Sint},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR8G8B8Sint},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR8G8B8A8Sint}};
-
-			format = mapped_format.at(accessor.type);
-
-			break;
-		}
-		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-		{
-			static const std::map<int, vk::Format> mapped_format = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR8Uint},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR8G8Uint},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR8G8B8Uint},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR8G8B8A8Uint}};
-
-			static const std::map<int, vk::Format> mapped_format_normalize = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR8Unorm},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR8G8Unorm},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR8G8B8Unorm},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR8G8B8A8Unorm}};
-
-			if (accessor.normalized)
-			{
-				format = mapped_format_normalize.at(accessor.type);
-			}
-			else
-			{
-				format = mapped_format.at(accessor.type);
-			}
-
-			break;
-		}
-		case TINYGLTF_COMPONENT_TYPE_SHORT:
-		{
-			static const std::map<int, vk::Format> mapped_format = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR16Sint},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR16G16Sint},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR16G16B16Sint},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR16G16B16A16Sint}};
-
-			format = mapped_format.at(accessor.type);
-
-			break;
-		}
-		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-		{
-			static const std::map<int, vk::Format> mapped_format = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR16Uint},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR16G16Uint},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR16G16B16Uint},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR16G16B16A16Uint}};
-
-			static const std::map<int, vk::Format> mapped_format_normalize = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR16Unorm},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR16G16Unorm},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR16G16B16Unorm},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR16G16B16A16Unorm}};
-			if (accessor.normalized)
-			{
-				format = mapped_format_normalize.at(accessor.type);
-			}
-			else
-			{
-				format = mapped_format.at(accessor.type);
-			}
-
-			break;
-		}
-		case TINYGLTF_COMPONENT_TYPE_INT:
-		{
-			static const std::map<int, vk::Format> mapped_format = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR32Sint},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR32G32Sint},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR32G32B32Sint},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR32G32B32A32Sint}};
-
-			format = mapped_format.at(accessor.type);
-
-			break;
-		}
-		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-		{
-			static const std::map<int, vk::Format> mapped_format = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR32Uint},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR32G32Uint},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR32G32B32Uint},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR32G32B32A32Uint}};
-			format = mapped_format.at(accessor.type);
-
-			break;
-		}
-		case TINYGLTF_COMPONENT_TYPE_FLOAT:
-		{
-			static const std::map<int, vk::Format> mapped_format = {
-			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR32Sfloat},
-			    {TINYGLTF_TYPE_VEC2, vk::Format::eR32G32Sfloat},
-			    {TINYGLTF_TYPE_VEC3, vk::Format::eR32G32B32Sfloat},
-			    {TINYGLTF_TYPE_VEC4, vk::Format::eR32G32B32A32Sfloat}};
-
-			format = mapped_format.at(accessor.type);
-
-			break;
-		}
-		default:
-		{
-			format = vk::Format::eUndefined;
-			break;
-		}
-	}
-
-	return format;
-}
-
-std::vector<uint8_t> get_attr_data(const tinygltf::Model &model, uint32_t accessor_id)
-{
-	assert(accessor_id < model.accessors.size());
-	auto &accessor = model.accessors[accessor_id];
-	assert(accessor.bufferView < model.bufferViews.size());
-	auto &buffer_view = model.bufferViews[accessor.bufferView];
-	assert(buffer_view.buffer < model.buffers.size());
-	auto &buffer = model.buffers[buffer_view.buffer];
-
-	size_t stride     = accessor.ByteStride(buffer_view);
-	size_t start_byte = accessor.byteOffset + buffer_view.byteOffset;
-	size_t end_byte   = start_byte + accessor.count * stride;
-
-	return {buffer.data.begin() + start_byte, buffer.data.begin() + end_byte};
-}
-
-std::vector<uint8_t> convert_data_stride(const std::vector<uint8_t> &src,
-                                         uint32_t                    src_stride,
-                                         uint32_t                    dst_stride)
-{
-	auto                 elem_count = src.size() / src_stride;
-	std::vector<uint8_t> dst(elem_count * dst_stride);
-
-	for (uint32_t src_idx = 0, dst_idx = 0; src_idx < src.size() && dst_idx < dst.size();
-	     src_idx += src_stride, dst_idx += dst_stride)
-	{
-		std::copy(src.begin() + src_idx, src.begin() + src_idx + src_stride, dst.begin() + dst_idx);
-	}
-
-	return dst;
-}
-
 }        // namespace W3D
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include <memory>
 
+#include "common/file_utils.hpp"
 #include "common/glm_common.hpp"
 
 namespace W3D
@@ -17,6 +18,8 @@ class Allocator;
 
 namespace sg
 {
+template <typename T>
+class ComponentView;
 class Scene;
 class Node;
 class Camera;
@@ -34,6 +37,9 @@ struct Vertex;
 };        // namespace sg
 
 struct ImageTransferInfo;
+class CommandBuffer;
+class Buffer;
+class UploadBatch;
 
 // Loader class responsible for loading gltf file.
 // This class relies on tinygltf to read the gltf file.
@@ -42,17 +48,26 @@ struct ImageTransferInfo;
 class GLTFLoader
 {
   public:
-	static const glm::vec3 W3D_CONVERSION_SCALE;
-
 	GLTFLoader(Device const &device);
 	virtual ~GLTFLoader() = default;
 	std::unique_ptr<sg::Scene>   read_scene_from_file(const std::string &file_name,
 	                                                  int                scene_index = -1);
 	std::unique_ptr<sg::SubMesh> read_model_from_file(const std::string &file_name, int mesh_idx);
 
+	// Streaming interface used by AsyncSceneLoad.
+	// read_file() only touches the CPU and is safe to call from a worker thread.
+	// create_streaming_scene() and upload_deferred_images() record GPU work and must run on the main thread.
+	void                       read_file(const std::string &file_name);
+	std::unique_ptr<sg::Scene> create_streaming_scene(int scene_index = -1);
+	std::vector<sg::Texture *> upload_deferred_images(size_t byte_budget);
+	bool                       has_deferred_images() const;
+	size_t                     get_deferred_image_count() const;
+	size_t                     get_uploaded_image_count() const;
+
   private:
-	void      load_gltf_model(const std::string &file_name);
-	sg::Scene parse_scene(int scene_idx = -1);
+	void                       load_gltf_model(const std::string &file_name);
+	void                       load_image_transfer_infos();
+	std::unique_ptr<sg::Scene> parse_scene(int scene_idx = -1);
 
 	void load_samplers() const;
 	void load_images();
@@ -70,10 +85,12 @@ class GLTFLoader
 	                                                  size_t                index) const;
 	std::unique_ptr<sg::Camera>            parse_camera(const tinygltf::Camera &gltf_camera) const;
 	std::unique_ptr<sg::Mesh>              parse_mesh(const tinygltf::Mesh &gltf_mesh) const;
-	std::unique_ptr<sg::SubMesh>           parse_submesh(sg::Mesh *p_mesh, const tinygltf::Primitive &gltf_submesh) const;
+	std::unique_ptr<sg::SubMesh>           parse_submesh(sg::Mesh *p_mesh, const tinygltf::Primitive &gltf_submesh, UploadBatch &batch) const;
 	std::unique_ptr<sg::PBRMaterial>       parse_material(
 	          const tinygltf::Material &gltf_material) const;
-	std::unique_ptr<sg::Image>   parse_image(const tinygltf::Image &gltf_image);
+	std::unique_ptr<sg::Image>   parse_image(const tinygltf::Image &gltf_image) const;
+	ImageTransferInfo            parse_image_transfer_info(tinygltf::Image &gltf_image) const;
+	bool                         prepare_mipmaps(ImageTransferInfo &img_tinfo) const;
 	std::unique_ptr<sg::Sampler> parse_sampler(const tinygltf::Sampler &gltf_sampler) const;
 	std::unique_ptr<sg::Texture> parse_texture(const tinygltf::Texture &gltf_texture) const;
 	std::unique_ptr<sg::SubMesh> parse_submesh_as_model(
@@ -90,60 +107,34 @@ class GLTFLoader
 	std::unique_ptr<sg::Sampler>     create_default_sampler() const;
 	std::unique_ptr<sg::Camera>      create_default_camera() const;
 
-	void             batch_upload_images() const;
+	void             batch_upload_images();
+	size_t           record_image_uploads(CommandBuffer &cmd_buf, std::vector<Buffer> &staging_bufs, const std::vector<sg::Image *> &p_images, size_t first, size_t count, size_t byte_budget);
 	void             create_image_resource(sg::Image &image, size_t idx) const;
-	void             append_textures_to_material(tinygltf::ParameterMap &parameter_map, std::vector<sg::Texture *> &p_textures, sg::PBRMaterial *p_material);
-	size_t           get_submesh_vertex_count(const tinygltf::Primitive &submesh) const;
+	void             append_textures_to_material(tinygltf::ParameterMap &parameter_map, const sg::ComponentView<sg::Texture> &p_textures, sg::PBRMaterial *p_material);
 	void             update_parent_mesh_bound(sg::Mesh *p_mesh, const tinygltf::Primitive &gltf_submesh) const;
 	tinygltf::Scene *pick_scene(int scene_idx);
 	void             init_node_hierarchy(tinygltf::Scene *p_gltf_scene, std::vector<std::unique_ptr<sg::Node>> &p_nodes, sg::Node &root);
 	void             init_scene_bound();
 
-	// POD struct that describes how to read p_data.
-	template <typename T>
-	struct DataAccessInfo
-	{
-		const T *p_data;
-		size_t   stride;        // This is stride is not BYTE stride, but T stride.
-	};
-
-	// Get an accessor's data.
-	template <typename T>
-	DataAccessInfo<T> get_attr_data_ptr(const tinygltf::Primitive &submesh, const char *name) const
-	{
-		auto it = submesh.attributes.find(name);
-		if (it == submesh.attributes.end())
-		{
-			return {
-			    .p_data = nullptr,
-			    .stride = 0,
-			};
-		}
-		return get_accessor_data_ptr<T>(it->second);
-	}
-
-	// Read the accessor data as specified by the spec.
-	template <typename T>
-	DataAccessInfo<T> get_accessor_data_ptr(int accessor_id) const
-	{
-		assert(accessor_id < gltf_model_.accessors.size());
-		const tinygltf::Accessor &accessor = gltf_model_.accessors[accessor_id];
-		assert(accessor.bufferView < gltf_model_.bufferViews.size());
-		const tinygltf::BufferView &buffer_view = gltf_model_.bufferViews[accessor.bufferView];
-		assert(buffer_view.buffer < gltf_model_.buffers.size());
-		const tinygltf::Buffer &buffer = gltf_model_.buffers[buffer_view.buffer];
-
-		return {
-		    .p_data = reinterpret_cast<const T *>(&buffer.data[accessor.byteOffset + buffer_view.byteOffset]),
-		    .stride = accessor.ByteStride(buffer_view) / sizeof(T),
-		};
-	}
-
 	const Device                  &device_;
 	sg::Scene                     *p_scene_;
 	tinygltf::Model                gltf_model_;
 	std::string                    model_path_;
 	std::vector<ImageTransferInfo> img_tinfos_;
+	std::vector<bool>              img_blit_mips_;        // The mip chain of img_tinfos_[i] is generated with blits after upload.
+	std::vector<uint64_t>          img_hashes_;           // Content hashes, the resource cache keys.
+	std::vector<bool>              img_uploads_;          // False if the image shares a resource that is uploaded already or by an earlier image.
+	std::vector<size_t>            material_indices_;     // glTF material -> material component after merging.
+
+	// A .glb is memory mapped. Its binary chunk is read in place through p_glb_bin_ instead of gltf_model_.buffers[0].
+	fu::MappedFile glb_file_;
+	const uint8_t *p_glb_bin_ = nullptr;
+
+	// Streaming state. When defer_images_ is set, textures point to the default texture until their image is uploaded.
+	bool                                   defer_images_      = false;
+	size_t                                 next_deferred_img_ = 0;
+	std::vector<sg::Image *>               p_deferred_images_;
+	std::vector<std::vector<sg::Texture *>> img_textures_;
 };
 
 }        // namespace W3D
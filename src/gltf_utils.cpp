@@ -0,0 +1,751 @@
+#include "gltf_utils.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <json.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+#include "common/ktx2.hpp"
+#include "common/logging.hpp"
+#include "common/utils.hpp"
+#include "common/vertex_convert.hpp"
+#include "scene_graph/components/submesh.hpp"
+#include "scene_graph/scripts/animation.hpp"
+
+namespace W3D
+{
+
+// Default vertex attributes.
+const glm::vec3 DEFAULT_NORMAL = glm::vec3(0.0f);
+const glm::vec2 DEFAULT_UV     = glm::vec2(0.0f);
+const glm::vec4 DEFAULT_JOINT  = glm::vec4(0.0f);
+const glm::vec4 DEFAULT_WEIGHT = glm::vec4(0.0f);
+const glm::vec4 DEFAULT_COLOR  = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
+// Vertices converted at once by write_submesh_vertices().
+const size_t VERTEX_CHUNK_SIZE = 4096;
+
+// GLB container constants.
+const uint32_t GLB_MAGIC       = 0x46546C67;        // "glTF"
+const uint32_t GLB_VERSION     = 2;
+const uint32_t GLB_CHUNK_JSON  = 0x4E4F534A;
+const uint32_t GLB_CHUNK_BIN   = 0x004E4942;
+const size_t   GLB_HEADER_SIZE = 12;
+const size_t   GLB_CHUNK_SIZE  = 8;
+
+// tinygltf rejects a buffer without data, so buffers[0] gets 4 zero bytes instead of the binary chunk.
+const char *GLB_BIN_PLACEHOLDER_URI = "data:application/octet-stream;base64,AAAAAA==";
+const int   GLB_BIN_PLACEHOLDER_LEN = 4;
+// Images stored in the binary chunk are renamed to this uri. tinygltf then reads them through glb_read_whole_file.
+const char *GLB_IMAGE_URI = "w3d_glb_buffer_view_";
+
+// Helper function for getting the vertex count
+size_t get_submesh_vertex_count(const tinygltf::Model &model, const tinygltf::Primitive &submesh)
+{
+	// GLTF gurantees that a vertex will always have position attribute
+	const tinygltf::Accessor &accessor = model.accessors[submesh.attributes.find("POSITION")->second];
+	return accessor.count;
+}
+
+// Read the vertex attributes of a submesh.
+std::vector<sg::Vertex> read_submesh_vertices(const tinygltf::Model &model, const tinygltf::Primitive &submesh, const uint8_t *p_glb_bin)
+{
+	std::vector<sg::Vertex> vertexs(get_submesh_vertex_count(model, submesh));
+	write_submesh_vertices(model, submesh, vertexs.data(), p_glb_bin);
+	return vertexs;
+}
+
+// Map a tinygltf component type to the converter's.
+ComponentType to_component_type(int component_type)
+{
+	switch (component_type)
+	{
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			return ComponentType::eInt8;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return ComponentType::eUint8;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			return ComponentType::eInt16;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			return ComponentType::eUint16;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+			return ComponentType::eUint32;
+		case TINYGLTF_COMPONENT_TYPE_FLOAT:
+			return ComponentType::eFloat;
+		default:
+			throw std::runtime_error("Unsupported accessor component type.");
+	}
+}
+
+// Read the sparse index of element k.
+uint32_t read_sparse_index(const uint8_t *p_indices, int component_type, size_t k)
+{
+	switch (component_type)
+	{
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return p_indices[k];
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		{
+			uint16_t index;
+			std::memcpy(&index, p_indices + k * sizeof(uint16_t), sizeof(uint16_t));
+			return index;
+		}
+		default:
+		{
+			uint32_t index;
+			std::memcpy(&index, p_indices + k * sizeof(uint32_t), sizeof(uint32_t));
+			return index;
+		}
+	}
+}
+
+AttributeSource get_attribute_source(const tinygltf::Model &model, int accessor_id, const uint8_t *p_glb_bin, std::vector<float> &dense_storage)
+{
+	assert(accessor_id < model.accessors.size());
+	const tinygltf::Accessor &accessor = model.accessors[accessor_id];
+
+	AttributeSource src{
+	    .p_data     = nullptr,
+	    .stride     = 0,
+	    .type       = to_component_type(accessor.componentType),
+	    .components = static_cast<uint32_t>(tinygltf::GetNumComponentsInType(accessor.type)),
+	    .normalized = accessor.normalized,
+	};
+	if (accessor.bufferView >= 0)
+	{
+		const tinygltf::BufferView &buffer_view = model.bufferViews[accessor.bufferView];
+		src.p_data                              = get_buffer_data(model, buffer_view.buffer, p_glb_bin) + buffer_view.byteOffset + accessor.byteOffset;
+		src.stride                              = accessor.ByteStride(buffer_view);
+	}
+	if (!accessor.sparse.isSparse && src.p_data)
+	{
+		return src;
+	}
+
+	// Densify. Elements without a buffer view are zero, then the sparse values replace theirs.
+	uint32_t components = src.components;
+	size_t   dst_stride = components * sizeof(float);
+	dense_storage.assign(accessor.count * components, 0.0f);
+	if (src.p_data)
+	{
+		convert_attribute(src, dense_storage.data(), dst_stride, components, accessor.count);
+	}
+
+	if (accessor.sparse.isSparse)
+	{
+		const tinygltf::BufferView &index_view = model.bufferViews[accessor.sparse.indices.bufferView];
+		const tinygltf::BufferView &value_view = model.bufferViews[accessor.sparse.values.bufferView];
+		const uint8_t              *p_indices  = get_buffer_data(model, index_view.buffer, p_glb_bin) + index_view.byteOffset + accessor.sparse.indices.byteOffset;
+
+		AttributeSource values = src;
+		values.p_data          = get_buffer_data(model, value_view.buffer, p_glb_bin) + value_view.byteOffset + accessor.sparse.values.byteOffset;
+		values.stride          = get_component_size(src.type) * components;
+		for (size_t k = 0; k < static_cast<size_t>(accessor.sparse.count); k++)
+		{
+			uint32_t index = read_sparse_index(p_indices, accessor.sparse.indices.componentType, k);
+			assert(index < accessor.count);
+			AttributeSource value = values;
+			value.p_data += k * values.stride;
+			convert_attribute(value, &dense_storage[index * components], dst_stride, components, 1);
+		}
+	}
+
+	return {
+	    .p_data     = reinterpret_cast<const uint8_t *>(dense_storage.data()),
+	    .stride     = dst_stride,
+	    .type       = ComponentType::eFloat,
+	    .components = components,
+	    .normalized = false,
+	};
+}
+
+// Convert the vertex attributes of a submesh straight into p_vertexs.
+// Vertices are converted in chunks with the bulk converters, one attribute at a time.
+// A chunk is written to p_vertexs once, so that write combined memory sees whole lines.
+void write_submesh_vertices(const tinygltf::Model &model, const tinygltf::Primitive &submesh, sg::Vertex *p_vertexs, const uint8_t *p_glb_bin)
+{
+	struct VertexAttribute
+	{
+		const char  *name;
+		size_t       offset;
+		uint32_t     components;
+		uint32_t     convert_bits;
+		const float *p_default;
+	};
+
+	const VertexAttribute attributes[] = {
+	    {"POSITION", offsetof(sg::Vertex, pos), 3, ATTRIBUTE_CONVERT_FLIP_X, nullptr},
+	    {"NORMAL", offsetof(sg::Vertex, norm), 3, ATTRIBUTE_CONVERT_FLIP_X | ATTRIBUTE_CONVERT_NORMALIZE, glm::value_ptr(DEFAULT_NORMAL)},
+	    {"TEXCOORD_0", offsetof(sg::Vertex, uv), 2, 0, glm::value_ptr(DEFAULT_UV)},
+	    {"JOINTS_0", offsetof(sg::Vertex, joint), 4, 0, glm::value_ptr(DEFAULT_JOINT)},
+	    {"WEIGHTS_0", offsetof(sg::Vertex, weight), 4, 0, glm::value_ptr(DEFAULT_WEIGHT)},
+	    {"COLOR_0", offsetof(sg::Vertex, color), 4, 0, glm::value_ptr(DEFAULT_COLOR)},
+	};
+	const size_t ATTRIBUTE_COUNT = sizeof(attributes) / sizeof(attributes[0]);
+
+	std::optional<AttributeSource> sources[ATTRIBUTE_COUNT];
+	std::vector<float>             dense_storages[ATTRIBUTE_COUNT];
+	for (size_t a = 0; a < ATTRIBUTE_COUNT; a++)
+	{
+		auto it = submesh.attributes.find(attributes[a].name);
+		if (it != submesh.attributes.end())
+		{
+			sources[a] = get_attribute_source(model, it->second, p_glb_bin, dense_storages[a]);
+		}
+	}
+	// Joints and weights only make sense together.
+	const size_t JOINT_ATTRIBUTE  = 3;
+	const size_t WEIGHT_ATTRIBUTE = 4;
+	if (!sources[JOINT_ATTRIBUTE] || !sources[WEIGHT_ATTRIBUTE])
+	{
+		sources[JOINT_ATTRIBUTE].reset();
+		sources[WEIGHT_ATTRIBUTE].reset();
+	}
+
+	size_t                  vertex_count = get_submesh_vertex_count(model, submesh);
+	std::vector<sg::Vertex> chunk(std::min(vertex_count, VERTEX_CHUNK_SIZE));
+	for (size_t first = 0; first < vertex_count; first += chunk.size())
+	{
+		size_t count = std::min(chunk.size(), vertex_count - first);
+		for (size_t a = 0; a < ATTRIBUTE_COUNT; a++)
+		{
+			float *p_dst = reinterpret_cast<float *>(reinterpret_cast<uint8_t *>(chunk.data()) + attributes[a].offset);
+			if (sources[a])
+			{
+				AttributeSource src = *sources[a];
+				src.p_data += first * src.stride;
+				convert_attribute(src, p_dst, sizeof(sg::Vertex), attributes[a].components, count, attributes[a].convert_bits);
+			}
+			else
+			{
+				fill_attribute(attributes[a].p_default, p_dst, sizeof(sg::Vertex), attributes[a].components, count);
+			}
+		}
+		std::memcpy(p_vertexs + first, chunk.data(), count * sizeof(sg::Vertex));
+	}
+}
+
+std::vector<uint32_t> find_image_usages(const tinygltf::Model &model)
+{
+	std::vector<uint32_t> usages(model.images.size(), 0);
+	for (const tinygltf::Material &gltf_material : model.materials)
+	{
+		std::pair<int, uint32_t> slots[] = {
+		    {gltf_material.pbrMetallicRoughness.baseColorTexture.index, IMAGE_USAGE_BASE_COLOR},
+		    {gltf_material.normalTexture.index, IMAGE_USAGE_NORMAL},
+		    {gltf_material.occlusionTexture.index, IMAGE_USAGE_OCCLUSION},
+		    {gltf_material.emissiveTexture.index, IMAGE_USAGE_EMISSIVE},
+		    {gltf_material.pbrMetallicRoughness.metallicRoughnessTexture.index, IMAGE_USAGE_METALLIC_ROUGHNESS},
+		};
+		for (const auto &[texture_idx, usage] : slots)
+		{
+			if (texture_idx < 0 || texture_idx >= static_cast<int>(model.textures.size()))
+			{
+				continue;
+			}
+			int image_idx = model.textures[texture_idx].source;
+			if (image_idx >= 0 && image_idx < static_cast<int>(usages.size()))
+			{
+				usages[image_idx] |= usage;
+			}
+		}
+	}
+	return usages;
+}
+
+std::vector<bool> find_srgb_images(const tinygltf::Model &model)
+{
+	std::vector<uint32_t> usages = find_image_usages(model);
+	std::vector<bool>     is_srgb_image(usages.size(), false);
+	for (size_t i = 0; i < usages.size(); i++)
+	{
+		is_srgb_image[i] = usages[i] & (IMAGE_USAGE_BASE_COLOR | IMAGE_USAGE_EMISSIVE);
+	}
+	return is_srgb_image;
+}
+
+bool load_image_data(tinygltf::Image *p_image, const int image_idx, std::string *p_err, std::string *p_warn, int req_width, int req_height, const unsigned char *p_bytes, int size, void *p_user_data)
+{
+	if (!is_ktx2(p_bytes, size))
+	{
+		return tinygltf::LoadImageData(p_image, image_idx, p_err, p_warn, req_width, req_height, p_bytes, size, p_user_data);
+	}
+
+	// The container is parsed by read_ktx2() when the image is used. Only the extent is read here.
+	uint32_t width;
+	uint32_t height;
+	if (!read_ktx2_extent(p_bytes, size, &width, &height))
+	{
+		if (p_err)
+		{
+			*p_err += "Truncated KTX2 image.\n";
+		}
+		return false;
+	}
+	p_image->width     = static_cast<int>(width);
+	p_image->height    = static_cast<int>(height);
+	p_image->component = 0;
+	p_image->bits      = 0;
+	p_image->mimeType  = "image/ktx2";
+	p_image->image.assign(p_bytes, p_bytes + size);
+	return true;
+}
+
+// Read the indices of a submesh. W3D always draws with u32 indices.
+std::vector<uint8_t> read_submesh_indices(const tinygltf::Model &model, const tinygltf::Primitive &submesh, const uint8_t *p_glb_bin)
+{
+	if (submesh.indices < 0)
+	{
+		return {};
+	}
+
+	std::vector<uint8_t> indexs(get_submesh_index_count(model, submesh) * sizeof(uint32_t));
+	write_submesh_indices(model, submesh, reinterpret_cast<uint32_t *>(indexs.data()), p_glb_bin);
+	return indexs;
+}
+
+size_t get_submesh_index_count(const tinygltf::Model &model, const tinygltf::Primitive &submesh)
+{
+	return submesh.indices < 0 ? 0 : model.accessors[submesh.indices].count;
+}
+
+// Widen the indices of a submesh straight into p_indexs.
+void write_submesh_indices(const tinygltf::Model &model, const tinygltf::Primitive &submesh, uint32_t *p_indexs, const uint8_t *p_glb_bin)
+{
+	size_t                  index_count = get_submesh_index_count(model, submesh);
+	DataAccessInfo<uint8_t> indexs      = get_accessor_data_ptr<uint8_t>(model, submesh.indices, p_glb_bin);
+
+	switch (get_attr_format(model, submesh.indices))
+	{
+		case vk::Format::eR32Uint:
+			for (size_t i = 0; i < index_count; i++)
+			{
+				std::memcpy(&p_indexs[i], &indexs.p_data[i * indexs.stride], sizeof(uint32_t));
+			}
+			break;
+		case vk::Format::eR16Uint:
+			for (size_t i = 0; i < index_count; i++)
+			{
+				uint16_t index;
+				std::memcpy(&index, &indexs.p_data[i * indexs.stride], sizeof(uint16_t));
+				p_indexs[i] = index;
+			}
+			break;
+		case vk::Format::eR8Uint:
+			for (size_t i = 0; i < index_count; i++)
+			{
+				p_indexs[i] = indexs.p_data[i * indexs.stride];
+			}
+			break;
+		default:
+			// unreachable;
+			break;
+	}
+}
+
+vk::Filter to_vk_min_filter(int min_filter)
+{
+	switch (min_filter)
+	{
+		case TINYGLTF_TEXTURE_FILTER_NEAREST:
+		case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR:
+		case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
+			return vk::Filter::eNearest;
+		case TINYGLTF_TEXTURE_FILTER_LINEAR:
+		case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR:
+		case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
+			return vk::Filter::eLinear;
+		default:
+			return vk::Filter::eLinear;
+	}
+}
+
+vk::Filter to_vk_mag_filter(int mag_filter)
+{
+	switch (mag_filter)
+	{
+		case TINYGLTF_TEXTURE_FILTER_LINEAR:
+			return vk::Filter::eLinear;
+		case TINYGLTF_TEXTURE_FILTER_NEAREST:
+			return vk::Filter::eNearest;
+		default:
+			return vk::Filter::eLinear;
+	}
+}
+
+vk::SamplerMipmapMode to_vk_mipmap_mode(int mipmap_mode)
+{
+	switch (mipmap_mode)
+	{
+		case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR:
+		case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
+			return vk::SamplerMipmapMode::eNearest;
+		case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR:
+		case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
+			return vk::SamplerMipmapMode::eLinear;
+		default:
+			return vk::SamplerMipmapMode::eLinear;
+	}
+}
+
+vk::SamplerAddressMode to_vk_wrap_mode(int wrap_mode)
+{
+	switch (wrap_mode)
+	{
+		case TINYGLTF_TEXTURE_WRAP_REPEAT:
+			return vk::SamplerAddressMode::eRepeat;
+		case TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE:
+			return vk::SamplerAddressMode::eClampToEdge;
+		case TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT:
+			return vk::SamplerAddressMode::eMirroredRepeat;
+		default:
+			return vk::SamplerAddressMode::eRepeat;
+	}
+}
+
+sg::AnimationType to_sg_animation_type(const std::string &interpolation)
+{
+	if (interpolation == "LINEAR")
+	{
+		return sg::AnimationType::eLinear;
+	}
+	else if (interpolation == "STEP")
+	{
+		return sg::AnimationType::eStep;
+	}
+	else if (interpolation == "CUBICSPLINE")
+	{
+		return sg::AnimationType::eCubicSpline;
+	}
+	LOGW("Unkown interpolation value {}.", interpolation);
+	return sg::AnimationType::eLinear;
+}
+
+sg::AnimationTarget to_sg_animation_target(const std::string &target)
+{
+	if (target == "translation")
+	{
+		return sg::AnimationTarget::eTranslation;
+	}
+	else if (target == "rotation")
+	{
+		return sg::AnimationTarget::eRotation;
+	}
+	else if (target == "scale")
+	{
+		return sg::AnimationTarget::eScale;
+	}
+	LOGW("Animation target {} is not supported!", target);
+	return sg::AnimationTarget::eTranslation;
+}
+
+void to_W3D_vector_in_place(glm::vec3 &vec)
+{
+	vec *= W3D_CONVERSION_SCALE;
+}
+
+void to_W3D_quaternion_in_place(glm::quat &quat)
+{
+	// We need to flip the handiness
+	float     flip_scale        = -1;
+	glm::vec3 new_axis_rotation = flip_scale * glm::vec3(quat.x, quat.y, quat.z) * W3D_CONVERSION_SCALE;
+	quat.x                      = new_axis_rotation.x;
+	quat.y                      = new_axis_rotation.y;
+	quat.z                      = new_axis_rotation.z;
+}
+
+void to_W3D_matrix_in_place(glm::mat4 &M)
+{
+	glm::mat4 convert = glm::scale(glm::mat4(1.0f), W3D_CONVERSION_SCALE);
+	M                 = convert * M * convert;
+}
+
+vk::Format get_attr_format(const tinygltf::Model &model, uint32_t accessor_id)
+{
+	assert(accessor_id < model.accessors.size());
+	auto &accessor = model.accessors[accessor_id];
+
+	vk::Format format;
+
+	switch (accessor.componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+		{
+			static const std::map<int, vk::Format> mapped_format = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR8Sint},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR8G8Sint},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR8G8B8Sint},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR8G8B8A8Sint}};
+
+			format = mapped_format.at(accessor.type);
+
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		{
+			static const std::map<int, vk::Format> mapped_format = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR8Uint},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR8G8Uint},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR8G8B8Uint},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR8G8B8A8Uint}};
+
+			static const std::map<int, vk::Format> mapped_format_normalize = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR8Unorm},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR8G8Unorm},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR8G8B8Unorm},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR8G8B8A8Unorm}};
+
+			if (accessor.normalized)
+			{
+				format = mapped_format_normalize.at(accessor.type);
+			}
+			else
+			{
+				format = mapped_format.at(accessor.type);
+			}
+
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+		{
+			static const std::map<int, vk::Format> mapped_format = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR16Sint},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR16G16Sint},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR16G16B16Sint},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR16G16B16A16Sint}};
+
+			format = mapped_format.at(accessor.type);
+
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		{
+			static const std::map<int, vk::Format> mapped_format = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR16Uint},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR16G16Uint},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR16G16B16Uint},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR16G16B16A16Uint}};
+
+			static const std::map<int, vk::Format> mapped_format_normalize = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR16Unorm},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR16G16Unorm},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR16G16B16Unorm},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR16G16B16A16Unorm}};
+			if (accessor.normalized)
+			{
+				format = mapped_format_normalize.at(accessor.type);
+			}
+			else
+			{
+				format = mapped_format.at(accessor.type);
+			}
+
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_INT:
+		{
+			static const std::map<int, vk::Format> mapped_format = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR32Sint},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR32G32Sint},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR32G32B32Sint},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR32G32B32A32Sint}};
+
+			format = mapped_format.at(accessor.type);
+
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+		{
+			static const std::map<int, vk::Format> mapped_format = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR32Uint},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR32G32Uint},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR32G32B32Uint},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR32G32B32A32Uint}};
+			format = mapped_format.at(accessor.type);
+
+			break;
+		}
+		case TINYGLTF_COMPONENT_TYPE_FLOAT:
+		{
+			static const std::map<int, vk::Format> mapped_format = {
+			    {TINYGLTF_TYPE_SCALAR, vk::Format::eR32Sfloat},
+			    {TINYGLTF_TYPE_VEC2, vk::Format::eR32G32Sfloat},
+			    {TINYGLTF_TYPE_VEC3, vk::Format::eR32G32B32Sfloat},
+			    {TINYGLTF_TYPE_VEC4, vk::Format::eR32G32B32A32Sfloat}};
+
+			format = mapped_format.at(accessor.type);
+
+			break;
+		}
+		default:
+		{
+			format = vk::Format::eUndefined;
+			break;
+		}
+	}
+
+	return format;
+}
+
+std::vector<uint8_t> get_attr_data(const tinygltf::Model &model, uint32_t accessor_id, const uint8_t *p_glb_bin)
+{
+	assert(accessor_id < model.accessors.size());
+	auto &accessor = model.accessors[accessor_id];
+	assert(accessor.bufferView < model.bufferViews.size());
+	auto          &buffer_view = model.bufferViews[accessor.bufferView];
+	const uint8_t *p_buffer    = get_buffer_data(model, buffer_view.buffer, p_glb_bin);
+
+	size_t stride     = accessor.ByteStride(buffer_view);
+	size_t start_byte = accessor.byteOffset + buffer_view.byteOffset;
+	size_t end_byte   = start_byte + accessor.count * stride;
+
+	return {p_buffer + start_byte, p_buffer + end_byte};
+}
+
+// Where the images of a GLB loaded in place are.
+struct GLBImageSource
+{
+	const uint8_t                         *p_bin;
+	size_t                                 bin_size;
+	std::vector<std::pair<size_t, size_t>> views;        // (byteOffset, byteLength) of every buffer view.
+};
+
+bool glb_file_exists(const std::string &abs_filename, void *p_user_data)
+{
+	return abs_filename.find(GLB_IMAGE_URI) != std::string::npos || tinygltf::FileExists(abs_filename, nullptr);
+}
+
+// Copy an embedded image out of the binary chunk. Anything else is read from disk.
+// * Only the encoded image is copied. tinygltf decodes it right away and drops the copy.
+bool glb_read_whole_file(std::vector<unsigned char> *p_out, std::string *p_err, const std::string &filepath, void *p_user_data)
+{
+	size_t pos = filepath.find(GLB_IMAGE_URI);
+	if (pos == std::string::npos)
+	{
+		return tinygltf::ReadWholeFile(p_out, p_err, filepath, nullptr);
+	}
+
+	const GLBImageSource &source = *static_cast<const GLBImageSource *>(p_user_data);
+	size_t                view   = std::stoul(filepath.substr(pos + std::strlen(GLB_IMAGE_URI)));
+	if (view >= source.views.size() || source.views[view].first + source.views[view].second > source.bin_size)
+	{
+		if (p_err)
+		{
+			(*p_err) += "GLB image buffer view " + std::to_string(view) + " is out of range.\n";
+		}
+		return false;
+	}
+
+	const uint8_t *p_view = source.p_bin + source.views[view].first;
+	p_out->assign(p_view, p_view + source.views[view].second);
+	return true;
+}
+
+// Split the GLB container, patch the JSON so that tinygltf never touches the binary chunk, and parse it.
+bool load_glb_in_place(tinygltf::Model &model, std::string *p_err, std::string *p_warn, const uint8_t *p_data, size_t size, const std::string &base_dir, const uint8_t **pp_glb_bin)
+{
+	auto read_u32 = [p_data](size_t offset) {
+		uint32_t value;
+		std::memcpy(&value, p_data + offset, sizeof(value));
+		return value;
+	};
+
+	if (size < GLB_HEADER_SIZE + GLB_CHUNK_SIZE || read_u32(0) != GLB_MAGIC || read_u32(4) != GLB_VERSION || read_u32(8) > size)
+	{
+		(*p_err) += "Invalid GLB header.\n";
+		return false;
+	}
+
+	size_t json_size = read_u32(GLB_HEADER_SIZE);
+	if (read_u32(GLB_HEADER_SIZE + 4) != GLB_CHUNK_JSON || GLB_HEADER_SIZE + GLB_CHUNK_SIZE + json_size > size)
+	{
+		(*p_err) += "Invalid GLB JSON chunk.\n";
+		return false;
+	}
+	const char *p_json = reinterpret_cast<const char *>(p_data + GLB_HEADER_SIZE + GLB_CHUNK_SIZE);
+
+	// The binary chunk is optional. Chunks are 4 bytes aligned.
+	GLBImageSource source{
+	    .p_bin    = nullptr,
+	    .bin_size = 0,
+	};
+	size_t bin_chunk = GLB_HEADER_SIZE + GLB_CHUNK_SIZE + ((json_size + 3) & ~size_t(3));
+	if (bin_chunk + GLB_CHUNK_SIZE <= size && read_u32(bin_chunk + 4) == GLB_CHUNK_BIN)
+	{
+		source.p_bin    = p_data + bin_chunk + GLB_CHUNK_SIZE;
+		source.bin_size = read_u32(bin_chunk);
+		if (bin_chunk + GLB_CHUNK_SIZE + source.bin_size > size)
+		{
+			(*p_err) += "Invalid GLB BIN chunk.\n";
+			return false;
+		}
+	}
+
+	nlohmann::json json = nlohmann::json::parse(p_json, p_json + json_size, nullptr, false);
+	if (json.is_discarded())
+	{
+		(*p_err) += "Invalid GLB JSON chunk.\n";
+		return false;
+	}
+
+	// buffers[0] without uri is the binary chunk.
+	bool has_glb_bin = source.p_bin && json.contains("buffers") && !json["buffers"].empty() && !json["buffers"][0].contains("uri");
+	if (has_glb_bin)
+	{
+		nlohmann::json &buffer = json["buffers"][0];
+		if (buffer.value("byteLength", size_t(0)) > source.bin_size)
+		{
+			(*p_err) += "GLB buffer is larger than the BIN chunk.\n";
+			return false;
+		}
+		buffer["uri"]        = GLB_BIN_PLACEHOLDER_URI;
+		buffer["byteLength"] = GLB_BIN_PLACEHOLDER_LEN;
+	}
+
+	if (has_glb_bin && json.contains("bufferViews") && json.contains("images"))
+	{
+		const nlohmann::json &buffer_views = json["bufferViews"];
+		for (const nlohmann::json &buffer_view : buffer_views)
+		{
+			source.views.emplace_back(buffer_view.value("byteOffset", size_t(0)), buffer_view.value("byteLength", size_t(0)));
+		}
+
+		for (nlohmann::json &image : json["images"])
+		{
+			if (!image.contains("bufferView"))
+			{
+				continue;
+			}
+			size_t view = image["bufferView"].get<size_t>();
+			if (view < buffer_views.size() && buffer_views[view].value("buffer", -1) == 0)
+			{
+				image["uri"] = GLB_IMAGE_URI + std::to_string(view);
+				image.erase("bufferView");
+				image.erase("mimeType");
+			}
+		}
+	}
+
+	std::string patched_json = json.dump();
+	json                     = nlohmann::json();
+
+	tinygltf::FsCallbacks fs_callbacks{};
+	fs_callbacks.FileExists     = &glb_file_exists;
+	fs_callbacks.ExpandFilePath = &tinygltf::ExpandFilePath;
+	fs_callbacks.ReadWholeFile  = &glb_read_whole_file;
+	fs_callbacks.WriteWholeFile = &tinygltf::WriteWholeFile;
+	fs_callbacks.user_data      = &source;
+
+	tinygltf::TinyGLTF gltf_loader;
+	gltf_loader.SetFsCallbacks(fs_callbacks);
+	gltf_loader.SetImageLoader(&load_image_data, nullptr);
+	bool load_result = gltf_loader.LoadASCIIFromString(&model, p_err, p_warn, patched_json.c_str(), to_u32(patched_json.size()), base_dir);
+
+	*pp_glb_bin = has_glb_bin ? source.p_bin : nullptr;
+	return load_result;
+}
+
+}        // namespace W3D
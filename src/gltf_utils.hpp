@@ -0,0 +1,126 @@
+#pragma once
+
+#include <tiny_gltf.h>
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "common/glm_common.hpp"
+#include "common/vk_common.hpp"
+
+namespace W3D
+{
+namespace sg
+{
+struct Vertex;
+enum class AnimationType;
+enum class AnimationTarget;
+}        // namespace sg
+
+// glTF helpers that don't touch the device.
+// They are shared by GLTFLoader and the offline cooker.
+
+// This conversion scale is needed because gltf is right-handed but W3D is left handed.
+inline const glm::vec3 W3D_CONVERSION_SCALE = glm::vec3(-1, 1, 1);
+
+// Type conversions helper functions.
+// They convert tinygltf constants to our types.
+vk::Filter             to_vk_min_filter(int min_filter);
+vk::Filter             to_vk_mag_filter(int mag_filter);
+vk::SamplerMipmapMode  to_vk_mipmap_mode(int mipmap_mode);
+vk::SamplerAddressMode to_vk_wrap_mode(int wrap_mode);
+sg::AnimationType      to_sg_animation_type(const std::string &interpolation);
+sg::AnimationTarget    to_sg_animation_target(const std::string &target);
+void                   to_W3D_vector_in_place(glm::vec3 &vec);
+void                   to_W3D_quaternion_in_place(glm::quat &quat);
+void                   to_W3D_matrix_in_place(glm::mat4 &M);
+vk::Format             get_attr_format(const tinygltf::Model &model, uint32_t accessor_id);
+std::vector<uint8_t>   get_attr_data(const tinygltf::Model &model, uint32_t accessor_id, const uint8_t *p_glb_bin = nullptr);
+
+// Material slots that sample an image. An image can be used by several slots.
+enum ImageUsageBits : uint32_t
+{
+	IMAGE_USAGE_BASE_COLOR         = 1 << 0,
+	IMAGE_USAGE_NORMAL             = 1 << 1,
+	IMAGE_USAGE_OCCLUSION          = 1 << 2,
+	IMAGE_USAGE_EMISSIVE           = 1 << 3,
+	IMAGE_USAGE_METALLIC_ROUGHNESS = 1 << 4,
+};
+
+// Find the usage bits of every image.
+std::vector<uint32_t> find_image_usages(const tinygltf::Model &model);
+// Find the images that hold color data (base color and emissive textures). They are stored as sRGB.
+std::vector<bool> find_srgb_images(const tinygltf::Model &model);
+
+// tinygltf image loader. KTX2 files are kept as they are and tagged with the image/ktx2 mime type, everything else is decoded by tinygltf.
+bool load_image_data(tinygltf::Image *p_image, const int image_idx, std::string *p_err, std::string *p_warn, int req_width, int req_height, const unsigned char *p_bytes, int size, void *p_user_data);
+
+// Read a submesh's vertices and convert them to W3D's vertex layout and handedness.
+// The write_* variants convert straight into p_vertexs, e.g. a mapped staging buffer. It must hold the vertex count.
+size_t                  get_submesh_vertex_count(const tinygltf::Model &model, const tinygltf::Primitive &submesh);
+std::vector<sg::Vertex> read_submesh_vertices(const tinygltf::Model &model, const tinygltf::Primitive &submesh, const uint8_t *p_glb_bin = nullptr);
+void                    write_submesh_vertices(const tinygltf::Model &model, const tinygltf::Primitive &submesh, sg::Vertex *p_vertexs, const uint8_t *p_glb_bin = nullptr);
+// Read a submesh's indices widened to u32. Return an empty vector if the submesh is not indexed.
+// write_submesh_indices() widens straight into p_indexs. It must hold the index count.
+std::vector<uint8_t> read_submesh_indices(const tinygltf::Model &model, const tinygltf::Primitive &submesh, const uint8_t *p_glb_bin = nullptr);
+size_t               get_submesh_index_count(const tinygltf::Model &model, const tinygltf::Primitive &submesh);
+void                 write_submesh_indices(const tinygltf::Model &model, const tinygltf::Primitive &submesh, uint32_t *p_indexs, const uint8_t *p_glb_bin = nullptr);
+
+// Load a .glb without copying its binary chunk.
+// tinygltf only sees the JSON chunk. buffers[0] is left empty and *pp_glb_bin points to the binary chunk in p_data instead.
+// Every accessor helper takes that pointer as p_glb_bin. p_data must outlive all reads.
+bool load_glb_in_place(tinygltf::Model &model, std::string *p_err, std::string *p_warn, const uint8_t *p_data, size_t size, const std::string &base_dir, const uint8_t **pp_glb_bin);
+
+// Get the bytes of a buffer. The binary chunk of a GLB loaded in place overrides buffers[0].
+inline const uint8_t *get_buffer_data(const tinygltf::Model &model, int buffer_id, const uint8_t *p_glb_bin)
+{
+	if (buffer_id == 0 && p_glb_bin)
+	{
+		return p_glb_bin;
+	}
+	assert(buffer_id < model.buffers.size());
+	return model.buffers[buffer_id].data.data();
+}
+
+// POD struct that describes how to read p_data.
+template <typename T>
+struct DataAccessInfo
+{
+	const T *p_data;
+	size_t   stride;        // This is stride is not BYTE stride, but T stride.
+};
+
+// Read the accessor data as specified by the spec.
+// * The pointer points into the buffer. Nothing is copied.
+template <typename T>
+DataAccessInfo<T> get_accessor_data_ptr(const tinygltf::Model &model, int accessor_id, const uint8_t *p_glb_bin = nullptr)
+{
+	assert(accessor_id < model.accessors.size());
+	const tinygltf::Accessor &accessor = model.accessors[accessor_id];
+	assert(accessor.bufferView < model.bufferViews.size());
+	const tinygltf::BufferView &buffer_view = model.bufferViews[accessor.bufferView];
+	const uint8_t              *p_buffer    = get_buffer_data(model, buffer_view.buffer, p_glb_bin);
+
+	return {
+	    .p_data = reinterpret_cast<const T *>(p_buffer + accessor.byteOffset + buffer_view.byteOffset),
+	    .stride = accessor.ByteStride(buffer_view) / sizeof(T),
+	};
+}
+
+// Get an accessor's data.
+template <typename T>
+DataAccessInfo<T> get_attr_data_ptr(const tinygltf::Model &model, const tinygltf::Primitive &submesh, const char *name, const uint8_t *p_glb_bin = nullptr)
+{
+	auto it = submesh.attributes.find(name);
+	if (it == submesh.attributes.end())
+	{
+		return {
+		    .p_data = nullptr,
+		    .stride = 0,
+		};
+	}
+	return get_accessor_data_ptr<T>(model, it->second, p_glb_bin);
+}
+
+}        // namespace W3D
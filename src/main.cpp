@@ -2,14 +2,59 @@
 
 #include <exception>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 #include "core/renderer.hpp"
 
-int main()
+// Usage: Wolfie3D [scene] [--crowd <node name> <instance count>]
+// The scene is a .gltf, .glb or cooked .w3dpack file under the model directory, e.g. 2.0/Fox/glTF/Fox.gltf.
+// It's loaded in the background while the default scene is shown.
+// --crowd spawns copies of a skinned node of the scene, e.g. --crowd fox 256.
+int main(int argc, char **argv)
 {
+	std::string scene_name;
+	std::string crowd_node_name;
+	uint32_t    crowd_instance_count = 0;
+	try
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (arg == "--crowd")
+			{
+				if (i + 2 >= argc)
+				{
+					throw std::runtime_error("--crowd expects a node name and an instance count");
+				}
+				crowd_node_name      = argv[i + 1];
+				crowd_instance_count = static_cast<uint32_t>(std::stoul(argv[i + 2]));
+				i += 2;
+			}
+			else
+			{
+				scene_name = arg;
+			}
+		}
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "Bad arguments: " << e.what() << std::endl;
+		std::cerr << "Usage: Wolfie3D [scene] [--crowd <node name> <instance count>]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
 	W3D::Renderer renderer;
 	try
 	{
+		if (!scene_name.empty())
+		{
+			renderer.load_scene_async(scene_name);
+		}
+		if (!crowd_node_name.empty())
+		{
+			renderer.spawn_crowd(crowd_node_name, crowd_instance_count);
+		}
 		renderer.start();
 	}
 	catch (const std::exception &e)
@@ -19,4 +64,4 @@ int main()
 	}
 
 	return EXIT_SUCCESS;
-};
\ No newline at end of file
+};
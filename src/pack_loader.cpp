@@ -0,0 +1,519 @@
+#include "pack_loader.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "asset_pack.hpp"
+#include "common/file_utils.hpp"
+#include "common/logging.hpp"
+#include "common/utils.hpp"
+#include "core/command_buffer.hpp"
+#include "core/device.hpp"
+#include "core/device_memory/buffer.hpp"
+#include "core/image_resource.hpp"
+#include "core/image_view.hpp"
+#include "core/physical_device.hpp"
+#include "core/resource_cache.hpp"
+#include "core/upload_batch.hpp"
+#include "texture_streamer.hpp"
+
+#include "scene_graph/components/aabb.hpp"
+#include "scene_graph/components/image.hpp"
+#include "scene_graph/components/mesh.hpp"
+#include "scene_graph/components/pbr_material.hpp"
+#include "scene_graph/components/perspective_camera.hpp"
+#include "scene_graph/components/sampler.hpp"
+#include "scene_graph/components/skin.hpp"
+#include "scene_graph/components/submesh.hpp"
+#include "scene_graph/components/texture.hpp"
+#include "scene_graph/node.hpp"
+#include "scene_graph/scene.hpp"
+#include "scene_graph/scripts/animation.hpp"
+#include "scene_graph/scripts/animator.hpp"
+
+namespace W3D
+{
+
+PackLoader::PackLoader(Device const &device) :
+    device_(device)
+{
+}
+
+PackLoader::~PackLoader()
+{
+}
+
+// Map the pack and build the scene.
+std::unique_ptr<sg::Scene> PackLoader::read_scene_from_file(const std::string &file_name, TextureStreamer *p_texture_streamer)
+{
+	read_file(file_name);
+	return create_scene(p_texture_streamer);
+}
+
+// Map the pack and validate its layout. Nothing touches the device, so this may run on a worker thread.
+void PackLoader::read_file(const std::string &file_name)
+{
+	p_reader_ = std::make_shared<pack::Reader>(fu::compute_abs_path(fu::FileType::eModelAsset, file_name));
+}
+
+// Build the scene out of the mapped pack.
+// Given a texture streamer, the images are handed to it and the mapping stays alive as their level source.
+std::unique_ptr<sg::Scene> PackLoader::create_scene(TextureStreamer *p_texture_streamer)
+{
+	p_texture_streamer_ = p_texture_streamer;
+
+	std::unique_ptr<sg::Scene> p_scene = std::make_unique<sg::Scene>(p_reader_->get_scene_name());
+	p_scene_                           = p_scene.get();
+
+	// Same order as GLTFLoader. A component is loaded after every component it points to.
+	device_.get_resource_cache().release_expired();
+	UploadBatch batch(device_);
+	load_samplers();
+	load_images(batch);
+	load_textures();
+	load_materials();
+	load_meshs(batch);
+	batch.flush();
+	load_skins();
+	load_cameras();
+	load_nodes();
+	load_animations();
+	p_scene_->init_transform_hierarchy();
+	init_scene_bound();
+
+	// Release the mapping. The streamer keeps it if it reads levels out of it.
+	if (p_texture_streamer_)
+	{
+		p_texture_streamer_->hold_source(p_reader_);
+	}
+	p_reader_.reset();
+
+	device_.get_resource_cache().log_stats();
+	return p_scene;
+}
+
+// Load sg::Sampler.
+void PackLoader::load_samplers()
+{
+	const pack::Sampler *p_records = p_reader_->get_records<pack::Sampler>();
+	float                max_anisotropy =
+	    device_.get_physical_device().get_handle().getProperties().limits.maxSamplerAnisotropy;
+
+	for (uint32_t i = 0; i < p_reader_->get_count<pack::Sampler>(); i++)
+	{
+		const pack::Sampler  &record = p_records[i];
+		vk::SamplerCreateInfo sampler_cinfo{
+		    .magFilter     = static_cast<vk::Filter>(record.mag_filter),
+		    .minFilter     = static_cast<vk::Filter>(record.min_filter),
+		    .mipmapMode    = static_cast<vk::SamplerMipmapMode>(record.mipmap_mode),
+		    .addressModeU  = static_cast<vk::SamplerAddressMode>(record.address_mode_u),
+		    .addressModeV  = static_cast<vk::SamplerAddressMode>(record.address_mode_v),
+		    .addressModeW  = static_cast<vk::SamplerAddressMode>(record.address_mode_w),
+		    .maxAnisotropy = max_anisotropy,
+		    .maxLod        = std::numeric_limits<float>::max(),
+		    .borderColor   = vk::BorderColor::eIntOpaqueWhite,
+		};
+		p_scene_->add_component(std::make_unique<sg::Sampler>(device_, p_reader_->get_string(record.name), sampler_cinfo));
+	}
+}
+
+// Create the images and record the copies out of the mapping.
+// With a texture streamer, only the tail of each mip chain is uploaded. The streamer brings the other levels in later.
+// Images that are not streamed are shared through the resource cache.
+void PackLoader::load_images(UploadBatch &batch)
+{
+	const pack::Image *p_records = p_reader_->get_records<pack::Image>();
+	ResourceCache     &cache     = device_.get_resource_cache();
+
+	for (uint32_t i = 0; i < p_reader_->get_count<pack::Image>(); i++)
+	{
+		const pack::Image &record = p_records[i];
+		if (!device_.get_physical_device().is_sampled_image_supported(static_cast<vk::Format>(record.format)))
+		{
+			throw std::runtime_error("Image " + std::string(p_reader_->get_string(record.name)) + " uses a format the device can't sample. Cook the pack with --uncompressed.");
+		}
+
+		ImageMetaInfo meta{
+		    .extent = {
+		        .width  = record.width,
+		        .height = record.height,
+		        .depth  = 1,
+		    },
+		    .format = static_cast<vk::Format>(record.format),
+		    .levels = record.levels,
+		};
+		check_image_size(record, meta);
+		if (p_texture_streamer_ && TextureStreamer::get_tail_level(meta) > 0)
+		{
+			std::unique_ptr<sg::Image> p_image = std::make_unique<sg::Image>(ImageResource(device_, nullptr), p_reader_->get_string(record.name));
+			p_texture_streamer_->add_image(*p_image, meta, p_reader_->get_blob(record.data), batch);
+			p_scene_->add_component(std::move(p_image));
+			continue;
+		}
+
+		uint64_t                       hash       = ResourceCache::hash_image(p_reader_->get_blob(record.data), record.data.size, meta);
+		std::shared_ptr<ImageResource> p_resource = cache.find_image(hash);
+		if (p_resource)
+		{
+			p_scene_->add_component(std::make_unique<sg::Image>(std::move(p_resource), p_reader_->get_string(record.name)));
+			continue;
+		}
+
+		vk::ImageCreateInfo img_cinfo{
+		    .imageType = vk::ImageType::e2D,
+		    .format    = static_cast<vk::Format>(record.format),
+		    .extent    = {
+		           .width  = record.width,
+		           .height = record.height,
+		           .depth  = 1,
+            },
+		    .mipLevels   = record.levels,
+		    .arrayLayers = 1,
+		    .samples     = vk::SampleCountFlagBits::e1,
+		    .tiling      = vk::ImageTiling::eOptimal,
+		    .usage       = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+		    .sharingMode = vk::SharingMode::eExclusive,
+		};
+
+		Image                   vk_image   = device_.get_device_memory_allocator().allocate_device_only_image(img_cinfo);
+		vk::ImageViewCreateInfo view_cinfo = ImageView::two_dim_view_cinfo(vk_image.get_handle(), img_cinfo.format, vk::ImageAspectFlagBits::eColor, img_cinfo.mipLevels);
+		ImageResource           resource(std::move(vk_image), ImageView(device_, view_cinfo));
+
+		Buffer        &staging_buf = batch.stage(p_reader_->get_blob(record.data), record.data.size);
+		CommandBuffer &cmd_buf     = batch.get_cmd_buf();
+		cmd_buf.set_image_layout(resource, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer);
+		cmd_buf.update_image(resource, staging_buf);
+		cmd_buf.set_image_layout(resource, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+
+		std::unique_ptr<sg::Image> p_image = std::make_unique<sg::Image>(std::move(resource), p_reader_->get_string(record.name));
+		cache.add_image(hash, p_image->get_shared_resource(), meta);
+		p_scene_->add_component(std::move(p_image));
+	}
+}
+
+// Load the textures.
+void PackLoader::load_textures()
+{
+	const pack::Texture           *p_records  = p_reader_->get_records<pack::Texture>();
+	sg::ComponentView<sg::Image>   p_images   = p_scene_->get_components<sg::Image>();
+	sg::ComponentView<sg::Sampler> p_samplers = p_scene_->get_components<sg::Sampler>();
+
+	for (uint32_t i = 0; i < p_reader_->get_count<pack::Texture>(); i++)
+	{
+		const pack::Texture &record = p_records[i];
+
+		std::unique_ptr<sg::Texture> p_texture = std::make_unique<sg::Texture>(p_reader_->get_string(record.name));
+		p_texture->p_resource_                 = &p_images[p_reader_->check_index<pack::Image>(record.image)]->get_resource();
+		p_texture->p_sampler_                  = p_samplers[p_reader_->check_index<pack::Sampler>(record.sampler)];
+		p_scene_->add_component(std::move(p_texture));
+	}
+}
+
+// Load the materials.
+void PackLoader::load_materials()
+{
+	const pack::Material          *p_records  = p_reader_->get_records<pack::Material>();
+	sg::ComponentView<sg::Texture> p_textures = p_scene_->get_components<sg::Texture>();
+
+	for (uint32_t i = 0; i < p_reader_->get_count<pack::Material>(); i++)
+	{
+		const pack::Material            &record     = p_records[i];
+		std::unique_ptr<sg::PBRMaterial> p_material = std::make_unique<sg::PBRMaterial>(p_reader_->get_string(record.name));
+
+		p_material->base_color_factor_ = glm::make_vec4(record.base_color_factor);
+		p_material->metallic_factor_   = record.metallic_factor;
+		p_material->roughness_factor_  = record.roughness_factor;
+		p_material->emissive_          = glm::make_vec3(record.emissive);
+		p_material->alpha_mode_        = static_cast<sg::AlphaMode>(record.alpha_mode);
+		p_material->alpha_cutoff_      = record.alpha_cutoff;
+		p_material->is_double_sided    = record.double_sided;
+		p_material->flag_              = static_cast<sg::PBRMaterialFlagBits>(record.flag);
+
+		for (uint32_t slot = 0; slot < pack::TEXTURE_SLOT_COUNT; slot++)
+		{
+			if (record.textures[slot] != pack::NONE)
+			{
+				p_material->texture_map_[pack::TEXTURE_SLOT_NAMES[slot]] = p_textures[p_reader_->check_index<pack::Texture>(record.textures[slot])];
+			}
+		}
+		p_scene_->add_component(std::move(p_material));
+	}
+}
+
+// Load all meshes. Vertex and index blobs are already in their GPU layout.
+void PackLoader::load_meshs(UploadBatch &batch)
+{
+	const pack::Mesh                  *p_mesh_records    = p_reader_->get_records<pack::Mesh>();
+	const pack::SubMesh               *p_submesh_records = p_reader_->get_records<pack::SubMesh>();
+	sg::ComponentView<sg::PBRMaterial> p_materials       = p_scene_->get_components<sg::PBRMaterial>();
+	const DeviceMemoryAllocator       &allocator         = device_.get_device_memory_allocator();
+
+	for (uint32_t i = 0; i < p_reader_->get_count<pack::Mesh>(); i++)
+	{
+		const pack::Mesh         &mesh_record = p_mesh_records[i];
+		std::unique_ptr<sg::Mesh> p_mesh      = std::make_unique<sg::Mesh>(p_reader_->get_string(mesh_record.name));
+		p_mesh->get_mut_bounds().update(glm::make_vec3(mesh_record.bound_min), glm::make_vec3(mesh_record.bound_max));
+		p_reader_->check_range<pack::SubMesh>(mesh_record.first_submesh, mesh_record.submesh_count);
+
+		for (uint32_t j = 0; j < mesh_record.submesh_count; j++)
+		{
+			const pack::SubMesh         &record    = p_submesh_records[mesh_record.first_submesh + j];
+			std::unique_ptr<sg::SubMesh> p_submesh = std::make_unique<sg::SubMesh>();
+			p_submesh->vertex_count_               = record.vertex_count;
+			p_submesh->idx_count_                  = record.index_count;
+
+			const sg::Material &material   = *p_materials[p_reader_->check_index<pack::Material>(record.material)];
+			const sg::Vertex   *p_vertices = p_reader_->get_blob<sg::Vertex>(record.vertices, record.vertex_count);
+
+			Buffer  vertex_buf         = allocator.allocate_vertex_buffer(record.vertices.size);
+			Buffer &vertex_staging_buf = batch.stage(p_vertices, record.vertices.size);
+			batch.get_cmd_buf().copy_buffer(vertex_staging_buf, vertex_buf, record.vertices.size);
+			p_submesh->p_vertex_buf_ = std::make_unique<Buffer>(std::move(vertex_buf));
+
+			if (record.index_count)
+			{
+				const uint32_t *p_indices = p_reader_->get_blob<uint32_t>(record.indices, record.index_count);
+
+				Buffer  idx_buf         = allocator.allocate_index_buffer(record.indices.size);
+				Buffer &idx_staging_buf = batch.stage(p_indices, record.indices.size);
+				batch.get_cmd_buf().copy_buffer(idx_staging_buf, idx_buf, record.indices.size);
+				p_submesh->p_idx_buf_ = std::make_unique<Buffer>(std::move(idx_buf));
+			}
+
+			p_submesh->set_material(material);
+			p_mesh->add_submesh(*p_submesh);
+			p_scene_->add_component(std::move(p_submesh));
+		}
+
+		p_scene_->add_component(std::move(p_mesh));
+	}
+}
+
+// Load the skins.
+void PackLoader::load_skins()
+{
+	const pack::Skin *p_records = p_reader_->get_records<pack::Skin>();
+
+	for (uint32_t i = 0; i < p_reader_->get_count<pack::Skin>(); i++)
+	{
+		const pack::Skin         &record   = p_records[i];
+		std::unique_ptr<sg::Skin> p_skin   = std::make_unique<sg::Skin>(p_reader_->get_string(record.name));
+		const uint32_t           *p_joints = p_reader_->get_blob<uint32_t>(record.joints, record.joint_count);
+		const float              *p_IBMs   = p_reader_->get_blob<float>(record.IBMs, record.joint_count * 16ull);
+
+		p_skin->reserve_joints(record.joint_count);
+		for (uint32_t joint_id = 0; joint_id < record.joint_count; joint_id++)
+		{
+			p_skin->add_joint(p_reader_->check_index<pack::Node>(p_joints[joint_id]), glm::make_mat4(&p_IBMs[joint_id * 16]));
+		}
+		p_scene_->add_component(std::move(p_skin));
+	}
+}
+
+// Load the cameras.
+void PackLoader::load_cameras()
+{
+	const pack::Camera *p_records = p_reader_->get_records<pack::Camera>();
+
+	for (uint32_t i = 0; i < p_reader_->get_count<pack::Camera>(); i++)
+	{
+		const pack::Camera                   &record   = p_records[i];
+		std::unique_ptr<sg::PerspectiveCamera> p_camera = std::make_unique<sg::PerspectiveCamera>(p_reader_->get_string(record.name));
+		p_camera->set_aspect_ratio(record.aspect_ratio);
+		p_camera->set_field_of_view(record.yfov);
+		p_camera->set_near_plane(record.znear);
+		p_camera->set_far_plane(record.zfar);
+		p_scene_->add_component(std::move(p_camera));
+	}
+}
+
+// Load all nodes.
+// Parents are stored before their children, so the hierarchy is built in a single pass.
+void PackLoader::load_nodes()
+{
+	const pack::Node             *p_records = p_reader_->get_records<pack::Node>();
+	sg::ComponentView<sg::Mesh>   p_meshs   = p_scene_->get_components<sg::Mesh>();
+	sg::ComponentView<sg::Camera> p_cameras = p_scene_->get_components<sg::Camera>();
+	sg::ComponentView<sg::Skin>   p_skins   = p_scene_->get_components<sg::Skin>();
+
+	uint32_t                               node_count = p_reader_->get_count<pack::Node>();
+	std::vector<std::unique_ptr<sg::Node>> p_nodes;
+	p_nodes.reserve(node_count + 1);
+	std::unique_ptr<sg::Node> root = std::make_unique<sg::Node>(0, p_reader_->get_scene_name());
+
+	for (uint32_t i = 0; i < node_count; i++)
+	{
+		const pack::Node         &record = p_records[i];
+		std::unique_ptr<sg::Node> p_node = std::make_unique<sg::Node>(i, p_reader_->get_string(record.name));
+
+		sg::Transform &transform = p_node->get_transform();
+		transform.set_tranlsation(glm::make_vec3(record.translation));
+		transform.set_rotation(glm::quat::wxyz(record.rotation[3], record.rotation[0], record.rotation[1], record.rotation[2]));
+		transform.set_scale(glm::make_vec3(record.scale));
+
+		if (record.mesh != pack::NONE)
+		{
+			sg::Mesh *p_mesh = p_meshs[p_reader_->check_index<pack::Mesh>(record.mesh)];
+			p_node->set_component(*p_mesh);
+			p_mesh->add_node(*p_node);
+		}
+
+		if (record.camera != pack::NONE)
+		{
+			sg::Camera *p_camera = p_cameras[p_reader_->check_index<pack::Camera>(record.camera)];
+			p_node->set_component(*p_camera);
+			p_camera->set_node(*p_node);
+		}
+
+		if (record.skin != pack::NONE)
+		{
+			p_node->set_component(*p_skins[p_reader_->check_index<pack::Skin>(record.skin)]);
+		}
+
+		if (record.parent == pack::PARENT_ROOT)
+		{
+			root->add_child(*p_node);
+			p_node->set_parent(*root);
+		}
+		else if (record.parent >= 0)
+		{
+			// Parents come first, so only the nodes before this one are valid.
+			if (static_cast<uint32_t>(record.parent) >= i)
+			{
+				throw std::runtime_error("Pack node " + std::to_string(i) + " has a bad parent.");
+			}
+			sg::Node &parent = *p_nodes[record.parent];
+			parent.add_child(*p_node);
+			p_node->set_parent(parent);
+		}
+		else if (record.parent != pack::PARENT_NONE)
+		{
+			throw std::runtime_error("Pack node " + std::to_string(i) + " has a bad parent.");
+		}
+
+		p_nodes.push_back(std::move(p_node));
+	}
+
+	p_scene_->set_root_node(*root);
+	p_nodes.push_back(std::move(root));
+	p_scene_->set_nodes(std::move(p_nodes));
+}
+
+// Load the animations.
+void PackLoader::load_animations()
+{
+	const pack::Animation                      *p_records         = p_reader_->get_records<pack::Animation>();
+	const pack::Channel                        *p_channel_records = p_reader_->get_records<pack::Channel>();
+	std::vector<sg::Node *>                     p_nodes           = p_scene_->get_nodes();
+	std::vector<std::unique_ptr<sg::Animation>> p_animations;
+	sg::ClipCompressionStats                    compression_stats;
+	p_animations.reserve(p_reader_->get_count<pack::Animation>());
+
+	for (uint32_t i = 0; i < p_reader_->get_count<pack::Animation>(); i++)
+	{
+		const pack::Animation            &record      = p_records[i];
+		std::unique_ptr<sg::Animation>    p_animation = std::make_unique<sg::Animation>(p_reader_->get_string(record.name));
+		std::vector<sg::AnimationChannel> channels;
+		p_reader_->check_range<pack::Channel>(record.first_channel, record.channel_count);
+		channels.reserve(record.channel_count);
+
+		for (uint32_t j = 0; j < record.channel_count; j++)
+		{
+			const pack::Channel &channel_record = p_channel_records[record.first_channel + j];
+			if (channel_record.target > static_cast<uint32_t>(sg::AnimationTarget::eScale) ||
+			    channel_record.interpolation > static_cast<uint32_t>(sg::AnimationType::eCubicSpline))
+			{
+				throw std::runtime_error("Pack channel has an unknown target or interpolation.");
+			}
+			sg::AnimationTarget target = static_cast<sg::AnimationTarget>(channel_record.target);
+			sg::AnimationType   type   = static_cast<sg::AnimationType>(channel_record.interpolation);
+
+			// Cubic spline keys are (in tangent, value, out tangent).
+			uint64_t     key_size     = (target == sg::AnimationTarget::eRotation ? 4 : 3) * (type == sg::AnimationType::eCubicSpline ? 3 : 1);
+			uint64_t     output_count = channel_record.key_count * key_size;
+			const float *p_inputs     = p_reader_->get_blob<float>(channel_record.inputs, channel_record.key_count);
+			const float *p_outputs    = p_reader_->get_blob<float>(channel_record.outputs, output_count);
+
+			sg::AnimationSampler sampler;
+			sampler.type   = type;
+			sampler.inputs = std::vector<float>(p_inputs, p_inputs + channel_record.key_count);
+
+			if (target == sg::AnimationTarget::eRotation)
+			{
+				sampler.init_quats();
+				std::vector<glm::quat> &quats = sampler.get_mut_quats();
+				quats.reserve(output_count / 4);
+				for (size_t k = 0; k + 3 < output_count; k += 4)
+				{
+					quats.push_back(glm::quat::wxyz(p_outputs[k + 3], p_outputs[k + 0], p_outputs[k + 1], p_outputs[k + 2]));
+				}
+			}
+			else
+			{
+				sampler.init_vecs();
+				std::vector<glm::vec3> &vecs = sampler.get_mut_vecs();
+				vecs.reserve(output_count / 3);
+				for (size_t k = 0; k + 2 < output_count; k += 3)
+				{
+					vecs.push_back(glm::make_vec3(&p_outputs[k]));
+				}
+			}
+
+			channels.push_back(sg::AnimationChannel{
+			    .node    = *p_nodes[p_reader_->check_index<pack::Node>(channel_record.node)],
+			    .target  = target,
+			    .sampler = std::move(sampler),
+			});
+		}
+
+		p_animation->set_channels(std::move(channels));
+		p_animation->update_interval();
+		p_animation->compile();
+		compression_stats.add(p_animation->get_compression_stats());
+		p_animations.push_back(std::move(p_animation));
+	}
+	if (!p_animations.empty())
+	{
+		sg::log_clip_compression_stats("Pack animations", compression_stats);
+	}
+	// Stored under sg::Animation like GLTFLoader does. add_component() would file them under sg::Script.
+	p_scene_->set_components(std::move(p_animations));
+	p_scene_->set_components(sg::Animator::create_per_skeleton(p_scene_->get_components<sg::Animation>()));
+}
+
+// Check that an image blob holds exactly its mip chain.
+// The uploads and the texture streamer copy levels out of it by their computed size.
+void PackLoader::check_image_size(const pack::Image &record, const ImageMetaInfo &meta)
+{
+	if (record.width == 0 || record.height == 0 || record.levels == 0 || record.levels > max_mip_levels(record.width, record.height))
+	{
+		throw std::runtime_error("Image " + std::string(p_reader_->get_string(record.name)) + " has a bad extent or level count.");
+	}
+
+	uint64_t chain_size = 0;
+	for (uint32_t level = 0; level < meta.levels; level++)
+	{
+		chain_size += ImageResource::get_level_size(meta.format, meta.extent, level);
+	}
+	if (record.data.size != chain_size)
+	{
+		throw std::runtime_error("Image " + std::string(p_reader_->get_string(record.name)) + " doesn't hold its mip chain.");
+	}
+}
+
+// We calculate the scene's AABB by taking the union of all node's AABB.
+void PackLoader::init_scene_bound()
+{
+	std::vector<sg::Node *> p_nodes  = p_scene_->get_nodes();
+	sg::AABB               &scene_bd = p_scene_->get_bound();
+
+	for (sg::Node *p_node : p_nodes)
+	{
+		if (p_node->has_component<sg::Mesh>())
+		{
+			sg::Mesh &mesh = p_node->get_component<sg::Mesh>();
+			scene_bd.update(mesh.get_mut_bounds().transform(p_node->get_transform().get_world_M()));
+		}
+	}
+}
+
+}        // namespace W3D
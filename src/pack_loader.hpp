@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace W3D
+{
+class Device;
+struct ImageMetaInfo;
+class TextureStreamer;
+class UploadBatch;
+
+namespace pack
+{
+class Reader;
+struct Image;
+}        // namespace pack
+
+namespace sg
+{
+class Scene;
+class Node;
+}        // namespace sg
+
+// Loader class responsible for loading cooked W3D packs. See asset_pack.hpp for the format.
+// The pack is memory mapped and its blobs are copied straight into staging buffers.
+// Nothing is parsed, decoded or converted at load time.
+// Given a texture streamer, the images are handed to it and the mapping stays alive as their level source.
+// read_file() and create_scene() split the load for AsyncSceneLoad. Only read_file() is safe on a worker thread.
+class PackLoader
+{
+  public:
+	PackLoader(Device const &device);
+	~PackLoader();
+
+	std::unique_ptr<sg::Scene> read_scene_from_file(const std::string &file_name, TextureStreamer *p_texture_streamer = nullptr);
+
+	void                       read_file(const std::string &file_name);
+	std::unique_ptr<sg::Scene> create_scene(TextureStreamer *p_texture_streamer = nullptr);
+
+  private:
+	void load_samplers();
+	void load_images(UploadBatch &batch);
+	void load_textures();
+	void load_materials();
+	void load_meshs(UploadBatch &batch);
+	void load_cameras();
+	void load_skins();
+	void load_nodes();
+	void load_animations();
+	void init_scene_bound();
+	void check_image_size(const pack::Image &record, const ImageMetaInfo &meta);
+
+	const Device                 &device_;
+	TextureStreamer              *p_texture_streamer_ = nullptr;
+	std::shared_ptr<pack::Reader> p_reader_;
+	sg::Scene                    *p_scene_ = nullptr;
+};
+
+}        // namespace W3D
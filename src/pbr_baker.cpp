@@ -1,17 +1,26 @@
 #include "pbr_baker.hpp"
 
+#include <cstring>
+
 #include "gltf_loader.hpp"
 
 #include "common/error.hpp"
 
 #include "common/file_utils.hpp"
+#include "common/ibl_reference.hpp"
+#include "common/ktx2.hpp"
+#include "common/logging.hpp"
 #include "core/command_buffer.hpp"
+#include "core/compute_pipeline.hpp"
 #include "core/device.hpp"
+#include "core/device_memory/allocator.hpp"
 #include "core/device_memory/buffer.hpp"
 #include "core/framebuffer.hpp"
 #include "core/graphics_pipeline.hpp"
 #include "core/image_view.hpp"
+#include "core/physical_device.hpp"
 #include "core/render_pass.hpp"
+#include "core/resource_cache.hpp"
 
 #include "scene_graph/components/submesh.hpp"
 
@@ -32,34 +41,145 @@ PBR::PBR(){};
 PBR::~PBR(){};
 
 // Default resolutions for all PBR textures.
-const uint32_t PBRBaker::IRRADIANCE_DIMENSION = 64;
-const uint32_t PBRBaker::PREFILTER_DIMENSION  = 512;
-const uint32_t PBRBaker::BRDF_LUT_DIMENSION   = 512;
-
-const std::vector<glm::mat4> PBRBaker::CUBE_FACE_MATRIXS = {
-    // POSITIVE_X
-    glm::rotate(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
-                glm::radians(180.0f),
-                glm::vec3(1.0f, 0.0f, 0.0f)),
-    // NEGATIVE_X
-    glm::rotate(glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
-                glm::radians(180.0f),
-                glm::vec3(1.0f, 0.0f, 0.0f)),
-    // POSITIVE_Y
-    glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
-    // NEGATIVE_Y
-    glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
-    // POSITIVE_Z
-    glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
-    // NEGATIVE_Z
-    glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
+const uint32_t PBRBaker::IRRADIANCE_DIMENSION    = 64;
+const uint32_t PBRBaker::PREFILTER_DIMENSION     = 512;
+const uint32_t PBRBaker::BRDF_LUT_DIMENSION      = 512;
+const uint32_t PBRBaker::IRRADIANCE_SH_DIMENSION = 64;
+const uint32_t PBRBaker::CACHE_VERSION           = 1;
+const bool     PBRBaker::VALIDATE_BAKE           = false;
+
+const uint32_t BAKE_GROUP_SIZE = 8;        // local_size_x and local_size_y of the bake shaders.
+const char    *BACKGROUND_NAME = "papermill.dds";
+
+// Per coefficient: the basis constant of sh_basis() in sh_project.comp, times the band's factor of the cosine lobe over PI.
+// The factors are 1, 2/3 and 1/4 for bands 0, 1 and 2.
+const std::array<float, 9> SH_IRRADIANCE_FACTORS = {
+    0.282095f,
+    0.488603f * 2.0f / 3.0f,
+    0.488603f * 2.0f / 3.0f,
+    0.488603f * 2.0f / 3.0f,
+    1.092548f / 4.0f,
+    1.092548f / 4.0f,
+    0.315392f / 4.0f,
+    1.092548f / 4.0f,
+    0.546274f / 4.0f,
 };
 
+ImageMetaInfo get_irradiance_meta()
+{
+	return {
+	    .extent = {
+	        .width  = PBRBaker::IRRADIANCE_DIMENSION,
+	        .height = PBRBaker::IRRADIANCE_DIMENSION,
+	        .depth  = 1,
+	    },
+	    .format = vk::Format::eR32G32B32A32Sfloat,
+	    .levels = max_mip_levels(PBRBaker::IRRADIANCE_DIMENSION, PBRBaker::IRRADIANCE_DIMENSION),
+	};
+}
+
+// The grid the environment is projected from. The partial sums are 32 bit floats.
+ImageMetaInfo get_irradiance_sh_meta()
+{
+	return {
+	    .extent = {
+	        .width  = PBRBaker::IRRADIANCE_SH_DIMENSION,
+	        .height = PBRBaker::IRRADIANCE_SH_DIMENSION,
+	        .depth  = 1,
+	    },
+	    .format = vk::Format::eR32G32B32A32Sfloat,
+	    .levels = 1,
+	};
+}
+
+ImageMetaInfo get_prefilter_meta()
+{
+	return {
+	    .extent = {
+	        .width  = PBRBaker::PREFILTER_DIMENSION,
+	        .height = PBRBaker::PREFILTER_DIMENSION,
+	        .depth  = 1,
+	    },
+	    .format = vk::Format::eR16G16B16A16Sfloat,
+	    .levels = max_mip_levels(PBRBaker::PREFILTER_DIMENSION, PBRBaker::PREFILTER_DIMENSION),
+	};
+}
+
+ImageMetaInfo get_brdf_lut_meta()
+{
+	return {
+	    .extent = {
+	        .width  = PBRBaker::BRDF_LUT_DIMENSION,
+	        .height = PBRBaker::BRDF_LUT_DIMENSION,
+	        .depth  = 1,
+	    },
+	    .format = vk::Format::eR16G16Sfloat,
+	    .levels = 1,
+	};
+}
+
+uint32_t get_group_count(uint32_t dimension)
+{
+	return (dimension + BAKE_GROUP_SIZE - 1) / BAKE_GROUP_SIZE;
+}
+
+// Size of every level of every face, tightly packed. The layout of a KTX2Image binary.
+size_t get_mip_chain_size(const ImageMetaInfo &meta, uint32_t faces)
+{
+	size_t size = 0;
+	for (uint32_t m = 0; m < meta.levels; m++)
+	{
+		size += ImageResource::get_level_size(meta.format, meta.extent, m) * faces;
+	}
+	return size;
+}
+
+// Hash everything a bake depends on. The sample counts are compiled into the shaders.
+uint64_t compute_cache_key(const ImageTransferInfo &background, IrradianceMode irradiance_mode, bool is_brdf_lut_computed)
+{
+	struct MapSource
+	{
+		ImageMetaInfo             meta;
+		std::vector<const char *> shader_names;
+	};
+	const MapSource sources[] = {
+	    irradiance_mode == IrradianceMode::eSphericalHarmonics ? MapSource{get_irradiance_sh_meta(), {"sh_project.comp.spv"}} : MapSource{get_irradiance_meta(), {"irradiance.comp.spv"}},
+	    {get_prefilter_meta(), {"prefilter.comp.spv"}},
+	    {get_brdf_lut_meta(), is_brdf_lut_computed ? std::vector<const char *>{"brdf_lut.comp.spv"} : std::vector<const char *>{"brdf_lut.vert.spv", "brdf_lut.frag.spv"}},
+	};
+
+	uint64_t key = ResourceCache::hash_image(background.binary.data(), background.binary.size(), background.meta);
+
+	auto combine = [&key](uint64_t value) {
+		key ^= value + 0x9e3779b97f4a7c15ull + (key << 6) + (key >> 2);
+	};
+	combine(PBRBaker::CACHE_VERSION);
+	for (const MapSource &source : sources)
+	{
+		for (const char *shader_name : source.shader_names)
+		{
+			std::vector<uint8_t> binary = fu::read_shader_binary(shader_name);
+			combine(ResourceCache::hash_image(binary.data(), binary.size(), source.meta));
+		}
+	}
+	return key;
+}
+
+void log_bake_error(const char *map_name, const KTX2Image &map, const KTX2Image &reference)
+{
+	IBLMapError error = compare_ibl_maps(map, reference);
+	LOGI("The {} map is off the CPU reference by {:.5f} at most and {:.6f} on average.", map_name, error.max_error, error.mean_error);
+}
+
 // Create the PBRBaker and init renderdoc (only used for debugging).
-PBRBaker::PBRBaker(Device &device) :
+PBRBaker::PBRBaker(Device &device, IrradianceMode irradiance_mode) :
     device_(device),
+    irradiance_mode_(irradiance_mode),
     desc_state_(device)
 {
+	const PhysicalDevice &physical_device = device_.get_physical_device();
+	is_brdf_lut_computed_                 = physical_device.is_storage_image_supported(vk::Format::eR16G16Sfloat) && physical_device.is_extended_storage_formats_supported();
+
 	if (HMODULE mod = GetModuleHandleA("renderdoc.dll"))
 	{
 		pRENDERDOC_GetAPI RENDERDOC_GetAPI =
@@ -71,16 +191,33 @@ PBRBaker::PBRBaker(Device &device) :
 	load_background();
 }
 
-// Bake all the IBL resources.
+// Bake all the IBL resources, or load them from the cache.
 PBR PBRBaker::bake()
 {
-	prepare_irradiance();
+	if (load_cache())
+	{
+		return std::move(result_);
+	}
+
+	if (irradiance_mode_ == IrradianceMode::eSphericalHarmonics)
+	{
+		prepare_irradiance_sh();
+	}
+	else
+	{
+		prepare_irradiance();
+	}
 	prepare_prefilter();
 	prepare_brdf_lut();
+	if (VALIDATE_BAKE)
+	{
+		validate_bake();
+	}
+	save_cache();
 	return std::move(result_);
 }
 
-// Load a texture cube model. We will render irradiance and prefilter using it.
+// Load a texture cube model. The renderer draws the skybox with it.
 void PBRBaker::load_cube_model()
 {
 	GLTFLoader loader(device_);
@@ -91,9 +228,10 @@ void PBRBaker::load_cube_model()
 // * We hardcoded the HDR cubemap. But it can be replaced with other .dds HDR cubemap.
 void PBRBaker::load_background()
 {
-	std::string       path      = fu::compute_abs_path(fu::FileType::eImage, "papermill.dds");
+	std::string       path      = fu::compute_abs_path(fu::FileType::eImage, BACKGROUND_NAME);
 	ImageTransferInfo img_tinfo = ImageResource::load_cubic_image(path);
 	ImageResource     resource  = ImageResource::create_empty_cubic_img_resrc(device_, img_tinfo.meta);
+	cache_key_                  = compute_cache_key(img_tinfo, irradiance_mode_, is_brdf_lut_computed_);
 
 	CommandBuffer cmd_buf     = device_.begin_one_time_buf();
 	Buffer        staging_buf = device_.get_device_memory_allocator().allocate_staging_buffer(img_tinfo.binary.size());
@@ -113,291 +251,57 @@ void PBRBaker::load_background()
 }
 
 // Create and bake the irradiance texture.
+// The irradiance texture is a convoluted cubemap that allows us to query the irradiance using a direction.
 void PBRBaker::prepare_irradiance()
 {
-	ImageMetaInfo cube_meta{
-	    .extent = {
-	        .width  = IRRADIANCE_DIMENSION,
-	        .height = IRRADIANCE_DIMENSION,
-	        .depth  = 1,
-	    },
-	    .format = vk::Format::eR32G32B32A32Sfloat,
-	    .levels = max_mip_levels(IRRADIANCE_DIMENSION, IRRADIANCE_DIMENSION),
-	};
+	ImageMetaInfo cube_meta = get_irradiance_meta();
 	result_.p_irradiance = create_empty_cube_texture(cube_meta);
 	if (rdoc_api)
 		rdoc_api->StartFrameCapture(NULL, NULL);
-	bake_irradiance(cube_meta);
+	bake_cube_map(*result_.p_irradiance, cube_meta, "irradiance.comp.spv");
 	if (rdoc_api)
 		rdoc_api->EndFrameCapture(NULL, NULL);
 };
 
-// Bake the irradiance texture.
-// The irradiance texture is a convoluted cubemap that allows us to query the irradiance using a direction.
-// The position is assumed to be fixed. We store the irradiance at postion p with direction N at cubemap's textel at N.
-void PBRBaker::bake_irradiance(ImageMetaInfo &cube_meta)
+// Bake the irradiance spherical harmonics and upload them.
+void PBRBaker::prepare_irradiance_sh()
 {
-	RenderPass           render_pass        = create_color_only_renderpass(cube_meta.format);
-	ImageResource        transfer_src_resrc = create_transfer_src(cube_meta.extent, cube_meta.format);
-	Framebuffer          framebuffer        = create_square_framebuffer(render_pass, transfer_src_resrc.get_view(), cube_meta.extent.width);
-	DescriptorAllocation desc_allocation    = allocate_texture_descriptor(*result_.p_background);
-
-	vk::PushConstantRange push_constant_range{
-	    .stageFlags = vk::ShaderStageFlagBits::eVertex,
-	    .offset     = 0,
-	    .size       = sizeof(glm::mat4),
-	};
-
-	vk::PipelineLayoutCreateInfo pl_layout_cinfo{
-	    .setLayoutCount         = 1,
-	    .pSetLayouts            = &desc_allocation.set_layout,
-	    .pushConstantRangeCount = 1,
-	    .pPushConstantRanges    = &push_constant_range,
-	};
-
-	GraphicsPipeline pl = create_graphics_pipeline(render_pass, pl_layout_cinfo, "irradiance.vert.spv", "irradiance.frag.spv");
-
-	std::array<vk::ClearValue, 1> clear_values = {
-	    std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f},
-	};
-	vk::RenderPassBeginInfo pass_begin_info{
-	    .renderPass  = render_pass.get_handle(),
-	    .framebuffer = framebuffer.get_handle(),
-	    .renderArea  = {
-	         .extent = {
-	             .width  = cube_meta.extent.width,
-	             .height = cube_meta.extent.height,
-            }},
-	    .clearValueCount = to_u32(clear_values.size()),
-	    .pClearValues    = clear_values.data(),
-	};
-
-	CommandBuffer     bake_buf        = device_.begin_one_time_buf();
-	vk::CommandBuffer bake_buf_handle = bake_buf.get_handle();
-	vk::Viewport      viewport{
-	         .x = 0,
-	         .y = 0,
-    };
-	vk::Rect2D scissor{
-	    .offset = {
-	        .x = 0,
-	        .y = 0,
-	    },
-	    .extent = {
-	        .width  = cube_meta.extent.width,
-	        .height = cube_meta.extent.height,
-	    },
-	};
-
-	bake_buf.set_image_layout(result_.p_irradiance->resource, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer);
-
-	uint32_t  img_width  = cube_meta.extent.width;
-	uint32_t  img_height = cube_meta.extent.height;
-	glm::mat4 pco        = glm::mat4(1.0f);
-
-	// We need to render to all 6 faces and all mipmap levels.
-	for (uint32_t m = 0; m < cube_meta.levels; m++)
-	{
-		img_width  = std::max(1u, cube_meta.extent.width >> m);
-		img_height = std::max(1u, cube_meta.extent.height >> m);
-		for (uint32_t f = 0; f < 6; f++)
-		{
-			// We render to f face at m level.
-			// Once we finished rendering it, convert the format for transfer src.
-			// Transfer the render result from the framebuffer to the PBRTexture.
-			// Convert the format back for rendering.
-			// Repeat for all f and m.
-			viewport.width  = img_width;
-			viewport.height = img_height;
-			pco             = glm::perspective(glm::pi<float>() / 2.0f, 1.0f, 0.1f, 512.0f) * CUBE_FACE_MATRIXS[f];
-			bake_buf_handle.setViewport(0, viewport);
-			bake_buf_handle.setScissor(0, scissor);
-			bake_buf_handle.beginRenderPass(pass_begin_info, vk::SubpassContents::eInline);
-			bake_buf_handle.pushConstants<glm::mat4>(pl.get_pipeline_layout(), vk::ShaderStageFlagBits::eVertex, 0, pco);
-			bake_buf_handle.bindPipeline(vk::PipelineBindPoint::eGraphics, pl.get_handle());
-			bake_buf_handle.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pl.get_pipeline_layout(), 0, desc_allocation.set, {});
-			draw_box(bake_buf);
-			bake_buf_handle.endRenderPass();
-			bake_buf.set_image_layout(transfer_src_resrc, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal);
-
-			vk::ImageCopy copy_region = {
-			    .srcSubresource = {
-			        .aspectMask     = vk::ImageAspectFlagBits::eColor,
-			        .mipLevel       = 0,
-			        .baseArrayLayer = 0,
-			        .layerCount     = 1,
-			    },
-			    .dstSubresource{
-			        .aspectMask     = vk::ImageAspectFlagBits::eColor,
-			        .mipLevel       = m,
-			        .baseArrayLayer = f,
-			        .layerCount     = 1,
-			    },
-			    .extent = {
-			        .width  = img_width,
-			        .height = img_height,
-			        .depth  = 1,
-			    },
-			};
-
-			bake_buf_handle.copyImage(transfer_src_resrc.get_image().get_handle(), vk::ImageLayout::eTransferSrcOptimal, result_.p_irradiance->resource.get_image().get_handle(), vk::ImageLayout::eTransferDstOptimal, copy_region);
-			bake_buf.set_image_layout(transfer_src_resrc, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eColorAttachmentOptimal);
-		}
-	}
-
-	bake_buf.set_image_layout(result_.p_irradiance->resource, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
-
-	device_.end_one_time_buf(bake_buf);
+	if (rdoc_api)
+		rdoc_api->StartFrameCapture(NULL, NULL);
+	bake_irradiance_sh();
+	if (rdoc_api)
+		rdoc_api->EndFrameCapture(NULL, NULL);
+	result_.p_irradiance_sh = create_irradiance_sh_buffer();
 }
 
 // Create the prefilter PBRTexture and bake it.
+// Similar to Irradiance map, we allow shader to use a direction N to sample from the texture.
+// The higher the mipmap levels, the higher the roughness. Lower resolution has less of a impact when the roughness is high.
 void PBRBaker::prepare_prefilter()
 {
-	ImageMetaInfo cube_meta{
-	    .extent = {
-	        .width  = PREFILTER_DIMENSION,
-	        .height = PREFILTER_DIMENSION,
-	        .depth  = 1,
-	    },
-	    .format = vk::Format::eR16G16B16A16Sfloat,
-	    .levels = max_mip_levels(PREFILTER_DIMENSION, PREFILTER_DIMENSION),
-	};
+	ImageMetaInfo cube_meta = get_prefilter_meta();
 	result_.p_prefilter = create_empty_cube_texture(cube_meta);
 	if (rdoc_api)
 		rdoc_api->StartFrameCapture(NULL, NULL);
-	bake_prefilter(cube_meta);
+	bake_cube_map(*result_.p_prefilter, cube_meta, "prefilter.comp.spv");
 	if (rdoc_api)
 		rdoc_api->EndFrameCapture(NULL, NULL);
 }
 
-// Bake the prefilter texture.
-// Similar to Irradiance map, we allow shader to use a direction N to sample from the texture.
-// The position is assumed to be fixed. We store the prefilter at postion p with direction N at cubemap's textel at N.
-void PBRBaker::bake_prefilter(ImageMetaInfo &cube_meta)
-{
-	RenderPass           render_pass        = create_color_only_renderpass(cube_meta.format);
-	ImageResource        transfer_src_resrc = create_transfer_src(cube_meta.extent, cube_meta.format);
-	Framebuffer          framebuffer        = create_square_framebuffer(render_pass, transfer_src_resrc.get_view(), cube_meta.extent.width);
-	DescriptorAllocation desc_allocation    = allocate_texture_descriptor(*result_.p_background);
-
-	struct PCO
-	{
-		glm::mat4 proj;
-		float     roughness;
-	} pco;
-	vk::PushConstantRange push_constant_range{
-	    vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
-	    0,
-	    sizeof(pco),
-	};
-
-	vk::PipelineLayoutCreateInfo pl_layout_cinfo{
-	    .setLayoutCount         = 1,
-	    .pSetLayouts            = &desc_allocation.set_layout,
-	    .pushConstantRangeCount = 1,
-	    .pPushConstantRanges    = &push_constant_range,
-	};
-
-	GraphicsPipeline pl = create_graphics_pipeline(render_pass, pl_layout_cinfo, "prefilter.vert.spv", "prefilter.frag.spv");
-
-	std::array<vk::ClearValue, 1> clear_values = {
-	    std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f},
-	};
-	vk::RenderPassBeginInfo pass_begin_info{
-	    .renderPass  = render_pass.get_handle(),
-	    .framebuffer = framebuffer.get_handle(),
-	    .renderArea  = {
-	         .extent = {
-	             .width  = cube_meta.extent.width,
-	             .height = cube_meta.extent.height,
-            },
-        },
-	    .clearValueCount = to_u32(clear_values.size()),
-	    .pClearValues    = clear_values.data(),
-	};
-
-	CommandBuffer     bake_buf        = device_.begin_one_time_buf();
-	vk::CommandBuffer bake_buf_handle = bake_buf.get_handle();
-	vk::Viewport      viewport{
-	         .x = 0,
-	         .y = 0,
-    };
-	vk::Rect2D scissor{
-	    .offset = {
-	        .x = 0,
-	        .y = 0,
-	    },
-	    .extent = {
-	        .width  = cube_meta.extent.width,
-	        .height = cube_meta.extent.height,
-	    },
-	};
-
-	bake_buf.set_image_layout(result_.p_prefilter->resource, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer);
-
-	uint32_t img_width  = cube_meta.extent.width;
-	uint32_t img_height = cube_meta.extent.height;
-	uint32_t div        = 1u;
-
-	// See irradiance map rendering. We go through the same process here.
-	for (uint32_t m = 0; m < cube_meta.levels; m++)
-	{
-		img_width  = std::max(1u, cube_meta.extent.width >> m);
-		img_height = std::max(1u, cube_meta.extent.height >> m);
-		// The higher the mipmap levels, the higher the roughness.
-		// Lower resolution has less of a impact when the roughness is high.
-		pco.roughness = m / static_cast<float>(cube_meta.levels - 1);
-
-		for (uint32_t f = 0; f < 6; f++)
-		{
-			viewport.width  = img_width;
-			viewport.height = img_height;
-			pco.proj        = glm::perspective(glm::pi<float>() / 2.0f, 1.0f, 0.1f, 512.0f) * CUBE_FACE_MATRIXS[f];
-
-			bake_buf_handle.pushConstants<PCO>(pl.get_pipeline_layout(), vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, pco);
-			bake_buf_handle.setViewport(0, viewport);
-			bake_buf_handle.setScissor(0, scissor);
-			bake_buf_handle.beginRenderPass(pass_begin_info, vk::SubpassContents::eInline);
-			bake_buf_handle.bindPipeline(vk::PipelineBindPoint::eGraphics, pl.get_handle());
-			bake_buf_handle.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pl.get_pipeline_layout(), 0, desc_allocation.set, {});
-			draw_box(bake_buf);
-			bake_buf_handle.endRenderPass();
-
-			vk::ImageCopy copy_region = {
-			    .srcSubresource = {
-			        .aspectMask     = vk::ImageAspectFlagBits::eColor,
-			        .mipLevel       = 0,
-			        .baseArrayLayer = 0,
-			        .layerCount     = 1,
-			    },
-			    .dstSubresource{
-			        .aspectMask     = vk::ImageAspectFlagBits::eColor,
-			        .mipLevel       = m,
-			        .baseArrayLayer = f,
-			        .layerCount     = 1,
-			    },
-			    .extent = {
-			        .width  = img_width,
-			        .height = img_height,
-			        .depth  = 1,
-			    },
-			};
-			transfer_from_src_to_texture(bake_buf, transfer_src_resrc, *result_.p_prefilter, copy_region);
-		}
-	}
-
-	bake_buf.set_image_layout(result_.p_prefilter->resource, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
-
-	device_.end_one_time_buf(bake_buf);
-}
-
 // Create the brdf lut texture and bake it.
 void PBRBaker::prepare_brdf_lut()
 {
 	create_brdf_lut_texture();
 	if (rdoc_api)
 		rdoc_api->StartFrameCapture(NULL, NULL);
-	bake_brdf_lut();
+	if (is_brdf_lut_computed_)
+	{
+		bake_brdf_lut();
+	}
+	else
+	{
+		draw_brdf_lut();
+	}
 	if (rdoc_api)
 		rdoc_api->EndFrameCapture(NULL, NULL);
 }
@@ -417,8 +321,9 @@ void PBRBaker::create_brdf_lut_texture()
 	    .arrayLayers = 1,
 	    .samples     = vk::SampleCountFlagBits::e1,
 	    .tiling      = vk::ImageTiling::eOptimal,
-	    .usage       = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
+	    .usage       = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
 	};
+	image_cinfo.usage |= is_brdf_lut_computed_ ? vk::ImageUsageFlagBits::eStorage : vk::ImageUsageFlagBits::eColorAttachment;
 
 	Image img = device_.get_device_memory_allocator().allocate_device_only_image(image_cinfo);
 
@@ -433,8 +338,28 @@ void PBRBaker::create_brdf_lut_texture()
 	    Sampler(device_, sample_cinfo));
 }
 
-// Bake the brdf lut.
+// Bake the brdf lut with a compute shader that writes the texture directly.
 void PBRBaker::bake_brdf_lut()
+{
+	DescriptorAllocation         desc_allocation = allocate_storage_descriptor(result_.p_brdf_lut->resource.get_view());
+	vk::PipelineLayoutCreateInfo pl_layout_cinfo{
+	    .setLayoutCount = 1,
+	    .pSetLayouts    = &desc_allocation.set_layout,
+	};
+	ComputePipeline pl = ComputePipeline(device_, "brdf_lut.comp.spv", pl_layout_cinfo);
+
+	CommandBuffer     bake_buf        = device_.begin_one_time_buf();
+	vk::CommandBuffer bake_buf_handle = bake_buf.get_handle();
+	bake_buf.set_image_layout(result_.p_brdf_lut->resource, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader);
+	bake_buf_handle.bindPipeline(vk::PipelineBindPoint::eCompute, pl.get_handle());
+	bake_buf_handle.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pl.get_pipeline_layout(), 0, desc_allocation.set, {});
+	bake_buf_handle.dispatch(get_group_count(BRDF_LUT_DIMENSION), get_group_count(BRDF_LUT_DIMENSION), 1);
+	bake_buf.set_image_layout(result_.p_brdf_lut->resource, vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader);
+	device_.end_one_time_buf(bake_buf);
+}
+
+// Fallback for devices that can't write rg16f storage images. Draw the brdf lut with a fullscreen triangle.
+void PBRBaker::draw_brdf_lut()
 {
 	RenderPass                   render_pass = create_color_only_renderpass(vk::Format::eR16G16Sfloat, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal);
 	Framebuffer                  framebuffer = create_square_framebuffer(render_pass, result_.p_brdf_lut->resource.get_view(), BRDF_LUT_DIMENSION);
@@ -505,6 +430,306 @@ void PBRBaker::bake_brdf_lut()
 	device_.end_one_time_buf(bake_buf);
 }
 
+// Compare the maps just baked against the CPU reference. A map the reference can't bake is skipped.
+// * The reference doesn't filter across the faces of a cube, so some error along the face edges is expected.
+void PBRBaker::validate_bake()
+{
+	try
+	{
+		ImageTransferInfo background = ImageResource::load_cubic_image(fu::compute_abs_path(fu::FileType::eImage, BACKGROUND_NAME));
+
+		KTX2Image environment{
+		    .vk_format = static_cast<uint32_t>(background.meta.format),
+		    .width     = background.meta.extent.width,
+		    .height    = background.meta.extent.height,
+		    .levels    = background.meta.levels,
+		    .faces     = 6,
+		    .binary    = std::move(background.binary),
+		};
+
+		if (result_.p_irradiance)
+		{
+			log_bake_error("irradiance", read_back_texture(*result_.p_irradiance, get_irradiance_meta(), 6), bake_irradiance_reference(environment, IRRADIANCE_DIMENSION));
+		}
+		log_bake_error("prefilter", read_back_texture(*result_.p_prefilter, get_prefilter_meta(), 6), bake_prefilter_reference(environment, PREFILTER_DIMENSION));
+	}
+	catch (const std::exception &e)
+	{
+		LOGW("Failed to validate the IBL maps: {}", e.what());
+	}
+	log_bake_error("brdf_lut", read_back_texture(*result_.p_brdf_lut, get_brdf_lut_meta(), 1), bake_brdf_lut_reference(BRDF_LUT_DIMENSION));
+}
+
+// Project the environment onto 9 spherical harmonics. It takes one sample per grid texel, where the irradiance map convolves every texel.
+// sh_project.comp projects a cube face grid of IRRADIANCE_SH_DIMENSION texels. Each workgroup reduces its 8x8 texels to one partial sum per coefficient.
+// The partial sums are read back and added up here. Then the cosine lobe and the basis constants are folded into the coefficients.
+void PBRBaker::bake_irradiance_sh()
+{
+	uint32_t group_count   = get_group_count(IRRADIANCE_SH_DIMENSION);
+	uint32_t partial_count = group_count * group_count * 6;
+	Buffer   partial_buf   = device_.get_device_memory_allocator().allocate_readback_buffer(partial_count * sizeof(IrradianceSH));
+
+	vk::DescriptorImageInfo env_iinfo{
+	    .sampler     = result_.p_background->sampler.get_handle(),
+	    .imageView   = result_.p_background->resource.get_view().get_handle(),
+	    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+	};
+	vk::DescriptorBufferInfo partial_binfo{
+	    .buffer = partial_buf.get_handle(),
+	    .offset = 0,
+	    .range  = VK_WHOLE_SIZE,
+	};
+	DescriptorAllocation desc_allocation =
+	    DescriptorBuilder::begin(desc_state_.cache, desc_state_.allocator)
+	        .bind_image(0, env_iinfo, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eCompute)
+	        .bind_buffer(1, partial_binfo, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+	        .build();
+
+	uint32_t              dimension = IRRADIANCE_SH_DIMENSION;
+	vk::PushConstantRange push_constant_range{
+	    .stageFlags = vk::ShaderStageFlagBits::eCompute,
+	    .offset     = 0,
+	    .size       = sizeof(dimension),
+	};
+	vk::PipelineLayoutCreateInfo pl_layout_cinfo{
+	    .setLayoutCount         = 1,
+	    .pSetLayouts            = &desc_allocation.set_layout,
+	    .pushConstantRangeCount = 1,
+	    .pPushConstantRanges    = &push_constant_range,
+	};
+	ComputePipeline pl = ComputePipeline(device_, "sh_project.comp.spv", pl_layout_cinfo);
+
+	vk::MemoryBarrier readback_barrier{
+	    .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+	    .dstAccessMask = vk::AccessFlagBits::eHostRead,
+	};
+
+	CommandBuffer     bake_buf        = device_.begin_one_time_buf();
+	vk::CommandBuffer bake_buf_handle = bake_buf.get_handle();
+	bake_buf_handle.bindPipeline(vk::PipelineBindPoint::eCompute, pl.get_handle());
+	bake_buf_handle.pushConstants<uint32_t>(pl.get_pipeline_layout(), vk::ShaderStageFlagBits::eCompute, 0, dimension);
+	bake_buf_handle.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pl.get_pipeline_layout(), 0, desc_allocation.set, {});
+	bake_buf_handle.dispatch(group_count, group_count, 6);
+	bake_buf_handle.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, readback_barrier, {}, {});
+	device_.end_one_time_buf(bake_buf);
+
+	const glm::vec4 *p_partials = reinterpret_cast<const glm::vec4 *>(partial_buf.read_mapped_data());
+	for (uint32_t c = 0; c < irradiance_sh_.size(); c++)
+	{
+		glm::vec3 sum(0.0f);
+		for (uint32_t p = 0; p < partial_count; p++)
+		{
+			sum += glm::vec3(p_partials[p * irradiance_sh_.size() + c]);
+		}
+		irradiance_sh_[c] = glm::vec4(sum * SH_IRRADIANCE_FACTORS[c], 0.0f);
+	}
+}
+
+// Bake a cube map with a compute shader, which writes every face and mip level of the texture in place.
+// Each level is one dispatch over its 6 faces, through a 2D array view of the level. The shader gets the roughness of the level, m / (levels - 1).
+// The position is assumed to be fixed. We store the result for direction N at cubemap's texel at N.
+void PBRBaker::bake_cube_map(PBRTexture &texture, const ImageMetaInfo &cube_meta, const char *comp_shader_name)
+{
+	// The views and their descriptors have to outlive the bake.
+	std::vector<ImageView>            level_views;
+	std::vector<DescriptorAllocation> desc_allocations;
+	level_views.reserve(cube_meta.levels);
+	for (uint32_t m = 0; m < cube_meta.levels; m++)
+	{
+		vk::ImageViewCreateInfo view_cinfo = ImageView::cube_level_view_cinfo(texture.resource.get_image().get_handle(), cube_meta.format, vk::ImageAspectFlagBits::eColor, m);
+		level_views.emplace_back(device_, view_cinfo);
+		desc_allocations.push_back(allocate_storage_descriptor(level_views.back(), result_.p_background.get()));
+	}
+
+	float                 roughness = 0.0f;
+	vk::PushConstantRange push_constant_range{
+	    .stageFlags = vk::ShaderStageFlagBits::eCompute,
+	    .offset     = 0,
+	    .size       = sizeof(roughness),
+	};
+
+	// Every level has the same set layout.
+	vk::PipelineLayoutCreateInfo pl_layout_cinfo{
+	    .setLayoutCount         = 1,
+	    .pSetLayouts            = &desc_allocations[0].set_layout,
+	    .pushConstantRangeCount = 1,
+	    .pPushConstantRanges    = &push_constant_range,
+	};
+	ComputePipeline pl = ComputePipeline(device_, comp_shader_name, pl_layout_cinfo);
+
+	CommandBuffer     bake_buf        = device_.begin_one_time_buf();
+	vk::CommandBuffer bake_buf_handle = bake_buf.get_handle();
+	bake_buf.set_image_layout(texture.resource, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral, vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader);
+	bake_buf_handle.bindPipeline(vk::PipelineBindPoint::eCompute, pl.get_handle());
+
+	// The levels don't depend on each other. No barriers are needed between the dispatches.
+	for (uint32_t m = 0; m < cube_meta.levels; m++)
+	{
+		uint32_t level_dimension = std::max(1u, cube_meta.extent.width >> m);
+		roughness                = cube_meta.levels > 1 ? m / static_cast<float>(cube_meta.levels - 1) : 0.0f;
+		bake_buf_handle.pushConstants<float>(pl.get_pipeline_layout(), vk::ShaderStageFlagBits::eCompute, 0, roughness);
+		bake_buf_handle.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pl.get_pipeline_layout(), 0, desc_allocations[m].set, {});
+		bake_buf_handle.dispatch(get_group_count(level_dimension), get_group_count(level_dimension), 6);
+	}
+
+	bake_buf.set_image_layout(texture.resource, vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader);
+	device_.end_one_time_buf(bake_buf);
+}
+
+// Upload the maps a bake with the same key saved. Return false if any of them is missing or doesn't match.
+bool PBRBaker::load_cache()
+{
+	bool                        is_sh        = irradiance_mode_ == IrradianceMode::eSphericalHarmonics;
+	std::unique_ptr<PBRTexture> p_irradiance = is_sh ? nullptr : load_cached_texture("irradiance", get_irradiance_meta(), 6);
+	std::unique_ptr<PBRTexture> p_prefilter  = load_cached_texture("prefilter", get_prefilter_meta(), 6);
+	std::unique_ptr<PBRTexture> p_brdf_lut   = load_cached_texture("brdf_lut", get_brdf_lut_meta(), 1);
+	if ((is_sh ? !load_cached_irradiance_sh() : !p_irradiance) || !p_prefilter || !p_brdf_lut)
+	{
+		return false;
+	}
+
+	result_.p_irradiance = std::move(p_irradiance);
+	result_.p_prefilter  = std::move(p_prefilter);
+	result_.p_brdf_lut   = std::move(p_brdf_lut);
+	if (is_sh)
+	{
+		result_.p_irradiance_sh = create_irradiance_sh_buffer();
+	}
+	LOGI("Loaded the IBL maps from the cache.");
+	return true;
+}
+
+// A bake that can't be saved is still used. The next launch bakes again.
+void PBRBaker::save_cache()
+{
+	try
+	{
+		if (irradiance_mode_ == IrradianceMode::eSphericalHarmonics)
+		{
+			save_cached_irradiance_sh();
+		}
+		else
+		{
+			save_cached_texture("irradiance", *result_.p_irradiance, get_irradiance_meta(), 6);
+		}
+		save_cached_texture("prefilter", *result_.p_prefilter, get_prefilter_meta(), 6);
+		save_cached_texture("brdf_lut", *result_.p_brdf_lut, get_brdf_lut_meta(), 1);
+	}
+	catch (const std::exception &e)
+	{
+		LOGW("Failed to save the IBL maps to the cache: {}", e.what());
+	}
+}
+
+std::string PBRBaker::get_cache_path(const char *map_name, const char *extension) const
+{
+	return fu::compute_abs_path(fu::FileType::eCache, "ibl_" + std::to_string(cache_key_) + "_" + map_name + extension);
+}
+
+// Return nullptr if the cached map is missing, unreadable or doesn't match the meta info.
+std::unique_ptr<PBRTexture> PBRBaker::load_cached_texture(const char *map_name, const ImageMetaInfo &meta, uint32_t faces)
+{
+	std::string path = get_cache_path(map_name);
+	if (!fu::file_exists(path))
+	{
+		return nullptr;
+	}
+
+	KTX2Image image;
+	try
+	{
+		std::vector<uint8_t> file = fu::read_binary(path);
+		image                     = read_ktx2(file.data(), file.size());
+	}
+	catch (const std::exception &e)
+	{
+		LOGW("Ignoring the cached IBL map {}: {}", path, e.what());
+		return nullptr;
+	}
+	if (image.vk_format != static_cast<uint32_t>(meta.format) || image.width != meta.extent.width || image.height != meta.extent.height ||
+	    image.levels != meta.levels || image.faces != faces || image.binary.size() != get_mip_chain_size(meta, faces))
+	{
+		LOGW("Ignoring the cached IBL map {}. It doesn't match the bake.", path);
+		return nullptr;
+	}
+
+	ImageResource resource    = faces == 6 ? ImageResource::create_empty_cubic_img_resrc(device_, meta) : ImageResource::create_empty_two_dim_img_resrc(device_, meta);
+	CommandBuffer cmd_buf     = device_.begin_one_time_buf();
+	Buffer        staging_buf = device_.get_device_memory_allocator().allocate_staging_buffer(image.binary.size());
+	staging_buf.update(image.binary);
+
+	cmd_buf.set_image_layout(resource, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer);
+	cmd_buf.update_image(resource, staging_buf);
+	cmd_buf.set_image_layout(resource, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+	device_.end_one_time_buf(cmd_buf);
+
+	vk::SamplerCreateInfo sampler_cinfo = Sampler::linear_clamp_cinfo(device_.get_physical_device(), meta.levels);
+	return std::make_unique<PBRTexture>(std::move(resource), Sampler(device_, sampler_cinfo));
+}
+
+void PBRBaker::save_cached_texture(const char *map_name, PBRTexture &texture, const ImageMetaInfo &meta, uint32_t faces)
+{
+	fu::write_binary(get_cache_path(map_name), write_ktx2(read_back_texture(texture, meta, faces)));
+}
+
+// Read the map back in the layout of a KTX2 image.
+// * The map is expected to be in eShaderReadOnlyOptimal. It is left there.
+KTX2Image PBRBaker::read_back_texture(PBRTexture &texture, const ImageMetaInfo &meta, uint32_t faces)
+{
+	size_t size = get_mip_chain_size(meta, faces);
+
+	Buffer        readback_buf = device_.get_device_memory_allocator().allocate_readback_buffer(size);
+	CommandBuffer cmd_buf      = device_.begin_one_time_buf();
+	cmd_buf.set_image_layout(texture.resource, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal);
+	cmd_buf.read_image(texture.resource, readback_buf);
+	cmd_buf.set_image_layout(texture.resource, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+	device_.end_one_time_buf(cmd_buf);
+
+	const uint8_t *p_data = readback_buf.read_mapped_data();
+
+	return {
+	    .vk_format = static_cast<uint32_t>(meta.format),
+	    .width     = meta.extent.width,
+	    .height    = meta.extent.height,
+	    .levels    = meta.levels,
+	    .faces     = faces,
+	    .binary    = std::vector<uint8_t>(p_data, p_data + size),
+	};
+}
+
+// The coefficients are cached as they are laid out in memory.
+bool PBRBaker::load_cached_irradiance_sh()
+{
+	std::string path = get_cache_path("irradiance_sh", ".bin");
+	if (!fu::file_exists(path))
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> file = fu::read_binary(path);
+	if (file.size() != sizeof(IrradianceSH))
+	{
+		LOGW("Ignoring the cached IBL map {}. It doesn't match the bake.", path);
+		return false;
+	}
+	std::memcpy(irradiance_sh_.data(), file.data(), sizeof(IrradianceSH));
+	return true;
+}
+
+void PBRBaker::save_cached_irradiance_sh()
+{
+	const uint8_t *p_data = reinterpret_cast<const uint8_t *>(irradiance_sh_.data());
+	fu::write_binary(get_cache_path("irradiance_sh", ".bin"), std::vector<uint8_t>(p_data, p_data + sizeof(IrradianceSH)));
+}
+
+// Create the uniform buffer pbr_sh.frag reads the coefficients from.
+std::unique_ptr<Buffer> PBRBaker::create_irradiance_sh_buffer()
+{
+	Buffer buf = device_.get_device_memory_allocator().allocate_uniform_buffer(sizeof(IrradianceSH));
+	buf.update(irradiance_sh_.data(), sizeof(IrradianceSH));
+	return std::make_unique<Buffer>(std::move(buf));
+}
+
 // Helper function to create a cube PBRTexture
 std::unique_ptr<PBRTexture> PBRBaker::create_empty_cube_texture(ImageMetaInfo &cube_meta)
 {
@@ -525,7 +750,7 @@ ImageResource PBRBaker::create_empty_cubic_img_resource(ImageMetaInfo &meta)
 	    .arrayLayers = 6,
 	    .samples     = vk::SampleCountFlagBits::e1,
 	    .tiling      = vk::ImageTiling::eOptimal,
-	    .usage       = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+	    .usage       = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc,
 	    .sharingMode = vk::SharingMode::eExclusive,
 	};
 
@@ -584,36 +809,6 @@ RenderPass PBRBaker::create_color_only_renderpass(vk::Format format, vk::ImageLa
 	return RenderPass(device_, render_pass_cinfo);
 }
 
-// Create an image resource suitable for being the transfer resource.
-// The result will be used as a framebuffer in bake_irradiance and bake_prefilter.
-ImageResource PBRBaker::create_transfer_src(vk::Extent3D extent, vk::Format format)
-{
-	vk::ImageCreateInfo transfer_src_cinfo{
-	    .imageType     = vk::ImageType::e2D,
-	    .format        = format,
-	    .extent        = extent,
-	    .mipLevels     = 1,
-	    .arrayLayers   = 1,
-	    .samples       = vk::SampleCountFlagBits::e1,
-	    .tiling        = vk::ImageTiling::eOptimal,
-	    .usage         = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
-	    .sharingMode   = vk::SharingMode::eExclusive,
-	    .initialLayout = vk::ImageLayout::eUndefined,
-	};
-
-	Image img = device_.get_device_memory_allocator().allocate_device_only_image(transfer_src_cinfo);
-
-	vk::ImageViewCreateInfo view_cinfo = ImageView::two_dim_view_cinfo(img.get_handle(), format, vk::ImageAspectFlagBits::eColor, 1);
-
-	ImageResource resrc = ImageResource(std::move(img), ImageView(device_, view_cinfo));
-
-	CommandBuffer cmd_buf = device_.begin_one_time_buf();
-	cmd_buf.set_image_layout(resrc, vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal);
-	device_.end_one_time_buf(cmd_buf);
-
-	return resrc;
-}
-
 // Helper function to create a square framebuffer.
 Framebuffer PBRBaker::create_square_framebuffer(const RenderPass &render_pass, const ImageView &view, uint32_t dimension)
 {
@@ -629,58 +824,28 @@ Framebuffer PBRBaker::create_square_framebuffer(const RenderPass &render_pass, c
 	return Framebuffer(device_, framebuffer_cinfo);
 }
 
-// Helper function to create a graphics pipeline with the default state.
-GraphicsPipeline PBRBaker::create_graphics_pipeline(RenderPass &render_pass, vk::PipelineLayoutCreateInfo &pl_layout_cinfo, const char *vert_shader_name, const char *frag_shader_name)
+// Helper function to create descriptors for a compute bake.
+// The storage view is bound at binding 0. With a source texture, the source is bound at binding 0 and the view at binding 1.
+DescriptorAllocation PBRBaker::allocate_storage_descriptor(const ImageView &view, PBRTexture *p_source)
 {
-	std::array<vk::VertexInputBindingDescription, 1> binding_descriptions;
-	binding_descriptions[0] = vk::VertexInputBindingDescription{
-	    .binding   = 0,
-	    .stride    = sizeof(sg::Vertex),
-	    .inputRate = vk::VertexInputRate::eVertex,
-	};
-
-	GraphicsPipelineState state{
-	    .vert_shader_name   = vert_shader_name,
-	    .frag_shader_name   = frag_shader_name,
-	    .vertex_input_state = {
-	        .attribute_descriptions = sg::Vertex::get_input_attr_descriptions(),
-	        .binding_descriptions   = binding_descriptions,
-	    },
-	    .depth_stencil_state = {
-	        .depth_test_enable  = false,
-	        .depth_write_enable = false,
-	        .depth_compare_op   = vk::CompareOp::eLessOrEqual,
-	    },
+	vk::DescriptorImageInfo storage_iinfo{
+	    .imageView   = view.get_handle(),
+	    .imageLayout = vk::ImageLayout::eGeneral,
 	};
-	return GraphicsPipeline(device_, render_pass, state, pl_layout_cinfo);
-}
+	if (!p_source)
+	{
+		return DescriptorBuilder::begin(desc_state_.cache, desc_state_.allocator).bind_image(0, storage_iinfo, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute).build();
+	}
 
-// Helper function to create descriptors for the texture.
-DescriptorAllocation PBRBaker::allocate_texture_descriptor(PBRTexture &texture)
-{
-	vk::DescriptorImageInfo desc_iinfo{
-	    .sampler     = texture.sampler.get_handle(),
-	    .imageView   = texture.resource.get_view().get_handle(),
+	vk::DescriptorImageInfo source_iinfo{
+	    .sampler     = p_source->sampler.get_handle(),
+	    .imageView   = p_source->resource.get_view().get_handle(),
 	    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
 	};
-	return DescriptorBuilder::begin(desc_state_.cache, desc_state_.allocator).bind_image(0, desc_iinfo, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment).build();
-}
-
-// Helper function that writes the commands to draw the textured box.
-void PBRBaker::draw_box(CommandBuffer &cmd_buf)
-{
-	vk::CommandBuffer cmd_buf_handle = cmd_buf.get_handle();
-	cmd_buf_handle.bindVertexBuffers(0, result_.p_box->p_vertex_buf_->get_handle(), {0});
-	cmd_buf_handle.bindIndexBuffer(result_.p_box->p_idx_buf_->get_handle(), 0, vk::IndexType::eUint32);
-	cmd_buf_handle.drawIndexed(result_.p_box->idx_count_, 1, 0, 0, 0);
-}
-
-// Helper function that copy data from the src to the PBRTexture.
-void PBRBaker::transfer_from_src_to_texture(CommandBuffer &cmd_buf, ImageResource &src, PBRTexture &texture, vk::ImageCopy copy_region)
-{
-	cmd_buf.set_image_layout(src, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal);
-	cmd_buf.get_handle().copyImage(src.get_image().get_handle(), vk::ImageLayout::eTransferSrcOptimal, texture.resource.get_image().get_handle(), vk::ImageLayout::eTransferDstOptimal, copy_region);
-	cmd_buf.set_image_layout(src, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eColorAttachmentOptimal);
+	return DescriptorBuilder::begin(desc_state_.cache, desc_state_.allocator)
+	    .bind_image(0, source_iinfo, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eCompute)
+	    .bind_image(1, storage_iinfo, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute)
+	    .build();
 }
 
-}        // namespace W3D
\ No newline at end of file
+}        // namespace W3D
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <array>
 #include <memory>
+#include <string>
 
 #include "common/glm_common.hpp"
 
@@ -15,11 +17,11 @@ namespace sg
 class SubMesh;
 }
 class Device;
+class Buffer;
+struct KTX2Image;
 
-class GraphicsPipeline;
 class RenderPass;
 class Framebuffer;
-class CommandBuffer;
 
 // PBRTexture manages its own lifetime.
 // * It is NOT owned by a scene.
@@ -32,6 +34,17 @@ struct PBRTexture
 	Sampler       sampler;
 };
 
+// How the diffuse part of the IBL is stored.
+enum class IrradianceMode
+{
+	eCubemap,                   // A convolved cubemap. pbr.frag reads it once per pixel.
+	eSphericalHarmonics,        // 9 spherical harmonics coefficients in a uniform buffer. pbr_sh.frag evaluates them.
+};
+
+// Irradiance / PI of the environment as 9 spherical harmonics coefficients. The cosine lobe and the basis constants are folded in.
+// The layout matches the IrradianceSH block of pbr_sh.frag. w is unused.
+using IrradianceSH = std::array<glm::vec4, 9>;
+
 // POD struct for all the PBR resource.
 struct PBR
 {
@@ -42,7 +55,8 @@ struct PBR
 	PBR &operator=(PBR &&rhs) = default;
 
 	std::unique_ptr<PBRTexture>  p_background;
-	std::unique_ptr<PBRTexture>  p_irradiance;
+	std::unique_ptr<PBRTexture>  p_irradiance;           // Null with IrradianceMode::eSphericalHarmonics.
+	std::unique_ptr<Buffer>      p_irradiance_sh;        // Uniform buffer holding an IrradianceSH. Null with IrradianceMode::eCubemap.
 	std::unique_ptr<PBRTexture>  p_prefilter;
 	std::unique_ptr<PBRTexture>  p_brdf_lut;
 	std::unique_ptr<sg::SubMesh> p_box;
@@ -50,43 +64,60 @@ struct PBR
 
 // Responsible for baking IBL resources.
 // To get a better understanding about PBR and IBL, refer to https://learnopengl.com/PBR/Theory
+// The maps are baked by compute shaders that write every face and mip level in place. See bake_cube_map().
+// With IrradianceMode::eSphericalHarmonics, the irradiance map is replaced by 9 coefficients. See bake_irradiance_sh().
+// Baked maps are saved to the cache directory as KTX2 files. A later bake with the same key uploads them instead of rendering them.
+// The key hashes the environment map, the dimensions and formats of the maps, and the shader binaries, which hold the sample counts.
+// With VALIDATE_BAKE, fresh bakes are compared against the CPU reference of common/ibl_reference.hpp and the error is logged.
 class PBRBaker
 {
   public:
 	static const uint32_t IRRADIANCE_DIMENSION;
 	static const uint32_t PREFILTER_DIMENSION;
 	static const uint32_t BRDF_LUT_DIMENSION;
+	static const uint32_t IRRADIANCE_SH_DIMENSION;        // Of a face of the grid the environment is projected from.
+	static const uint32_t CACHE_VERSION;                  // Bump it when the bake changes in a way the key doesn't see.
+	static const bool     VALIDATE_BAKE;                  // Slow. The CPU bakes every map again.
 
-	PBRBaker(Device &device);
+	PBRBaker(Device &device, IrradianceMode irradiance_mode = IrradianceMode::eCubemap);
 
 	PBR bake();
 
   private:
-	static const std::vector<glm::mat4> CUBE_FACE_MATRIXS;
-
 	void load_background();
 	void load_cube_model();
+	bool load_cache();
+	void save_cache();
 	void prepare_prefilter();
 	void prepare_irradiance();
+	void prepare_irradiance_sh();
 	void prepare_brdf_lut();
-	void bake_irradiance(ImageMetaInfo &cube_meta);
-	void bake_prefilter(ImageMetaInfo &cube_meta);
+	void bake_irradiance_sh();
+	void bake_cube_map(PBRTexture &texture, const ImageMetaInfo &cube_meta, const char *comp_shader_name);
 	void bake_brdf_lut();
-
-	void draw_box(CommandBuffer &cmd_buf);
-	void transfer_from_src_to_texture(CommandBuffer &cmd_buf, ImageResource &src, PBRTexture &texture, vk::ImageCopy copy_region);
+	void draw_brdf_lut();
+	void validate_bake();
 
 	RenderPass                  create_color_only_renderpass(vk::Format format, vk::ImageLayout initial_layout = vk::ImageLayout::eUndefined, vk::ImageLayout final_layout = vk::ImageLayout::eColorAttachmentOptimal);
-	ImageResource               create_transfer_src(vk::Extent3D extent, vk::Format format);
 	Framebuffer                 create_square_framebuffer(const RenderPass &render_pass, const ImageView &view, uint32_t dimension);
-	GraphicsPipeline            create_graphics_pipeline(RenderPass &render_pass, vk::PipelineLayoutCreateInfo &ppl_layout_cinfo, const char *vert_shader_name, const char *frag_shader_name);
-	DescriptorAllocation        allocate_texture_descriptor(PBRTexture &texture);
+	std::unique_ptr<Buffer>     create_irradiance_sh_buffer();
+	DescriptorAllocation        allocate_storage_descriptor(const ImageView &view, PBRTexture *p_source = nullptr);
+	std::string                 get_cache_path(const char *map_name, const char *extension = ".ktx2") const;
+	std::unique_ptr<PBRTexture> load_cached_texture(const char *map_name, const ImageMetaInfo &meta, uint32_t faces);
+	KTX2Image                   read_back_texture(PBRTexture &texture, const ImageMetaInfo &meta, uint32_t faces);
+	void                        save_cached_texture(const char *map_name, PBRTexture &texture, const ImageMetaInfo &meta, uint32_t faces);
+	bool                        load_cached_irradiance_sh();
+	void                        save_cached_irradiance_sh();
 	std::unique_ptr<PBRTexture> create_empty_cube_texture(ImageMetaInfo &cube_meta);
 	ImageResource               create_empty_cubic_img_resource(ImageMetaInfo &img_tinfo);
 	void                        create_brdf_lut_texture();
 
 	Device         &device_;
+	IrradianceMode  irradiance_mode_;
 	PBR             result_;
+	IrradianceSH    irradiance_sh_;        // Kept for the cache with IrradianceMode::eSphericalHarmonics.
 	DescriptorState desc_state_;
+	uint64_t        cache_key_            = 0;
+	bool            is_brdf_lut_computed_ = false;        // Writing the rg16f LUT as a storage image is optional. draw_brdf_lut() is the fallback.
 };
 }        // namespace W3D
@@ -1,7 +1,35 @@
 #include "component.hpp"
 
+#include <mutex>
+#include <unordered_map>
+
+#include "common/logging.hpp"
+
 namespace W3D::sg
 {
+// Ids are handed out once per type, the templated overload caches them.
+ComponentTypeId get_component_type_id(const std::type_index &type)
+{
+	static std::mutex                                           mutex;
+	static std::unordered_map<std::type_index, ComponentTypeId> type_ids;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto                        it = type_ids.find(type);
+	if (it != type_ids.end())
+	{
+		return it->second;
+	}
+
+	if (type_ids.size() >= MAX_COMPONENT_TYPES)
+	{
+		LOGE("More than {} component types.", MAX_COMPONENT_TYPES);
+		abort();
+	}
+	ComponentTypeId id = static_cast<ComponentTypeId>(type_ids.size());
+	type_ids.emplace(type, id);
+	return id;
+}
+
 Component::Component(const std::string &name) :
     name_(name){};
 
@@ -9,4 +37,4 @@ const std::string &Component::get_name() const
 {
 	return name_;
 }
-}        // namespace W3D::sg
\ No newline at end of file
+}        // namespace W3D::sg
@@ -1,13 +1,32 @@
 #pragma once
 
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <typeindex>
+#include <vector>
 
 namespace W3D
 {
 namespace sg
 {
 
+// Component types are numbered in the order they are first seen.
+// Nodes keep a bitmask of these ids and scenes keep one array of components per id.
+using ComponentTypeId = uint32_t;
+
+constexpr uint32_t MAX_COMPONENT_TYPES = 64;        // One bit per type in a node's mask.
+
+ComponentTypeId get_component_type_id(const std::type_index &type);
+
+template <typename T>
+ComponentTypeId get_component_type_id()
+{
+	static const ComponentTypeId id = get_component_type_id(typeid(T));
+	return id;
+}
+
 // An abstract component class.
 class Component
 {
@@ -23,5 +42,86 @@ class Component
 	std::string name_;
 };
 
+// Typed view of the components a scene stores under T.
+// It reads the scene's array every time, so it doesn't allocate and stays valid when components of T are added.
+// * Every component stored under T is a T, so elements are static_cast. See Scene::get_components().
+template <typename T>
+class ComponentView
+{
+  public:
+	class Iterator
+	{
+	  public:
+		using Base              = std::vector<std::unique_ptr<Component>>::const_iterator;
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = T *;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = T **;
+		using reference         = T *;
+
+		Iterator(Base it) :
+		    it_(it)
+		{
+		}
+
+		T *operator*() const
+		{
+			return static_cast<T *>(it_->get());
+		}
+
+		Iterator &operator++()
+		{
+			++it_;
+			return *this;
+		}
+
+		bool operator==(const Iterator &rhs) const
+		{
+			return it_ == rhs.it_;
+		}
+
+		bool operator!=(const Iterator &rhs) const
+		{
+			return it_ != rhs.it_;
+		}
+
+	  private:
+		Base it_;
+	};
+
+	ComponentView(const std::vector<std::unique_ptr<Component>> &p_components) :
+	    p_components_(&p_components)
+	{
+	}
+
+	T *operator[](size_t idx) const
+	{
+		return static_cast<T *>((*p_components_)[idx].get());
+	}
+
+	Iterator begin() const
+	{
+		return Iterator(p_components_->begin());
+	}
+
+	Iterator end() const
+	{
+		return Iterator(p_components_->end());
+	}
+
+	size_t size() const
+	{
+		return p_components_->size();
+	}
+
+	bool empty() const
+	{
+		return p_components_->empty();
+	}
+
+  private:
+	const std::vector<std::unique_ptr<Component>> *p_components_;
+};
+
 }        // namespace sg
-}        // namespace W3D
\ No newline at end of file
+}        // namespace W3D
@@ -45,7 +45,7 @@ void AABB::update(const AABB &b)
 
 // AABB Transform algorithm by Jim Arvo
 // See https://www.realtimerendering.com/resources/GraphicsGems/gems/TransBox.c
-AABB AABB::transform(glm::mat4 T)
+AABB AABB::transform(glm::mat4 T) const
 {
 	float     a, b;
 	glm::vec3 new_min, new_max;
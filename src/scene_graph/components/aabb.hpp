@@ -16,7 +16,7 @@ class AABB : public Component
 	void      update(const glm::vec3 &pt);
 	void      update(const glm::vec3 &min, const glm::vec3 &max);
 	void      update(const AABB &b);
-	AABB      transform(glm::mat4 T);
+	AABB      transform(glm::mat4 T) const;
 	glm::vec3 get_scale() const;
 	glm::vec3 get_center() const;
 	glm::vec3 get_min() const;
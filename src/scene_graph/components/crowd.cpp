@@ -0,0 +1,27 @@
+#include "crowd.hpp"
+
+#include "core/device_memory/buffer.hpp"
+
+namespace W3D::sg
+{
+
+Crowd::Crowd(Node &node, const std::string &name) :
+    Component(name),
+    node_(node)
+{
+}
+
+Crowd::~Crowd()
+{}
+
+std::type_index Crowd::get_type()
+{
+	return typeid(Crowd);
+}
+
+Node &Crowd::get_node()
+{
+	return node_;
+}
+
+}        // namespace W3D::sg
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/glm_common.hpp"
+#include "common/vk_common.hpp"
+#include "scene_graph/component.hpp"
+
+namespace W3D
+{
+class Buffer;
+namespace sg
+{
+class Node;
+
+// A clip in the frame buffer of a crowd. Mirrors the std430 layout of crowd.vert.
+struct BakedClip
+{
+	uint32_t first_frame;        // Frames are joint_count_ joint matrices each.
+	uint32_t frame_count;
+	float    frame_rate;        // Frames per second. The frames span the clip exactly, so this is (frame_count - 1) / duration.
+	float    duration;
+};
+
+// An instance of a crowd. Mirrors the std430 layout of crowd.vert.
+struct CrowdInstance
+{
+	glm::mat4 model;
+	uint32_t  clip;
+	float     time_offset;        // Seconds added to the crowd time.
+	float     speed;              // Playback rate.
+	float     padding;
+};
+
+// Crowd component.
+// Instances of a skinned mesh that play baked animations on the GPU.
+// The joint matrices of every clip are baked at a fixed rate into a storage buffer. See AnimationBaker.
+// Each joint matrix is stored as the top three rows of the affine matrix.
+// The vertex shader picks the two frames around an instance's time and blends them. Nothing is evaluated on the CPU per frame.
+class Crowd : public Component
+{
+  public:
+	Crowd(Node &node, const std::string &name = "");
+	virtual ~Crowd();
+	virtual std::type_index get_type() override;
+
+	Node &get_node();
+
+	uint32_t                 joint_count_    = 0;
+	uint32_t                 instance_count_ = 0;
+	std::vector<std::string> clip_names_;        // Names of the animations the clips were baked from.
+	std::vector<BakedClip>   clips_;
+
+	std::unique_ptr<Buffer> p_frame_buf_;
+	std::unique_ptr<Buffer> p_clip_buf_;
+	std::unique_ptr<Buffer> p_instance_buf_;
+	vk::DescriptorSet       set_;
+
+  private:
+	Node &node_;        // Has the mesh and the skin the crowd is made of.
+};
+
+}        // namespace sg
+}        // namespace W3D
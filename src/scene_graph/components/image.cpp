@@ -10,13 +10,19 @@ namespace W3D::sg
 
 Image::Image(ImageResource &&resource, const std::string &name) :
     Component(name),
-    resource_(std::move(resource))
+    p_resource_(std::make_shared<ImageResource>(std::move(resource)))
+{
+}
+
+Image::Image(std::shared_ptr<ImageResource> p_resource, const std::string &name) :
+    Component(name),
+    p_resource_(std::move(p_resource))
 {
 }
 
 Image::Image(Image &&rhs) :
     Component(rhs.get_name()),
-    resource_(std::move(rhs.resource_))
+    p_resource_(std::move(rhs.p_resource_))
 {
 }
 
@@ -27,11 +33,16 @@ std::type_index Image::get_type()
 
 ImageResource &Image::get_resource()
 {
-	return resource_;
+	return *p_resource_;
+}
+
+std::shared_ptr<ImageResource> Image::get_shared_resource()
+{
+	return p_resource_;
 }
 
 void Image::set_resource(ImageResource &&resource)
 {
-	resource_ = std::move(resource);
+	*p_resource_ = std::move(resource);
 }
 }        // namespace W3D::sg
\ No newline at end of file
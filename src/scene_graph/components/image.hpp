@@ -2,6 +2,8 @@
 
 #include <stdint.h>
 
+#include <memory>
+
 #include "common/vk_common.hpp"
 #include "core/image_resource.hpp"
 #include "scene_graph/component.hpp"
@@ -14,21 +16,25 @@ class Device;
 namespace sg
 {
 // Image Component. Wraps around an image resource.
+// The resource can be shared with images of other scenes through the device's resource cache.
 class Image : public Component
 {
   public:
 	Image(ImageResource &&resrc, const std::string &name);
+	Image(std::shared_ptr<ImageResource> p_resource, const std::string &name);
 	Image(Image &&);
 
 	virtual ~Image() = default;
 	virtual std::type_index get_type() override;
 
-	ImageResource &get_resource();
+	ImageResource                 &get_resource();
+	std::shared_ptr<ImageResource> get_shared_resource();
 
+	// ! The resource is replaced in place, so that textures pointing to it stay valid. Don't call this on a shared resource.
 	void set_resource(ImageResource &&resource);
 
   private:
-	ImageResource resource_;
+	std::shared_ptr<ImageResource> p_resource_;
 };
 }        // namespace sg
 
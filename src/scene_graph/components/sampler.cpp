@@ -1,13 +1,14 @@
 #include "sampler.hpp"
 
 #include "core/device.hpp"
+#include "core/resource_cache.hpp"
 
 namespace W3D::sg
 {
 Sampler::Sampler(const Device &device, const std::string &name, vk::SamplerCreateInfo &sampler_cinfo) :
     Component(name),
     device_(device),
-    sampler_(device_, sampler_cinfo){};
+    p_sampler_(device_.get_resource_cache().request_sampler(sampler_cinfo)){};
 
 std::type_index Sampler::get_type()
 {
@@ -16,6 +17,6 @@ std::type_index Sampler::get_type()
 
 vk::Sampler Sampler::get_handle()
 {
-	return sampler_.get_handle();
+	return p_sampler_->get_handle();
 }
 }        // namespace W3D::sg
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include "common/vk_common.hpp"
 #include "core/sampler.hpp"
 #include "scene_graph/component.hpp"
@@ -11,6 +13,7 @@ class Device;
 namespace sg
 {
 // Component wrapper for sampler.
+// The sampler itself comes from the device's resource cache and is shared by every sampler component with the same create info.
 class Sampler : public Component
 {
   public:
@@ -21,8 +24,8 @@ class Sampler : public Component
 	vk::Sampler             get_handle();
 
   private:
-	const Device &device_;
-	W3D::Sampler  sampler_;
+	const Device                 &device_;
+	std::shared_ptr<W3D::Sampler> p_sampler_;
 };
 }        // namespace sg
 }        // namespace W3D
\ No newline at end of file
@@ -1,8 +1,5 @@
 #include "skin.hpp"
 
-#include <iostream>
-
-#include "glm/gtx/string_cast.hpp"
 #include "scene_graph/scene.hpp"
 
 namespace W3D::sg
@@ -13,20 +10,24 @@ Skin::Skin(const std::string &name) :
 // Calculate all the joint matrices
 void Skin::compute_joint_Ms(sg::Scene &scene, glm::mat4 *p_joint_Ms) const
 {
-	std::vector<sg::Node *> p_nodes = scene.get_nodes();
 	// We need to multiply the IBMs to first convert submesh to bone CS.
-	for (int joint_id = 0; joint_id < joint_node_map_.size(); joint_id++)
+	for (size_t joint_id = 0; joint_id < joint_node_ids_.size(); joint_id++)
 	{
-		Node *p_node         = p_nodes[joint_node_map_.at(joint_id)];
-		Node *p_parent       = p_node->get_parent();
-		p_joint_Ms[joint_id] = p_node->get_transform().get_world_M() * IBMs_[joint_id];
+		Node &node           = scene.get_node_by_index(joint_node_ids_[joint_id]);
+		p_joint_Ms[joint_id] = node.get_transform().get_world_M() * IBMs_[joint_id];
 	}
 }
 
-void Skin::add_new_joint(int joint_id, uint32_t node_id)
+void Skin::reserve_joints(size_t joint_count)
 {
-	node_joint_map_[node_id]  = joint_id;
-	joint_node_map_[joint_id] = node_id;
+	joint_node_ids_.reserve(joint_count);
+	IBMs_.reserve(joint_count);
+}
+
+void Skin::add_joint(uint32_t node_id, const glm::mat4 &IBM)
+{
+	joint_node_ids_.push_back(node_id);
+	IBMs_.push_back(IBM);
 }
 
 std::type_index Skin::get_type()
@@ -34,7 +35,17 @@ std::type_index Skin::get_type()
 	return typeid(Skin);
 }
 
-std::array<glm::mat4, Skin::MAX_NUM_JOINTS> &Skin::get_IBMs()
+size_t Skin::get_joint_count() const
+{
+	return joint_node_ids_.size();
+}
+
+uint32_t Skin::get_joint_node_id(size_t joint_id) const
+{
+	return joint_node_ids_[joint_id];
+}
+
+const std::vector<glm::mat4> &Skin::get_IBMs() const
 {
 	return IBMs_;
 }
@@ -1,7 +1,6 @@
 #pragma once
 
-#include <array>
-#include <unordered_map>
+#include <vector>
 
 #include "common/glm_common.hpp"
 #include "scene_graph/component.hpp"
@@ -12,22 +11,27 @@ class Node;
 class Scene;
 
 // Component Wrapper for skin.
-
+// Joints are kept in joint order in two flat arrays: the index of each joint's node and its inverse bind matrix.
 class Skin : public Component
 {
   public:
-	static const int MAX_NUM_JOINTS = 256;
 	Skin(const std::string &name = "");
 
-	void                                   compute_joint_Ms(sg::Scene &scene, glm::mat4 *p_joint_Ms) const;
-	void                                   add_new_joint(int joint_id, uint32_t node_id);
-	std::type_index                        get_type() override;
-	std::array<glm::mat4, MAX_NUM_JOINTS> &get_IBMs();
+	// Write the joint matrices in joint order. p_joint_Ms needs room for get_joint_count() matrices.
+	void compute_joint_Ms(sg::Scene &scene, glm::mat4 *p_joint_Ms) const;
+	// Joints are numbered in the order they are added.
+	void                          reserve_joints(size_t joint_count);
+	void                          add_joint(uint32_t node_id, const glm::mat4 &IBM);
+	std::type_index               get_type() override;
+	size_t                        get_joint_count() const;
+	uint32_t                      get_joint_node_id(size_t joint_id) const;
+	const std::vector<glm::mat4> &get_IBMs() const;
+
+	uint32_t joint_offset_ = 0;        // Index of the skin's first matrix in the renderer's joint buffer. Set by the renderer every frame.
 
   private:
-	std::array<glm::mat4, MAX_NUM_JOINTS> IBMs_;
-	// Joint idx != node idx. We maintain a two way map to store this relation.
-	std::unordered_map<uint32_t, int> node_joint_map_;
-	std::unordered_map<int, uint32_t> joint_node_map_;
+	// Joint idx != node idx.
+	std::vector<uint32_t>  joint_node_ids_;
+	std::vector<glm::mat4> IBMs_;
 };
 }        // namespace W3D::sg
\ No newline at end of file
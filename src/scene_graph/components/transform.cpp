@@ -3,6 +3,7 @@
 #include <glm/gtx/matrix_decompose.hpp>
 
 #include "scene_graph/node.hpp"
+#include "scene_graph/transform_hierarchy.hpp"
 
 namespace W3D::sg
 {
@@ -19,6 +20,10 @@ std::type_index Transform::get_type()
 // Return the world transform.
 glm::mat4 Transform::get_world_M()
 {
+	if (p_hierarchy_)
+	{
+		return p_hierarchy_->get_world_M(slot_);
+	}
 	if (!need_update_)
 	{
 		return world_M_;
@@ -39,38 +44,69 @@ glm::mat4 Transform::get_world_M()
 
 glm::mat4 Transform::get_local_M()
 {
+	if (p_hierarchy_)
+	{
+		return p_hierarchy_->get_local_M(slot_);
+	}
 	return glm::translate(glm::mat4(1.0), translation_) * glm::mat4_cast(rotation_) *
 	       glm::scale(glm::mat4(1.0), scale_);
 }
 
 glm::vec3 Transform::get_scale()
 {
+	if (p_hierarchy_)
+	{
+		return p_hierarchy_->get_scale(slot_);
+	}
 	return scale_;
 }
 
 glm::vec3 Transform::get_translation()
 {
+	if (p_hierarchy_)
+	{
+		return p_hierarchy_->get_translation(slot_);
+	}
 	return translation_;
 }
 
 glm::quat Transform::get_rotation()
 {
+	if (p_hierarchy_)
+	{
+		return p_hierarchy_->get_rotation(slot_);
+	}
 	return rotation_;
 }
 
 void Transform::set_tranlsation(const glm::vec3 &translation)
 {
+	if (p_hierarchy_)
+	{
+		p_hierarchy_->set_translation(slot_, translation);
+		return;
+	}
 	translation_ = translation;
 	invalidate_world_M();
 }
 void Transform::set_rotation(const glm::quat &rotation)
 {
+	if (p_hierarchy_)
+	{
+		p_hierarchy_->set_rotation(slot_, rotation);
+		return;
+	}
 	rotation_ = rotation;
 	invalidate_world_M();
 }
 
 void Transform::set_scale(const glm::vec3 &scale)
 {
+	if (p_hierarchy_)
+	{
+		p_hierarchy_->set_scale(slot_, scale);
+		return;
+	}
 	scale_ = scale;
 	invalidate_world_M();
 }
@@ -81,12 +117,25 @@ void Transform::set_local_M(const glm::mat4 &local_M)
 	glm::vec3 skew;
 	glm::vec4 perspective;
 	glm::decompose(local_M, scale_, rotation_, translation_, skew, perspective);
+	if (p_hierarchy_)
+	{
+		p_hierarchy_->set_translation(slot_, translation_);
+		p_hierarchy_->set_rotation(slot_, rotation_);
+		p_hierarchy_->set_scale(slot_, scale_);
+		return;
+	}
 	invalidate_world_M();
 }
 
 // We need to propgate the change to children transforms.
+// A bound transform leaves that to the hierarchy's update pass.
 void Transform::invalidate_world_M()
 {
+	if (p_hierarchy_)
+	{
+		p_hierarchy_->mark_dirty(slot_);
+		return;
+	}
 	need_update_                       = true;
 	std::vector<sg::Node *> p_children = node_.get_children();
 	for (sg::Node *p_child : p_children)
@@ -99,4 +148,11 @@ void Transform::invalidate_world_M()
 	}
 }
 
+// Move the transform into a hierarchy slot. The slot must already hold this transform's SRT.
+void Transform::bind(TransformHierarchy *p_hierarchy, uint32_t slot)
+{
+	p_hierarchy_ = p_hierarchy;
+	slot_        = slot;
+}
+
 }        // namespace W3D::sg
\ No newline at end of file
@@ -8,10 +8,12 @@
 namespace W3D::sg
 {
 class Node;
+class TransformHierarchy;
 
 // Representing transform matrix.
 // We store the local matrix using SRT.
 // World_M is cached. Only recalculate it if this node's parent needs to be recalculated or the local matix is changed.
+// * Once bound to a TransformHierarchy, the transform lives in its slot there and setters only mark the slot dirty.
 class Transform : public Component
 {
   public:
@@ -30,11 +32,15 @@ class Transform : public Component
 	void set_scale(const glm::vec3 &scale);
 	void set_local_M(const glm::mat4 &local_M);
 	void invalidate_world_M();
+	void bind(TransformHierarchy *p_hierarchy, uint32_t slot);
 
   private:
 	void update_world_M();
 
-	Node     &node_;
+	Node               &node_;
+	TransformHierarchy *p_hierarchy_ = nullptr;
+	uint32_t            slot_        = 0;
+
 	glm::vec3 translation_ = glm::vec3(0.0, 0.0, 0.0);
 	glm::quat rotation_    = glm::quat(1.0, 0.0, 0.0, 0.0);
 	glm::vec3 scale_       = glm::vec3(1.0, 1.0, 1.0);
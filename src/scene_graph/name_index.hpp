@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/utils.hpp"
+
+namespace W3D::sg
+{
+
+// Index from string_hash(name) to the first object added with that name. This is what a linear scan would return.
+// Objects whose name hashes like a different name already indexed are kept aside and scanned on lookup.
+// * T needs get_name(). The index holds raw pointers, the owner keeps it in sync.
+template <typename T>
+class NameIndex
+{
+  public:
+	void add(T *p_t)
+	{
+		const std::string &name = p_t->get_name();
+		auto [it, inserted]     = p_ts_.emplace(string_hash(name.c_str()), p_t);
+		if (!inserted && it->second->get_name() != name)
+		{
+			p_collided_ts_.push_back(p_t);
+		}
+	}
+
+	template <typename Range>
+	void rebuild(const Range &p_ts)
+	{
+		clear();
+		for (T *p_t : p_ts)
+		{
+			add(p_t);
+		}
+	}
+
+	void clear()
+	{
+		p_ts_.clear();
+		p_collided_ts_.clear();
+	}
+
+	T *find(const std::string &name) const
+	{
+		auto it = p_ts_.find(string_hash(name.c_str()));
+		if (it != p_ts_.end() && it->second->get_name() == name)
+		{
+			return it->second;
+		}
+
+		for (T *p_t : p_collided_ts_)
+		{
+			if (p_t->get_name() == name)
+			{
+				return p_t;
+			}
+		}
+		return nullptr;
+	}
+
+  private:
+	std::unordered_map<uint32_t, T *> p_ts_;
+	std::vector<T *>                  p_collided_ts_;
+};
+
+}        // namespace W3D::sg
@@ -1,5 +1,7 @@
 #include "node.hpp"
 
+#include <cassert>
+
 namespace W3D::sg
 {
 Node::Node(const size_t id, const std::string &name) :
@@ -24,16 +26,28 @@ void Node::set_parent(Node &parent)
 	T_.invalidate_world_M();
 }
 
+// Number of set bits. Portable stand in for std::popcount.
+uint32_t count_bits(uint64_t bits)
+{
+	bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+	bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+	bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return static_cast<uint32_t>((bits * 0x0101010101010101ull) >> 56);
+}
+
+// Replace the component of the same type if there is one.
 void Node::set_component(Component &component)
 {
-	auto it = components_.find(component.get_type());
-	if (it != components_.end())
+	ComponentTypeId type_id = get_component_type_id(component.get_type());
+	uint32_t        slot    = get_component_slot(type_id);
+	if (has_component(type_id))
 	{
-		it->second = &component;
+		p_components_[slot] = &component;
 	}
 	else
 	{
-		components_.insert(std::make_pair(component.get_type(), &component));
+		p_components_.insert(p_components_.begin() + slot, &component);
+		component_mask_ |= 1ull << type_id;
 	}
 }
 
@@ -59,9 +73,15 @@ const std::vector<Node *> &Node::get_children() const
 
 Component &Node::get_component(const std::type_index index)
 {
-	return *components_.at(index);
+	return get_component(get_component_type_id(index));
 };
 
+Component &Node::get_component(ComponentTypeId type_id)
+{
+	assert(has_component(type_id));
+	return *p_components_[get_component_slot(type_id)];
+}
+
 Transform &Node::get_transform()
 {
 	return T_;
@@ -69,6 +89,17 @@ Transform &Node::get_transform()
 
 bool Node::has_component(const std::type_index index)
 {
-	return components_.count(index) > 0;
+	return has_component(get_component_type_id(index));
+}
+
+bool Node::has_component(ComponentTypeId type_id) const
+{
+	return (component_mask_ >> type_id) & 1ull;
+}
+
+// Index of type_id in p_components_: the number of components with a smaller type id.
+uint32_t Node::get_component_slot(ComponentTypeId type_id) const
+{
+	return count_bits(component_mask_ & ((1ull << type_id) - 1));
 }
 }        // namespace W3D::sg
\ No newline at end of file
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "components/transform.hpp"
@@ -11,6 +10,7 @@ namespace W3D::sg
 
 // This class is the key to our scene representations.
 // Refer to GLTF spec for better understanding.
+// Components are kept in type id order. A bitmask of the ids tells which ones the node has and where they are.
 class Node
 {
   public:
@@ -23,9 +23,10 @@ class Node
 	template <class T>
 	bool has_component()
 	{
-		return has_component(typeid(T));
+		return has_component(get_component_type_id<T>());
 	}
 	bool has_component(const std::type_index index);
+	bool has_component(ComponentTypeId type_id) const;
 
 	void add_child(Node &child);
 
@@ -36,20 +37,25 @@ class Node
 
 	// Query the node and get all components with type T.
 	// ! Caller needs to check whether components with type T exists.
+	// * A component is stored under its get_type(), so the one stored under T is a T.
 	template <class T>
 	inline T &get_component()
 	{
-		return dynamic_cast<T &>(get_component(typeid(T)));
+		return static_cast<T &>(get_component(get_component_type_id<T>()));
 	}
 	Component &get_component(const std::type_index index);
+	Component &get_component(ComponentTypeId type_id);
 	Transform &get_transform();
 
   private:
-	size_t                                           id_;
-	std::string                                      name_;
-	Transform                                        T_;
-	Node                                            *parent_{nullptr};
-	std::vector<Node *>                              children_;
-	std::unordered_map<std::type_index, Component *> components_;        // A type-pointers map.
+	uint32_t get_component_slot(ComponentTypeId type_id) const;
+
+	size_t                   id_;
+	std::string              name_;
+	Transform                T_;
+	Node                    *parent_{nullptr};
+	std::vector<Node *>      children_;
+	uint64_t                 component_mask_ = 0;        // Bit i is set if the node has a component of type id i.
+	std::vector<Component *> p_components_;              // Sorted by type id.
 };
 }        // namespace W3D::sg
\ No newline at end of file
@@ -13,6 +13,7 @@ Scene::Scene(const std::string &name) :
 // Add a node to the scene.
 void Scene::add_node(std::unique_ptr<Node> &&pNode)
 {
+	node_index_.add(pNode.get());
 	p_nodes_.emplace_back(std::move(pNode));
 }
 
@@ -27,7 +28,9 @@ void Scene::add_component(std::unique_ptr<Component> &&pComponent)
 {
 	if (pComponent)
 	{
-		p_components_[pComponent->get_type()].push_back(std::move(pComponent));
+		ComponentTypeId type_id = get_component_type_id(pComponent->get_type());
+		component_indices_[type_id].add(pComponent.get());
+		p_components_[type_id].push_back(std::move(pComponent));
 	}
 }
 
@@ -37,7 +40,9 @@ void Scene::add_component_to_node(std::unique_ptr<Component> &&pComponent, Node
 	if (pComponent)
 	{
 		node.set_component(*pComponent);
-		p_components_[pComponent->get_type()].push_back(std::move(pComponent));
+		ComponentTypeId type_id = get_component_type_id(pComponent->get_type());
+		component_indices_[type_id].add(pComponent.get());
+		p_components_[type_id].push_back(std::move(pComponent));
 	}
 }
 
@@ -45,7 +50,14 @@ void Scene::add_component_to_node(std::unique_ptr<Component> &&pComponent, Node
 void Scene::set_components(const std::type_index                   type,
                            std::vector<std::unique_ptr<Component>> pComponents)
 {
-	p_components_[type] = std::move(pComponents);
+	set_components(get_component_type_id(type), std::move(pComponents));
+}
+
+void Scene::set_components(ComponentTypeId                         type_id,
+                           std::vector<std::unique_ptr<Component>> pComponents)
+{
+	p_components_[type_id] = std::move(pComponents);
+	component_indices_[type_id].rebuild(ComponentView<Component>(p_components_[type_id]));
 }
 
 void Scene::set_root_node(Node &node)
@@ -56,6 +68,7 @@ void Scene::set_root_node(Node &node)
 void Scene::set_nodes(std::vector<std::unique_ptr<Node>> &&nodes)
 {
 	p_nodes_ = std::move(nodes);
+	node_index_.rebuild(get_nodes());
 }
 
 // Return raw pointers to the nodes.
@@ -82,6 +95,19 @@ Node &Scene::get_node_by_index(int idx)
 	return *p_nodes_[idx].get();
 }
 
+void Scene::init_transform_hierarchy()
+{
+	p_transform_hierarchy_ = std::make_unique<TransformHierarchy>(*root_);
+}
+
+void Scene::update_transforms()
+{
+	if (p_transform_hierarchy_)
+	{
+		p_transform_hierarchy_->update_world_Ms();
+	}
+}
+
 // Get the scene's bound
 AABB &Scene::get_bound()
 {
@@ -91,26 +117,18 @@ AABB &Scene::get_bound()
 // Find a node by name.
 Node *Scene::find_node(const std::string &name)
 {
-	for (auto &pNode : p_nodes_)
-	{
-		if (pNode->get_name() == name)
-		{
-			return pNode.get();
-		}
-	}
-
-	return nullptr;
+	return node_index_.find(name);
 }
 
 // Private function used by template get_components.
 const std::vector<std::unique_ptr<Component>> &Scene::get_components(
     const std::type_index &type) const
 {
-	return p_components_.at(type);
+	return p_components_[get_component_type_id(type)];
 }
 
 bool Scene::has_component(const std::type_index &type) const
 {
-	return p_components_.count(type) > 0;
+	return !p_components_[get_component_type_id(type)].empty();
 }
 }        // namespace W3D::sg
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
 #include <typeindex>
@@ -9,7 +10,9 @@
 
 #include "common/glm_common.hpp"
 #include "scene_graph/components/aabb.hpp"
+#include "scene_graph/name_index.hpp"
 #include "scene_graph/node.hpp"
+#include "scene_graph/transform_hierarchy.hpp"
 
 namespace W3D::sg
 {
@@ -19,6 +22,9 @@ class Component;
 class SubMesh;
 
 // This class is responsible for managing all scene-related resources, including all components.
+// Components are owned in one array per component type id. get_components() returns a typed view of an array.
+// * add_component() stores a component under its get_type(), set_components<T>() under T.
+// Nodes and the components of every type are indexed by name, so find_node() and find_component() don't scan.
 class Scene
 {
   public:
@@ -32,20 +38,7 @@ class Scene
 	template <typename T>
 	T *find_component(const std::string &name)
 	{
-		T *result = nullptr;
-		if (has_component<T>())
-		{
-			const std::vector<std::unique_ptr<Component>> &p_query_comp = get_components(typeid(T));
-			for (auto &p_component : p_query_comp)
-			{
-				if (p_component->get_name() == name)
-				{
-					result = dynamic_cast<T *>(p_component.get());
-					break;
-				}
-			}
-		}
-		return result;
+		return static_cast<T *>(component_indices_[get_component_type_id<T>()].find(name));
 	}
 
 	void  add_node(std::unique_ptr<Node> &&pNode);
@@ -55,6 +48,12 @@ class Scene
 	Node *find_node(const std::string &name);
 	void  add_component_to_node(std::unique_ptr<Component> &&pComponent, Node &node);
 
+	// Move the transforms of every node reachable from the root into a TransformHierarchy.
+	// Loaders call it once the hierarchy is complete. Call it again after changing the hierarchy.
+	void init_transform_hierarchy();
+	// Recompute the world matrices changed since the last update.
+	void update_transforms();
+
 	// Helper functions that set a vector of components.
 	// The resource passed in will now be owned by the scene.
 	template <typename T>
@@ -64,25 +63,18 @@ class Scene
 		std::transform(p_ts.begin(), p_ts.end(), p_components.begin(), [](std::unique_ptr<T> &p_t) -> std::unique_ptr<Component> {
 			return std::unique_ptr<Component>(std::move(p_t));
 		});
-		set_components(typeid(T), std::move(p_components));
+		set_components(get_component_type_id<T>(), std::move(p_components));
 	}
 	void set_components(const std::type_index                   type,
 	                    std::vector<std::unique_ptr<Component>> pComponents);
+	void set_components(ComponentTypeId                         type_id,
+	                    std::vector<std::unique_ptr<Component>> pComponents);
 
-	// Helper function that returns RAW pointers to components with type T.
+	// Typed view of the components with type T. It doesn't allocate, so it is fine to call it every frame.
 	template <typename T>
-	std::vector<T *> get_components() const
+	ComponentView<T> get_components() const
 	{
-		std::vector<T *> result;
-		if (has_component(typeid(T)))
-		{
-			auto &scene_components = get_components(typeid(T));
-			result.resize(scene_components.size());
-			std::transform(scene_components.begin(), scene_components.end(), result.begin(), [](const std::unique_ptr<Component> &component) -> T * {
-				return dynamic_cast<T *>(component.get());
-			});
-		}
-		return result;
+		return ComponentView<T>(p_components_[get_component_type_id<T>()]);
 	}
 
 	const std::vector<std::unique_ptr<Component>> &get_components(
@@ -91,7 +83,7 @@ class Scene
 	template <typename T>
 	bool has_component() const
 	{
-		return has_component(typeid(T));
+		return !p_components_[get_component_type_id<T>()].empty();
 	}
 	bool                    has_component(const std::type_index &type) const;
 	Node                   &get_root_node();
@@ -104,8 +96,12 @@ class Scene
 	Node       *root_ = nullptr;
 	AABB        bound_;
 
-	std::vector<std::unique_ptr<Node>>                                           p_nodes_;
-	std::unordered_map<std::type_index, std::vector<std::unique_ptr<Component>>> p_components_;
+	std::unique_ptr<TransformHierarchy> p_transform_hierarchy_;
+
+	std::vector<std::unique_ptr<Node>>                                       p_nodes_;
+	std::array<std::vector<std::unique_ptr<Component>>, MAX_COMPONENT_TYPES> p_components_;            // Indexed by component type id.
+	NameIndex<Node>                                                          node_index_;
+	std::array<NameIndex<Component>, MAX_COMPONENT_TYPES>                    component_indices_;        // Indexed by component type id.
 };
 
 }        // namespace W3D::sg
\ No newline at end of file
@@ -18,6 +18,20 @@ void Script::resize(uint32_t width, uint32_t height)
 {
 }
 
+ScriptAccess Script::get_access()
+{
+	return {};
+}
+
+void Script::sample(float delta_time)
+{
+	update(delta_time);
+}
+
+void Script::commit()
+{
+}
+
 NodeScript::NodeScript(Node &node, const std::string &name) :
     Script(name),
     node_(node)
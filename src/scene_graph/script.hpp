@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "scene_graph/component.hpp"
 #include "scene_graph/event.hpp"
 #include "scene_graph/node.hpp"
@@ -7,6 +9,15 @@
 namespace W3D::sg
 {
 
+// The nodes a script touches in its update. A node stands for its subtree, since moving a node moves its descendants.
+// * An exclusive script may touch anything. It conflicts with every other script.
+struct ScriptAccess
+{
+	std::vector<Node *> p_reads;
+	std::vector<Node *> p_writes;
+	bool                is_exclusive = true;
+};
+
 // An abstract script class. It should update some state given a delta time.
 // The update function is called each frame.
 class Script : public Component
@@ -20,6 +31,13 @@ class Script : public Component
 	virtual void update(float delta_time) = 0;
 	virtual void process_event(const Event &event);
 	virtual void resize(uint32_t width, uint32_t height);
+
+	// Split update for ScriptScheduler. sample() can run on a worker thread, next to scripts whose access doesn't conflict with it.
+	// It computes the update without writing to the nodes. commit() then writes the result on the main thread.
+	// By default, a script is exclusive and sample() runs update() on the main thread.
+	virtual ScriptAccess get_access();
+	virtual void         sample(float delta_time);
+	virtual void         commit();
 };
 
 // An abstract script class.
@@ -0,0 +1,156 @@
+#include "script_scheduler.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "common/job_system.hpp"
+#include "common/utils.hpp"
+#include "scene_graph/node.hpp"
+#include "scene_graph/scene.hpp"
+#include "scene_graph/script.hpp"
+
+namespace W3D::sg
+{
+
+bool is_in_subtree(const Node *p_node, const Node *p_root)
+{
+	for (; p_node; p_node = p_node->get_parent())
+	{
+		if (p_node == p_root)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Drop the nodes that are in the subtree of another node.
+std::vector<const Node *> get_subtree_roots(const std::vector<Node *> &p_nodes)
+{
+	std::unordered_set<const Node *> p_node_set(p_nodes.begin(), p_nodes.end());
+	std::vector<const Node *>        p_roots;
+	for (const Node *p_node : p_node_set)
+	{
+		const Node *p_ancestor = p_node->get_parent();
+		while (p_ancestor && !p_node_set.count(p_ancestor))
+		{
+			p_ancestor = p_ancestor->get_parent();
+		}
+		if (!p_ancestor)
+		{
+			p_roots.push_back(p_node);
+		}
+	}
+	return p_roots;
+}
+
+bool overlaps(const std::vector<const Node *> &p_roots_a, const std::vector<const Node *> &p_roots_b)
+{
+	for (const Node *p_a : p_roots_a)
+	{
+		for (const Node *p_b : p_roots_b)
+		{
+			if (is_in_subtree(p_a, p_b) || is_in_subtree(p_b, p_a))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+ScriptScheduler::ScriptScheduler(Scene &scene) :
+    scene_(scene)
+{
+}
+
+void ScriptScheduler::update(const std::vector<Script *> &p_scripts, float delta_time)
+{
+	run(
+	    p_scripts,
+	    [&p_scripts, delta_time](size_t script_idx) {
+		    p_scripts[script_idx]->sample(delta_time);
+	    },
+	    [&p_scripts](size_t script_idx) {
+		    p_scripts[script_idx]->commit();
+	    });
+}
+
+void ScriptScheduler::run(const std::vector<Script *> &p_scripts, const ScriptJob &sample_job, const ScriptJob &commit_job)
+{
+	if (!is_valid_ || p_scripts != p_scripts_)
+	{
+		build_batches(p_scripts);
+	}
+
+	for (const std::vector<uint32_t> &batch : batches_)
+	{
+		// Commits of the batch before, or anything before the scheduler, leave world matrices dirty. Resolving them isn't thread safe.
+		scene_.update_transforms();
+		// * An exclusive script is alone in its batch, and a single job runs on the calling thread.
+		JobSystem::get().parallel_for(0, batch.size(), 1, [&batch, &sample_job](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++)
+			{
+				sample_job(batch[i]);
+			}
+		});
+		for (uint32_t script_idx : batch)
+		{
+			commit_job(script_idx);
+		}
+	}
+}
+
+void ScriptScheduler::invalidate()
+{
+	is_valid_ = false;
+}
+
+uint32_t ScriptScheduler::get_batch_count() const
+{
+	return to_u32(batches_.size());
+}
+
+void ScriptScheduler::build_batches(const std::vector<Script *> &p_scripts)
+{
+	std::vector<Access> accesses;
+	accesses.reserve(p_scripts.size());
+	for (Script *p_script : p_scripts)
+	{
+		ScriptAccess access = p_script->get_access();
+		accesses.push_back({
+		    .p_reads      = get_subtree_roots(access.p_reads),
+		    .p_writes     = get_subtree_roots(access.p_writes),
+		    .is_exclusive = access.is_exclusive,
+		});
+	}
+
+	std::vector<uint32_t> script_batches(p_scripts.size(), 0);
+	batches_.clear();
+	for (size_t i = 0; i < p_scripts.size(); i++)
+	{
+		const Access &access = accesses[i];
+		uint32_t      batch  = 0;
+		for (size_t j = 0; j < i; j++)
+		{
+			const Access &other = accesses[j];
+			if (access.is_exclusive || other.is_exclusive ||
+			    overlaps(access.p_writes, other.p_writes) || overlaps(access.p_writes, other.p_reads) || overlaps(access.p_reads, other.p_writes))
+			{
+				batch = std::max(batch, script_batches[j] + 1);
+			}
+		}
+
+		script_batches[i] = batch;
+		if (batch == batches_.size())
+		{
+			batches_.emplace_back();
+		}
+		batches_[batch].push_back(to_u32(i));
+	}
+
+	p_scripts_ = p_scripts;
+	is_valid_  = true;
+}
+
+}        // namespace W3D::sg
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace W3D::sg
+{
+class Node;
+class Scene;
+class Script;
+
+// Updates scripts in batches of scripts that don't conflict. See Script::get_access().
+// The scripts of a batch sample in parallel on the JobSystem, then commit in order on the main thread.
+// A script goes in the batch after the last earlier script it conflicts with, so conflicting scripts keep their order.
+// World matrices are resolved before every batch, so samples can read them.
+// * The batches are rebuilt when the list of scripts changes. Call invalidate() when the access of a script does.
+class ScriptScheduler
+{
+  public:
+	using ScriptJob = std::function<void(size_t script_idx)>;
+
+	ScriptScheduler(Scene &scene);
+
+	void update(const std::vector<Script *> &p_scripts, float delta_time);
+	// Run other work in the batches of p_scripts. The jobs get indices into p_scripts.
+	void     run(const std::vector<Script *> &p_scripts, const ScriptJob &sample_job, const ScriptJob &commit_job);
+	void     invalidate();
+	uint32_t get_batch_count() const;
+
+  private:
+	struct Access
+	{
+		std::vector<const Node *> p_reads;         // Subtree roots. Nodes under another one are dropped.
+		std::vector<const Node *> p_writes;        // Subtree roots.
+		bool                      is_exclusive;
+	};
+
+	void build_batches(const std::vector<Script *> &p_scripts);
+
+	Scene                             &scene_;
+	std::vector<Script *>              p_scripts_;        // The scripts the batches were built for.
+	std::vector<std::vector<uint32_t>> batches_;
+	bool                               is_valid_ = false;
+};
+
+}        // namespace W3D::sg
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <memory>
 #include <variant>
 
 #include "scene_graph/script.hpp"
+#include "scene_graph/scripts/clip_compression.hpp"
+#include "scene_graph/scripts/pose.hpp"
 
 namespace W3D::sg
 {
+class AnimationClip;
 
 enum class AnimationType
 {
@@ -74,27 +78,42 @@ struct AnimationChannel
 	AnimationSampler sampler;
 };
 
+// Channels are compiled into an AnimationClip by compile() or on the first update. Each update samples the clip into a pose and commits it.
+// The animation writes the nodes of its channels. See Script::get_access().
+// An Animator can drive the animation instead. It samples the clip into its own poses and the animation isn't updated.
+// ! Channels can't be added once compiled.
 class Animation : public Script
 {
   public:
 	Animation(const std::string &name = "");
+	~Animation();
 
-	void update(float delta_time) override;
+	void         update(float delta_time) override;
+	ScriptAccess get_access() override;
+	void         sample(float delta_time) override;
+	void         commit() override;
 
 	void update_interval();
 	void set_channels(std::vector<AnimationChannel> &&channels);
 	void add_channel(Node &node, const AnimationTarget &target, const AnimationSampler &sampler);
+	// Compress the channels into the clip and release them. Loaders call this so the raw keys don't outlive the load.
+	void                        compile();
+	const ClipCompressionStats &get_compression_stats() const;
+	AnimationClip              &get_clip();
+	// Advance a playback time, looping back at the end time.
+	float advance_time(float time, float delta_time) const;
+	void  set_driven(bool driven);
+	bool  is_driven() const;
 
   private:
-	void update_by_channel(const AnimationChannel &channel);
-	void linear_update(const AnimationChannel &channel, size_t i);
-	void step_update(const AnimationChannel &channel, size_t i);
-	void cubic_spline_update(const AnimationChannel &channel, size_t i);
-
-	std::vector<AnimationChannel> channels_;
-	float                         current_time_{0.0f};
-	float                         start_time_{std::numeric_limits<float>::max()};
-	float                         end_time_{std::numeric_limits<float>::min()};
+
+	std::vector<AnimationChannel>  channels_;        // Released once compiled.
+	std::unique_ptr<AnimationClip> p_clip_;
+	Pose                           pose_;
+	float                          current_time_{0.0f};
+	float                          start_time_{std::numeric_limits<float>::max()};
+	float                          end_time_{std::numeric_limits<float>::lowest()};
+	bool                           driven_{false};
 };
 
 }        // namespace W3D::sg
\ No newline at end of file
@@ -0,0 +1,506 @@
+#include "animation_clip.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include "common/soa_interpolate.hpp"
+#include "scene_graph/node.hpp"
+#include "scene_graph/scripts/pose.hpp"
+
+namespace W3D::sg
+{
+
+// Intervals the cursor steps over before we fall back to a binary search.
+const size_t MAX_CURSOR_STEPS = 4;
+// Key reduction tolerances of a joint without children.
+const float TRANSLATION_TOLERANCE = 1e-4f;
+const float ROTATION_TOLERANCE    = 1e-3f;        // Radians.
+const float SCALE_TOLERANCE       = 1e-4f;
+
+void store_lane(const glm::vec3 &value, float *p_lanes, size_t count, size_t lane)
+{
+	p_lanes[lane]             = value.x;
+	p_lanes[count + lane]     = value.y;
+	p_lanes[2 * count + lane] = value.z;
+}
+
+void store_lane(const glm::quat &value, float *p_lanes, size_t count, size_t lane)
+{
+	p_lanes[lane]             = value.x;
+	p_lanes[count + lane]     = value.y;
+	p_lanes[2 * count + lane] = value.z;
+	p_lanes[3 * count + lane] = value.w;
+}
+
+glm::vec3 load_vec3_lane(const float *p_lanes, size_t count, size_t lane)
+{
+	return glm::vec3(p_lanes[lane], p_lanes[count + lane], p_lanes[2 * count + lane]);
+}
+
+glm::quat load_quat_lane(const float *p_lanes, size_t count, size_t lane)
+{
+	return glm::quat::wxyz(p_lanes[3 * count + lane], p_lanes[lane], p_lanes[count + lane], p_lanes[2 * count + lane]);
+}
+
+uint32_t get_subtree_height(const Node &node)
+{
+	uint32_t height = 0;
+	for (const Node *p_child : node.get_children())
+	{
+		height = std::max(height, get_subtree_height(*p_child) + 1);
+	}
+	return height;
+}
+
+// The tolerances are for joints without children. A joint's error moves every joint below it, so they are divided by the height of its subtree.
+float get_tolerance(const AnimationChannel &channel)
+{
+	switch (channel.target)
+	{
+		case AnimationTarget::eTranslation:
+			return TRANSLATION_TOLERANCE / (1 + get_subtree_height(channel.node));
+		case AnimationTarget::eRotation:
+			return ROTATION_TOLERANCE / (1 + get_subtree_height(channel.node));
+		case AnimationTarget::eScale:
+			return SCALE_TOLERANCE / (1 + get_subtree_height(channel.node));
+	}
+	return 0.0f;
+}
+
+// Indices of the keys the clip keeps. Cubic splines keep all of them.
+std::vector<uint32_t> reduce_keys(const AnimationChannel &channel, float tolerance)
+{
+	const AnimationSampler &sampler = channel.sampler;
+	size_t                  count   = sampler.inputs.size();
+	if (sampler.type == AnimationType::eCubicSpline)
+	{
+		std::vector<uint32_t> all_keys(count);
+		std::iota(all_keys.begin(), all_keys.end(), 0);
+		return all_keys;
+	}
+
+	bool is_linear = sampler.type == AnimationType::eLinear;
+	if (channel.target == AnimationTarget::eRotation)
+	{
+		const glm::quat *p_quats = sampler.get_quats().data();
+		return is_linear ? reduce_linear_keys(sampler.inputs.data(), p_quats, count, tolerance) : reduce_step_keys(p_quats, count, tolerance);
+	}
+	const glm::vec3 *p_vecs = sampler.get_vecs().data();
+	return is_linear ? reduce_linear_keys(sampler.inputs.data(), p_vecs, count, tolerance) : reduce_step_keys(p_vecs, count, tolerance);
+}
+
+AnimationClip::AnimationClip(const std::vector<AnimationChannel> &channels)
+{
+	std::unordered_map<Node *, uint32_t>   node_to_slot;
+	std::map<std::vector<float>, uint32_t> time_tracks;
+	tracks_.reserve(channels.size());
+	for (const AnimationChannel &channel : channels)
+	{
+		auto [it, inserted] = node_to_slot.emplace(&channel.node, static_cast<uint32_t>(p_nodes_.size()));
+		if (inserted)
+		{
+			p_nodes_.push_back(&channel.node);
+		}
+		add_channel(channel, it->second, time_tracks);
+	}
+
+	size_t time_size               = (times_.size() + inv_durations_.size()) * sizeof(float);
+	size_t packed_size             = packed_quats_.size() * sizeof(PackedQuat) + packed_vec3s_.size() * sizeof(PackedVec3) + vec3_ranges_.size() * sizeof(QuantizationRange);
+	size_t float_size              = vec3_values_.size() * sizeof(glm::vec3) + quat_values_.size() * sizeof(glm::quat);
+	compression_stats_.track_count = tracks_.size();
+	compression_stats_.size        = time_size + packed_size + float_size;
+}
+
+// Reduce and pack the keys of a channel, then file its track.
+void AnimationClip::add_channel(const AnimationChannel &channel, uint32_t slot, std::map<std::vector<float>, uint32_t> &time_tracks)
+{
+	const AnimationSampler &sampler     = channel.sampler;
+	bool                    is_rotation = channel.target == AnimationTarget::eRotation;
+	size_t                  value_size  = is_rotation ? sampler.get_quats().size() * sizeof(glm::quat) : sampler.get_vecs().size() * sizeof(glm::vec3);
+	compression_stats_.raw_key_count += sampler.inputs.size();
+	compression_stats_.raw_size += sampler.inputs.size() * sizeof(float) + value_size;
+
+	// Linear and step vec3s are packed over the range of their own keys. The packing error and the reduction error add up,
+	// so the reduction only gets what's left of the tolerance. Packing a track that would take more than half of it isn't worth it.
+	QuantizationRange range;
+	float             tolerance = get_tolerance(channel);
+	bool              is_packed = sampler.type != AnimationType::eCubicSpline;
+	if (is_packed && !is_rotation)
+	{
+		range.include(sampler.get_vecs());
+		float packing_error = range.get_max_error();
+		is_packed           = packing_error <= 0.5f * tolerance;
+		tolerance -= is_packed ? packing_error : 0.0f;
+	}
+
+	std::vector<uint32_t> kept_keys = reduce_keys(channel, tolerance);
+	std::vector<float>    times(kept_keys.size());
+	for (size_t k = 0; k < kept_keys.size(); k++)
+	{
+		times[k] = sampler.inputs[kept_keys[k]];
+	}
+	compression_stats_.key_count += kept_keys.size();
+
+	uint32_t first_value;
+	if (sampler.type == AnimationType::eCubicSpline)
+	{
+		if (is_rotation)
+		{
+			first_value = static_cast<uint32_t>(quat_values_.size());
+			quat_values_.insert(quat_values_.end(), sampler.get_quats().begin(), sampler.get_quats().end());
+		}
+		else
+		{
+			first_value = static_cast<uint32_t>(vec3_values_.size());
+			vec3_values_.insert(vec3_values_.end(), sampler.get_vecs().begin(), sampler.get_vecs().end());
+		}
+	}
+	else if (is_rotation)
+	{
+		first_value = static_cast<uint32_t>(packed_quats_.size());
+		for (uint32_t key : kept_keys)
+		{
+			packed_quats_.push_back(pack_quat(sampler.get_quats()[key]));
+		}
+	}
+	else if (is_packed)
+	{
+		first_value = static_cast<uint32_t>(packed_vec3s_.size());
+		for (uint32_t key : kept_keys)
+		{
+			packed_vec3s_.push_back(range.pack(sampler.get_vecs()[key]));
+		}
+		vec3_ranges_.push_back(range);
+	}
+	else
+	{
+		first_value = static_cast<uint32_t>(vec3_values_.size());
+		for (uint32_t key : kept_keys)
+		{
+			vec3_values_.push_back(sampler.get_vecs()[key]);
+		}
+	}
+
+	uint32_t track_idx = static_cast<uint32_t>(tracks_.size());
+	tracks_.push_back(Track{
+	    .slot        = slot,
+	    .target      = channel.target,
+	    .type        = sampler.type,
+	    .first_key   = add_time_track(std::move(times), time_tracks),
+	    .key_count   = static_cast<uint32_t>(kept_keys.size()),
+	    .first_value = first_value,
+	    .range       = is_packed && !is_rotation ? static_cast<uint32_t>(vec3_ranges_.size() - 1) : 0,
+	    .is_packed   = is_packed,
+	    .cursor      = 0,
+	});
+	switch (sampler.type)
+	{
+		case AnimationType::eLinear:
+			(is_rotation ? linear_quat_tracks_ : linear_vec3_tracks_).push_back(track_idx);
+			break;
+		case AnimationType::eCubicSpline:
+			(is_rotation ? cubic_quat_tracks_ : cubic_vec3_tracks_).push_back(track_idx);
+			break;
+		case AnimationType::eStep:
+			step_tracks_.push_back(track_idx);
+			break;
+	}
+}
+
+// Tracks with the same times share them and their interval lengths.
+uint32_t AnimationClip::add_time_track(std::vector<float> &&times, std::map<std::vector<float>, uint32_t> &time_tracks)
+{
+	auto it = time_tracks.find(times);
+	if (it != time_tracks.end())
+	{
+		compression_stats_.shared_time_track_count++;
+		return it->second;
+	}
+
+	uint32_t first_key = static_cast<uint32_t>(times_.size());
+	for (size_t k = 0; k < times.size(); k++)
+	{
+		float time     = times[k];
+		float duration = k + 1 < times.size() ? times[k + 1] - time : 0.0f;
+		times_.push_back(time);
+		inv_durations_.push_back(duration > 0.0f ? 1.0f / duration : 0.0f);
+		start_time_ = std::min(start_time_, time);
+		end_time_   = std::max(end_time_, time);
+	}
+	time_tracks.emplace(std::move(times), first_key);
+	return first_key;
+}
+
+const std::vector<Node *> &AnimationClip::get_nodes() const
+{
+	return p_nodes_;
+}
+
+float AnimationClip::get_start_time() const
+{
+	return start_time_;
+}
+
+float AnimationClip::get_end_time() const
+{
+	return end_time_;
+}
+
+const ClipCompressionStats &AnimationClip::get_compression_stats() const
+{
+	return compression_stats_;
+}
+
+void AnimationClip::sample(float time, Pose &pose)
+{
+	sample_linear_vec3s(time, pose);
+	sample_linear_quats(time, pose);
+	sample_cubic_vec3s(time, pose);
+	sample_cubic_quats(time, pose);
+	sample_steps(time, pose);
+}
+
+// Find the interval i with times[i] <= time < times[i + 1]. The last interval also takes time == the last key.
+// Forward playback moves the cursor a few intervals at most. Seeks and loops binary search.
+// Return false if time is outside the keys.
+bool AnimationClip::find_interval(Track &track, float time) const
+{
+	const float *p_times = times_.data() + track.first_key;
+	if (track.key_count < 2 || time < p_times[0] || time > p_times[track.key_count - 1])
+	{
+		return false;
+	}
+
+	size_t last = track.key_count - 2;
+	if (track.cursor <= last && p_times[track.cursor] <= time)
+	{
+		for (size_t step = 0; step < MAX_CURSOR_STEPS; step++)
+		{
+			if (track.cursor == last || time < p_times[track.cursor + 1])
+			{
+				return true;
+			}
+			track.cursor++;
+		}
+	}
+
+	size_t upper = std::upper_bound(p_times, p_times + track.key_count, time) - p_times;
+	track.cursor = std::min(upper - 1, last);
+	return true;
+}
+
+float AnimationClip::get_interp_val(const Track &track, float time) const
+{
+	size_t key = track.first_key + track.cursor;
+	return (time - times_[key]) * inv_durations_[key];
+}
+
+// Find the interval and the interpolation factor of every lane of a group.
+void AnimationClip::gather_lanes(const std::vector<uint32_t> &track_indices, float time)
+{
+	size_t count = track_indices.size();
+	lane_active_.resize(count);
+	lane_t_.resize(count);
+	lane_a_.resize(4 * count);
+	lane_b_.resize(4 * count);
+	lane_c_.resize(4 * count);
+	lane_d_.resize(4 * count);
+	lane_out_.resize(4 * count);
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		Track &track       = tracks_[track_indices[lane]];
+		lane_active_[lane] = find_interval(track, time);
+		lane_t_[lane]      = lane_active_[lane] ? get_interp_val(track, time) : 0.0f;
+	}
+}
+
+void AnimationClip::sample_linear_vec3s(float time, Pose &pose)
+{
+	size_t count = linear_vec3_tracks_.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	gather_lanes(linear_vec3_tracks_, time);
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		const Track &track = tracks_[linear_vec3_tracks_[lane]];
+		if (lane_active_[lane])
+		{
+			store_lane(get_vec3(track, track.cursor), lane_a_.data(), count, lane);
+			store_lane(get_vec3(track, track.cursor + 1), lane_b_.data(), count, lane);
+		}
+	}
+
+	lerp_soa(count, 3, lane_a_.data(), lane_b_.data(), lane_t_.data(), lane_out_.data());
+
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		if (lane_active_[lane])
+		{
+			write_vec3(tracks_[linear_vec3_tracks_[lane]], load_vec3_lane(lane_out_.data(), count, lane), pose);
+		}
+	}
+}
+
+void AnimationClip::sample_linear_quats(float time, Pose &pose)
+{
+	size_t count = linear_quat_tracks_.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	gather_lanes(linear_quat_tracks_, time);
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		const Track &track = tracks_[linear_quat_tracks_[lane]];
+		if (lane_active_[lane])
+		{
+			store_lane(get_quat(track, track.cursor), lane_a_.data(), count, lane);
+			store_lane(get_quat(track, track.cursor + 1), lane_b_.data(), count, lane);
+		}
+	}
+
+	nlerp_quat_soa(count, lane_a_.data(), lane_b_.data(), lane_t_.data(), lane_out_.data());
+
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		if (lane_active_[lane])
+		{
+			uint32_t slot        = tracks_[linear_quat_tracks_[lane]].slot;
+			pose.rotations[slot] = load_quat_lane(lane_out_.data(), count, lane);
+			pose.written[slot] |= POSE_ROTATION;
+		}
+	}
+}
+
+// Cubic spline keys are (in tangent, value, out tangent). The tangents are scaled by the interval length here.
+void AnimationClip::sample_cubic_vec3s(float time, Pose &pose)
+{
+	size_t count = cubic_vec3_tracks_.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	gather_lanes(cubic_vec3_tracks_, time);
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		const Track &track = tracks_[cubic_vec3_tracks_[lane]];
+		if (lane_active_[lane])
+		{
+			size_t value = track.first_value + track.cursor * 3;
+			size_t key   = track.first_key + track.cursor;
+			float  delta = times_[key + 1] - times_[key];
+			store_lane(vec3_values_[value + 1], lane_a_.data(), count, lane);
+			store_lane(delta * vec3_values_[value + 2], lane_b_.data(), count, lane);
+			store_lane(vec3_values_[value + 4], lane_c_.data(), count, lane);
+			store_lane(delta * vec3_values_[value + 3], lane_d_.data(), count, lane);
+		}
+	}
+
+	hermite_soa(count, 3, lane_a_.data(), lane_b_.data(), lane_c_.data(), lane_d_.data(), lane_t_.data(), lane_out_.data());
+
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		if (lane_active_[lane])
+		{
+			write_vec3(tracks_[cubic_vec3_tracks_[lane]], load_vec3_lane(lane_out_.data(), count, lane), pose);
+		}
+	}
+}
+
+void AnimationClip::sample_cubic_quats(float time, Pose &pose)
+{
+	size_t count = cubic_quat_tracks_.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	gather_lanes(cubic_quat_tracks_, time);
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		const Track &track = tracks_[cubic_quat_tracks_[lane]];
+		if (lane_active_[lane])
+		{
+			size_t value = track.first_value + track.cursor * 3;
+			size_t key   = track.first_key + track.cursor;
+			float  delta = times_[key + 1] - times_[key];
+			store_lane(quat_values_[value + 1], lane_a_.data(), count, lane);
+			store_lane(delta * quat_values_[value + 2], lane_b_.data(), count, lane);
+			store_lane(quat_values_[value + 4], lane_c_.data(), count, lane);
+			store_lane(delta * quat_values_[value + 3], lane_d_.data(), count, lane);
+		}
+	}
+
+	hermite_soa(count, 4, lane_a_.data(), lane_b_.data(), lane_c_.data(), lane_d_.data(), lane_t_.data(), lane_out_.data());
+	normalize_quat_soa(count, lane_out_.data());
+
+	for (size_t lane = 0; lane < count; lane++)
+	{
+		if (lane_active_[lane])
+		{
+			uint32_t slot        = tracks_[cubic_quat_tracks_[lane]].slot;
+			pose.rotations[slot] = load_quat_lane(lane_out_.data(), count, lane);
+			pose.written[slot] |= POSE_ROTATION;
+		}
+	}
+}
+
+// Steps only copy a key. There is nothing to vectorize.
+void AnimationClip::sample_steps(float time, Pose &pose)
+{
+	for (uint32_t track_idx : step_tracks_)
+	{
+		Track &track = tracks_[track_idx];
+		if (!find_interval(track, time))
+		{
+			continue;
+		}
+
+		if (track.target == AnimationTarget::eRotation)
+		{
+			pose.rotations[track.slot] = get_quat(track, track.cursor);
+			pose.written[track.slot] |= POSE_ROTATION;
+		}
+		else
+		{
+			write_vec3(track, get_vec3(track, track.cursor), pose);
+		}
+	}
+}
+
+// Unpack the value of a linear or step key.
+glm::vec3 AnimationClip::get_vec3(const Track &track, size_t key) const
+{
+	if (!track.is_packed)
+	{
+		return vec3_values_[track.first_value + key];
+	}
+	return vec3_ranges_[track.range].unpack(packed_vec3s_[track.first_value + key]);
+}
+
+glm::quat AnimationClip::get_quat(const Track &track, size_t key) const
+{
+	return unpack_quat(packed_quats_[track.first_value + key]);
+}
+
+void AnimationClip::write_vec3(const Track &track, const glm::vec3 &value, Pose &pose) const
+{
+	if (track.target == AnimationTarget::eTranslation)
+	{
+		pose.translations[track.slot] = value;
+		pose.written[track.slot] |= POSE_TRANSLATION;
+	}
+	else
+	{
+		pose.scales[track.slot] = value;
+		pose.written[track.slot] |= POSE_SCALE;
+	}
+}
+
+}        // namespace W3D::sg
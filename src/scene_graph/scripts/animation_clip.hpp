@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include <glm/gtx/quaternion.hpp>
+
+#include "common/glm_common.hpp"
+#include "scene_graph/scripts/animation.hpp"
+#include "scene_graph/scripts/clip_compression.hpp"
+
+namespace W3D::sg
+{
+class Node;
+struct Pose;
+
+// Runtime form of an animation's channels.
+// The keys of all channels live in a few flat arrays. Channels are grouped by interpolation and value type.
+// Keys are compressed when the clip is built. See clip_compression.
+// - Linear and step keys that the keys around them reproduce within a per-joint tolerance are dropped.
+// - Linear and step rotations are packed to 48 bits. Translations and scales are packed to 16 bits per component over the range of their track.
+//   The packing error is taken out of the joint's tolerance. A track whose range is too wide for it keeps its values as floats.
+// - Tracks with the same times share them.
+// Cubic spline keys are kept as they are. Their tangents don't fit the ranges of the values.
+// sample() gathers one lane per channel of a group into SoA arrays and interpolates the whole group with the SIMD kernels of soa_interpolate.
+// Results go into a Pose. Nothing is written to the nodes until the pose is committed.
+// * Linear rotations use nlerp. With keyframe rates animations are authored at, it is indistinguishable from slerp.
+class AnimationClip
+{
+  public:
+	AnimationClip(const std::vector<AnimationChannel> &channels);
+
+	// Pose slot -> node. Poses passed to sample() are initialized with these.
+	const std::vector<Node *>  &get_nodes() const;
+	float                       get_start_time() const;
+	float                       get_end_time() const;
+	const ClipCompressionStats &get_compression_stats() const;
+
+	// Channels whose keys don't cover time leave their target unwritten.
+	void sample(float time, Pose &pose);
+
+  private:
+	struct Track
+	{
+		uint32_t        slot;
+		AnimationTarget target;
+		AnimationType   type;
+		uint32_t        first_key;          // Into times_ and inv_durations_. Shared by tracks with the same times.
+		uint32_t        key_count;
+		uint32_t        first_value;        // Into packed_quats_ or packed_vec3s_. Cubic splines and unpacked vec3s index quat_values_ or vec3_values_, cubic splines with 3 values per key.
+		uint32_t        range;              // Into vec3_ranges_. Only used by packed vec3s.
+		bool            is_packed;
+		size_t          cursor;             // Interval sampled last.
+	};
+
+	void      add_channel(const AnimationChannel &channel, uint32_t slot, std::map<std::vector<float>, uint32_t> &time_tracks);
+	uint32_t  add_time_track(std::vector<float> &&times, std::map<std::vector<float>, uint32_t> &time_tracks);
+	bool      find_interval(Track &track, float time) const;
+	float     get_interp_val(const Track &track, float time) const;
+	glm::vec3 get_vec3(const Track &track, size_t key) const;
+	glm::quat get_quat(const Track &track, size_t key) const;
+	void  sample_linear_vec3s(float time, Pose &pose);
+	void  sample_linear_quats(float time, Pose &pose);
+	void  sample_cubic_vec3s(float time, Pose &pose);
+	void  sample_cubic_quats(float time, Pose &pose);
+	void  sample_steps(float time, Pose &pose);
+	void  gather_lanes(const std::vector<uint32_t> &track_indices, float time);
+	void  write_vec3(const Track &track, const glm::vec3 &value, Pose &pose) const;
+
+	std::vector<Node *>            p_nodes_;
+	std::vector<Track>             tracks_;
+	std::vector<float>             times_;
+	std::vector<float>             inv_durations_;        // 1 / (times_[k + 1] - times_[k]). 0 for empty intervals and for the last key of a track.
+	std::vector<PackedQuat>        packed_quats_;
+	std::vector<PackedVec3>        packed_vec3s_;
+	std::vector<glm::vec3>         vec3_values_;
+	std::vector<glm::quat>         quat_values_;
+	std::vector<QuantizationRange> vec3_ranges_;
+	std::vector<uint32_t>          linear_vec3_tracks_;
+	std::vector<uint32_t>          linear_quat_tracks_;
+	std::vector<uint32_t>          cubic_vec3_tracks_;
+	std::vector<uint32_t>          cubic_quat_tracks_;
+	std::vector<uint32_t>          step_tracks_;
+	float                          start_time_ = std::numeric_limits<float>::max();
+	float                          end_time_   = std::numeric_limits<float>::lowest();
+	ClipCompressionStats           compression_stats_;
+
+	// SoA lanes of the group being sampled. Reused across groups and frames.
+	std::vector<uint8_t> lane_active_;
+	std::vector<float>   lane_t_;
+	std::vector<float>   lane_a_;
+	std::vector<float>   lane_b_;
+	std::vector<float>   lane_c_;
+	std::vector<float>   lane_d_;
+	std::vector<float>   lane_out_;
+};
+
+}        // namespace W3D::sg
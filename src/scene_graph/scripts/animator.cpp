@@ -0,0 +1,489 @@
+#include "animator.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "scene_graph/node.hpp"
+#include "scene_graph/scripts/animation.hpp"
+#include "scene_graph/scripts/animation_clip.hpp"
+
+namespace W3D::sg
+{
+
+const uint32_t Animator::INVALID_SLOT = std::numeric_limits<uint32_t>::max();
+
+size_t find_group(std::vector<size_t> &parents, size_t i)
+{
+	while (parents[i] != i)
+	{
+		parents[i] = parents[parents[i]];
+		i          = parents[i];
+	}
+	return i;
+}
+
+// Nlerp along the shorter arc.
+glm::quat blend_rotation(const glm::quat &a, const glm::quat &b, float weight)
+{
+	glm::quat shortest_b = glm::dot(a, b) < 0.0f ? -b : b;
+	return glm::normalize(a * (1.0f - weight) + shortest_b * weight);
+}
+
+// Scale factor from reference to scale. Components with a zero reference stay 1.
+glm::vec3 get_scale_factor(const glm::vec3 &reference, const glm::vec3 &scale)
+{
+	glm::vec3 factor(1.0f);
+	for (glm::length_t c = 0; c < 3; c++)
+	{
+		if (reference[c] != 0.0f)
+		{
+			factor[c] = scale[c] / reference[c];
+		}
+	}
+	return factor;
+}
+
+std::vector<std::unique_ptr<Animator>> Animator::create_per_skeleton(const ComponentView<Animation> &p_animations)
+{
+	// Union the animations that share a node.
+	std::vector<size_t>                parents(p_animations.size());
+	std::unordered_map<Node *, size_t> node_to_animation;
+	std::iota(parents.begin(), parents.end(), 0);
+	for (size_t i = 0; i < p_animations.size(); i++)
+	{
+		for (Node *p_node : p_animations[i]->get_clip().get_nodes())
+		{
+			auto [it, inserted] = node_to_animation.emplace(p_node, i);
+			if (!inserted)
+			{
+				parents[find_group(parents, i)] = find_group(parents, it->second);
+			}
+		}
+	}
+
+	// Groups keep the order of the animations, so later layers win like later updates did.
+	std::vector<std::vector<Animation *>> groups;
+	std::unordered_map<size_t, size_t>    group_indices;
+	for (size_t i = 0; i < p_animations.size(); i++)
+	{
+		auto [it, inserted] = group_indices.emplace(find_group(parents, i), groups.size());
+		if (inserted)
+		{
+			groups.emplace_back();
+		}
+		groups[it->second].push_back(p_animations[i]);
+	}
+
+	std::vector<std::unique_ptr<Animator>> p_animators;
+	p_animators.reserve(groups.size());
+	for (const std::vector<Animation *> &group : groups)
+	{
+		std::unique_ptr<Animator> p_animator = std::make_unique<Animator>(group, group.front()->get_name());
+		for (Animation *p_animation : group)
+		{
+			p_animator->play(p_animator->add_layer(BlendMode::eOverride), *p_animation);
+		}
+		p_animators.push_back(std::move(p_animator));
+	}
+	return p_animators;
+}
+
+Animator::Animator(const std::vector<Animation *> &p_animations, const std::string &name) :
+    Script(name)
+{
+	for (Animation *p_animation : p_animations)
+	{
+		p_animation->set_driven(true);
+		for (Node *p_node : p_animation->get_clip().get_nodes())
+		{
+			if (node_to_slot_.emplace(p_node, static_cast<uint32_t>(p_nodes_.size())).second)
+			{
+				p_nodes_.push_back(p_node);
+			}
+		}
+	}
+	rest_pose_.init(p_nodes_);
+	layer_pose_.init(p_nodes_);
+	pose_.init(p_nodes_);
+	previous_pose_.init(p_nodes_);
+	shown_pose_.init(p_nodes_);
+}
+
+void Animator::update(float delta_time)
+{
+	sample(delta_time);
+	commit();
+}
+
+ScriptAccess Animator::get_access()
+{
+	return {
+	    .p_writes     = p_nodes_,
+	    .is_exclusive = false,
+	};
+}
+
+void Animator::sample(float delta_time)
+{
+	advance(delta_time);
+	if (is_evaluation_due())
+	{
+		evaluate();
+	}
+	else
+	{
+		interpolate();
+	}
+}
+
+void Animator::commit()
+{
+	if (p_pending_pose_)
+	{
+		p_pending_pose_->commit();
+		p_pending_pose_ = nullptr;
+	}
+}
+
+void Animator::set_update_interval(float interval)
+{
+	update_interval_ = std::max(0.0f, interval);
+}
+
+float Animator::get_update_interval() const
+{
+	return update_interval_;
+}
+
+void Animator::set_paused(bool paused)
+{
+	if (paused_ && !paused)
+	{
+		has_evaluated_ = false;
+	}
+	paused_ = paused;
+}
+
+bool Animator::is_paused() const
+{
+	return paused_;
+}
+
+void Animator::advance(float delta_time)
+{
+	pending_time_ += delta_time;
+	since_evaluation_ += delta_time;
+}
+
+bool Animator::is_evaluation_due() const
+{
+	return !paused_ && (!has_evaluated_ || since_evaluation_ >= update_interval_);
+}
+
+float Animator::get_time_since_evaluation() const
+{
+	return since_evaluation_;
+}
+
+// Evaluate the layers one update interval ahead of time.
+// Without an interval, or right after resuming, the pose is shown as is. Otherwise, interpolate() blends toward it.
+void Animator::evaluate()
+{
+	// The layers can't go back in time. When the interval shrinks, they stay ahead until time catches up.
+	float delta_time = std::max(0.0f, pending_time_ + update_interval_ - lead_time_);
+	lead_time_ += delta_time - pending_time_;
+	pending_time_     = 0.0f;
+	since_evaluation_ = 0.0f;
+
+	bool blend = update_interval_ > 0.0f && has_evaluated_;
+	if (blend)
+	{
+		previous_pose_ = is_blending_ ? shown_pose_ : pose_;
+	}
+	evaluate_layers(delta_time);
+	has_evaluated_  = true;
+	is_blending_    = blend;
+	p_pending_pose_ = blend ? nullptr : &pose_;
+}
+
+// Blend the nodes from the pose they showed at the last evaluation toward it.
+void Animator::interpolate()
+{
+	if (paused_ || !is_blending_)
+	{
+		return;
+	}
+
+	float t = update_interval_ > 0.0f ? std::min(1.0f, since_evaluation_ / update_interval_) : 1.0f;
+	for (size_t slot = 0; slot < p_nodes_.size(); slot++)
+	{
+		uint8_t written = previous_pose_.written[slot] | pose_.written[slot];
+		if (written)
+		{
+			shown_pose_.translations[slot] = glm::mix(previous_pose_.translations[slot], pose_.translations[slot], t);
+			shown_pose_.rotations[slot]    = blend_rotation(previous_pose_.rotations[slot], pose_.rotations[slot], t);
+			shown_pose_.scales[slot]       = glm::mix(previous_pose_.scales[slot], pose_.scales[slot], t);
+		}
+		shown_pose_.written[slot] = written;
+	}
+	p_pending_pose_ = &shown_pose_;
+}
+
+// Blend the layers into pose_ over the rest pose.
+void Animator::evaluate_layers(float delta_time)
+{
+	pose_.translations = rest_pose_.translations;
+	pose_.rotations    = rest_pose_.rotations;
+	pose_.scales       = rest_pose_.scales;
+	pose_.clear_written();
+
+	for (Layer &layer : layers_)
+	{
+		advance_layer(layer, delta_time);
+		if (layer.states.empty() || layer.weight <= 0.0f)
+		{
+			continue;
+		}
+
+		if (layer.mode == BlendMode::eOverride)
+		{
+			sample_override_layer(layer);
+			apply_override_layer(layer);
+		}
+		else
+		{
+			sample_additive_layer(layer);
+			apply_additive_layer(layer);
+		}
+	}
+}
+
+uint32_t Animator::add_layer(BlendMode mode, float weight)
+{
+	layers_.push_back(Layer{
+	    .mode   = mode,
+	    .weight = weight,
+	});
+	return static_cast<uint32_t>(layers_.size() - 1);
+}
+
+void Animator::set_layer_weight(uint32_t layer, float weight)
+{
+	layers_[layer].weight = weight;
+}
+
+void Animator::set_layer_mask(uint32_t layer, const std::unordered_map<const Node *, float> &node_weights)
+{
+	std::vector<float> &mask = layers_[layer].mask;
+	mask.resize(p_nodes_.size());
+	for (size_t slot = 0; slot < p_nodes_.size(); slot++)
+	{
+		auto it    = node_weights.find(p_nodes_[slot]);
+		mask[slot] = it != node_weights.end() ? it->second : 0.0f;
+	}
+}
+
+void Animator::clear_layer_mask(uint32_t layer)
+{
+	layers_[layer].mask.clear();
+}
+
+void Animator::play(uint32_t layer_idx, Animation &animation, float fade_time)
+{
+	Layer         &layer = layers_[layer_idx];
+	AnimationClip &clip  = animation.get_clip();
+
+	ClipState state{
+	    .p_animation = &animation,
+	    .time        = 0.0f,
+	    .fade        = fade_time > 0.0f ? 0.0f : 1.0f,
+	    .fade_rate   = fade_time > 0.0f ? 1.0f / fade_time : 0.0f,
+	};
+
+	state.slots.reserve(clip.get_nodes().size());
+	for (Node *p_node : clip.get_nodes())
+	{
+		auto it = node_to_slot_.find(p_node);
+		state.slots.push_back(it != node_to_slot_.end() ? it->second : INVALID_SLOT);
+	}
+	state.pose.init(clip.get_nodes());
+	if (layer.mode == BlendMode::eAdditive)
+	{
+		state.reference.init(clip.get_nodes());
+		clip.sample(clip.get_start_time(), state.reference);
+	}
+
+	// A cut replaces whatever the layer played.
+	if (state.fade >= 1.0f)
+	{
+		layer.states.clear();
+	}
+	layer.states.push_back(std::move(state));
+	animation.set_driven(true);
+}
+
+void Animator::stop(uint32_t layer)
+{
+	layers_[layer].states.clear();
+}
+
+const std::vector<Node *> &Animator::get_nodes() const
+{
+	return p_nodes_;
+}
+
+void Animator::advance_layer(Layer &layer, float delta_time)
+{
+	for (ClipState &state : layer.states)
+	{
+		state.time = state.p_animation->advance_time(state.time, delta_time);
+		state.fade = std::min(1.0f, state.fade + state.fade_rate * delta_time);
+	}
+
+	// A state that has faded in hides every state before it.
+	for (size_t i = layer.states.size(); i-- > 1;)
+	{
+		if (layer.states[i].fade >= 1.0f)
+		{
+			layer.states.erase(layer.states.begin(), layer.states.begin() + i);
+			break;
+		}
+	}
+}
+
+// The layer pose starts as the pose below the layer. Each state blends the targets it animates toward its clip by its fade.
+void Animator::sample_override_layer(Layer &layer)
+{
+	layer_pose_.translations = pose_.translations;
+	layer_pose_.rotations    = pose_.rotations;
+	layer_pose_.scales       = pose_.scales;
+	layer_pose_.clear_written();
+
+	for (ClipState &state : layer.states)
+	{
+		state.pose.clear_written();
+		state.p_animation->get_clip().sample(state.time, state.pose);
+		for (size_t clip_slot = 0; clip_slot < state.slots.size(); clip_slot++)
+		{
+			uint8_t  written = state.pose.written[clip_slot];
+			uint32_t slot    = state.slots[clip_slot];
+			if (!written || slot == INVALID_SLOT)
+			{
+				continue;
+			}
+
+			if (written & POSE_TRANSLATION)
+			{
+				layer_pose_.translations[slot] = glm::mix(layer_pose_.translations[slot], state.pose.translations[clip_slot], state.fade);
+			}
+			if (written & POSE_ROTATION)
+			{
+				layer_pose_.rotations[slot] = blend_rotation(layer_pose_.rotations[slot], state.pose.rotations[clip_slot], state.fade);
+			}
+			if (written & POSE_SCALE)
+			{
+				layer_pose_.scales[slot] = glm::mix(layer_pose_.scales[slot], state.pose.scales[clip_slot], state.fade);
+			}
+			layer_pose_.written[slot] |= written;
+		}
+	}
+}
+
+// The layer pose holds the difference of each clip to its first frame: translation offsets, rotations and scale factors.
+void Animator::sample_additive_layer(Layer &layer)
+{
+	std::fill(layer_pose_.translations.begin(), layer_pose_.translations.end(), glm::vec3(0.0f));
+	std::fill(layer_pose_.rotations.begin(), layer_pose_.rotations.end(), glm::quat::wxyz(1.0f, 0.0f, 0.0f, 0.0f));
+	std::fill(layer_pose_.scales.begin(), layer_pose_.scales.end(), glm::vec3(1.0f));
+	layer_pose_.clear_written();
+
+	for (ClipState &state : layer.states)
+	{
+		state.pose.clear_written();
+		state.p_animation->get_clip().sample(state.time, state.pose);
+		for (size_t clip_slot = 0; clip_slot < state.slots.size(); clip_slot++)
+		{
+			uint8_t  written = state.pose.written[clip_slot];
+			uint32_t slot    = state.slots[clip_slot];
+			if (!written || slot == INVALID_SLOT)
+			{
+				continue;
+			}
+
+			if (written & POSE_TRANSLATION)
+			{
+				glm::vec3 offset               = state.pose.translations[clip_slot] - state.reference.translations[clip_slot];
+				layer_pose_.translations[slot] = glm::mix(layer_pose_.translations[slot], offset, state.fade);
+			}
+			if (written & POSE_ROTATION)
+			{
+				glm::quat rotation          = glm::inverse(state.reference.rotations[clip_slot]) * state.pose.rotations[clip_slot];
+				layer_pose_.rotations[slot] = blend_rotation(layer_pose_.rotations[slot], rotation, state.fade);
+			}
+			if (written & POSE_SCALE)
+			{
+				glm::vec3 factor         = get_scale_factor(state.reference.scales[clip_slot], state.pose.scales[clip_slot]);
+				layer_pose_.scales[slot] = glm::mix(layer_pose_.scales[slot], factor, state.fade);
+			}
+			layer_pose_.written[slot] |= written;
+		}
+	}
+}
+
+void Animator::apply_override_layer(const Layer &layer)
+{
+	for (size_t slot = 0; slot < p_nodes_.size(); slot++)
+	{
+		uint8_t written = layer_pose_.written[slot];
+		float   weight  = layer.mask.empty() ? layer.weight : layer.weight * layer.mask[slot];
+		if (!written || weight <= 0.0f)
+		{
+			continue;
+		}
+
+		if (written & POSE_TRANSLATION)
+		{
+			pose_.translations[slot] = glm::mix(pose_.translations[slot], layer_pose_.translations[slot], weight);
+		}
+		if (written & POSE_ROTATION)
+		{
+			pose_.rotations[slot] = blend_rotation(pose_.rotations[slot], layer_pose_.rotations[slot], weight);
+		}
+		if (written & POSE_SCALE)
+		{
+			pose_.scales[slot] = glm::mix(pose_.scales[slot], layer_pose_.scales[slot], weight);
+		}
+		pose_.written[slot] |= written;
+	}
+}
+
+void Animator::apply_additive_layer(const Layer &layer)
+{
+	const glm::quat identity = glm::quat::wxyz(1.0f, 0.0f, 0.0f, 0.0f);
+	for (size_t slot = 0; slot < p_nodes_.size(); slot++)
+	{
+		uint8_t written = layer_pose_.written[slot];
+		float   weight  = layer.mask.empty() ? layer.weight : layer.weight * layer.mask[slot];
+		if (!written || weight <= 0.0f)
+		{
+			continue;
+		}
+
+		if (written & POSE_TRANSLATION)
+		{
+			pose_.translations[slot] += layer_pose_.translations[slot] * weight;
+		}
+		if (written & POSE_ROTATION)
+		{
+			pose_.rotations[slot] = glm::normalize(pose_.rotations[slot] * blend_rotation(identity, layer_pose_.rotations[slot], weight));
+		}
+		if (written & POSE_SCALE)
+		{
+			pose_.scales[slot] *= glm::mix(glm::vec3(1.0f), layer_pose_.scales[slot], weight);
+		}
+		pose_.written[slot] |= written;
+	}
+}
+
+}        // namespace W3D::sg
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "scene_graph/component.hpp"
+#include "scene_graph/script.hpp"
+#include "scene_graph/scripts/pose.hpp"
+
+namespace W3D::sg
+{
+class Animation;
+
+enum class BlendMode
+{
+	eOverride,        // Blend toward the layer's pose by the layer weight.
+	eAdditive,        // Add the difference between the clip and its first frame, scaled by the layer weight.
+};
+
+// Plays the animations of one skeleton on layers and blends them into one pose buffer.
+// Every update starts from the rest pose and applies the layers in order. Each node is written once, when the pose is committed.
+// A layer crossfades from the animation it played before to the one it was last asked to play.
+// The layers can be evaluated less often than the animator is updated. See set_update_interval() and AnimationScheduler.
+// * Animations passed to an animator are driven by it. They must not be updated on their own.
+class Animator : public Script
+{
+  public:
+	static const uint32_t INVALID_SLOT;
+
+	// One animator per group of animations that share nodes. Each animation plays on its own override layer.
+	// A target animated by several animations ends up with the value of the last one, like updating them one by one does.
+	static std::vector<std::unique_ptr<Animator>> create_per_skeleton(const ComponentView<Animation> &p_animations);
+
+	// The nodes of the animations make up the skeleton. The rest pose is their transforms at this point.
+	Animator(const std::vector<Animation *> &p_animations, const std::string &name = "");
+
+	void         update(float delta_time) override;
+	ScriptAccess get_access() override;
+	void         sample(float delta_time) override;
+	void         commit() override;
+
+	// Level of detail. AnimationScheduler calls advance() and then evaluate() or interpolate() instead of sample().
+	// With an interval, the layers are evaluated one interval ahead of time, every interval seconds.
+	// The updates in between blend the nodes from the pose they showed toward that evaluation. An interval of 0 evaluates every update.
+	void  set_update_interval(float interval);
+	float get_update_interval() const;
+	// A paused animator only keeps time. Its nodes hold their pose and the first evaluation after resuming snaps to the current time.
+	void  set_paused(bool paused);
+	bool  is_paused() const;
+	void  advance(float delta_time);
+	bool  is_evaluation_due() const;
+	float get_time_since_evaluation() const;
+	void  evaluate();
+	void  interpolate();
+
+	uint32_t add_layer(BlendMode mode, float weight = 1.0f);
+	void     set_layer_weight(uint32_t layer, float weight);
+	// Per node weight of a layer. Nodes that aren't in node_weights get 0.
+	void set_layer_mask(uint32_t layer, const std::unordered_map<const Node *, float> &node_weights);
+	void clear_layer_mask(uint32_t layer);
+	// Crossfade the layer to the animation over fade_time seconds. A fade time of 0 cuts to it.
+	void play(uint32_t layer, Animation &animation, float fade_time = 0.0f);
+	void stop(uint32_t layer);
+
+	const std::vector<Node *> &get_nodes() const;
+
+  private:
+	struct ClipState
+	{
+		Animation            *p_animation;
+		std::vector<uint32_t> slots;            // Clip pose slot -> animator slot. INVALID_SLOT for nodes outside the skeleton.
+		Pose                  pose;             // In clip slots.
+		Pose                  reference;        // Additive layers only. The clip at its start time.
+		float                 time;
+		float                 fade;             // Blend factor from the states before it. 1 once faded in.
+		float                 fade_rate;        // Fade per second.
+	};
+
+	struct Layer
+	{
+		BlendMode              mode;
+		float                  weight;
+		std::vector<float>     mask;          // Per slot. Empty means 1 everywhere.
+		std::vector<ClipState> states;        // Oldest first. States before the last one faded in are dropped.
+	};
+
+	void evaluate_layers(float delta_time);
+	void advance_layer(Layer &layer, float delta_time);
+	void sample_override_layer(Layer &layer);
+	void sample_additive_layer(Layer &layer);
+	void apply_override_layer(const Layer &layer);
+	void apply_additive_layer(const Layer &layer);
+
+	std::vector<Node *>                  p_nodes_;
+	std::unordered_map<Node *, uint32_t> node_to_slot_;
+	std::vector<Layer>                   layers_;
+	Pose                                 rest_pose_;
+	Pose                                 layer_pose_;        // Pose of the layer being applied. Deltas for additive layers.
+	Pose                                 pose_;
+
+	// Level of detail state.
+	Pose  previous_pose_;        // What the nodes showed when the layers were last evaluated.
+	Pose  shown_pose_;           // Blend of previous_pose_ and pose_.
+	float update_interval_  = 0.0f;
+	float pending_time_     = 0.0f;        // Time the layers haven't been advanced by yet.
+	float lead_time_        = 0.0f;        // How far the layers are ahead of time.
+	float since_evaluation_ = 0.0f;
+	bool  paused_           = false;
+	bool  has_evaluated_    = false;           // Cleared on resume, so that the next evaluation snaps.
+	bool  is_blending_      = false;           // The nodes show shown_pose_ rather than pose_.
+	Pose *p_pending_pose_   = nullptr;        // Pose the next commit() writes.
+};
+
+}        // namespace W3D::sg
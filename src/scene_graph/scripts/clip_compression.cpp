@@ -0,0 +1,265 @@
+#include "clip_compression.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/logging.hpp"
+
+namespace W3D::sg
+{
+
+const float    QUAT_COMPONENT_BOUND = 0.70710678f;        // No component but the largest can be bigger than 1 / sqrt(2).
+const uint64_t QUAT_COMPONENT_MAX   = (1 << 15) - 1;
+const float    VEC3_COMPONENT_MAX   = 65535.0f;
+// Longest run of keys a linear segment may replace. Bounds the reduction to O(count * MAX_REDUCED_SPAN).
+const size_t MAX_REDUCED_SPAN = 64;
+
+PackedQuat pack_quat(const glm::quat &q)
+{
+	glm::quat n             = glm::normalize(q);
+	float     components[4] = {n.x, n.y, n.z, n.w};
+	uint32_t  largest       = 0;
+	for (uint32_t c = 1; c < 4; c++)
+	{
+		if (std::abs(components[c]) > std::abs(components[largest]))
+		{
+			largest = c;
+		}
+	}
+
+	// q and -q are the same rotation. Flip q so the dropped component is positive.
+	float    sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+	uint64_t bits = largest;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		if (c == largest)
+		{
+			continue;
+		}
+		float normalized = std::clamp(sign * components[c] / QUAT_COMPONENT_BOUND * 0.5f + 0.5f, 0.0f, 1.0f);
+		bits             = (bits << 15) | static_cast<uint64_t>(normalized * QUAT_COMPONENT_MAX + 0.5f);
+	}
+	return {static_cast<uint16_t>(bits >> 32), static_cast<uint16_t>(bits >> 16), static_cast<uint16_t>(bits)};
+}
+
+glm::quat unpack_quat(const PackedQuat &packed)
+{
+	uint64_t bits    = (static_cast<uint64_t>(packed[0]) << 32) | (static_cast<uint64_t>(packed[1]) << 16) | packed[2];
+	uint32_t largest = static_cast<uint32_t>(bits >> 45) & 3;
+
+	// The last component packed is in the lowest bits.
+	float components[4];
+	float length_2 = 0.0f;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		uint32_t c = 3 - i;
+		if (c == largest)
+		{
+			continue;
+		}
+		float normalized = static_cast<float>(bits & QUAT_COMPONENT_MAX) / QUAT_COMPONENT_MAX;
+		components[c]    = (normalized * 2.0f - 1.0f) * QUAT_COMPONENT_BOUND;
+		length_2 += components[c] * components[c];
+		bits >>= 15;
+	}
+	components[largest] = std::sqrt(std::max(0.0f, 1.0f - length_2));
+	return glm::quat::wxyz(components[3], components[0], components[1], components[2]);
+}
+
+void QuantizationRange::include(const std::vector<glm::vec3> &values)
+{
+	for (const glm::vec3 &value : values)
+	{
+		min = glm::min(min, value);
+		max = glm::max(max, value);
+	}
+}
+
+PackedVec3 QuantizationRange::pack(const glm::vec3 &value) const
+{
+	PackedVec3 packed;
+	for (glm::length_t c = 0; c < 3; c++)
+	{
+		float extent     = max[c] - min[c];
+		float normalized = extent > 0.0f ? std::clamp((value[c] - min[c]) / extent, 0.0f, 1.0f) : 0.0f;
+		packed[c]        = static_cast<uint16_t>(normalized * VEC3_COMPONENT_MAX + 0.5f);
+	}
+	return packed;
+}
+
+glm::vec3 QuantizationRange::unpack(const PackedVec3 &packed) const
+{
+	glm::vec3 value;
+	for (glm::length_t c = 0; c < 3; c++)
+	{
+		value[c] = min[c] + packed[c] / VEC3_COMPONENT_MAX * (max[c] - min[c]);
+	}
+	return value;
+}
+
+float QuantizationRange::get_max_error() const
+{
+	// Each component is rounded by half a step at most.
+	return glm::length(max - min) / VEC3_COMPONENT_MAX * 0.5f;
+}
+
+glm::quat nlerp(const glm::quat &a, const glm::quat &b, float t)
+{
+	glm::quat shortest_b = glm::dot(a, b) < 0.0f ? -b : b;
+	return glm::normalize(a * (1.0f - t) + shortest_b * t);
+}
+
+// Angle of the rotation from a to b. acos(dot) has no precision left near 1, so we take the atan2 of the chord lengths instead.
+float get_angle_between(const glm::quat &a, const glm::quat &b)
+{
+	glm::quat n_a = glm::normalize(a);
+	glm::quat n_b = glm::normalize(b);
+	if (glm::dot(n_a, n_b) < 0.0f)
+	{
+		n_b = -n_b;
+	}
+	glm::quat difference = n_a + (-n_b);
+	glm::quat sum        = n_a + n_b;
+	return 4.0f * std::atan2(std::sqrt(glm::dot(difference, difference)), std::sqrt(glm::dot(sum, sum)));
+}
+
+float get_linear_error(const glm::vec3 &a, const glm::vec3 &b, float t, const glm::vec3 &value)
+{
+	return glm::distance(glm::mix(a, b, t), value);
+}
+
+float get_linear_error(const glm::quat &a, const glm::quat &b, float t, const glm::quat &value)
+{
+	return get_angle_between(nlerp(a, b, t), value);
+}
+
+float get_step_error(const glm::vec3 &a, const glm::vec3 &b)
+{
+	return glm::distance(a, b);
+}
+
+float get_step_error(const glm::quat &a, const glm::quat &b)
+{
+	return get_angle_between(a, b);
+}
+
+// Can the segment anchor -> end replace every key in between?
+template <typename T>
+bool fits_segment(const float *p_times, const T *p_values, size_t anchor, size_t end, float tolerance)
+{
+	if (end - anchor < 2)
+	{
+		return true;
+	}
+
+	float duration = p_times[end] - p_times[anchor];
+	if (duration <= 0.0f)
+	{
+		return false;
+	}
+	for (size_t i = anchor + 1; i < end; i++)
+	{
+		float t = (p_times[i] - p_times[anchor]) / duration;
+		if (get_linear_error(p_values[anchor], p_values[end], t, p_values[i]) > tolerance)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Grow a segment from the last key kept until it can't replace the keys it spans, then keep the key before its end.
+template <typename T>
+std::vector<uint32_t> reduce_linear_keys_impl(const float *p_times, const T *p_values, size_t count, float tolerance)
+{
+	std::vector<uint32_t> kept;
+	if (count == 0)
+	{
+		return kept;
+	}
+
+	kept.push_back(0);
+	size_t anchor = 0;
+	for (size_t end = 2; end < count; end++)
+	{
+		if (end - anchor > MAX_REDUCED_SPAN || !fits_segment(p_times, p_values, anchor, end, tolerance))
+		{
+			anchor = end - 1;
+			kept.push_back(static_cast<uint32_t>(anchor));
+		}
+	}
+	if (count > 1)
+	{
+		kept.push_back(static_cast<uint32_t>(count - 1));
+	}
+	return kept;
+}
+
+template <typename T>
+std::vector<uint32_t> reduce_step_keys_impl(const T *p_values, size_t count, float tolerance)
+{
+	std::vector<uint32_t> kept;
+	if (count == 0)
+	{
+		return kept;
+	}
+
+	kept.push_back(0);
+	for (size_t i = 1; i + 1 < count; i++)
+	{
+		if (get_step_error(p_values[kept.back()], p_values[i]) > tolerance)
+		{
+			kept.push_back(static_cast<uint32_t>(i));
+		}
+	}
+	if (count > 1)
+	{
+		kept.push_back(static_cast<uint32_t>(count - 1));
+	}
+	return kept;
+}
+
+std::vector<uint32_t> reduce_linear_keys(const float *p_times, const glm::vec3 *p_values, size_t count, float tolerance)
+{
+	return reduce_linear_keys_impl(p_times, p_values, count, tolerance);
+}
+
+std::vector<uint32_t> reduce_linear_keys(const float *p_times, const glm::quat *p_values, size_t count, float tolerance)
+{
+	return reduce_linear_keys_impl(p_times, p_values, count, tolerance);
+}
+
+std::vector<uint32_t> reduce_step_keys(const glm::vec3 *p_values, size_t count, float tolerance)
+{
+	return reduce_step_keys_impl(p_values, count, tolerance);
+}
+
+std::vector<uint32_t> reduce_step_keys(const glm::quat *p_values, size_t count, float tolerance)
+{
+	return reduce_step_keys_impl(p_values, count, tolerance);
+}
+
+void ClipCompressionStats::add(const ClipCompressionStats &other)
+{
+	raw_key_count += other.raw_key_count;
+	key_count += other.key_count;
+	raw_size += other.raw_size;
+	size += other.size;
+	track_count += other.track_count;
+	shared_time_track_count += other.shared_time_track_count;
+}
+
+void log_clip_compression_stats(const std::string &label, const ClipCompressionStats &stats)
+{
+	LOGI("{}: kept {} of {} keys, {:.2f} MB -> {:.2f} MB ({:.1f}x). {} of {} tracks share their times.",
+	     label,
+	     stats.key_count,
+	     stats.raw_key_count,
+	     stats.raw_size / (1024.0 * 1024.0),
+	     stats.size / (1024.0 * 1024.0),
+	     stats.size ? static_cast<double>(stats.raw_size) / stats.size : 0.0,
+	     stats.shared_time_track_count,
+	     stats.track_count);
+}
+
+}        // namespace W3D::sg
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <glm/gtx/quaternion.hpp>
+
+#include "common/glm_common.hpp"
+
+namespace W3D::sg
+{
+
+// Smallest-three quaternion in 48 bits.
+// The largest component is dropped and recovered from the other three, since the quaternion is unit length.
+// 2 bits hold its index, the other three components take 15 bits each over [-1 / sqrt(2), 1 / sqrt(2)].
+using PackedQuat = std::array<uint16_t, 3>;
+// 16 bits per component over a QuantizationRange.
+using PackedVec3 = std::array<uint16_t, 3>;
+
+PackedQuat pack_quat(const glm::quat &q);
+glm::quat  unpack_quat(const PackedQuat &packed);
+
+// Per-component range that vec3s are quantized over.
+struct QuantizationRange
+{
+	void       include(const std::vector<glm::vec3> &values);
+	PackedVec3 pack(const glm::vec3 &value) const;
+	glm::vec3  unpack(const PackedVec3 &packed) const;
+	// Largest distance between a value in the range and its unpacked value.
+	float get_max_error() const;
+
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+};
+
+// Key reduction. These return the indices of the keys to keep. The first and last keys are always kept.
+// A linear key is dropped when interpolating the keys kept around it reproduces it within tolerance.
+// Rotation tolerances are angles in radians. Rotations are interpolated with nlerp, like AnimationClip does.
+std::vector<uint32_t> reduce_linear_keys(const float *p_times, const glm::vec3 *p_values, size_t count, float tolerance);
+std::vector<uint32_t> reduce_linear_keys(const float *p_times, const glm::quat *p_values, size_t count, float tolerance);
+// A step key is dropped when it is within tolerance of the key kept before it.
+std::vector<uint32_t> reduce_step_keys(const glm::vec3 *p_values, size_t count, float tolerance);
+std::vector<uint32_t> reduce_step_keys(const glm::quat *p_values, size_t count, float tolerance);
+
+struct ClipCompressionStats
+{
+	void add(const ClipCompressionStats &other);
+
+	size_t raw_key_count           = 0;
+	size_t key_count               = 0;
+	size_t raw_size                = 0;        // Bytes of times and values in the channels.
+	size_t size                    = 0;        // Bytes of times, interval lengths and values in the clip.
+	size_t track_count             = 0;
+	size_t shared_time_track_count = 0;        // Tracks that reuse the times of another track.
+};
+
+void log_clip_compression_stats(const std::string &label, const ClipCompressionStats &stats);
+
+}        // namespace W3D::sg
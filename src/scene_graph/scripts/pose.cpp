@@ -0,0 +1,56 @@
+#include "pose.hpp"
+
+#include <algorithm>
+
+#include "scene_graph/node.hpp"
+
+namespace W3D::sg
+{
+
+void Pose::init(const std::vector<Node *> &p_pose_nodes)
+{
+	p_nodes = p_pose_nodes;
+	translations.resize(p_nodes.size());
+	rotations.resize(p_nodes.size());
+	scales.resize(p_nodes.size());
+	written.assign(p_nodes.size(), 0);
+	for (size_t slot = 0; slot < p_nodes.size(); slot++)
+	{
+		Transform &T       = p_nodes[slot]->get_transform();
+		translations[slot] = T.get_translation();
+		rotations[slot]    = T.get_rotation();
+		scales[slot]       = T.get_scale();
+	}
+}
+
+void Pose::clear_written()
+{
+	std::fill(written.begin(), written.end(), 0);
+}
+
+void Pose::commit() const
+{
+	for (size_t slot = 0; slot < p_nodes.size(); slot++)
+	{
+		if (!written[slot])
+		{
+			continue;
+		}
+
+		Transform &T = p_nodes[slot]->get_transform();
+		if (written[slot] & POSE_TRANSLATION)
+		{
+			T.set_tranlsation(translations[slot]);
+		}
+		if (written[slot] & POSE_ROTATION)
+		{
+			T.set_rotation(rotations[slot]);
+		}
+		if (written[slot] & POSE_SCALE)
+		{
+			T.set_scale(scales[slot]);
+		}
+	}
+}
+
+}        // namespace W3D::sg
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/gtx/quaternion.hpp>
+
+#include "common/glm_common.hpp"
+
+namespace W3D::sg
+{
+class Node;
+
+enum PoseTargetBits : uint8_t
+{
+	POSE_TRANSLATION = 1 << 0,
+	POSE_ROTATION    = 1 << 1,
+	POSE_SCALE       = 1 << 2,
+};
+
+// Local transforms of a fixed set of nodes, one slot per node.
+// Animations write into a pose and commit() then sets every written target on the nodes in one pass.
+struct Pose
+{
+	// Start from the nodes' current local transforms.
+	void init(const std::vector<Node *> &p_pose_nodes);
+	void clear_written();
+	void commit() const;
+
+	std::vector<Node *>    p_nodes;
+	std::vector<glm::vec3> translations;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<uint8_t>   written;        // PoseTargetBits set since the last clear_written().
+};
+
+}        // namespace W3D::sg
@@ -0,0 +1,156 @@
+#include "transform_hierarchy.hpp"
+
+#include <algorithm>
+#include <queue>
+
+#include "scene_graph/node.hpp"
+
+namespace W3D::sg
+{
+
+const int32_t TransformHierarchy::NO_PARENT = -1;
+
+// Assign slots in breadth first order and bind every reachable transform to its slot.
+TransformHierarchy::TransformHierarchy(Node &root)
+{
+	struct NodeTraversal
+	{
+		Node   *p_node;
+		int32_t parent_slot;
+	};
+
+	std::queue<NodeTraversal> q;
+	q.push({
+	    .p_node      = &root,
+	    .parent_slot = NO_PARENT,
+	});
+
+	while (!q.empty())
+	{
+		NodeTraversal traversal = q.front();
+		q.pop();
+
+		uint32_t   slot = static_cast<uint32_t>(parents_.size());
+		Transform &T    = traversal.p_node->get_transform();
+		translations_.push_back(T.get_translation());
+		rotations_.push_back(T.get_rotation());
+		scales_.push_back(T.get_scale());
+		// Nodes like the default camera are children of root without having root set as their parent.
+		parents_.push_back(traversal.p_node->get_parent() ? traversal.parent_slot : NO_PARENT);
+		T.bind(this, slot);
+
+		for (Node *p_child : traversal.p_node->get_children())
+		{
+			q.push({
+			    .p_node      = p_child,
+			    .parent_slot = static_cast<int32_t>(slot),
+			});
+		}
+	}
+
+	world_Ms_.resize(parents_.size(), glm::mat4(1.0f));
+	updated_.resize(parents_.size(), 0);
+	dirty_bits_.resize((parents_.size() + 63) / 64, ~0ull);
+	first_dirty_ = 0;
+	has_dirty_   = true;
+}
+
+TransformHierarchy::~TransformHierarchy()
+{
+}
+
+const glm::vec3 &TransformHierarchy::get_translation(uint32_t slot) const
+{
+	return translations_[slot];
+}
+
+const glm::quat &TransformHierarchy::get_rotation(uint32_t slot) const
+{
+	return rotations_[slot];
+}
+
+const glm::vec3 &TransformHierarchy::get_scale(uint32_t slot) const
+{
+	return scales_[slot];
+}
+
+glm::mat4 TransformHierarchy::get_local_M(uint32_t slot) const
+{
+	return glm::translate(glm::mat4(1.0), translations_[slot]) * glm::mat4_cast(rotations_[slot]) *
+	       glm::scale(glm::mat4(1.0), scales_[slot]);
+}
+
+const glm::mat4 &TransformHierarchy::get_world_M(uint32_t slot)
+{
+	if (has_dirty_)
+	{
+		update_world_Ms();
+	}
+	return world_Ms_[slot];
+}
+
+void TransformHierarchy::set_translation(uint32_t slot, const glm::vec3 &translation)
+{
+	translations_[slot] = translation;
+	mark_dirty(slot);
+}
+
+void TransformHierarchy::set_rotation(uint32_t slot, const glm::quat &rotation)
+{
+	rotations_[slot] = rotation;
+	mark_dirty(slot);
+}
+
+void TransformHierarchy::set_scale(uint32_t slot, const glm::vec3 &scale)
+{
+	scales_[slot] = scale;
+	mark_dirty(slot);
+}
+
+// Only the slot itself is marked. Its descendants are picked up by the update pass.
+void TransformHierarchy::mark_dirty(uint32_t slot)
+{
+	dirty_bits_[slot / 64] |= 1ull << (slot % 64);
+	first_dirty_ = has_dirty_ ? std::min(first_dirty_, slot) : slot;
+	has_dirty_   = true;
+}
+
+// Recompute the dirty slots and their descendants in one pass.
+// Parents come first, so a parent's world matrix is final by the time its children read it.
+void TransformHierarchy::update_world_Ms()
+{
+	if (!has_dirty_)
+	{
+		return;
+	}
+
+	uint32_t size = get_size();
+	for (uint32_t slot = first_dirty_; slot < size; slot++)
+	{
+		int32_t parent = parents_[slot];
+		// Slots before first_dirty_ are not recomputed in this pass. Their updated_ flags are from an earlier one.
+		bool parent_updated = parent >= static_cast<int32_t>(first_dirty_) && updated_[parent];
+		bool dirty          = (dirty_bits_[slot / 64] >> (slot % 64)) & 1ull;
+		updated_[slot]      = dirty || parent_updated;
+		if (!updated_[slot])
+		{
+			continue;
+		}
+
+		world_Ms_[slot] = get_local_M(slot);
+		if (parent != NO_PARENT)
+		{
+			world_Ms_[slot] = world_Ms_[parent] * world_Ms_[slot];
+		}
+	}
+
+	std::fill(dirty_bits_.begin() + first_dirty_ / 64, dirty_bits_.end(), 0ull);
+	has_dirty_ = false;
+}
+
+uint32_t TransformHierarchy::get_size() const
+{
+	return static_cast<uint32_t>(parents_.size());
+}
+
+}        // namespace W3D::sg
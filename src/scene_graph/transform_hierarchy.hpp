@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/gtx/quaternion.hpp>
+
+#include "common/glm_common.hpp"
+
+namespace W3D::sg
+{
+class Node;
+
+// Transforms of a scene stored as arrays, one slot per node.
+// Slots are in breadth first order from the root, so a parent always comes before its children.
+// Setting a local transform only marks its slot dirty. update_world_Ms() then recomputes the world matrices in one pass:
+// a slot is recomputed if it is dirty or its parent was recomputed in the same pass.
+// * Bound sg::Transforms forward to their slot. See Transform::bind().
+// ! The parent of a slot is fixed when the hierarchy is built. Rebuild it after reparenting or adding nodes.
+class TransformHierarchy
+{
+  public:
+	static const int32_t NO_PARENT;
+
+	TransformHierarchy(Node &root);
+	TransformHierarchy(const TransformHierarchy &)            = delete;
+	TransformHierarchy &operator=(const TransformHierarchy &) = delete;
+	~TransformHierarchy();
+
+	const glm::vec3 &get_translation(uint32_t slot) const;
+	const glm::quat &get_rotation(uint32_t slot) const;
+	const glm::vec3 &get_scale(uint32_t slot) const;
+	glm::mat4        get_local_M(uint32_t slot) const;
+	// Run the update pass first if any slot is dirty.
+	const glm::mat4 &get_world_M(uint32_t slot);
+
+	void set_translation(uint32_t slot, const glm::vec3 &translation);
+	void set_rotation(uint32_t slot, const glm::quat &rotation);
+	void set_scale(uint32_t slot, const glm::vec3 &scale);
+	void mark_dirty(uint32_t slot);
+
+	void     update_world_Ms();
+	uint32_t get_size() const;
+
+  private:
+	std::vector<glm::vec3> translations_;
+	std::vector<glm::quat> rotations_;
+	std::vector<glm::vec3> scales_;
+	std::vector<glm::mat4> world_Ms_;
+	std::vector<int32_t>   parents_;
+	std::vector<uint64_t>  dirty_bits_;
+	std::vector<uint8_t>   updated_;                // Whether the slot was recomputed in the last pass.
+	uint32_t               first_dirty_ = 0;        // Slots before it are unaffected by the pending changes.
+	bool                   has_dirty_   = false;
+};
+}        // namespace W3D::sg
@@ -0,0 +1,321 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "core/command_buffer.hpp"
+#include "core/device.hpp"
+#include "core/device_memory/allocator.hpp"
+#include "core/upload_batch.hpp"
+
+#include "scene_graph/components/camera.hpp"
+#include "scene_graph/components/image.hpp"
+#include "scene_graph/components/mesh.hpp"
+#include "scene_graph/components/pbr_material.hpp"
+#include "scene_graph/components/submesh.hpp"
+#include "scene_graph/components/texture.hpp"
+#include "scene_graph/node.hpp"
+#include "scene_graph/scene.hpp"
+
+namespace W3D
+{
+const size_t   TextureStreamer::DEFAULT_BYTE_BUDGET   = 512 * 1024 * 1024;
+const size_t   TextureStreamer::DEFAULT_UPLOAD_BUDGET = 16 * 1024 * 1024;
+const uint32_t TextureStreamer::MAX_TAIL_EXTENT       = 64;
+
+// The first level that is not larger than MAX_TAIL_EXTENT.
+uint32_t TextureStreamer::get_tail_level(const ImageMetaInfo &meta)
+{
+	uint32_t level = 0;
+	while (level + 1 < meta.levels && std::max(meta.extent.width >> level, meta.extent.height >> level) > MAX_TAIL_EXTENT)
+	{
+		level++;
+	}
+	return level;
+}
+
+// Offset of first_level in a tightly packed chain.
+size_t TextureStreamer::get_levels_offset(const ImageMetaInfo &meta, uint32_t first_level)
+{
+	size_t offset = 0;
+	for (uint32_t m = 0; m < first_level; m++)
+	{
+		offset += ImageResource::get_level_size(meta.format, meta.extent, m);
+	}
+	return offset;
+}
+
+// The meta info of an image that starts at first_level.
+ImageMetaInfo TextureStreamer::get_resident_meta(const ImageMetaInfo &meta, uint32_t first_level)
+{
+	return {
+	    .extent = {
+	        .width  = std::max(meta.extent.width >> first_level, 1u),
+	        .height = std::max(meta.extent.height >> first_level, 1u),
+	        .depth  = 1,
+	    },
+	    .format = meta.format,
+	    .levels = meta.levels - first_level,
+	};
+}
+
+// retire_frames is the number of update() calls a replaced image is kept alive for. Use the number of inflight frames.
+TextureStreamer::TextureStreamer(const Device &device, uint32_t retire_frames, size_t byte_budget, size_t upload_budget) :
+    device_(device),
+    retire_frames_(retire_frames),
+    byte_budget_(byte_budget),
+    upload_budget_(upload_budget)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+void TextureStreamer::add_image(sg::Image &image, const ImageMetaInfo &meta, const uint8_t *p_levels, UploadBatch &batch)
+{
+	uint32_t tail_level = get_tail_level(meta);
+	streamed_images_.push_back({
+	    .p_image        = &image,
+	    .meta           = meta,
+	    .p_levels       = p_levels,
+	    .tail_level     = tail_level,
+	    .resident_level = meta.levels,
+	    .wanted_level   = tail_level,
+	    .priority       = 0.0f,
+	});
+	resource_to_image_[&image.get_resource()] = streamed_images_.size() - 1;
+	make_resident(streamed_images_.back(), tail_level, batch);
+}
+
+void TextureStreamer::hold_source(std::shared_ptr<const void> p_source)
+{
+	p_sources_.push_back(std::move(p_source));
+}
+
+void TextureStreamer::set_byte_budget(size_t byte_budget)
+{
+	byte_budget_ = byte_budget;
+}
+
+size_t TextureStreamer::get_resident_size() const
+{
+	return resident_size_;
+}
+
+// Move every image towards the level its meshes need.
+// Drops go first so that the loads can reuse their memory. Loads are done by priority until upload_budget_ is reached.
+std::vector<sg::Texture *> TextureStreamer::update(sg::Scene &scene, sg::Camera &camera, float viewport_height)
+{
+	release_retired_resources();
+	if (streamed_images_.empty())
+	{
+		return {};
+	}
+
+	compute_wanted_levels(scene, camera, viewport_height);
+	bool is_budget_bound = fit_wanted_levels_in_budget();
+
+	UploadBatch         batch(device_);
+	std::vector<bool>   is_changed(streamed_images_.size(), false);
+	std::vector<size_t> loads;
+
+	for (size_t i = 0; i < streamed_images_.size(); i++)
+	{
+		StreamedImage &streamed_image = streamed_images_[i];
+		// Keep one extra level when there's room, so that small camera moves don't reallocate the image back and forth.
+		if (streamed_image.wanted_level > streamed_image.resident_level + (is_budget_bound ? 0 : 1))
+		{
+			make_resident(streamed_image, streamed_image.wanted_level, batch);
+			is_changed[i] = true;
+		}
+		else if (streamed_image.wanted_level < streamed_image.resident_level)
+		{
+			loads.push_back(i);
+		}
+	}
+
+	std::sort(loads.begin(), loads.end(), [this](size_t lhs, size_t rhs) {
+		return streamed_images_[lhs].priority > streamed_images_[rhs].priority;
+	});
+
+	size_t uploaded_size = 0;
+	for (size_t i : loads)
+	{
+		StreamedImage &streamed_image = streamed_images_[i];
+		if (uploaded_size > 0 && uploaded_size + get_chain_size(streamed_image, streamed_image.wanted_level) > upload_budget_)
+		{
+			break;
+		}
+		uploaded_size += get_chain_size(streamed_image, streamed_image.wanted_level);
+		make_resident(streamed_image, streamed_image.wanted_level, batch);
+		is_changed[i] = true;
+	}
+	batch.flush();
+
+	std::vector<sg::Texture *> p_changed_textures;
+	for (sg::Texture *p_texture : scene.get_components<sg::Texture>())
+	{
+		auto it = resource_to_image_.find(p_texture->p_resource_);
+		if (it != resource_to_image_.end() && is_changed[it->second])
+		{
+			p_changed_textures.push_back(p_texture);
+		}
+	}
+	return p_changed_textures;
+}
+
+// Destroy the replaced images that no inflight frame can reference anymore.
+void TextureStreamer::release_retired_resources()
+{
+	for (RetiredResource &retired_resource : retired_resources_)
+	{
+		retired_resource.frames_left--;
+	}
+	retired_resources_.erase(std::remove_if(retired_resources_.begin(), retired_resources_.end(), [](const RetiredResource &retired_resource) {
+		                         return retired_resource.frames_left == 0;
+	                         }),
+	                         retired_resources_.end());
+}
+
+// Project the bounds of every mesh instance and derive the level that gives about one texel per pixel.
+// * This assumes that a texture is mapped once over its mesh. Images that no mesh samples fall back to their tail.
+void TextureStreamer::compute_wanted_levels(sg::Scene &scene, sg::Camera &camera, float viewport_height)
+{
+	for (StreamedImage &streamed_image : streamed_images_)
+	{
+		streamed_image.wanted_level = streamed_image.tail_level;
+		streamed_image.priority     = 0.0f;
+	}
+
+	glm::mat4 view    = camera.get_view();
+	glm::vec3 cam_pos = glm::vec3(glm::inverse(view)[3]);
+	// Pixels covered by one unit at distance one.
+	float focal = std::abs(camera.get_projection()[1][1]) * viewport_height * 0.5f;
+
+	for (sg::Mesh *p_mesh : scene.get_components<sg::Mesh>())
+	{
+		for (sg::Node *p_node : p_mesh->get_p_nodes())
+		{
+			sg::AABB bounds   = p_mesh->get_bounds().transform(p_node->get_transform().get_world_M());
+			float    radius   = glm::length(bounds.get_max() - bounds.get_min()) * 0.5f;
+			float    distance = glm::length(bounds.get_center() - cam_pos);
+			float    pixels   = distance > radius ? 2.0f * radius * focal / distance : std::numeric_limits<float>::max();
+
+			for (sg::SubMesh *p_submesh : p_mesh->get_p_submeshs())
+			{
+				const sg::PBRMaterial *p_material = dynamic_cast<const sg::PBRMaterial *>(p_submesh->get_material());
+				if (!p_material)
+				{
+					continue;
+				}
+				for (const auto &[name, p_texture] : p_material->texture_map_)
+				{
+					auto it = resource_to_image_.find(p_texture->p_resource_);
+					if (it == resource_to_image_.end())
+					{
+						continue;
+					}
+
+					StreamedImage &streamed_image = streamed_images_[it->second];
+					float          extent         = static_cast<float>(std::max(streamed_image.meta.extent.width, streamed_image.meta.extent.height));
+					uint32_t       level          = 0;
+					if (pixels < extent)
+					{
+						level = static_cast<uint32_t>(std::floor(std::log2(extent / std::max(pixels, 1.0f))));
+					}
+					streamed_image.wanted_level = std::min(streamed_image.wanted_level, std::min(level, streamed_image.tail_level));
+					streamed_image.priority     = std::max(streamed_image.priority, pixels);
+				}
+			}
+		}
+	}
+}
+
+// Drop levels from the least visible images until the wanted levels fit in the budget.
+// Return true if some image had to give up a level it wanted.
+bool TextureStreamer::fit_wanted_levels_in_budget()
+{
+	size_t budget     = get_budget();
+	size_t total_size = 0;
+	for (const StreamedImage &streamed_image : streamed_images_)
+	{
+		total_size += get_chain_size(streamed_image, streamed_image.wanted_level);
+	}
+	if (total_size <= budget)
+	{
+		return false;
+	}
+
+	std::vector<size_t> order(streamed_images_.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+		return streamed_images_[lhs].priority < streamed_images_[rhs].priority;
+	});
+
+	// Every pass takes one level from each image, least visible first.
+	bool is_dropped = true;
+	while (total_size > budget && is_dropped)
+	{
+		is_dropped = false;
+		for (size_t i : order)
+		{
+			StreamedImage &streamed_image = streamed_images_[i];
+			if (streamed_image.wanted_level < streamed_image.tail_level)
+			{
+				total_size -= ImageResource::get_level_size(streamed_image.meta.format, streamed_image.meta.extent, streamed_image.wanted_level);
+				streamed_image.wanted_level++;
+				is_dropped = true;
+				if (total_size <= budget)
+				{
+					break;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// Reallocate an image with the levels [level, levels) and record their upload.
+// The image it replaces is retired.
+void TextureStreamer::make_resident(StreamedImage &streamed_image, uint32_t level, UploadBatch &batch)
+{
+	ImageMetaInfo  resident_meta = get_resident_meta(streamed_image.meta, level);
+	ImageResource  resource      = ImageResource::create_empty_two_dim_img_resrc(device_, resident_meta);
+	size_t         size          = get_chain_size(streamed_image, level);
+	Buffer        &staging_buf   = batch.stage(streamed_image.p_levels + get_levels_offset(streamed_image.meta, level), size);
+	CommandBuffer &cmd_buf       = batch.get_cmd_buf();
+
+	cmd_buf.set_image_layout(resource, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eHost, vk::PipelineStageFlagBits::eTransfer);
+	cmd_buf.update_image(resource, staging_buf);
+	cmd_buf.set_image_layout(resource, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader);
+
+	if (streamed_image.resident_level < streamed_image.meta.levels)
+	{
+		resident_size_ -= get_chain_size(streamed_image, streamed_image.resident_level);
+		retired_resources_.push_back({
+		    .resource    = std::move(streamed_image.p_image->get_resource()),
+		    .frames_left = retire_frames_,
+		});
+	}
+	streamed_image.p_image->set_resource(std::move(resource));
+	streamed_image.resident_level = level;
+	resident_size_ += size;
+}
+
+size_t TextureStreamer::get_chain_size(const StreamedImage &streamed_image, uint32_t first_level) const
+{
+	return get_levels_offset(streamed_image.meta, streamed_image.meta.levels) - get_levels_offset(streamed_image.meta, first_level);
+}
+
+// byte_budget_, lowered to what the device local heaps have left.
+size_t TextureStreamer::get_budget() const
+{
+	DeviceMemoryBudget heap_budget = device_.get_device_memory_allocator().get_device_local_budget();
+	size_t             available   = heap_budget.budget > heap_budget.usage ? heap_budget.budget - heap_budget.usage : 0;
+	return std::min(byte_budget_, resident_size_ + available);
+}
+
+}        // namespace W3D
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "core/image_resource.hpp"
+
+namespace W3D
+{
+class Device;
+class UploadBatch;
+
+namespace sg
+{
+class Camera;
+class Image;
+class Scene;
+class Texture;
+}        // namespace sg
+
+// Streams the mip levels of images in and out of device memory.
+// Every streamed image starts with only its tail levels resident (see MAX_TAIL_EXTENT).
+// update() estimates the level each image needs from the projected size of the meshes that sample it.
+// Levels are then uploaded or dropped so that the streamed images fit in the byte budget and in VMA's heap budget.
+// * An image only holds its resident levels, so a residency change reallocates it. The old image is retired until no inflight frame can use it.
+// * Levels are read again from their source every time they come back in. See hold_source().
+class TextureStreamer
+{
+  public:
+	static const size_t   DEFAULT_BYTE_BUDGET;          // Device memory for all streamed images.
+	static const size_t   DEFAULT_UPLOAD_BUDGET;        // Bytes uploaded per update.
+	static const uint32_t MAX_TAIL_EXTENT;              // Levels up to this size are always resident.
+
+	static uint32_t      get_tail_level(const ImageMetaInfo &meta);
+	static size_t        get_levels_offset(const ImageMetaInfo &meta, uint32_t first_level);
+	static ImageMetaInfo get_resident_meta(const ImageMetaInfo &meta, uint32_t first_level);
+
+	TextureStreamer(const Device &device, uint32_t retire_frames, size_t byte_budget = DEFAULT_BYTE_BUDGET, size_t upload_budget = DEFAULT_UPLOAD_BUDGET);
+	TextureStreamer(const TextureStreamer &)            = delete;
+	TextureStreamer &operator=(const TextureStreamer &) = delete;
+	~TextureStreamer();
+
+	// p_levels holds every level, largest first. The tail levels are recorded into batch.
+	void   add_image(sg::Image &image, const ImageMetaInfo &meta, const uint8_t *p_levels, UploadBatch &batch);
+	// Keep the memory p_levels points to alive, e.g. a mapped pack.
+	void   hold_source(std::shared_ptr<const void> p_source);
+	void   set_byte_budget(size_t byte_budget);
+	size_t get_resident_size() const;
+
+	// Return the textures whose image was reallocated. Their descriptor sets need to be rebuilt.
+	std::vector<sg::Texture *> update(sg::Scene &scene, sg::Camera &camera, float viewport_height);
+
+  private:
+	struct StreamedImage
+	{
+		sg::Image     *p_image;
+		ImageMetaInfo  meta;
+		const uint8_t *p_levels;
+		uint32_t       tail_level;
+		uint32_t       resident_level;        // Largest resident level.
+		uint32_t       wanted_level;
+		float          priority;              // Projected size in pixels of the largest mesh that samples the image.
+	};
+
+	struct RetiredResource
+	{
+		ImageResource resource;
+		uint32_t      frames_left;
+	};
+
+	void   release_retired_resources();
+	void   compute_wanted_levels(sg::Scene &scene, sg::Camera &camera, float viewport_height);
+	bool   fit_wanted_levels_in_budget();
+	void   make_resident(StreamedImage &streamed_image, uint32_t level, UploadBatch &batch);
+	size_t get_chain_size(const StreamedImage &streamed_image, uint32_t first_level) const;
+	size_t get_budget() const;
+
+	const Device                                     &device_;
+	uint32_t                                          retire_frames_;
+	size_t                                            byte_budget_;
+	size_t                                            upload_budget_;
+	size_t                                            resident_size_ = 0;
+	std::vector<StreamedImage>                        streamed_images_;
+	std::unordered_map<const ImageResource *, size_t> resource_to_image_;        // sg::Image resource -> streamed_images_ index
+	std::vector<RetiredResource>                      retired_resources_;
+	std::vector<std::shared_ptr<const void>>          p_sources_;
+};
+
+}        // namespace W3D